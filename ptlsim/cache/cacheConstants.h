@@ -42,7 +42,6 @@ namespace Memory{
 	};
 
 	const int REQUEST_POOL_SIZE = 1024;
-	const double REQUEST_POOL_LOW_RATIO = 0.1;
 
 	/* CPU Controller */
 	const int CPU_CONT_PENDING_REQ_SIZE = 128;
@@ -108,32 +108,32 @@ CacheController::CacheController(W8 coreid, const char *name,
 
 CacheController::~CacheController()
 {
+    delete cacheLines_;
 }
 
 CacheQueueEntry* CacheController::find_dependency(MemoryRequest *request)
 {
 	W64 requestLineAddress = get_line_address(request);
 
-	CacheQueueEntry* queueEntry;
-	foreach_list_mutable(pendingRequests_.list(), queueEntry, entry,
-			prevEntry) {
+	/* Index keeps entries of a line in the same order as pendingRequests_ */
+	for(int idx = pendingIndex_.first(requestLineAddress); idx >= 0;
+			idx = pendingIndex_.next(idx)) {
+		CacheQueueEntry* queueEntry = &pendingRequests_[idx];
 
 		if(request == queueEntry->request || queueEntry->annuled)
 			continue;
 
-		if(get_line_address(queueEntry->request) == requestLineAddress) {
-			// Found an entry with same line address, check if other
-			// entry also depends on this entry or not and to
-			// maintain a chain of dependent entries, return the
-			// last entry in the chain
-			while(queueEntry->depends >= 0) {
-                if(pendingRequests_[queueEntry->depends].annuled)
-                    break;
-				queueEntry = &pendingRequests_[queueEntry->depends];
-            }
-
-			return queueEntry;
+		// Found an entry with same line address, check if other
+		// entry also depends on this entry or not and to
+		// maintain a chain of dependent entries, return the
+		// last entry in the chain
+		while(queueEntry->depends >= 0) {
+			if(pendingRequests_[queueEntry->depends].annuled)
+				break;
+			queueEntry = &pendingRequests_[queueEntry->depends];
 		}
+
+		return queueEntry;
 	}
 	return NULL;
 }
@@ -196,6 +196,7 @@ bool CacheController::handle_interconnect_cb(void *arg)
 		}
 
 		queueEntry->request = msg->request;
+		pendingIndex_.add(queueEntry->idx, get_line_address(msg->request));
 		queueEntry->sender = sender;
 		queueEntry->source = (Controller*)msg->origin;
 		queueEntry->dest = (Controller*)msg->dest;
@@ -311,6 +312,8 @@ bool CacheController::handle_interconnect_cb(void *arg)
 					}
 
 					newEntry->request = msg->request;
+					pendingIndex_.add(newEntry->idx,
+							get_line_address(msg->request));
 					newEntry->sender = sender;
 					newEntry->source = (Controller*)msg->origin;
 					newEntry->dest = (Controller*)msg->dest;
@@ -387,6 +390,52 @@ int CacheController::access_fast_path(Interconnect *interconnect,
 	return -1;
 }
 
+/**
+ * @brief Functional warming of this cache, no timing or events
+ *
+ * @param coreid Core that made the access
+ * @param physaddr Physical address of the access
+ * @param type Read, write or write-back from an upper cache
+ * @param is_icache Access is an instruction fetch
+ *
+ * @return false, these caches don't track sharing
+ */
+bool CacheController::warm(W8 coreid, W64 physaddr, OP_TYPE type,
+		bool is_icache)
+{
+	if(type == MEMORY_OP_EVICT)
+		return false;
+
+	CacheLine *line = cacheLines_->probe(physaddr);
+	bool write = (type != MEMORY_OP_READ);
+
+	/* Misses fill from below, write-through caches pass writes on */
+	if((!line && type != MEMORY_OP_UPDATE) || (write && !wt_disabled_)) {
+		if(lowerInterconnect_)
+			lowerInterconnect_->warm(this, coreid, physaddr, type,
+					is_icache);
+	}
+
+	if(!line) {
+		W64 oldTag = InvalidTag<W64>::INVALID;
+		line = cacheLines_->insert(physaddr, oldTag);
+
+		if(oldTag != InvalidTag<W64>::INVALID && wt_disabled_ &&
+				line->state == LINE_MODIFIED && lowerInterconnect_) {
+			lowerInterconnect_->warm(this, coreid, oldTag,
+					MEMORY_OP_UPDATE, false);
+		}
+
+		line->state = LINE_VALID;
+		line->init(cacheLines_->tagOf(physaddr));
+	}
+
+	if(write && wt_disabled_)
+		line->state = LINE_MODIFIED;
+
+	return false;
+}
+
 void CacheController::register_interconnect(Interconnect *interconnect,
         int type)
 {
@@ -761,8 +810,8 @@ bool CacheController::clear_entry_cb(void *arg)
 			marss_add_event(&cacheAccess_, 1, depEntry);
 		}
 
-		queueEntry->request->decRefCounter();
 		ADD_HISTORY_REM(queueEntry->request);
+		queueEntry->request->decRefCounter();
 		if(!queueEntry->annuled) {
 			if(pendingRequests_.list().count == 0) {
 				memdebug("Removing from pending request queue " <<
@@ -779,6 +828,7 @@ bool CacheController::clear_entry_cb(void *arg)
 					tmpEntry->dependsAddr = -1;
 				}
             }
+			pendingIndex_.remove(queueEntry->idx);
 			pendingRequests_.free(queueEntry);
 		}
 
@@ -810,6 +860,12 @@ void CacheController::annul_request(MemoryRequest *request)
 bool CacheController::send_update_message(CacheQueueEntry *queueEntry,
 		W64 tag)
 {
+	CacheQueueEntry *new_entry = pendingRequests_.alloc();
+	if(new_entry == NULL)
+		return false;
+
+	assert(new_entry);
+
 	MemoryRequest *request = memoryHierarchy_->get_free_request(
             queueEntry->request->get_coreid());
 	assert(request);
@@ -820,18 +876,13 @@ bool CacheController::send_update_message(CacheQueueEntry *queueEntry,
 		request->set_physical_address(tag);
 	}
 
-	CacheQueueEntry *new_entry = pendingRequests_.alloc();
-	if(new_entry == NULL)
-		return false;
-
-	assert(new_entry);
-
 	// set full flag if buffer is full
 	if(pendingRequests_.isFull()) {
 		memoryHierarchy_->set_controller_full(this, true);
 	}
 
 	new_entry->request = request;
+	pendingIndex_.add(new_entry->idx, get_line_address(request));
 	new_entry->sender = NULL;
 	new_entry->sendTo = lowerInterconnect_;
 	request->incRefCounter();
@@ -872,6 +923,7 @@ void CacheController::do_prefetch(MemoryRequest *request, int additional_delay)
 	assert(new_entry);
 
 	new_entry->request = new_request;
+	pendingIndex_.add(new_entry->idx, get_line_address(new_request));
 	new_entry->sender = NULL;
 	new_entry->sendTo = lowerInterconnect_;
 	new_entry->prefetch = true;
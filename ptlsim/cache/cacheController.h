@@ -35,6 +35,7 @@
 #include <cacheConstants.h>
 #include <memoryStats.h>
 #include <cacheLines.h>
+#include <pendingRequestIndex.h>
 
 #include <statsBuilder.h>
 
@@ -148,6 +149,9 @@ class CacheController : public Controller
 		// A Queue conatining pending requests for this cache
 		FixStateList<CacheQueueEntry, 128> pendingRequests_;
 
+		// Line address index of pendingRequests_
+		PendingRequestIndex<128> pendingIndex_;
+
 		// Flag to indicate if this cache is lowest private
 		// level cache
 		bool isLowestPrivate_;
@@ -203,6 +207,7 @@ class CacheController : public Controller
 		bool handle_interconnect_cb(void *arg);
 		int access_fast_path(Interconnect *interconnect,
 				MemoryRequest *request);
+		bool warm(W8 coreid, W64 physaddr, OP_TYPE type, bool is_icache);
 
 		void register_interconnect(Interconnect *interconnect, int type);
 		void register_upper_interconnect(Interconnect *interconnect);
@@ -0,0 +1,268 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <globals.h>
+#include <ptlsim.h>
+#include <memoryHierarchy.h>
+#include <cacheLines.h>
+
+using namespace Memory;
+
+/*
+ * Tags of a set are kept as low and high 32 bit halves and compared a vector
+ * of ways at a time, eight ways per compare with AVX2 and four with SSE2.
+ */
+#ifdef __AVX2__
+#define TAG_CHUNK_WAYS 8
+typedef W32 vec_tags __attribute__ ((vector_size(32)));
+typedef float vec_tags_ps __attribute__ ((vector_size(32)));
+
+static inline vec_tags x86_dup_tag(W32 tag) { vec_tags v = {tag, tag, tag, tag, tag, tag, tag, tag}; return v; }
+static inline W64 x86_tag_movmsk(vec_tags eq) { return __builtin_ia32_movmskps256((vec_tags_ps)eq); }
+#else
+#define TAG_CHUNK_WAYS 4
+typedef W32 vec_tags __attribute__ ((vector_size(16)));
+
+static inline vec_tags x86_dup_tag(W32 tag) { vec_tags v = {tag, tag, tag, tag}; return v; }
+static inline W64 x86_tag_movmsk(vec_tags eq) { return __builtin_ia32_movmskps((vec4f)eq); }
+#endif
+
+/* Tag storage of every set starts at this alignment */
+#define TAG_ALIGN 64
+
+CacheLines::CacheLines(int setCount, int wayCount, int lineSize,
+        int latency, int readPorts, int writePorts)
+    : setCount_(setCount)
+    , wayCount_(wayCount)
+    , lineSize_(lineSize)
+    , latency_(latency)
+    , readPorts_(readPorts)
+    , writePorts_(writePorts)
+{
+    assert(setCount > 0);
+    assert(inrange(wayCount, 1, 64));
+    assert(lineSize > 0 && (lineSize & (lineSize - 1)) == 0);
+
+    /* Same set and tag bits as AssociativeArray, which rounds the number of
+     * sets down to a power of two when indexing */
+    lineBits_ = x86_bsr32(lineSize);
+    setMask_ = bitmask(x86_bsr32(setCount));
+
+    chunkCount_ = ceil(wayCount, TAG_CHUNK_WAYS) / TAG_CHUNK_WAYS;
+    paddedWays_ = chunkCount_ * TAG_CHUNK_WAYS;
+
+    int tagCount = setCount * paddedWays_ * 2;
+    tagsBuf_ = new W32[tagCount + (TAG_ALIGN / sizeof(W32))];
+    tags_ = (W32*)ceil((Waddr)tagsBuf_, TAG_ALIGN);
+
+    evictMaps_ = new W64[setCount];
+    allWays_ = bitmask(wayCount);
+
+    lines_ = new CacheLine[setCount * wayCount];
+
+    lastAccessCycle_ = 0;
+    readPortUsed_ = 0;
+    writePortUsed_ = 0;
+
+    reset();
+}
+
+CacheLines::~CacheLines()
+{
+    delete[] tagsBuf_;
+    delete[] evictMaps_;
+    delete[] lines_;
+}
+
+void CacheLines::reset()
+{
+    foreach(i, setCount_) {
+        W32 *tags = set_tags(i);
+        foreach(j, paddedWays_ * 2) {
+            tags[j] = W32(-1);
+        }
+        evictMaps_[i] = 0;
+    }
+
+    foreach(i, setCount_ * wayCount_) {
+        lines_[i].reset();
+    }
+}
+
+void CacheLines::init()
+{
+    foreach(i, setCount_ * wayCount_) {
+        lines_[i].init(-1);
+    }
+}
+
+W64 CacheLines::tagOf(W64 address)
+{
+    return floor(address, lineSize_);
+}
+
+W64 CacheLines::get_tag(int set, int way) const
+{
+    W32 *tags = set_tags(set);
+    return (W64(tags[paddedWays_ + way]) << 32) | tags[way];
+}
+
+void CacheLines::set_tag(int set, int way, W64 tag)
+{
+    W32 *tags = set_tags(set);
+    tags[way] = LO32(tag);
+    tags[paddedWays_ + way] = HI32(tag);
+}
+
+/**
+ * @brief Compare given tag against all ways of a set
+ *
+ * Padding ways hold an all ones tag which no line address can match.
+ *
+ * @return Bit mask of ways holding the tag, at most one bit is set
+ */
+W64 CacheLines::match_mask(int set, W64 tag) const
+{
+    const vec_tags *lo = (const vec_tags*)set_tags(set);
+    const vec_tags *hi = lo + chunkCount_;
+    vec_tags targetLo = x86_dup_tag(LO32(tag));
+    vec_tags targetHi = x86_dup_tag(HI32(tag));
+    W64 mask = 0;
+
+    foreach(i, chunkCount_) {
+        vec_tags eq = (lo[i] == targetLo) & (hi[i] == targetHi);
+        mask |= x86_tag_movmsk(eq) << (i * TAG_CHUNK_WAYS);
+    }
+    return mask;
+}
+
+int CacheLines::match(int set, W64 tag) const
+{
+    W64 mask = match_mask(set, tag);
+
+    /* Way number or -1 without a data dependent branch, bit 63 is only
+     * found when nothing matched */
+    return int(x86_bsf64(mask | (1ULL << 63))) | -int(mask == 0);
+}
+
+int CacheLines::select(int set, W64 tag, W64& oldTag)
+{
+    W64 mask = match_mask(set, tag);
+    W64 evictMap = evictMaps_[set];
+    int way;
+
+    /* Branch on the compare result itself, it resolves a few cycles earlier
+     * than the way number on a miss */
+    if(mask) {
+        way = x86_bsf64(mask);
+    } else {
+        if(evictMap == allWays_) {
+            way = 0;
+            evictMap = 0;
+        } else {
+            way = x86_bsf64(~evictMap & allWays_);
+        }
+        oldTag = get_tag(set, way);
+        set_tag(set, way, tag);
+    }
+
+    evictMap |= (W64(1) << way);
+    if(evictMap == allWays_)
+        evictMap = (W64(1) << way);
+    evictMaps_[set] = evictMap;
+
+    return way;
+}
+
+void CacheLines::invalidate_way(int set, int way)
+{
+    set_tag(set, way, InvalidTag<W64>::INVALID);
+    evictMaps_[set] &= ~(W64(1) << way);
+    lines_[set * wayCount_ + way].reset();
+}
+
+// Return valid line if found, else return NULL
+CacheLine* CacheLines::probe(W64 address)
+{
+    int set = setOf(address);
+    W64 mask = match_mask(set, floor(address, lineSize_));
+
+    if(!mask)
+        return NULL;
+
+    evictMaps_[set] |= mask;
+    return &lines_[set * wayCount_ + x86_bsf64(mask)];
+}
+
+CacheLine* CacheLines::insert(W64 address, W64& oldTag)
+{
+    int set = setOf(address);
+    int way = select(set, floor(address, lineSize_), oldTag);
+
+    return &lines_[set * wayCount_ + way];
+}
+
+int CacheLines::invalidate(W64 address)
+{
+    int set = setOf(address);
+    int way = match(set, floor(address, lineSize_));
+
+    if(way < 0)
+        return -1;
+
+    invalidate_way(set, way);
+    return way;
+}
+
+CacheLine* CacheLines::probe(MemoryRequest *request)
+{
+    return probe(request->get_physical_address());
+}
+
+CacheLine* CacheLines::insert(MemoryRequest *request, W64& oldTag)
+{
+    return insert(request->get_physical_address(), oldTag);
+}
+
+int CacheLines::invalidate(MemoryRequest *request)
+{
+    return invalidate(request->get_physical_address());
+}
+
+bool CacheLines::get_port(MemoryRequest *request)
+{
+    bool rc = false;
+
+    if(lastAccessCycle_ < sim_cycle) {
+        lastAccessCycle_ = sim_cycle;
+        writePortUsed_ = 0;
+        readPortUsed_ = 0;
+    }
+
+    switch(request->get_type()) {
+        case MEMORY_OP_READ:
+            rc = (readPortUsed_ < readPorts_) ? ++readPortUsed_ : 0;
+            break;
+        case MEMORY_OP_WRITE:
+        case MEMORY_OP_UPDATE:
+        case MEMORY_OP_EVICT:
+            rc = (writePortUsed_ < writePorts_) ? ++writePortUsed_ : 0;
+            break;
+        default:
+            memdebug("Unknown type of memory request: " <<
+                    request->get_type() << endl);
+            assert(0);
+    };
+    return rc;
+}
+
+void CacheLines::print(ostream& os) const
+{
+    foreach(i, setCount_ * wayCount_) {
+        os << lines_[i];
+    }
+}
@@ -74,6 +74,7 @@ namespace Memory {
     struct CacheLinesBase
     {
         public:
+            virtual ~CacheLinesBase() {}
             virtual void init()=0;
             virtual W64 tagOf(W64 address)=0;
             virtual int latency() const =0;
@@ -81,6 +82,8 @@ namespace Memory {
             virtual CacheLine* insert(MemoryRequest *request,
                     W64& oldTag)=0;
             virtual int invalidate(MemoryRequest *request)=0;
+            virtual CacheLine* probe(W64 address)=0;
+            virtual CacheLine* insert(W64 address, W64& oldTag)=0;
             virtual bool get_port(MemoryRequest *request)=0;
             virtual void print(ostream& os) const =0;
             virtual int get_line_bits() const=0;
@@ -91,42 +94,87 @@ namespace Memory {
 			virtual int get_line_size() const=0;
     };
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        class CacheLines : public CacheLinesBase,
-        public AssociativeArray<W64, CacheLine, SET_COUNT,
-        WAY_COUNT, LINE_SIZE>
+    /**
+     * @brief Set associative array of CacheLine with geometry set at runtime
+     *
+     * Tags of a set are kept in one cache line aligned block, split in
+     * arrays of low and high 32 bits so a whole vector of ways is compared at
+     * once (eight with AVX2, four with SSE2). Replacement is the same pseudo-LRU as FullyAssociativeTags
+     * uses, so a cache behaves exactly like the AssociativeArray it replaces.
+     */
+    class CacheLines : public CacheLinesBase
     {
         private:
+            int setCount_;
+            int wayCount_;
+            int lineSize_;
+            int latency_;
+
+            int lineBits_;
+            W64 setMask_;
+
+            /* Ways rounded up to a full vector of 32 bit tag halves */
+            int paddedWays_;
+            int chunkCount_;
+
+            /* Per set: paddedWays_ low halves then paddedWays_ high halves */
+            W32 *tags_;
+            W32 *tagsBuf_;
+
+            /* Per set most recently used bits, as in FullyAssociativeTags */
+            W64 *evictMaps_;
+            W64 allWays_;
+
+            CacheLine *lines_;
+
             int readPortUsed_;
             int writePortUsed_;
             int readPorts_;
             int writePorts_;
             W64 lastAccessCycle_;
 
+            int setOf(W64 address) const {
+                return (address >> lineBits_) & setMask_;
+            }
+
+            W32* set_tags(int set) const {
+                return tags_ + (set * paddedWays_ * 2);
+            }
+
+            W64 get_tag(int set, int way) const;
+            void set_tag(int set, int way, W64 tag);
+
+            W64 match_mask(int set, W64 tag) const;
+            int match(int set, W64 tag) const;
+            int select(int set, W64 tag, W64& oldTag);
+            void invalidate_way(int set, int way);
+
         public:
-            typedef AssociativeArray<W64, CacheLine, SET_COUNT,
-                    WAY_COUNT, LINE_SIZE> base_t;
-            typedef FullyAssociativeArray<W64, CacheLine, WAY_COUNT,
-                    NullAssociativeArrayStatisticsCollector<W64,
-                    CacheLine> > Set;
+            CacheLines(int setCount, int wayCount, int lineSize,
+                    int latency, int readPorts, int writePorts);
+            ~CacheLines();
 
-            CacheLines(int readPorts, int writePorts);
             void init();
+            void reset();
             W64 tagOf(W64 address);
-            int latency() const { return LATENCY; };
+            int latency() const { return latency_; };
             CacheLine* probe(MemoryRequest *request);
             CacheLine* insert(MemoryRequest *request, W64& oldTag);
             int invalidate(MemoryRequest *request);
             bool get_port(MemoryRequest *request);
             void print(ostream& os) const;
 
+            CacheLine* probe(W64 address);
+            CacheLine* insert(W64 address, W64& oldTag);
+            int invalidate(W64 address);
+
 			/**
 			 * @brief Get Cache Size
 			 *
 			 * @return Size of Cache in bytes
 			 */
 			int get_size() const {
-				return (SET_COUNT * WAY_COUNT * LINE_SIZE);
+				return (setCount_ * wayCount_ * lineSize_);
 			}
 
 			/**
@@ -135,7 +183,7 @@ namespace Memory {
 			 * @return Sets in Cache
 			 */
 			int get_set_count() const {
-				return SET_COUNT;
+				return setCount_;
 			}
 
 			/**
@@ -144,7 +192,7 @@ namespace Memory {
 			 * @return Number of Cache Lines in one Set
 			 */
 			int get_way_count() const {
-				return WAY_COUNT;
+				return wayCount_;
 			}
 
 			/**
@@ -153,128 +201,31 @@ namespace Memory {
 			 * @return Number of bytes in Cache Line
 			 */
 			int get_line_size() const {
-				return LINE_SIZE;
+				return lineSize_;
 			}
 
             int get_line_bits() const {
-                return log2(LINE_SIZE);
+                return lineBits_;
             }
 
             int get_access_latency() const {
-                return LATENCY;
+                return latency_;
             }
     };
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        static inline ostream& operator <<(ostream& os, const
-                CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>&
-                cacheLines)
-        {
-            cacheLines.print(os);
-            return os;
-        }
-
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        static inline ostream& operator ,(ostream& os, const
-                CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>&
-                cacheLines)
-        {
-            cacheLines.print(os);
-            return os;
-        }
-
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::CacheLines(int readPorts, int writePorts) :
-            readPorts_(readPorts)
-            , writePorts_(writePorts)
+    static inline ostream& operator <<(ostream& os,
+            const CacheLines& cacheLines)
     {
-        lastAccessCycle_ = 0;
-        readPortUsed_ = 0;
-        writePortUsed_ = 0;
+        cacheLines.print(os);
+        return os;
     }
 
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        void CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::init()
-        {
-            foreach(i, SET_COUNT) {
-                Set &set = base_t::sets[i];
-                foreach(j, WAY_COUNT) {
-                    set.data[j].init(-1);
-                }
-            }
-        }
-
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        W64 CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::tagOf(W64 address)
-        {
-            return floor(address, LINE_SIZE);
-        }
-
-
-    // Return true if valid line is found, else return false
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        CacheLine* CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::probe(MemoryRequest *request)
-        {
-            W64 physAddress = request->get_physical_address();
-            CacheLine *line = base_t::probe(physAddress);
-
-            return line;
-        }
-
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        CacheLine* CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::insert(MemoryRequest *request, W64& oldTag)
-        {
-            W64 physAddress = request->get_physical_address();
-            CacheLine *line = base_t::select(physAddress, oldTag);
-
-            return line;
-        }
-
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        int CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::invalidate(MemoryRequest *request)
-        {
-            return base_t::invalidate(request->get_physical_address());
-        }
-
-
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        bool CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::get_port(MemoryRequest *request)
-        {
-            bool rc = false;
-
-            if(lastAccessCycle_ < sim_cycle) {
-                lastAccessCycle_ = sim_cycle;
-                writePortUsed_ = 0;
-                readPortUsed_ = 0;
-            }
-
-            switch(request->get_type()) {
-                case MEMORY_OP_READ:
-                    rc = (readPortUsed_ < readPorts_) ? ++readPortUsed_ : 0;
-                    break;
-                case MEMORY_OP_WRITE:
-                case MEMORY_OP_UPDATE:
-                case MEMORY_OP_EVICT:
-                    rc = (writePortUsed_ < writePorts_) ? ++writePortUsed_ : 0;
-                    break;
-                default:
-                    memdebug("Unknown type of memory request: " <<
-                            request->get_type() << endl);
-                    assert(0);
-            };
-            return rc;
-        }
-
-    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        void CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::print(ostream& os) const
-        {
-            foreach(i, SET_COUNT) {
-                const Set &set = base_t::sets[i];
-                foreach(j, WAY_COUNT) {
-                    os << set.data[j];
-                }
-            }
-        }
+    static inline ostream& operator ,(ostream& os,
+            const CacheLines& cacheLines)
+    {
+        cacheLines.print(os);
+        return os;
+    }
 
 };
 
@@ -64,6 +64,14 @@ namespace Memory {
                         Message &message)                                  = 0;
                 virtual bool is_line_valid(CacheLine *line)                = 0;
                 virtual void invalidate_line(CacheLine *line)              = 0;
+                virtual bool is_line_dirty(CacheLine *line)                = 0;
+                /* Set the state of a line after a functional warming access,
+                 * true if the line is shared afterwards */
+                virtual bool warm_line(CacheLine *line, OP_TYPE type,
+                        bool shared)                                       = 0;
+                /* Evict or downgrade a line for another core's warming access,
+                 * true if its dirty data has to be written back */
+                virtual bool warm_snoop(CacheLine *line, OP_TYPE type)     = 0;
                 virtual void handle_response(CacheQueueEntry *entry,
                         Message &message) = 0;
 				virtual void dump_configuration(YAML::Emitter &out) const = 0;
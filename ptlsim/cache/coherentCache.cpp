@@ -92,6 +92,7 @@ CacheController::CacheController(W8 coreid, const char *name,
 
 CacheController::~CacheController()
 {
+    delete cacheLines_;
     delete new_stats;
 }
 
@@ -99,25 +100,24 @@ CacheQueueEntry* CacheController::find_dependency(MemoryRequest *request)
 {
     W64 requestLineAddress = get_line_address(request);
 
-    CacheQueueEntry* queueEntry;
-    foreach_list_mutable(pendingRequests_.list(), queueEntry, entry,
-            prevEntry) {
+    /* Index keeps entries of a line in the same order as pendingRequests_ */
+    for(int idx = pendingIndex_.first(requestLineAddress); idx >= 0;
+            idx = pendingIndex_.next(idx)) {
+        CacheQueueEntry* queueEntry = &pendingRequests_[idx];
 
         if(request == queueEntry->request || queueEntry->annuled)
             continue;
 
-        if(get_line_address(queueEntry->request) == requestLineAddress) {
-            /*
-             * Found an entry with same line address, check if other
-             * entry also depends on this entry or not and to
-             * maintain a chain of dependent entries, return the
-             * last entry in the chain
-             */
-            while(queueEntry->depends >= 0)
-                queueEntry = &pendingRequests_[queueEntry->depends];
+        /*
+         * Found an entry with same line address, check if other
+         * entry also depends on this entry or not and to
+         * maintain a chain of dependent entries, return the
+         * last entry in the chain
+         */
+        while(queueEntry->depends >= 0)
+            queueEntry = &pendingRequests_[queueEntry->depends];
 
-            return queueEntry;
-        }
+        return queueEntry;
     }
     return NULL;
 }
@@ -178,6 +178,7 @@ bool CacheController::handle_upper_interconnect(Message &message)
     }
 
     queueEntry->request = message.request;
+    pendingIndex_.add(queueEntry->idx, get_line_address(message.request));
     queueEntry->sender  = (Interconnect*)message.sender;
     queueEntry->isSnoop = false;
     queueEntry->m_arg   = message.arg;
@@ -243,6 +244,7 @@ bool CacheController::handle_lower_interconnect(Message &message)
         CacheQueueEntry *newEntry = pendingRequests_.alloc();
         assert(newEntry);
         newEntry->request = message.request;
+        pendingIndex_.add(newEntry->idx, get_line_address(message.request));
         newEntry->isSnoop = true;
         newEntry->sender  = (Interconnect*)message.sender;
         newEntry->source  = (Controller*)message.origin;
@@ -263,6 +265,8 @@ bool CacheController::handle_lower_interconnect(Message &message)
                 assert(evictEntry);
 
                 evictEntry->request = message.request;
+                pendingIndex_.add(evictEntry->idx,
+                        get_line_address(message.request));
                 evictEntry->request->incRefCounter();
                 evictEntry->isSnoop = true;
                 evictEntry->m_arg   = message.arg;
@@ -305,6 +309,7 @@ void CacheController::send_message(CacheQueueEntry *queueEntry,
     }
 
     evictEntry->request = request;
+    pendingIndex_.add(evictEntry->idx, get_line_address(request));
     evictEntry->sender  = NULL;
     evictEntry->sendTo  = interconn;
     evictEntry->dest    = queueEntry->dest;
@@ -442,6 +447,113 @@ int CacheController::access_fast_path(Interconnect *interconnect,
     return -1;
 }
 
+/**
+ * @brief Functional warming of this cache, no timing or events
+ *
+ * @param coreid Core that made the access
+ * @param physaddr Physical address of the access
+ * @param type Read, write or write-back from an upper cache
+ * @param is_icache Access is an instruction fetch
+ *
+ * A miss fills the line from the lower levels first, shared if the
+ * directory reports copies in other cores. Writes that hit go down to the
+ * lowest private cache, like they do in timing mode, where the directory
+ * invalidates the other copies. A victim is evicted from the caches above
+ * and written back to the lower cache if dirty.
+ *
+ * @return true if the line is shared with other cores
+ */
+bool CacheController::warm(W8 coreid, W64 physaddr, OP_TYPE type,
+        bool is_icache)
+{
+    if (type == MEMORY_OP_EVICT)
+        return false;
+
+    CacheLine *line = cacheLines_->probe(physaddr);
+    bool shared = false;
+
+    if (line && is_line_valid(line)) {
+        if (type == MEMORY_OP_WRITE) {
+            if (!is_lowest_private() && lowerCont_)
+                lowerCont_->warm(coreid, physaddr, type, is_icache);
+            else if (is_lowest_private() && directory_)
+                directory_->warm(coreid, physaddr, type, is_icache);
+        }
+
+        return coherence_logic_->warm_line(line, type, false);
+    }
+
+    if (type != MEMORY_OP_UPDATE) {
+        if (is_lowest_private() && directory_)
+            shared = directory_->warm(coreid, physaddr, type, is_icache);
+        if (lowerCont_ && lowerCont_ != directory_) {
+            bool lower_shared = lowerCont_->warm(coreid, physaddr, type,
+                    is_icache);
+            if (!is_lowest_private())
+                shared = lower_shared;
+        }
+    }
+
+    W64 oldTag = InvalidTag<W64>::INVALID;
+    line = cacheLines_->insert(physaddr, oldTag);
+
+    if (oldTag != InvalidTag<W64>::INVALID && is_line_valid(line)) {
+        bool dirty = warm_snoop_upper(oldTag, MEMORY_OP_EVICT);
+
+        dirty |= coherence_logic_->is_line_dirty(line);
+        if (dirty && lowerCont_)
+            lowerCont_->warm(coreid, oldTag, MEMORY_OP_UPDATE, false);
+        if (is_lowest_private() && directory_)
+            directory_->warm(coreid, oldTag, MEMORY_OP_EVICT, false);
+    }
+
+    line->reset();
+    line->init(cacheLines_->tagOf(physaddr));
+    return coherence_logic_->warm_line(line, type, shared);
+}
+
+/**
+ * @brief Pass a warming evict or downgrade to the caches above this one
+ *
+ * @param physaddr Physical address of the line
+ * @param type Evict or read
+ *
+ * @return true if the line was dirty in an upper cache
+ */
+bool CacheController::warm_snoop_upper(W64 physaddr, OP_TYPE type)
+{
+    bool dirty = false;
+
+    if (upperInterconnect_)
+        dirty |= upperInterconnect_->warm_snoop(this, physaddr, type);
+    if (upperInterconnect2_)
+        dirty |= upperInterconnect2_->warm_snoop(this, physaddr, type);
+
+    return dirty;
+}
+
+/**
+ * @brief Evict or downgrade a line for another core's warming access
+ *
+ * @param physaddr Physical address of the line
+ * @param type Evict or read
+ *
+ * Called by the directory on the lowest private cache, which passes it on
+ * to the caches above.
+ *
+ * @return true if dirty data of the line has to be written back
+ */
+bool CacheController::warm_snoop(W64 physaddr, OP_TYPE type)
+{
+    bool dirty = warm_snoop_upper(physaddr, type);
+    CacheLine *line = cacheLines_->probe(physaddr);
+
+    if (line && is_line_valid(line))
+        dirty |= coherence_logic_->warm_snoop(line, type);
+
+    return dirty;
+}
+
 void CacheController::print_map(ostream& os)
 {
     os << "Cache-Controller: " << get_name() << endl;
@@ -804,8 +916,8 @@ bool CacheController::clear_entry_cb(void *arg)
             marss_add_event(&cacheAccess_, 1, depEntry);
         }
 
-        queueEntry->request->decRefCounter();
         ADD_HISTORY_REM(queueEntry->request);
+        queueEntry->request->decRefCounter();
         if(!queueEntry->annuled) {
             if(pendingRequests_.list().count == 0) {
                 memdebug("Removing from pending request queue " <<
@@ -813,6 +925,7 @@ bool CacheController::clear_entry_cb(void *arg)
                         queueEntry << endl);
             }
 
+            pendingIndex_.remove(queueEntry->idx);
             pendingRequests_.free(queueEntry);
         }
 
@@ -852,6 +965,7 @@ void CacheController::annul_request(MemoryRequest *request)
                 pendingRequests_[queueEntry->waitFor].depends = -1;
             }
 
+            pendingIndex_.remove(queueEntry->idx);
             pendingRequests_.free(queueEntry);
             ADD_HISTORY_REM(queueEntry->request);
 
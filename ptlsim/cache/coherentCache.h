@@ -36,6 +36,7 @@
 #include <memoryStats.h>
 #include <statsBuilder.h>
 #include <cacheLines.h>
+#include <pendingRequestIndex.h>
 
 namespace Memory {
 
@@ -175,6 +176,9 @@ namespace Memory {
                 // A Queue conatining pending requests for this cache
                 FixStateList<CacheQueueEntry, 256> pendingRequests_;
 
+                // Line address index of pendingRequests_
+                PendingRequestIndex<256> pendingIndex_;
+
                 // Flag to indicate if this cache is lowest private
                 // level cache
                 bool isLowestPrivate_;
@@ -229,6 +233,8 @@ namespace Memory {
 
                 void get_directory(Interconnect *interconn);
 
+                bool warm_snoop_upper(W64 physaddr, OP_TYPE type);
+
             public:
                 CacheController(W8 coreid, const char *name,
                         MemoryHierarchy *memoryHierarchy, CacheType type);
@@ -236,6 +242,9 @@ namespace Memory {
                 bool handle_interconnect_cb(void *arg);
                 int access_fast_path(Interconnect *interconnect,
                         MemoryRequest *request);
+                bool warm(W8 coreid, W64 physaddr, OP_TYPE type,
+                        bool is_icache);
+                bool warm_snoop(W64 physaddr, OP_TYPE type);
                 void print_map(ostream& os);
 
                 void register_interconnect(Interconnect *interconnect, int type);
@@ -252,6 +261,14 @@ namespace Memory {
                     return isLowestPrivate_;
                 }
 
+                void set_directory(Controller *dir) {
+                    directory_ = dir;
+                }
+
+                CacheLine* probe_line(W64 physaddr) {
+                    return cacheLines_->probe(physaddr);
+                }
+
                 void print(ostream& os) const;
 
                 bool is_full(bool fromInterconnect = false) const {
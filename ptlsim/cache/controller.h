@@ -31,6 +31,7 @@
 #include <globals.h>
 #include <superstl.h>
 #include <memoryRequest.h>
+#include <hostProfile.h>
 
 namespace Memory {
 
@@ -100,6 +101,8 @@ class Controller
 
 			handle_interconnect_.connect(signal_mem_ptr \
 					(*this, &Controller::handle_interconnect_cb));
+			host_profile_event_type(handle_interconnect_, name,
+					"handle_interconnect");
 		}
 
         virtual ~Controller()
@@ -111,9 +114,34 @@ class Controller
         virtual void cycle() {}
 #endif
 
+        /*
+         * Used by idle cycle skipping: first cycle at which this controller
+         * has per-cycle work to do (-1 if it only reacts to events), and
+         * advancing its per-cycle state over cycles that are skipped.
+         */
+        virtual W64 get_next_cycle() { return W64(-1); }
+        virtual void skip_cycles(W64 cycles) {}
+
 		virtual bool handle_interconnect_cb(void* arg)=0;
 		virtual int access_fast_path(Interconnect *interconnect,
 				MemoryRequest *request) { return -1; };
+
+        /*
+         * Functional warming while QEMU fast-forwards: update tags and
+         * coherence state for an access of 'coreid' right away, without
+         * requests, events, timing or stats. Controllers without state
+         * worth warming ignore it. Returns true if other cores' caches
+         * still have the line after the access.
+         */
+        virtual bool warm(W8 coreid, W64 physaddr, OP_TYPE type,
+                bool is_icache) { return false; }
+
+        /*
+         * Apply a warming evict (invalidate) or read (downgrade) from the
+         * directory to this cache and the caches above it. Returns true if
+         * the line was dirty here.
+         */
+        virtual bool warm_snoop(W64 physaddr, OP_TYPE type) { return false; }
         virtual void register_interconnect(Interconnect* interconnect,
                 int conn_type)=0;
 		virtual void print_map(ostream& os)=0;
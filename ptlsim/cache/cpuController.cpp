@@ -95,7 +95,6 @@ void CPUController::annul_request(MemoryRequest *request)
 			entry_t, nextentry_t) {
 		if(entry->request->is_same(request)) {
 			entry->annuled = true;
-			entry->request->decRefCounter();
 
             if unlikely  (entry->depends >= 0) {
                 CPUControllerQueueEntry *depEntry = &pendingRequests_[entry->depends];
@@ -110,8 +109,10 @@ void CPUController::annul_request(MemoryRequest *request)
                 pendingRequests_[entry->waitFor].depends = -1;
             }
 
+			pendingIndex_.remove(entry->idx);
 			pendingRequests_.free(entry);
             ADD_HISTORY_REM(entry->request);
+			entry->request->decRefCounter();
 		}
 	}
 }
@@ -124,6 +125,7 @@ int CPUController::flush()
 		if(entry->annuled) continue;
 		entry->annuled = true;
 		entry->request->decRefCounter();
+		pendingIndex_.remove(entry->idx);
 		pendingRequests_.free(entry);
 	}
 	return 4;
@@ -198,6 +200,7 @@ int CPUController::access_fast_path(Interconnect *interconnect,
 	}
 
 	queueEntry->request = request;
+	pendingIndex_.add(queueEntry->idx, get_line_address(request));
 
 	if(dependentEntry &&
 			dependentEntry->request->get_type() == request->get_type()) {
@@ -232,6 +235,27 @@ int CPUController::access_fast_path(Interconnect *interconnect,
 	return -1;
 }
 
+/**
+ * @brief Warm the L1 caches of this CPU with an access, no timing
+ *
+ * @param coreid Core that made the access
+ * @param physaddr Physical address of the access
+ * @param type Read or write
+ * @param is_icache Access is an instruction fetch
+ *
+ * @return true if other cores' caches have the line
+ */
+bool CPUController::warm(W8 coreid, W64 physaddr, OP_TYPE type,
+		bool is_icache)
+{
+	Interconnect *interconnect = (is_icache) ? int_L1_i_ : int_L1_d_;
+
+	if likely (interconnect)
+		return interconnect->warm(this, coreid, physaddr, type, is_icache);
+
+	return false;
+}
+
 bool CPUController::is_cache_availabe(bool is_icache)
 {
 	assert(0);
@@ -243,28 +267,25 @@ CPUControllerQueueEntry* CPUController::find_dependency(
 {
 	W64 requestLineAddr = get_line_address(request);
 
-	CPUControllerQueueEntry* queueEntry;
-	foreach_list_mutable(pendingRequests_.list(), queueEntry, entry_t,
-			prev_t) {
-		assert(queueEntry);
+	/* Index keeps entries of a line in the same order as pendingRequests_ */
+	for(int idx = pendingIndex_.first(requestLineAddr); idx >= 0;
+			idx = pendingIndex_.next(idx)) {
+		CPUControllerQueueEntry* queueEntry = &pendingRequests_[idx];
 		if unlikely (request == queueEntry->request)
 			continue;
 
-		if(get_line_address(queueEntry->request) == requestLineAddr) {
-
-            /*
-             * The dependency is handled as chained, so all the
-             * entries maintain an index to their next dependent
-             * entry. Find the last entry of the chain which has
-             * the depends value set to -1 and return that entry
-             */
+        /*
+         * The dependency is handled as chained, so all the
+         * entries maintain an index to their next dependent
+         * entry. Find the last entry of the chain which has
+         * the depends value set to -1 and return that entry
+         */
 
-			CPUControllerQueueEntry *retEntry = queueEntry;
-			while(retEntry->depends >= 0) {
-				retEntry = &pendingRequests_[retEntry->depends];
-			}
-			return retEntry;
+		CPUControllerQueueEntry *retEntry = queueEntry;
+		while(retEntry->depends >= 0) {
+			retEntry = &pendingRequests_[retEntry->depends];
 		}
+		return retEntry;
 	}
 	return NULL;
 }
@@ -317,10 +338,12 @@ void CPUController::finalize_request(CPUControllerQueueEntry *queueEntry)
 
 	memdebug("Entry finalized..\n");
 
-	request->decRefCounter();
 	ADD_HISTORY_REM(request);
-    if(!queueEntry->annuled)
+	request->decRefCounter();
+    if(!queueEntry->annuled) {
+		pendingIndex_.remove(queueEntry->idx);
 		pendingRequests_.free(queueEntry);
+	}
 
     /*
      * now check if pendingRequests_ buffer has space left then
@@ -328,7 +351,7 @@ void CPUController::finalize_request(CPUControllerQueueEntry *queueEntry)
      */
 	if likely (!pendingRequests_.isFull()) {
 		memoryHierarchy_->set_controller_full(this, false);
-		N_STAT_UPDATE(stats.queueFull, ++, request->is_kernel());
+		N_STAT_UPDATE(stats.queueFull, ++, kernel_req);
 	}
 }
 
@@ -382,6 +405,7 @@ bool CPUController::queue_access_cb(void *arg)
 	}
 
 	queueEntry->request = request;
+	pendingIndex_.add(queueEntry->idx, get_line_address(request));
 
 	CPUControllerQueueEntry *dependentEntry = find_dependency(request);
 
@@ -431,6 +455,34 @@ void CPUController::clock()
 	}
 }
 
+/**
+ * @brief Get the cycle in which clock() will finalize a pending request
+ *
+ * Entries with non-positive cycles are waiting for a wakeup and will never
+ * reach zero by clocking alone.
+ */
+W64 CPUController::get_next_cycle()
+{
+	W64 next = W64(-1);
+	CPUControllerQueueEntry* queueEntry;
+	foreach_list_mutable(pendingRequests_.list(), queueEntry, entry_t,
+			prev_t) {
+		if(queueEntry->cycles > 0)
+			next = min(next, sim_cycle + queueEntry->cycles - 1);
+	}
+	return next;
+}
+
+void CPUController::skip_cycles(W64 cycles)
+{
+	CPUControllerQueueEntry* queueEntry;
+	foreach_list_mutable(pendingRequests_.list(), queueEntry, entry_t,
+			prev_t) {
+		assert(queueEntry->cycles <= 0 || W64(queueEntry->cycles) > cycles);
+		queueEntry->cycles -= cycles;
+	}
+}
+
 void CPUController::print(ostream& os) const
 {
 	os << "---CPU-Controller: "<< get_name()<< endl;
@@ -32,6 +32,7 @@
 #include <interconnect.h>
 #include <superstl.h>
 #include <memoryStats.h>
+#include <pendingRequestIndex.h>
 //#include <logic.h>
 
 namespace Memory {
@@ -57,12 +58,12 @@ struct CPUControllerQueueEntry : public FixStateListObject
 			os << "Free Request Entry";
 			return os;
 		}
-		os << "Request{", *request, "} ";
-        os << "idx[", idx, "] ";
-		os << "cycles[", cycles, "] ";
-		os << "depends[", depends, "] ";
-        os << "waitFor[", waitFor, "] ";
-		os << "annuled[", annuled, "] ";
+		os << "Request{" << *request << "} ";
+        os << "idx[" << idx << "] ";
+		os << "cycles[" << cycles << "] ";
+		os << "depends[" << depends << "] ";
+        os << "waitFor[" << waitFor << "] ";
+		os << "annuled[" << annuled << "] ";
 		os << endl;
 		return os;
 	}
@@ -88,7 +89,7 @@ struct CPUControllerBufferEntry : public FixStateListObject
 	void init() {}
 
 	ostream& print(ostream& os) const {
-		os << "lineAddress[", (void*)lineAddress, "] ";
+		os << "lineAddress[" << (void*)lineAddress << "] ";
 		return os;
 	}
 };
@@ -116,6 +117,7 @@ class CPUController : public Controller
 
 		FixStateList<CPUControllerQueueEntry, \
 			CPU_CONT_PENDING_REQ_SIZE> pendingRequests_;
+		PendingRequestIndex<CPU_CONT_PENDING_REQ_SIZE> pendingIndex_;
 		FixStateList<CPUControllerBufferEntry, \
 			CPU_CONT_ICACHE_BUF_SIZE> icacheBuffer_;
 
@@ -145,10 +147,15 @@ class CPUController : public Controller
 
 		int access_fast_path(Interconnect *interconnect,
 				MemoryRequest *request);
+		bool warm(W8 coreid, W64 physaddr, OP_TYPE type, bool is_icache);
 		void clock();
+		W64 get_next_cycle();
+		void skip_cycles(W64 cycles);
         void register_interconnect(Interconnect *interconnect, int type);
 		void register_interconnect_L1_d(Interconnect *interconnect);
 		void register_interconnect_L1_i(Interconnect *interconnect);
+		Interconnect* get_interconnect_L1_d() const { return int_L1_d_; }
+		Interconnect* get_interconnect_L1_i() const { return int_L1_i_; }
 		void print(ostream& os) const;
 		bool is_cache_availabe(bool is_icache);
 		void annul_request(MemoryRequest *request);
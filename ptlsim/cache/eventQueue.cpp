@@ -0,0 +1,245 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <eventQueue.h>
+
+using namespace Memory;
+
+#define EVENT_WHEEL_MASK (EVENT_WHEEL_SIZE - 1)
+
+EventQueue::EventQueue()
+    : freeEvents_(NULL)
+{
+    foreach(i, EVENT_WHEEL_SIZE) {
+        buckets_[i].head = NULL;
+        buckets_[i].tail = NULL;
+    }
+
+    reset();
+}
+
+EventQueue::~EventQueue()
+{
+    foreach(i, chunks_.count()) {
+        delete[] chunks_[i];
+    }
+    chunks_.clear();
+}
+
+/**
+ * @brief Get a free Event, growing the pool if all Events are in use
+ */
+Event* EventQueue::alloc()
+{
+    if unlikely (!freeEvents_) {
+        Event *chunk = new Event[EVENT_POOL_CHUNK];
+        chunks_.push(chunk);
+        foreach(i, EVENT_POOL_CHUNK) {
+            chunk[i].next_ = freeEvents_;
+            freeEvents_ = &chunk[i];
+        }
+    }
+
+    Event *event = freeEvents_;
+    freeEvents_ = event->next_;
+    event->init();
+    return event;
+}
+
+void EventQueue::free(Event *event)
+{
+    event->next_ = freeEvents_;
+    freeEvents_ = event;
+}
+
+void EventQueue::add_to_bucket(Event *event)
+{
+    Bucket &bucket = buckets_[event->clock_ & EVENT_WHEEL_MASK];
+
+    event->next_ = NULL;
+    if(bucket.tail)
+        bucket.tail->next_ = event;
+    else
+        bucket.head = event;
+    bucket.tail = event;
+    wheelCount_++;
+}
+
+/**
+ * @brief Add an Event that is set up with its clock
+ *
+ * Events whose clock has already passed are executed with the next
+ * cycle that is drained, same as the sorted queue used to do.
+ */
+void EventQueue::insert(Event *event)
+{
+    if unlikely (event->clock_ < wheelCycle_)
+        event->clock_ = wheelCycle_;
+
+    if likely (event->clock_ - wheelCycle_ < EVENT_WHEEL_SIZE) {
+        add_to_bucket(event);
+    } else {
+        event->seq_ = seq_++;
+        overflow_push(event);
+    }
+}
+
+/**
+ * @brief Move overflow Events that now fit into the wheel
+ *
+ * Overflow Events of a cycle are always older than the Events added directly
+ * to that cycle's bucket, because a cycle only becomes reachable from
+ * insert() after refill() has run for it.
+ */
+void EventQueue::refill()
+{
+    while(overflow_.count() &&
+            overflow_[0]->clock_ - wheelCycle_ < EVENT_WHEEL_SIZE) {
+        add_to_bucket(overflow_pop());
+    }
+}
+
+/**
+ * @brief Remove next Event that is due at or before given cycle
+ *
+ * @param cycle Current simulation cycle
+ *
+ * @return Event to execute or NULL if no more Events are due. Caller must
+ * free the returned Event after executing it.
+ */
+Event* EventQueue::pop(W64 cycle)
+{
+    while(wheelCycle_ <= cycle) {
+        Bucket &bucket = buckets_[wheelCycle_ & EVENT_WHEEL_MASK];
+
+        if(bucket.head) {
+            Event *event = bucket.head;
+            bucket.head = event->next_;
+            if(!bucket.head)
+                bucket.tail = NULL;
+            wheelCount_--;
+            return event;
+        }
+
+        if(wheelCount_ == 0) {
+            /* Nothing left in wheel, skip straight to next overflow Event
+             * or to the cycle after given cycle */
+            W64 next = cycle + 1;
+            if(overflow_.count() && overflow_[0]->clock_ < next)
+                next = overflow_[0]->clock_;
+            wheelCycle_ = max(wheelCycle_ + 1, next);
+        } else {
+            wheelCycle_++;
+        }
+
+        refill();
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Get clock of earliest pending Event, -1 if queue is empty
+ */
+W64 EventQueue::next_clock()
+{
+    if(wheelCount_) {
+        W64 clock = wheelCycle_;
+        while(!buckets_[clock & EVENT_WHEEL_MASK].head)
+            clock++;
+        return clock;
+    }
+
+    if(overflow_.count())
+        return overflow_[0]->clock_;
+
+    return W64(-1);
+}
+
+void EventQueue::reset(W64 cycle)
+{
+    foreach(i, EVENT_WHEEL_SIZE) {
+        Event *event = buckets_[i].head;
+        while(event) {
+            Event *next = event->next_;
+            free(event);
+            event = next;
+        }
+        buckets_[i].head = NULL;
+        buckets_[i].tail = NULL;
+    }
+
+    foreach(i, overflow_.count()) {
+        free(overflow_[i]);
+    }
+    overflow_.clear();
+
+    wheelCount_ = 0;
+    wheelCycle_ = cycle;
+    seq_ = 0;
+}
+
+void EventQueue::overflow_push(Event *event)
+{
+    int i = overflow_.count();
+    overflow_.push(event);
+
+    while(i > 0) {
+        int parent = (i - 1) / 2;
+        if(!before(event, overflow_[parent]))
+            break;
+        overflow_[i] = overflow_[parent];
+        i = parent;
+    }
+    overflow_[i] = event;
+}
+
+Event* EventQueue::overflow_pop()
+{
+    Event *top = overflow_[0];
+    Event *last = overflow_.pop();
+    int n = overflow_.count();
+
+    if(n == 0)
+        return top;
+
+    int i = 0;
+    for(;;) {
+        int child = 2 * i + 1;
+        if(child >= n)
+            break;
+        if(child + 1 < n && before(overflow_[child + 1], overflow_[child]))
+            child++;
+        if(!before(overflow_[child], last))
+            break;
+        overflow_[i] = overflow_[child];
+        i = child;
+    }
+    overflow_[i] = last;
+
+    return top;
+}
+
+ostream& EventQueue::print(ostream& os) const
+{
+    os << "EventQueue: ", count(), " events, wheel at cycle ",
+       wheelCycle_, endl;
+
+    foreach(i, EVENT_WHEEL_SIZE) {
+        const Bucket &bucket = buckets_[(wheelCycle_ + i) & EVENT_WHEEL_MASK];
+        for(Event *event = bucket.head; event; event = event->next_)
+            os << *event;
+    }
+
+    if(overflow_.count()) {
+        os << "Overflow events:", endl;
+        foreach(i, overflow_.count())
+            os << *overflow_[i];
+    }
+
+    return os;
+}
@@ -0,0 +1,155 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <globals.h>
+#include <superstl.h>
+
+namespace Memory {
+
+/* Number of one-cycle buckets in EventQueue, must be a power of two */
+#define EVENT_WHEEL_SIZE 1024
+
+/* Number of Events allocated at once when EventQueue runs out of Events */
+#define EVENT_POOL_CHUNK 1024
+
+class Event
+{
+    private:
+        Signal *signal_;
+        W64    clock_;
+        void   *arg_;
+
+        /* EventQueue bookkeeping: insertion order and intrusive link */
+        W64    seq_;
+        Event  *next_;
+
+        friend class EventQueue;
+
+    public:
+        void init() {
+            signal_ = NULL;
+            clock_ = -1;
+            arg_ = NULL;
+            next_ = NULL;
+        }
+
+        void setup(Signal *signal, W64 clock, void *arg) {
+            signal_ = signal;
+            clock_ = clock;
+            arg_ = arg;
+        }
+
+        bool execute() {
+            return signal_->emit(arg_);
+        }
+
+        W64 get_clock() {
+            return clock_;
+        }
+
+        Signal* get_signal() {
+            return signal_;
+        }
+
+        void* get_arg() {
+            return arg_;
+        }
+
+        ostream& print(ostream& os) const {
+            os << "Event< ";
+            if(signal_)
+                os << "Signal:" << signal_->get_name() << " ";
+            os << "Clock:" << clock_ << " ";
+            os << "arg:" << arg_ ;
+            os << ">" << endl, flush;
+            return os;
+        }
+};
+
+static inline ostream& operator <<(ostream& os, const Event& event) {
+    return event.print(os);
+}
+
+/**
+ * @brief Timing wheel of pending memory events
+ *
+ * Events that are due within EVENT_WHEEL_SIZE cycles are appended to the
+ * bucket of their cycle, so insertion and per-cycle removal are O(1). Events
+ * further in the future wait in an overflow min-heap and are moved into the
+ * wheel as soon as their cycle comes in range. Events of the same cycle are
+ * always executed in the order they were added. Events are allocated from an
+ * internal pool that grows on demand.
+ */
+class EventQueue
+{
+    public:
+        EventQueue();
+        ~EventQueue();
+
+        Event* alloc();
+        void free(Event *event);
+
+        void insert(Event *event);
+        Event* pop(W64 cycle);
+        W64 next_clock();
+
+        void reset(W64 cycle = 0);
+
+        int count() const {
+            return wheelCount_ + overflow_.count();
+        }
+
+        bool empty() const {
+            return count() == 0;
+        }
+
+        ostream& print(ostream& os) const;
+
+    private:
+        struct Bucket {
+            Event *head;
+            Event *tail;
+        };
+
+        Bucket buckets_[EVENT_WHEEL_SIZE];
+        int    wheelCount_;
+
+        /* All Events in wheel have clock in
+         * [wheelCycle_, wheelCycle_ + EVENT_WHEEL_SIZE) */
+        W64    wheelCycle_;
+
+        /* Min-heap on (clock, seq) of Events beyond the wheel */
+        dynarray<Event*> overflow_;
+        W64    seq_;
+
+        Event  *freeEvents_;
+        dynarray<Event*> chunks_;
+
+        void add_to_bucket(Event *event);
+        void refill();
+
+        static bool before(Event *a, Event *b) {
+            if(a->clock_ != b->clock_)
+                return a->clock_ < b->clock_;
+            return a->seq_ < b->seq_;
+        }
+
+        void overflow_push(Event *event);
+        Event* overflow_pop();
+};
+
+static inline ostream& operator <<(ostream& os, const EventQueue& queue)
+{
+    return queue.print(os);
+}
+
+};
+
+#endif // EVENT_QUEUE_H
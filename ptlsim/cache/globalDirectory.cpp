@@ -47,18 +47,22 @@ Directory::Directory()
 
 DirectoryEntry* Directory::insert(MemoryRequest *req, W64& old_tag)
 {
-    W64 phys_addr = req->get_physical_address();
-    DirectoryEntry* entry = entries->select(phys_addr, old_tag);
-
-    return entry;
+    return insert(req->get_physical_address(), old_tag);
 }
 
 DirectoryEntry* Directory::probe(MemoryRequest *req)
 {
-    W64 phys_addr = req->get_physical_address();
-    DirectoryEntry* entry = entries->probe(phys_addr);
+    return probe(req->get_physical_address());
+}
 
-    return entry;
+DirectoryEntry* Directory::insert(W64 addr, W64& old_tag)
+{
+    return entries->select(addr, old_tag);
+}
+
+DirectoryEntry* Directory::probe(W64 addr)
+{
+    return entries->probe(addr);
 }
 
 int Directory::invalidate(MemoryRequest *req)
@@ -140,6 +144,17 @@ bool DirectoryController::handle_interconnect_cb(void *arg)
     return (this->*req_handlers[request->get_type()])(message);
 }
 
+/**
+ * @brief Track a lowest private cache whose lines this directory keeps
+ *
+ * @param cont Cache controller, indexed by its core
+ */
+void DirectoryController::add_cache_controller(Controller *cont)
+{
+    controllers[cont->idx]     = cont;
+    dir_controllers[cont->idx] = this;
+}
+
 void DirectoryController::register_interconnect(Interconnect *interconn,
         int type)
 {
@@ -174,8 +189,7 @@ void DirectoryController::register_interconnect(Interconnect *interconn,
                         /* This controller is up in hierarchy */
                         cont = machine.controller_hash.get(sg->controller);
                         assert(cont);
-                        controllers[(*cont)->idx]     = (*cont);
-                        dir_controllers[(*cont)->idx] = this;
+                        add_cache_controller(*cont);
                         break;
                     case INTERCONN_TYPE_UPPER2:
                     case INTERCONN_TYPE_I:
@@ -955,6 +969,101 @@ void DirectoryController::annul_request(MemoryRequest *request)
     }
 }
 
+/**
+ * @brief Pass a warming evict or downgrade to the caches that have a line
+ *
+ * @param entry Directory entry of the line
+ * @param physaddr Physical address of the line
+ * @param skip Core whose cache is left alone, -1 for none
+ * @param type Evict or read
+ *
+ * Dirty data given up by a cache is written back to the lower controller.
+ *
+ * @return true if any cache wrote the line back
+ */
+bool DirectoryController::warm_others(DirectoryEntry *entry, W64 physaddr,
+        int skip, OP_TYPE type)
+{
+    bool written_back = false;
+
+    foreach (i, NUM_SIM_CORES) {
+        if (i == skip || !entry->present[i] || !controllers[i])
+            continue;
+
+        if (controllers[i]->warm_snoop(physaddr, type)) {
+            if (lower_cont)
+                lower_cont->warm(i, physaddr, MEMORY_OP_UPDATE, false);
+            written_back = true;
+        }
+    }
+
+    return written_back;
+}
+
+/**
+ * @brief Functional warming of the directory entry of a line
+ *
+ * @param coreid Core whose lowest private cache filled or evicted the line
+ * @param physaddr Physical address of the line
+ * @param type Read or write fill, or evict
+ * @param is_icache Access is an instruction fetch
+ *
+ * A write invalidates the line in other cores' caches and a read
+ * downgrades their copies to shared. Replacing a directory entry evicts
+ * its line from all caches that have it, like timing mode does.
+ *
+ * @return true if other cores' caches still have the line
+ */
+bool DirectoryController::warm(W8 coreid, W64 physaddr, OP_TYPE type,
+        bool is_icache)
+{
+    DirectoryEntry *entry = dir_.probe(physaddr);
+
+    if (type == MEMORY_OP_EVICT || type == MEMORY_OP_UPDATE) {
+        if (entry && type == MEMORY_OP_EVICT) {
+            entry->present[coreid] = 0;
+            if (entry->owner == coreid) {
+                entry->owner = -1;
+                entry->dirty = 0;
+            }
+        }
+        return false;
+    }
+
+    if (!entry) {
+        W64 old_tag = InvalidTag<W64>::INVALID;
+        entry = dir_.insert(physaddr, old_tag);
+
+        if ((old_tag != InvalidTag<W64>::INVALID && old_tag != (W64)-1) &&
+                entry->present.nonzero()) {
+            warm_others(entry, old_tag, -1, MEMORY_OP_EVICT);
+        }
+
+        entry->init(dir_.tag_of(physaddr));
+    }
+
+    bitvec<NUM_SIM_CORES> others = entry->present;
+    others[coreid] = 0;
+
+    if (type == MEMORY_OP_WRITE) {
+        warm_others(entry, physaddr, coreid, MEMORY_OP_EVICT);
+        entry->present.reset();
+        entry->owner = coreid;
+        entry->dirty = 1;
+        others.reset();
+    } else if (others.nonzero()) {
+        if (warm_others(entry, physaddr, coreid, MEMORY_OP_READ))
+            entry->dirty = 0;
+    } else {
+        entry->owner = coreid;
+        entry->dirty = 0;
+    }
+
+    entry->present[coreid] = 1;
+
+    return others.nonzero();
+}
+
 /**
  * @brief Dump Directory Configuration in YAML Format
  *
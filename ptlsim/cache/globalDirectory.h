@@ -83,6 +83,8 @@ class Directory {
 
         DirectoryEntry *insert(MemoryRequest *req, W64&old_tag);
         DirectoryEntry *probe(MemoryRequest *req);
+        DirectoryEntry *insert(W64 addr, W64& old_tag);
+        DirectoryEntry *probe(W64 addr);
         int             invalidate(MemoryRequest *req);
 
         W64 tag_of(W64 addr) { return base_t::tagof(addr); }
@@ -190,6 +192,10 @@ class DirectoryController : public Controller {
         void print(ostream &os) const;
         bool is_full(bool flag=false) const;
         void annul_request(MemoryRequest *request);
+        bool warm(W8 coreid, W64 physaddr, OP_TYPE type, bool is_icache);
+        bool warm_others(DirectoryEntry *entry, W64 physaddr, int skip,
+                OP_TYPE type);
+        void add_cache_controller(Controller *cont);
 		void dump_configuration(YAML::Emitter &out) const;
 
         bool handle_read_miss(Message *message);
@@ -29,6 +29,7 @@
 #define INTERCONNECT_H
 
 #include <controller.h>
+#include <coreThreads.h>
 
 namespace Memory {
 
@@ -46,16 +47,34 @@ class Interconnect
 	private:
         stringbuf name_;
 		Signal controller_request_;
+		bool isPrivate_;
+
+		/*
+		 * Core tasks send to shared interconnects through coreThreads.
+		 * Without a quantum they wait for their turn and send directly,
+		 * so they see if the message was accepted.
+		 */
+		bool request_cb(void *arg) {
+			if unlikely (!isPrivate_ && core_task_deferring()) {
+				if(coreThreads.is_relaxed())
+					return coreThreads.defer_message(this, (Message*)arg);
+				core_task_serialize();
+			}
+			return controller_request_cb(arg);
+		}
 
 	public:
 		MemoryHierarchy *memoryHierarchy_;
 		Interconnect(const char *name, MemoryHierarchy *memoryHierarchy)
 			: controller_request_("Controller Request")
+			, isPrivate_(false)
 			, memoryHierarchy_(memoryHierarchy)
 		{
 			name_ << name;
 			controller_request_.connect(signal_mem_ptr(*this,
-						&Interconnect::controller_request_cb));
+						&Interconnect::request_cb));
+			host_profile_event_type(controller_request_, name,
+					"controller_request");
 		}
 
         virtual ~Interconnect()
@@ -67,6 +86,12 @@ class Interconnect
 		virtual void register_controller(Controller *controller)=0;
 		virtual int access_fast_path(Controller *controller,
 				MemoryRequest *request)=0;
+
+		/* Pass a functional warming access on to the other side */
+		virtual bool warm(Controller *controller, W8 coreid, W64 physaddr,
+				OP_TYPE type, bool is_icache) { return false; }
+		virtual bool warm_snoop(Controller *controller, W64 physaddr,
+				OP_TYPE type) { return false; }
 		virtual void print_map(ostream& os)=0;
 		virtual void print(ostream& os) const = 0;
 		virtual int get_delay()=0;
@@ -80,6 +105,15 @@ class Interconnect
 		char* get_name() const {
 			return name_.buf;
 		}
+
+		/* Only used by the core it belongs to */
+		bool is_private() const {
+			return isPrivate_;
+		}
+
+		void set_private(bool flag) {
+			isPrivate_ = flag;
+		}
 };
 
 static inline ostream& operator << (ostream& os, const Interconnect&
@@ -238,8 +238,8 @@ bool MemoryControllerSimple::access_completed_cb(void *arg)
 
         wait_interconnect_cb(queueEntry);
     } else {
-        queueEntry->request->decRefCounter();
         ADD_HISTORY_REM(queueEntry->request);
+        queueEntry->request->decRefCounter();
         pendingRequests_.free(queueEntry);
     }
 
@@ -254,8 +254,8 @@ bool MemoryControllerSimple::wait_interconnect_cb(void *arg)
 
 	/* Don't send response if its a memory update request */
 	if(queueEntry->request->get_type() == MEMORY_OP_UPDATE) {
-		queueEntry->request->decRefCounter();
 		ADD_HISTORY_REM(queueEntry->request);
+		queueEntry->request->decRefCounter();
 		pendingRequests_.free(queueEntry);
 		return true;
 	}
@@ -277,8 +277,8 @@ bool MemoryControllerSimple::wait_interconnect_cb(void *arg)
 		/* Failed to response to cache, retry after 1 cycle */
 		marss_add_event(&waitInterconnect_, 1, queueEntry);
 	} else {
-		queueEntry->request->decRefCounter();
 		ADD_HISTORY_REM(queueEntry->request);
+		queueEntry->request->decRefCounter();
         pendingRequests_.free(queueEntry);
 
 		if(!pendingRequests_.isFull()) {
@@ -296,8 +296,8 @@ void MemoryControllerSimple::annul_request(MemoryRequest *request)
         if(queueEntry->request->is_same(request)) {
             queueEntry->annuled = true;
             if(!queueEntry->inUse) {
-                queueEntry->request->decRefCounter();
                 ADD_HISTORY_REM(queueEntry->request);
+                queueEntry->request->decRefCounter();
                 pendingRequests_.free(queueEntry);
             }
         }
@@ -41,6 +41,7 @@
 #include <memoryStats.h>
 #include <memoryHierarchy.h>
 #include <statelist.h>
+#include <coreThreads.h>
 
 #include <cpuController.h>
 #include <memoryControllerSimple.h>
@@ -51,6 +52,7 @@ using namespace Memory;
 
 MemoryHierarchy::MemoryHierarchy(BaseMachine& machine) :
     machine_(machine)
+    , memoryController_(NULL)
     , someStructIsFull_(false)
 {
     coreNo_ = machine_.get_num_cores();
@@ -76,53 +78,124 @@ bool MemoryHierarchy::access_cache(MemoryRequest *request)
 	CPUController *cpuController = (CPUController*)cpuControllers_[coreid];
 	assert(cpuController != NULL);
 
+	/*
+	 * Hold a reference during the access, so requests that are not queued
+	 * anywhere (like fast path hits) go back to the pool right here.
+	 */
 	int ret_val;
+	bool is_write = (request->get_type() == MEMORY_OP_WRITE);
+	request->incRefCounter();
 	ret_val = ((CPUController*)cpuController)->access(request);
+	request->decRefCounter();
 
 	if(ret_val == 0)
 		return true;
 
-	if(request->get_type() == MEMORY_OP_WRITE)
+	if(is_write)
 		return true;
 
 	return false;
 }
 
+/**
+ * @brief Warm caches with an access while QEMU fast-forwards
+ *
+ * @param coreid Core that made the access
+ * @param physaddr Physical address of the access
+ * @param is_icache Access is an instruction fetch
+ * @param is_write Access is a store
+ *
+ * Only tags and coherence state of the caches and directory are updated,
+ * no request is created and no event or stats counter is touched.
+ */
+void MemoryHierarchy::warm_access(W8 coreid, W64 physaddr, bool is_icache,
+		bool is_write)
+{
+	Controller *cpuController = cpuControllers_[coreid];
+	assert(cpuController != NULL);
+
+	cpuController->warm(coreid, physaddr,
+			(is_write) ? MEMORY_OP_WRITE : MEMORY_OP_READ, is_icache);
+}
+
 void MemoryHierarchy::clock()
 {
-	// First clock all the cpu controllers
-	foreach(i, cpuControllers_.count()) {
-		CPUController *cpuController = (CPUController*)(
-				cpuControllers_[i]);
-		cpuController->clock();
+	// First clock all the cpu controllers, unless core tasks clock their own
+	if likely (!coreThreads.clocks_cpu_controllers()) {
+		foreach(i, cpuControllers_.count()) {
+			clock_cpu_controller(i);
+		}
 	}
 
 #if 1 /* yclin */
-	memoryController_->cycle();
+	if(memoryController_) {
+		HostProfileScope scope(host_profile_memory_controller);
+		memoryController_->cycle();
+	}
 #endif
 
 	Event *event;
-	while(!eventQueue_.empty()) {
-		event = eventQueue_.head();
-		if(event->get_clock() <= sim_cycle) {
-			memdebug("Executing event: ", *event);
-			eventQueue_.free(event);
-			assert(event->execute());
-		} else {
-			break;
-		}
+	while((event = eventQueue_.pop(sim_cycle))) {
+		memdebug("Executing event: ", *event);
+		assert(event->execute());
+		eventQueue_.free(event);
+	}
+}
+
+void MemoryHierarchy::clock_cpu_controller(int coreid)
+{
+	CPUController *cpuController = (CPUController*)(
+			cpuControllers_[coreid]);
+	HostProfileScope scope(host_profile_cpu_controller);
+	cpuController->clock();
+}
+
+/**
+ * @brief Get the first cycle in which clock() has any work to do
+ *
+ * @return Cycle of the earliest pending event or controller activity,
+ * -1 if memory hierarchy is completely idle
+ */
+W64 MemoryHierarchy::get_next_cycle()
+{
+	W64 next = eventQueue_.next_clock();
+
+	foreach(i, cpuControllers_.count()) {
+		next = min(next, cpuControllers_[i]->get_next_cycle());
+	}
+
+	if(memoryController_)
+		next = min(next, memoryController_->get_next_cycle());
+
+	return next;
+}
+
+/**
+ * @brief Advance per-cycle state of controllers over idle cycles
+ *
+ * @param cycles Number of cycles skipped, all before get_next_cycle()
+ */
+void MemoryHierarchy::skip_cycles(W64 cycles)
+{
+	foreach(i, cpuControllers_.count()) {
+		cpuControllers_[i]->skip_cycles(cycles);
 	}
+
+	if(memoryController_)
+		memoryController_->skip_cycles(cycles);
 }
 
 void MemoryHierarchy::reset()
 {
-	eventQueue_.reset();
+	eventQueue_.reset(sim_cycle);
 }
 
 int MemoryHierarchy::flush(uint8_t coreid)
 {
 	int delay = 0;
 
+	core_task_serialize();
+
 	if(coreid == -1) {
 		/* Here delay is not added because all the CPU Controllers
 		 * can be flushed in parallel */
@@ -138,6 +211,10 @@ int MemoryHierarchy::flush(uint8_t coreid)
 void MemoryHierarchy::set_controller_full(Controller* controller,
 		bool flag)
 {
+	if unlikely (core_task_deferring()) {
+		coreThreads.defer_controller_full(controller, flag);
+		return;
+	}
 
 	bool anyFull = false;
 	foreach(i, cpuControllers_.count()) {
@@ -161,6 +238,10 @@ void MemoryHierarchy::set_controller_full(Controller* controller,
 void MemoryHierarchy::set_interconnect_full(Interconnect* interconnect,
 		bool flag)
 {
+	if unlikely (core_task_deferring()) {
+		coreThreads.defer_interconnect_full(interconnect, flag);
+		return;
+	}
 	bool anyFull = false;
 	foreach(i, allInterconnects_.count()) {
 		if(allInterconnects_[i] == interconnect) {
@@ -258,85 +339,90 @@ void MemoryHierarchy::print_map(ostream& os)
 	os << "--End MemoryHierarchy Map\n";
 }
 
-void MemoryHierarchy::sort_event_queue(Event *event)
+void MemoryHierarchy::add_event(Signal *signal, int delay, void *arg)
 {
-	// First make sure that given event is in tail of queue
-	assert(eventQueue_.tail() == event);
-
-	// No need to sort if only 1 event
-	if(eventQueue_.count() == 1)
+	// Core tasks queue events of shared structures until their turn
+	if unlikely (core_task_deferring()) {
+		coreThreads.defer_event(signal, delay, arg);
 		return;
+	}
 
-	Event* entryEvent;
-	foreach_list_mutable(eventQueue_.list(), entryEvent, entry, preventry) {
-		if(*event < *entryEvent) {
-			eventQueue_.unlink(event);
-			eventQueue_.insert_after(event, (Event*)(entryEvent->prev));
-			return;
-		}
+	// If delay is 0, execute without queuing the event
+	if(delay == 0) {
+		memdebug("Executing event: Signal:", signal->get_name(),
+				" Clock:", sim_cycle, " arg:", arg, endl);
+		assert(signal->emit(arg));
+		return;
 	}
 
-	// Entry is already at the tail of queue, keep it there
-	return;
+	add_event_at(signal, sim_cycle + delay, arg);
 }
 
-void MemoryHierarchy::sort_event_queue_tail(Event *event)
+/**
+ * @brief Add event that executes in given cycle
+ *
+ * Unlike add_event() this always queues the event, core tasks use it to hand
+ * their events to the shared queue.
+ */
+void MemoryHierarchy::add_event_at(Signal *signal, W64 clock, void *arg)
 {
-	// First make sure that given event is in tail of queue
-	assert(eventQueue_.tail() == event);
-
-	// No need to sort if only 1 event
-	if (eventQueue_.count() == 1)
-		return;
+	Event *event = eventQueue_.alloc();
+	event->setup(signal, clock, arg);
 
-	Event* entryEvent;
-	foreach_list_mutable_backwards(eventQueue_.list(), entryEvent, entry, preventry) {
-        if (entryEvent == event)
-            continue;
+	memdebug("Adding event:", *event);
 
-        if (*event >= *entryEvent) {
-            eventQueue_.unlink(event);
-            eventQueue_.insert_after(event, (Event*)(entryEvent));
-            return;
-        }
-    }
+	eventQueue_.insert(event);
 }
 
-void MemoryHierarchy::add_event(Signal *signal, int delay, void *arg)
+/**
+ * @brief Check that no two cores share an L1 interconnect
+ *
+ * Cores only run on separate host threads when everything up to their L1
+ * caches is private to them.
+ *
+ * @return true if each CPU Controller has its own L1 interconnects
+ */
+bool MemoryHierarchy::has_private_L1() const
 {
-	Event *event = eventQueue_.alloc();
-	if(eventQueue_.count() == 1)
-		assert(event == eventQueue_.head());
-	assert(event);
-	event->setup(signal, sim_cycle + delay, arg);
-
-	// If delay is 0, execute without sorting the queue
-	if(delay == 0) {
-		memdebug("Executing event: ", *event);
-		assert(event->execute());
-
-		eventQueue_.free(event);
-        /* memdebug("Queue after add: \n", eventQueue_); */
-		return;
+	foreach(i, cpuControllers_.count()) {
+		CPUController *a = (CPUController*)cpuControllers_[i];
+		for(int j = i + 1; j < cpuControllers_.count(); j++) {
+			CPUController *b = (CPUController*)cpuControllers_[j];
+			if(a->get_interconnect_L1_d() == b->get_interconnect_L1_d() ||
+					a->get_interconnect_L1_d() == b->get_interconnect_L1_i() ||
+					a->get_interconnect_L1_i() == b->get_interconnect_L1_d() ||
+					a->get_interconnect_L1_i() == b->get_interconnect_L1_i())
+				return false;
+		}
 	}
+	return true;
+}
 
-	memdebug("Adding event:", *event);
-
-    sort_event_queue(event);
-
-	return;
+/**
+ * @brief Mark L1 interconnects of all CPU Controllers private
+ *
+ * Messages core tasks send to any other interconnect reach it through
+ * coreThreads.
+ */
+void MemoryHierarchy::set_private_L1()
+{
+	foreach(i, cpuControllers_.count()) {
+		CPUController *cpuController = (CPUController*)cpuControllers_[i];
+		cpuController->get_interconnect_L1_d()->set_private(true);
+		cpuController->get_interconnect_L1_i()->set_private(true);
+	}
 }
 
 Message* MemoryHierarchy::get_message()
 {
-    Message* message = messageQueue_.alloc();
+    Message* message = messageQueues_[core_task + 1].alloc();
     assert(message);
     return message;
 }
 
 void MemoryHierarchy::free_message(Message* msg)
 {
-	messageQueue_.free(msg);
+	messageQueues_[core_task + 1].free(msg);
 }
 
 void MemoryHierarchy::annul_request(W8 coreid,
@@ -351,7 +437,9 @@ void MemoryHierarchy::annul_request(W8 coreid,
 	MemoryRequest* memRequest = get_free_request(coreid);
 	memRequest->init(coreid, threadid, physaddr, robid, sim_cycle, total_insns_committed, 
     is_icache, -1, -1, (is_write ? MEMORY_OP_WRITE : MEMORY_OP_READ));
+	memRequest->incRefCounter();
 	cpuControllers_[coreid]->annul_request(memRequest);
+	memRequest->decRefCounter();
 	//foreach(i, allControllers_.count()) {
 	//	allControllers_[i]->annul_request(memRequest);
 	//}
@@ -402,6 +490,8 @@ int MemoryHierarchy::get_core_pending_offchip_miss(W8 coreid)
 bool MemoryHierarchy::grab_lock(W64 lockaddr, W8 ctx_id)
 {
     bool ret = false;
+
+    core_task_serialize();
     MemoryInterlockEntry* lock = interlocks.select_and_lock(lockaddr);
 
     if likely (lock && lock->ctx_id == (W8)-1) {
@@ -420,6 +510,8 @@ bool MemoryHierarchy::grab_lock(W64 lockaddr, W8 ctx_id)
  */
 void MemoryHierarchy::invalidate_lock(W64 lockaddr, W8 ctx_id)
 {
+    core_task_serialize();
+
     MemoryInterlockEntry* lock = interlocks.probe(lockaddr);
 
     assert(lock);
@@ -438,7 +530,16 @@ void MemoryHierarchy::invalidate_lock(W64 lockaddr, W8 ctx_id)
 bool MemoryHierarchy::probe_lock(W64 lockaddr, W8 ctx_id)
 {
     bool ret = false;
-    MemoryInterlockEntry* lock = interlocks.probe(lockaddr);
+    MemoryInterlockEntry* lock;
+
+    /* Core tasks replay the LRU update of the probe in their turn */
+    core_task_order();
+    if unlikely (core_task_deferring()) {
+        lock = interlocks.peek(lockaddr);
+        coreThreads.defer_lock_probe(lockaddr);
+    } else {
+        lock = interlocks.probe(lockaddr);
+    }
 
     if likely (!lock) { // If no one has grab the lock
         ret = true;
@@ -36,8 +36,10 @@
 #include <memoryRequest.h>
 #include <controller.h>
 #include <interconnect.h>
+#include <eventQueue.h>
 
 #include <statsBuilder.h>
+#include <hostProfile.h>
 
 #define DEBUG_MEMORY
 //#define DEBUG_WITH_FILE_NAME
@@ -56,15 +58,14 @@
 #define memdebug(...) (0)
 #endif
 
-#define ENABLE_MEM_REQUEST_HISTORY
 #ifdef ENABLE_MEM_REQUEST_HISTORY
 #define ADD_HISTORY(req, ...) req->get_history() << __VA_ARGS__
 #define ADD_HISTORY_ADD(req) ADD_HISTORY(req, "{+", get_name(), "} ")
 #define ADD_HISTORY_REM(req) ADD_HISTORY(req, "{-", get_name(), "} ")
 #else
-#define ADD_HISTORY(req, ...) (0)
-#define ADD_HISTORY_ADD(req) (0)
-#define ADD_HISTORY_REM(req) (0)
+#define ADD_HISTORY(req, ...) ((void)0)
+#define ADD_HISTORY_ADD(req) ((void)0)
+#define ADD_HISTORY_REM(req) ((void)0)
 #endif
 
 #ifndef ENABLE_CHECKS
@@ -78,81 +79,15 @@
 
 #define SET_SIGNAL_CB(name, name_postfix, signal, cb) \
 { \
-    stringbuf *sg_n = new stringbuf(); \
-    *sg_n << name, name_postfix; \
-    signal.set_name(sg_n->buf); \
+    stringbuf sg_n; \
+    sg_n << name, name_postfix; \
+    signal.set_name(sg_n.buf); \
     signal.connect(signal_mem_ptr(*this, cb)); \
+    host_profile_event_type(signal, name, name_postfix); \
 }
 
 namespace Memory {
 
-  class Event : public FixStateListObject
-	{
-		private:
-			Signal *signal_;
-			W64    clock_;
-			void   *arg_;
-
-		public:
-			void init() {
-				signal_ = NULL;
-				clock_ = -1;
-				arg_ = NULL;
-			}
-
-			void setup(Signal *signal, W64 clock, void *arg) {
-				signal_ = signal;
-				clock_ = clock;
-				arg_ = arg;
-			}
-
-			bool execute() {
-				return signal_->emit(arg_);
-			}
-
-			W64 get_clock() {
-				return clock_;
-			}
-
-			ostream& print(ostream& os) const {
-				os << "Event< ";
-				if(signal_)
-					os << "Signal:" << signal_->get_name() << " ";
-				os << "Clock:" << clock_ << " ";
-				os << "arg:" << arg_ ;
-				os << ">" << endl, flush;
-				return os;
-			}
-
-			bool operator ==(Event &event) {
-				if(clock_ == event.clock_)
-					return true;
-				return false;
-			}
-
-			bool operator >(Event &event) {
-				if(clock_ > event.clock_)
-					return true;
-				return false;
-			}
-
-			bool operator <(Event &event) {
-				if(clock_ < event.clock_)
-					return true;
-				return false;
-			}
-
-            bool operator >=(Event &event) {
-                if (clock_ >= event.clock_)
-                    return true;
-                return false;
-            }
-	};
-
-  static inline ostream& operator <<(ostream& os, const Event& event) {
-      return event.print(os);
-  }
-
   struct MemoryInterlockEntry {
       W8 ctx_id;
 
@@ -186,12 +121,18 @@ namespace Memory {
     // New Core wakeup function that uses Signal of MemoryRequest
     // if Signal is not setup, it uses old wrapper functions
     void core_wakeup(MemoryRequest *request) {
+        coreThreads.core_wakeup();
+
         if(request->get_coreSignal()) {
             request->get_coreSignal()->emit((void*)request);
             return;
         }
     }
 
+    // functional warming of caches and directory, no timing
+    void warm_access(W8 coreid, W64 physaddr, bool is_icache,
+            bool is_write);
+
 	// to remove the requests if rob eviction has occured
 	void annul_request(W8 coreid,
 			W8 threadid,
@@ -201,6 +142,9 @@ namespace Memory {
 			bool is_write);
 
     void clock();
+    void clock_cpu_controller(int coreid);
+    W64 get_next_cycle();
+    void skip_cycles(W64 cycles);
 
     void reset();
 
@@ -213,6 +157,7 @@ namespace Memory {
 
 	// Add event into event queue
 	void add_event(Signal *signal, int delay, void *arg);
+	void add_event_at(Signal *signal, W64 clock, void *arg);
 
 	MemoryRequest* get_free_request(int id) {
 		return requestPool_[id]->get_free_request();
@@ -233,6 +178,10 @@ namespace Memory {
         cpuControllers_.push(cont);
     }
 
+    int get_cpu_controller_count() const {
+        return cpuControllers_.count();
+    }
+
 #if 1 /* yclin */
     void add_cache_mem_controller(Controller* cont, bool mem=false) {
         allControllers_.push(cont);
@@ -257,6 +206,9 @@ namespace Memory {
         interconnectsFullFlags_.resize(allInterconnects_.count(), false);
     }
 
+    bool has_private_L1() const;
+    void set_private_L1();
+
     bool grab_lock(W64 lockaddr, W8 ctx_id);
     bool probe_lock(W64 lockaddr, W8 ctx_id);
     void invalidate_lock(W64 lockaddr, W8 ctx_id);
@@ -285,14 +237,11 @@ namespace Memory {
 	// Request pool
 	dynarray<RequestPool*> requestPool_;
 
-	// Message pool
-	FixStateList<Message, 128> messageQueue_;
+	// Message pools, one for simulation thread and one for each core task
+	FixStateList<Message, 128> messageQueues_[NUM_SIM_CORES + 1];
 
 	// Event Queue
-	FixStateList<Event, 2048> eventQueue_;
-
-	void sort_event_queue(Event *event);
-	void sort_event_queue_tail(Event *event);
+	EventQueue eventQueue_;
 
     // Temp Stats
     Stats *stats;
@@ -72,8 +72,9 @@ void MemoryRequest::init(W8 coreId,
 	memoryStat_ = NULL;
 #endif
 
-	if(history) delete history;
-	history = new stringbuf();
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+	history_.reset();
+#endif
 
 	memdebug("Init ", *this, endl);
 }
@@ -97,8 +98,9 @@ void MemoryRequest::init(MemoryRequest *request)
 	memoryStat_ = request->memoryStat_;
 #endif
 
-	if(history) delete history;
-	history = new stringbuf();
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+	history_.reset();
+#endif
 
 	memdebug("Init ", *this, endl);
 }
@@ -142,17 +144,16 @@ RequestPool::RequestPool()
 {
 	size_ = REQUEST_POOL_SIZE;
 	foreach(i, REQUEST_POOL_SIZE) {
+		(*this)[i].set_pool(this);
 		freeRequestList_.enqueue((selfqueuelink*)&((*this)[i]));
 	}
 }
 
 MemoryRequest* RequestPool::get_free_request()
 {
-	if (isPoolLow()){
-		garbage_collection();
-        /* if asserted here please increase REQUEST_POOL_SIZE */
-		assert(!isEmpty());
-	}
+	/* if asserted here please increase REQUEST_POOL_SIZE */
+	assert(!isEmpty());
+
 	MemoryRequest* memoryRequest = (MemoryRequest*)freeRequestList_.peek();
 	freeRequestList_.remove((selfqueuelink*)memoryRequest);
 	usedRequestsList_.enqueue((selfqueuelink*)memoryRequest);
@@ -160,26 +161,17 @@ MemoryRequest* RequestPool::get_free_request()
 	return memoryRequest;
 }
 
-void RequestPool::freeRequest( MemoryRequest* memoryrequest)
+/**
+ * @brief Return a request to the free list
+ *
+ * Called from MemoryRequest::decRefCounter() when the last reference to a
+ * request is released. Freed requests are added at the tail of free list so
+ * they are reused as late as possible.
+ */
+void RequestPool::free_request(MemoryRequest* memoryrequest)
 {
     /* we should free it only when no one refrence to it  */
 	assert(0 == memoryrequest->get_ref_counter());
 	usedRequestsList_.remove(memoryrequest);
 	freeRequestList_.enqueue(memoryrequest);
-	memoryrequest->set_ref_counter(0);
-}
-
-void RequestPool::garbage_collection()
-{
-	int cleaned = 0;
-	MemoryRequest *memoryRequest;
-	foreach_list_mutable(usedRequestsList_, memoryRequest, \
-			entry, nextentry){
-		if (0 == memoryRequest->get_ref_counter()){
-			freeRequest(memoryRequest);
-			cleaned++;
-		}
-	}
-	memdebug("number of Request cleaned by garbageCollector is: ",
-		   cleaned,	endl);
 }
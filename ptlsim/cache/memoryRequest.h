@@ -33,6 +33,15 @@
 #include <statelist.h>
 #include <cacheConstants.h>
 
+/*
+ * With ENABLE_MEM_REQUEST_HISTORY (scons req_history=1, default in debug
+ * builds) each request keeps a short trace of the controllers and
+ * interconnects it passed through, printed with the request for debugging.
+ */
+
+/* Bytes of history kept per request, older history is overwritten */
+#define MEM_REQUEST_HISTORY_SIZE 128
+
 #if 1 /* yclin */
 namespace DRAM {
 	struct MemoryStatable;
@@ -56,10 +65,68 @@ static const char* memory_op_names[NUM_MEMORY_OP] = {
 	"memory_op_evict"
 };
 
+/**
+ * @brief Fixed size ring buffer of request history
+ *
+ * Supports the same '<<' and ',' chaining as stringbuf for strings, but never
+ * allocates memory.
+ */
+class RequestHistory
+{
+	public:
+		RequestHistory() { reset(); }
+
+		void reset() {
+			head_ = 0;
+			wrapped_ = false;
+		}
+
+		RequestHistory& operator <<(const char *str) {
+			while(*str) {
+				buf_[head_++] = *str++;
+				if unlikely (head_ == MEM_REQUEST_HISTORY_SIZE) {
+					head_ = 0;
+					wrapped_ = true;
+				}
+			}
+			return *this;
+		}
+
+		RequestHistory& operator ,(const char *str) {
+			return (*this) << str;
+		}
+
+		ostream& print(ostream& os) const {
+			if(wrapped_) {
+				os << "...";
+				for(int i = head_; i < MEM_REQUEST_HISTORY_SIZE; i++)
+					os << buf_[i];
+			}
+			for(int i = 0; i < head_; i++)
+				os << buf_[i];
+			return os;
+		}
+
+	private:
+		char buf_[MEM_REQUEST_HISTORY_SIZE];
+		int head_;
+		bool wrapped_;
+};
+
+static inline ostream& operator <<(ostream& os, const RequestHistory& history)
+{
+	return history.print(os);
+}
+
+class RequestPool;
+
 class MemoryRequest: public selfqueuelink
 {
 	public:
-		MemoryRequest() { reset(); }
+		MemoryRequest() {
+			pool_ = NULL;
+			reset();
+		}
 
 		void reset() {
 			coreId_ = 0;
@@ -72,7 +139,9 @@ class MemoryRequest: public selfqueuelink
 			refCounter_ = 0; // or maybe 1
 			opType_ = MEMORY_OP_READ;
 			isData_ = 0;
-			history = new stringbuf();
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+			history_.reset();
+#endif
 			coreSignal_ = NULL;
 #if 1 /* yclin */
 			memoryStat_ = NULL;
@@ -83,8 +152,11 @@ class MemoryRequest: public selfqueuelink
 			refCounter_++;
 		}
 
-		void decRefCounter(){
-			refCounter_--;
+		/* Request returns to its pool as soon as last reference is gone */
+		inline void decRefCounter();
+
+		void set_pool(RequestPool *pool) {
+			pool_ = pool;
 		}
 
 		void init(W8 coreId,
@@ -141,7 +213,9 @@ class MemoryRequest: public selfqueuelink
 
 		W64 get_init_insns() { return insns_; }
 
-		stringbuf& get_history() { return *history; }
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+		RequestHistory& get_history() { return history_; }
+#endif
 
 		bool is_kernel() {
 			// based on owner RIP value
@@ -170,7 +244,9 @@ class MemoryRequest: public selfqueuelink
 			os << "isData[", isData_, "] ";
 			os << "ownerUUID[", ownerUUID_, "] ";
 			os << "ownerRIP[", (void*)ownerRIP_, "] ";
-			os << "History[ " << *history << "] ";
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+			os << "History[ " << history_ << "] ";
+#endif
 			if (coreSignal_) {
 				os << "coreSignal[ " << coreSignal_->get_name() << "] ";
 			}
@@ -189,8 +265,11 @@ class MemoryRequest: public selfqueuelink
 		W64 ownerUUID_;
 		int refCounter_;
 		OP_TYPE opType_;
-		stringbuf *history;
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+		RequestHistory history_;
+#endif
 		Signal *coreSignal_;
+		RequestPool *pool_;
 #if 1 /* yclin */
 		DRAM::MemoryStatable *memoryStat_;
 #endif
@@ -207,7 +286,7 @@ class RequestPool: public array<MemoryRequest,REQUEST_POOL_SIZE>
 	public:
 		RequestPool();
 		MemoryRequest* get_free_request();
-		void garbage_collection();
+		void free_request(MemoryRequest* request);
 
 		StateList& used_list() {
 			return usedRequestsList_;
@@ -242,20 +321,19 @@ class RequestPool: public array<MemoryRequest,REQUEST_POOL_SIZE>
 		StateList freeRequestList_;
 		StateList usedRequestsList_;
 
-		void freeRequest(MemoryRequest* request);
-
 		bool isEmpty()
 		{
 			return (freeRequestList_.empty());
 		}
-
-		bool isPoolLow()
-		{
-			return (freeRequestList_.count < (
-						REQUEST_POOL_SIZE * REQUEST_POOL_LOW_RATIO));
-		}
 };
 
+inline void MemoryRequest::decRefCounter()
+{
+	refCounter_--;
+	if(refCounter_ == 0 && pool_)
+		pool_->free_request(this);
+}
+
 static inline ostream& operator <<(ostream& os, RequestPool &pool)
 {
 	pool.print(os);
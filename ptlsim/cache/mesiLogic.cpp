@@ -444,6 +444,54 @@ bool MESILogic::is_line_valid(CacheLine *line)
     return true;
 }
 
+bool MESILogic::is_line_dirty(CacheLine *line)
+{
+    return (line->state == MESI_MODIFIED);
+}
+
+/**
+ * @brief Set line state after a functional warming access
+ *
+ * @param line Cache line that is hit or was just filled
+ * @param type Read, write or write-back
+ * @param shared Other cores' caches have the line
+ *
+ * Filled lines are shared if other cores have them, exclusive otherwise.
+ * Writes make lines modified, the directory has invalidated other copies.
+ *
+ * @return true if the line is shared
+ */
+bool MESILogic::warm_line(CacheLine *line, OP_TYPE type, bool shared)
+{
+    if (type == MEMORY_OP_WRITE || type == MEMORY_OP_UPDATE) {
+        line->state = MESI_MODIFIED;
+    } else if (line->state == MESI_INVALID) {
+        line->state = shared ? MESI_SHARED : MESI_EXCLUSIVE;
+    }
+
+    return (line->state == MESI_SHARED);
+}
+
+/**
+ * @brief Apply another core's warming access to a line
+ *
+ * @param line Valid cache line
+ * @param type Evict to invalidate the line, read to share it
+ *
+ * @return true if the line was modified and has to be written back
+ */
+bool MESILogic::warm_snoop(CacheLine *line, OP_TYPE type)
+{
+    bool dirty = (line->state == MESI_MODIFIED);
+
+    if (type == MEMORY_OP_EVICT)
+        line->state = MESI_INVALID;
+    else
+        line->state = MESI_SHARED;
+
+    return dirty;
+}
+
 void MESILogic::handle_response(CacheQueueEntry *entry, Message &msg)
 {
 }
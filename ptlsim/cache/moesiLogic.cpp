@@ -394,6 +394,61 @@ bool MOESILogic::is_line_valid(CacheLine *line)
     return true;
 }
 
+bool MOESILogic::is_line_dirty(CacheLine *line)
+{
+    return (line->state == MOESI_MODIFIED || line->state == MOESI_OWNER);
+}
+
+/**
+ * @brief Set line state after a functional warming access
+ *
+ * @param line Cache line that is hit or was just filled
+ * @param type Read, write or write-back
+ * @param shared Other cores' caches have the line
+ *
+ * Filled lines are shared if other cores have them, exclusive otherwise.
+ * Writes make lines modified, the directory has invalidated other copies.
+ *
+ * @return true if the line is shared
+ */
+bool MOESILogic::warm_line(CacheLine *line, OP_TYPE type, bool shared)
+{
+    if (type == MEMORY_OP_WRITE || type == MEMORY_OP_UPDATE) {
+        line->state = MOESI_MODIFIED;
+    } else if (line->state == MOESI_INVALID) {
+        line->state = shared ? MOESI_SHARED : MOESI_EXCLUSIVE;
+    }
+
+    return (line->state == MOESI_SHARED || line->state == MOESI_OWNER);
+}
+
+/**
+ * @brief Apply another core's warming access to a line
+ *
+ * @param line Valid cache line
+ * @param type Evict to invalidate the line, read to share it
+ *
+ * A read leaves modified lines owned by this cache, so only evicted
+ * dirty lines are written back.
+ *
+ * @return true if the line has to be written back
+ */
+bool MOESILogic::warm_snoop(CacheLine *line, OP_TYPE type)
+{
+    if (type == MEMORY_OP_EVICT) {
+        bool dirty = is_line_dirty(line);
+        line->state = MOESI_INVALID;
+        return dirty;
+    }
+
+    if (line->state == MOESI_MODIFIED)
+        line->state = MOESI_OWNER;
+    else if (line->state == MOESI_EXCLUSIVE)
+        line->state = MOESI_SHARED;
+
+    return false;
+}
+
 void MOESILogic::handle_response(CacheQueueEntry *queueEntry,
         Message &message)
 {
@@ -440,7 +495,7 @@ void MOESILogic::send_to_cont(CacheQueueEntry *queueEntry,
         Interconnect *sendTo, Controller *dest)
 {
     queueEntry->dest = dest;
-    queueEntry->request->get_history() << "{MOESI} ";
+    ADD_HISTORY(queueEntry->request, "{MOESI} ");
 
     send_response(queueEntry, sendTo);
 }
@@ -97,6 +97,9 @@ namespace CoherentCache {
                     Message &message);
             bool is_line_valid(CacheLine *line);
             void invalidate_line(CacheLine *line);
+            bool is_line_dirty(CacheLine *line);
+            bool warm_line(CacheLine *line, OP_TYPE type, bool shared);
+            bool warm_snoop(CacheLine *line, OP_TYPE type);
 			void dump_configuration(YAML::Emitter &out) const;
 
             void send_response(CacheQueueEntry *queueEntry,
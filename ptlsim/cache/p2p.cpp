@@ -127,6 +127,40 @@ int P2PInterconnect::access_fast_path(Controller *controller,
 	return receiver->access_fast_path(this, request);
 }
 
+/**
+ * @brief Forward a functional warming access to another controller
+ *
+ * @param controller Sender
+ * @param coreid Core that made the access
+ * @param physaddr Physical address of the access
+ * @param type Read, write or write-back
+ * @param is_icache Access is an instruction fetch
+ *
+ * @return true if other cores' caches have the line
+ */
+bool P2PInterconnect::warm(Controller *controller, W8 coreid, W64 physaddr,
+		OP_TYPE type, bool is_icache)
+{
+	Controller *receiver = get_other_controller(controller);
+	return receiver->warm(coreid, physaddr, type, is_icache);
+}
+
+/**
+ * @brief Forward a warming evict or downgrade to the upper controller
+ *
+ * @param controller Sender
+ * @param physaddr Physical address of the line
+ * @param type Evict or read
+ *
+ * @return true if the line was dirty in the upper controller
+ */
+bool P2PInterconnect::warm_snoop(Controller *controller, W64 physaddr,
+		OP_TYPE type)
+{
+	Controller *receiver = get_other_controller(controller);
+	return receiver->warm_snoop(physaddr, type);
+}
+
 /**
  * @brief Print connections of this instance
  *
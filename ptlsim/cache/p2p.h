@@ -72,6 +72,9 @@ class P2PInterconnect : public Interconnect
 		void register_controller(Controller *controller);
 		int access_fast_path(Controller *controller,
 				MemoryRequest *request);
+		bool warm(Controller *controller, W8 coreid, W64 physaddr,
+				OP_TYPE type, bool is_icache);
+		bool warm_snoop(Controller *controller, W64 physaddr, OP_TYPE type);
 		void print_map(ostream& os);
 
 		void print(ostream& os) const {
@@ -0,0 +1,119 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef PENDING_REQUEST_INDEX_H
+#define PENDING_REQUEST_INDEX_H
+
+#include <globals.h>
+#include <superstl.h>
+
+namespace Memory {
+
+/**
+ * @brief Line address to pending queue entry index
+ *
+ * Controllers keep their pending requests in a FixStateList and used to scan
+ * the whole list to find entries of a cache line. This index maps a line
+ * address to the FixStateList entry indices of that line in the order they
+ * were added, so a lookup only visits entries of the same hash bucket.
+ * Controllers add an entry once its request is set and remove it right
+ * before the entry is freed.
+ */
+template<int SIZE>
+class PendingRequestIndex
+{
+    public:
+        PendingRequestIndex() {
+            reset();
+        }
+
+        void reset() {
+            foreach(i, NUM_BUCKETS) {
+                head_[i] = -1;
+                tail_[i] = -1;
+            }
+            foreach(i, SIZE) {
+                lineAddress_[i] = -1;
+                next_[i] = -1;
+                prev_[i] = -1;
+                linked_[i] = false;
+            }
+        }
+
+        /* Add entry at the end of its line's chain */
+        void add(int idx, W64 lineAddress) {
+            if unlikely (linked_[idx])
+                remove(idx);
+
+            int b = bucket(lineAddress);
+            lineAddress_[idx] = lineAddress;
+            next_[idx] = -1;
+            prev_[idx] = tail_[b];
+
+            if(tail_[b] >= 0)
+                next_[tail_[b]] = idx;
+            else
+                head_[b] = idx;
+
+            tail_[b] = idx;
+            linked_[idx] = true;
+        }
+
+        void remove(int idx) {
+            if(!linked_[idx])
+                return;
+
+            int b = bucket(lineAddress_[idx]);
+
+            if(prev_[idx] >= 0)
+                next_[prev_[idx]] = next_[idx];
+            else
+                head_[b] = next_[idx];
+
+            if(next_[idx] >= 0)
+                prev_[next_[idx]] = prev_[idx];
+            else
+                tail_[b] = prev_[idx];
+
+            linked_[idx] = false;
+        }
+
+        /* Oldest entry of given line, -1 if there is none */
+        int first(W64 lineAddress) const {
+            return match(head_[bucket(lineAddress)], lineAddress);
+        }
+
+        /* Next entry of the same line after given entry, -1 at the end */
+        int next(int idx) const {
+            return match(next_[idx], lineAddress_[idx]);
+        }
+
+    private:
+        enum { NUM_BUCKETS = 2 * SIZE };
+
+        int  head_[NUM_BUCKETS];
+        int  tail_[NUM_BUCKETS];
+
+        W64  lineAddress_[SIZE];
+        int  next_[SIZE];
+        int  prev_[SIZE];
+        bool linked_[SIZE];
+
+        static int bucket(W64 lineAddress) {
+            return (lineAddress ^ (lineAddress >> 16)) % NUM_BUCKETS;
+        }
+
+        int match(int idx, W64 lineAddress) const {
+            while(idx >= 0 && lineAddress_[idx] != lineAddress)
+                idx = next_[idx];
+            return idx;
+        }
+};
+
+};
+
+#endif // PENDING_REQUEST_INDEX_H
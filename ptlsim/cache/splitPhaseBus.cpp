@@ -124,8 +124,8 @@ void BusInterconnect::annul_request(MemoryRequest *request)
             entry, nextentry) {
         if(queueEntry->request->is_same(request)) {
             queueEntry->annuled = true;
-            queueEntry->request->decRefCounter();
             ADD_HISTORY_REM(queueEntry->request);
+            queueEntry->request->decRefCounter();
             pendingRequests_.free(queueEntry);
         }
     }
@@ -522,9 +522,9 @@ bool BusInterconnect::data_broadcast_completed_cb(void *arg)
         default: assert(0);
     }
 
+    ADD_HISTORY_REM(pendingEntry->request);
     pendingEntry->request->decRefCounter();
     pendingRequests_.free(pendingEntry);
-    ADD_HISTORY_REM(pendingEntry->request);
 
     memoryHierarchy_->free_message(&message);
 
@@ -56,8 +56,8 @@ void Switch::annul_request(MemoryRequest *request)
 
             if (entry->request->is_same(request)) {
                 entry->annuled = true;
-                entry->request->decRefCounter();
                 ADD_HISTORY_REM(entry->request);
+                entry->request->decRefCounter();
                 controllers[i]->queue.free(entry);
 
                 if (entry->in_use) {
@@ -155,8 +155,8 @@ bool Switch::send_complete_cb(void *arg)
 	 * remove the entry from queue. */
 
 	if (success) {
-		queueEntry->request->decRefCounter();
 		ADD_HISTORY_REM(queueEntry->request);
+		queueEntry->request->decRefCounter();
 		cq->queue.free(queueEntry);
 	}
 
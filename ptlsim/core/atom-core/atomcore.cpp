@@ -155,6 +155,7 @@ void AtomOp::reset()
     foreach(i, MAX_UOPS_PER_ATOMOP) {
         setzero(uops[i]);
         synthops[i] = 0;
+        invsynthops[i] = 0;
         dest_registers[i] = -1;
         dest_register_values[i] = -1;
 
@@ -240,7 +241,7 @@ bool AtomOp::fetch()
     // Sanity checks
     assert(thread);
     assert(thread->current_bb);
-    assert(thread->current_bb->synthops);
+    assert(thread->current_bb->execs);
 
     bool ret_value = true;
 
@@ -257,7 +258,9 @@ bool AtomOp::fetch()
         TransOp& op = uops[i];
 
         op = thread->current_bb->transops[thread->bb_transop_index];
-        synthops[i] = thread->current_bb->synthops[thread->bb_transop_index];
+        const UopExec& exec = thread->current_bb->execs[thread->bb_transop_index];
+        synthops[i] = exec.synthop;
+        invsynthops[i] = exec.invsynthop;
 
         rip = fetchrip;
 
@@ -360,13 +363,11 @@ bool AtomOp::fetch()
                 op.cond = invert_cond(op.cond);
 
                 /*
-                 * We need to be careful here: we already looked up the
-                 * synthop for this uop according to the old condition,
-                 * so redo that here so we call the
-                 * correct code for the swapped condition.
+                 * We need to be careful here: the synthop for this uop
+                 * was resolved for the old condition, so switch to the
+                 * one for the swapped condition resolved along with it.
                  */
-                synthops[i] = get_synthcode_for_cond_branch(op.opcode,
-                        op.cond, op.size, 0);
+                swap(synthops[i], invsynthops[i]);
                 swap(op.riptaken, op.ripseq);
             }
         } else if unlikely (isclass(op.opcode, OPCLASS_INDIR_BRANCH)) {
@@ -784,8 +785,7 @@ W8 AtomOp::execute_uop(W8 idx)
             if likely (isclass(uop.opcode, OPCLASS_COND_BRANCH)) {
                 assert(realrip == uop.ripseq);
                 uop.cond = invert_cond(uop.cond);
-                synthops[idx] = get_synthcode_for_cond_branch(uop.opcode,
-                        uop.cond, uop.size, 0);
+                swap(synthops[idx], invsynthops[idx]);
                 swap(uop.riptaken, uop.ripseq);
             } else if unlikely (isclass(uop.opcode, OPCLASS_INDIR_BRANCH)) {
                 uop.riptaken = realrip;
@@ -835,6 +835,8 @@ W8 AtomOp::execute_ast(TransOp& uop)
     // Get the Assist function and execute it
     light_assist_func_t assist_func = light_assistid_to_func[assistid];
 
+    core_task_serialize();
+
     stringbuf assist_name;
     assist_name = light_assist_name(assist_func);
     ATOMOPLOG1("Executing assist func ", assist_name); 
@@ -1998,12 +2000,12 @@ bool AtomThread::fetch_check_current_bb()
         current_bb = NULL;
     }
 
-    BasicBlock *bb = bbcache[ctx.cpu_index](fetchrip);
+    BasicBlock *bb = get_bbcache(ctx.cpu_index).lookup(ctx, fetchrip);
 
     if likely (bb) {
         current_bb = bb;
     } else {
-        current_bb = bbcache[ctx.cpu_index].translate(ctx, fetchrip);
+        current_bb = get_bbcache(ctx.cpu_index).translate(ctx, fetchrip);
 
         if unlikely (!current_bb) {
             if(fetchrip.rip == ctx.eip) {
@@ -2020,9 +2022,9 @@ bool AtomThread::fetch_check_current_bb()
     if(current_bb) {
         // acquire a lock on this basic block so its not flushed out
         current_bb->acquire();
-        current_bb->use(sim_cycle);
+        current_bb->use(sim_cycle, ctx.cpu_index);
 
-        if(!current_bb->synthops) {
+        if(!current_bb->execs) {
             synth_uops_for_bb(*current_bb);
         }
 
@@ -2678,7 +2680,7 @@ bool AtomThread::commit_queue()
         st_commit.uops += buf.op->num_uops_used;
 
         if(buf.op->eom || commit_result == COMMIT_BARRIER) {
-            total_insns_committed++;
+            xadd(total_insns_committed, W64(1));
             st_commit.insns++;
             break;
         }
@@ -2795,6 +2797,8 @@ bool AtomThread::handle_interrupt()
  */
 bool AtomThread::handle_barrier()
 {
+    core_task_serialize();
+
     int assistid = ctx.eip;
     assist_func_t assist = (assist_func_t)(Waddr)assistid_to_func[assistid];
     
@@ -3000,6 +3004,12 @@ AtomCore::AtomCore(BaseMachine& machine, int num_threads, const char* name)
 	run_cycle.connect(signal_mem_ptr(*this, &AtomCore::runcycle));
 	marss_register_per_cycle_event(&run_cycle);
 
+    stringbuf profile_group;
+    profile_group << "cores." << name;
+    foreach(i, NUM_STAGES) {
+        stage_profile[i].init(profile_group, stage_names[i]);
+    }
+
     foreach(i, threadcount) {
         Context& ctx = machine.get_next_context();
 
@@ -3022,6 +3032,7 @@ AtomCore::~AtomCore()
 void AtomCore::fetch()
 {
     ATOMCORELOG("fetch()");
+    HostProfileScope profscope(stage_profile[STAGE_FETCH]);
 
     running_thread->fetch();
 }
@@ -3032,6 +3043,7 @@ void AtomCore::fetch()
 void AtomCore::frontend()
 {
     ATOMCORELOG("frontend()");
+    HostProfileScope profscope(stage_profile[STAGE_FRONTEND]);
 
     running_thread->frontend();
 }
@@ -3042,6 +3054,7 @@ void AtomCore::frontend()
 void AtomCore::issue()
 {
     ATOMCORELOG("issue()");
+    HostProfileScope profscope(stage_profile[STAGE_ISSUE]);
 
     in_thread_switch = running_thread->issue();
 }
@@ -3053,6 +3066,7 @@ void AtomCore::issue()
 void AtomCore::complete()
 {
     ATOMCORELOG("complete()");
+    HostProfileScope profscope(stage_profile[STAGE_COMPLETE]);
 
     running_thread->complete();
 }
@@ -3063,6 +3077,7 @@ void AtomCore::complete()
 void AtomCore::forward()
 {
     ATOMCORELOG("forward()");
+    HostProfileScope profscope(stage_profile[STAGE_FORWARD]);
 
     running_thread->forward();
 }
@@ -3078,6 +3093,7 @@ void AtomCore::forward()
 void AtomCore::transfer()
 {
     ATOMCORELOG("transfer()");
+    HostProfileScope profscope(stage_profile[STAGE_TRANSFER]);
 
     running_thread->transfer();
 }
@@ -3088,6 +3104,7 @@ void AtomCore::transfer()
 bool AtomCore::writeback()
 {
     ATOMCORELOG("writeback()");
+    HostProfileScope profscope(stage_profile[STAGE_WRITEBACK]);
 
     return running_thread->writeback();
 }
@@ -3151,6 +3168,7 @@ bool AtomCore::runcycle(void* none)
 
     if(exit_requested) {
         ATOMCORELOG("Exit to qemu requested");
+        core_task_serialize();
         machine.ret_qemu_env = &running_thread->ctx;
         return exit_requested;
     }
@@ -3283,6 +3301,53 @@ void AtomCore::flush_tlb_virt(Context& ctx, Waddr virtaddr)
     }
 }
 
+/**
+ * @brief Insert a page into the TLBs during functional warming
+ *
+ * @param ctx Context that accessed the page
+ * @param virtaddr Virtual address of the access
+ * @param is_icache Access is an instruction fetch
+ *
+ * @return false if ctx doesn't run on this core
+ */
+bool AtomCore::warm_tlb(Context& ctx, W64 virtaddr, bool is_icache)
+{
+    foreach(i, threadcount) {
+        if(threads[i]->ctx.cpu_index == ctx.cpu_index) {
+            if(is_icache)
+                itlb.insert(virtaddr, i);
+            else
+                dtlb.insert(virtaddr, i);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Train branch predictor during functional warming
+ *
+ * @param ctx Context that executed the branch
+ * @param type Branch hint flags
+ * @param branchaddr Address after the branch instruction
+ * @param target Next rip after the branch
+ *
+ * @return false if ctx doesn't run on this core
+ */
+bool AtomCore::warm_branch(Context& ctx, int type, W64 branchaddr,
+        W64 target)
+{
+    foreach(i, threadcount) {
+        if(threads[i]->ctx.cpu_index == ctx.cpu_index) {
+            threads[i]->branchpred.warm(type, branchaddr, target);
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void AtomCore::dump_state(ostream& os)
 {
     os << *this;
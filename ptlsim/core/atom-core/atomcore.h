@@ -17,6 +17,7 @@
 #include <decode.h>
 
 #include <statsBuilder.h>
+#include <hostProfile.h>
 
 #include <atomcore-const.h>
 
@@ -171,6 +172,22 @@ namespace ATOM_CORE_MODEL {
         "ok", "barrier", "interrupt", "smc", "failed",
     };
 
+    enum {
+        STAGE_FETCH = 0,
+        STAGE_FRONTEND,
+        STAGE_ISSUE,
+        STAGE_COMPLETE,
+        STAGE_FORWARD,
+        STAGE_TRANSFER,
+        STAGE_WRITEBACK,
+        NUM_STAGES
+    };
+
+    static const char* stage_names[NUM_STAGES] = {
+        "fetch", "frontend", "issue", "complete", "forward", "transfer",
+        "writeback",
+    };
+
     //
     // Opcodes and properties
     //
@@ -571,6 +588,7 @@ namespace ATOM_CORE_MODEL {
         W32  fu_mask;
 
         uopimpl_func_t synthops[MAX_UOPS_PER_ATOMOP];
+        uopimpl_func_t invsynthops[MAX_UOPS_PER_ATOMOP];
         TransOp        uops[MAX_UOPS_PER_ATOMOP];
         bool           load_requestd[MAX_UOPS_PER_ATOMOP];
         W16            rflags[MAX_UOPS_PER_ATOMOP];
@@ -1044,6 +1062,8 @@ namespace ATOM_CORE_MODEL {
         void check_ctx_changes();
         void flush_tlb(Context& ctx);
         void flush_tlb_virt(Context& ctx, Waddr virtaddr);
+        bool warm_tlb(Context& ctx, W64 virtaddr, bool is_icache);
+        bool warm_branch(Context& ctx, int type, W64 branchaddr, W64 target);
         void dump_state(ostream& os);
         void update_stats();
         void flush_pipeline();
@@ -1082,6 +1102,9 @@ namespace ATOM_CORE_MODEL {
 
 		Signal run_cycle;
 
+        /* Host time profile of each pipeline stage */
+        HostProfileSite stage_profile[NUM_STAGES];
+
         /**
          * @brief Fetch/Decode Queue
          *
@@ -35,6 +35,32 @@ namespace Core {
             virtual void flush_pipeline() = 0;
 		    virtual void dump_configuration(YAML::Emitter &out) const = 0;
 
+            /*
+             * Idle cycle skipping: a core returns the first cycle in which it
+             * has to run again. Cores that can't tell are always busy.
+             */
+            virtual W64 get_next_cycle() { return sim_cycle; }
+            virtual void skip_cycles(W64 cycles) {}
+
+            /*
+             * Functional warming while QEMU fast-forwards: update the TLBs
+             * or the branch predictor of the thread that runs ctx, without
+             * timing or stats. Returns false if ctx doesn't run on this
+             * core.
+             */
+            virtual bool warm_tlb(Context& ctx, W64 virtaddr,
+                    bool is_icache) { return false; }
+            virtual bool warm_branch(Context& ctx, int type, W64 branchaddr,
+                    W64 target) { return false; }
+
+            /*
+             * Uop issue benchmark: rename and dispatch every uop of bb, then
+             * run them through the issue stage, rounds times. Returns the
+             * host ticks spent in the issue stage, 0 if the core can't run
+             * it.
+             */
+            virtual W64 bench_issue(BasicBlock& bb, W64 rounds) { return 0; }
+
             void update_memory_hierarchy_ptr();
 
             BaseMachine& machine;
@@ -466,6 +466,20 @@ void BranchPredictorInterface::annulras(const PredictorUpdate& predinfo) {
   impl->annulras(predinfo);
 };
 
+//
+// Functional warming: train the tables with a branch that QEMU executed,
+// as if it was predicted at fetch and resolved at commit right away.
+// branchaddr is the first byte after the branch, target the next rip.
+//
+void BranchPredictorInterface::warm(int type, W64 branchaddr, W64 target) {
+  PredictorUpdate update = PredictorUpdate();
+
+  impl->predict(update, type, branchaddr, target);
+  if unlikely (type & (BRANCH_HINT_CALL|BRANCH_HINT_RET))
+    impl->updateras(update, branchaddr);
+  impl->update(update, branchaddr, target);
+}
+
 void BranchPredictorInterface::flush() { }
 
 ostream& operator <<(ostream& os, const BranchPredictorInterface& branchpred) {
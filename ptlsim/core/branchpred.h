@@ -72,6 +72,7 @@ struct BranchPredictorInterface {
   void update(PredictorUpdate& update, W64 branchaddr, W64 target);
   void updateras(PredictorUpdate& predinfo, W64 branchaddr);
   void annulras(const PredictorUpdate& predinfo);
+  void warm(int type, W64 branchaddr, W64 target);
   void flush();
 };
 
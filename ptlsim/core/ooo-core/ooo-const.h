@@ -269,6 +269,13 @@ namespace OOO_CORE_MODEL {
     /* Size of unaligned predictor Bloom filter */
     static const int UNALIGNED_PREDICTOR_SIZE = 4096;
 
+    /* Pipeline stages in the host time profile */
+    enum {
+        STAGE_FETCH, STAGE_FRONTEND, STAGE_RENAME, STAGE_DISPATCH,
+        STAGE_ISSUE, STAGE_ISSUE_LOAD, STAGE_ISSUE_STORE, STAGE_COMPLETE,
+        STAGE_TRANSFER, STAGE_WRITEBACK, STAGE_COMMIT, STAGE_TLBWALK,
+        STAGE_COUNT };
+
     /* String names used in stats labels */
     extern const char* physreg_state_names[MAX_PHYSREG_STATE];
     extern const char* short_physreg_state_names[MAX_PHYSREG_STATE];
@@ -280,6 +287,7 @@ namespace OOO_CORE_MODEL {
 #endif
 
     extern const char* phys_reg_file_names[PHYS_REG_FILE_COUNT];
+    extern const char* stage_names[STAGE_COUNT];
 
 };
 
@@ -61,9 +61,9 @@ void IssueQueue<size, operandcount>::reset(W8 coreid, OooCore* core_) {
     valid = 0;
     issued = 0;
     allready = 0;
-    foreach (i, operandcount) {
-        tags[i].reset();
-    }
+    waiting = 0;
+    columns_used = 0;
+    matrix.reset();
     uopids.reset();
 
     foreach (i, core.threadcount) {
@@ -157,10 +157,7 @@ void IssueQueue<size, operandcount>::reset(W8 coreid, W8 threadid,
  */
 template <int size, int operandcount>
 void IssueQueue<size, operandcount>::clock() {
-    allready = (valid & (~issued));
-    foreach (operand, operandcount) {
-        allready &= ~tags[operand].valid;
-    }
+    allready = (valid & (~issued) & (~waiting));
 }
 
 /**
@@ -187,14 +184,14 @@ bool IssueQueue<size, operandcount>::insert(tag_t uopid, const tag_t* operands,
 
     uopids.insertslot(slot, uopid);
 
+    int col = (~columns_used).lsb();
+    columns_used[col] = 1;
+    columns[slot] = col;
+    slots[col] = slot;
+
     valid[slot] = 1;
     issued[slot] = 0;
-
-    foreach (operand, operandcount) {
-        if likely (preready[operand])
-            tags[operand].invalidateslot(slot);
-        else tags[operand].insertslot(slot, operands[operand]);
-    }
+    waiting[slot] = matrix.insert(col, operands, preready);
 
     return true;
 }
@@ -208,13 +205,16 @@ bool IssueQueue<size, operandcount>::insert(tag_t uopid, const tag_t* operands,
  *
  * @return True.
  *
- * This is used to wakeup dependent entries in issue-queue.
+ * This is used to wakeup dependent entries in issue-queue. Only the entries
+ * in the wakeup matrix row of the tag are visited.
  */
 template <int size, int operandcount>
 bool IssueQueue<size, operandcount>::broadcast(tag_t uopid) {
-    vec_t tagvec = assoc_t::prep(uopid);
+    bitvec<size> woken = matrix.wakeup(uopid);
 
-    foreach (operand, operandcount) tags[operand].invalidate(tagvec);
+    for (int col = woken.lsb(-1); col >= 0; col = woken.nextlsb(col)) {
+        waiting[slot_of_column(col)] = 0;
+    }
 
     return true;
 }
@@ -262,12 +262,7 @@ bool IssueQueue<size, operandcount>::replay(int slot, const tag_t* operands, con
     assert(issued[slot]);
 
     issued[slot] = 0;
-
-    foreach (operand, operandcount) {
-        if (preready[operand])
-            tags[operand].invalidateslot(slot);
-        else tags[operand].insertslot(slot, operands[operand]);
-    }
+    waiting[slot] = matrix.insert(columns[slot], operands, preready);
 
     return true;
 }
@@ -314,15 +309,21 @@ bool IssueQueue<size, operandcount>::switch_to_end(int slot, const tag_t* operan
  */
 template <int size, int operandcount>
 bool IssueQueue<size, operandcount>::remove(int slot) {
-    uopids.collapse(slot);
+    int col = columns[slot];
+    matrix.clear(col);
+    columns_used[col] = 0;
 
-    foreach (i, operandcount) {
-        tags[i].collapse(slot);
+    uopids.collapse(slot);
+    if likely (slot < count - 1) {
+        memmove(&columns[slot], &columns[slot + 1],
+                (count - slot - 1) * sizeof(columns[0]));
+        for (int i = slot; i < count - 1; i++) slots[columns[i]] = i;
     }
 
     valid = valid.remove(slot, 1);
     issued = issued.remove(slot, 1);
     allready = allready.remove(slot, 1);
+    waiting = waiting.remove(slot, 1);
 
     count--;
     assert(count >= 0);
@@ -350,7 +351,9 @@ ostream& IssueQueue<size, operandcount>::print(ostream& os) const {
            ((allready[i]) ? 'R' : '-'), ' ';
         foreach (j, operandcount) {
             if (j) os << ' ';
-            tags[j].printid(os, i);
+            if (i < count)
+                matrix.printid(os, columns[i], j);
+            else os << "???";
         }
         os << endl;
     }
@@ -437,7 +440,7 @@ int ReorderBufferEntry::issue() {
         return ISSUE_COMPLETED;
     }
 
-    W32 executable_on_fu = fuinfo[uop.opcode].fu & clusters[cluster].fu_mask & core.fu_avail;
+    W32 executable_on_fu = executable_on_fu_mask & clusters[cluster].fu_mask & core.fu_avail;
 
     /* Are any FUs available in this cycle? */
     if unlikely (!executable_on_fu) {
@@ -496,7 +499,7 @@ int ReorderBufferEntry::issue() {
     fu = lsbindex(executable_on_fu);
     clearbit(core.fu_avail, fu);
     core.robs_on_fu[fu] = this;
-    cycles_left = fuinfo[uop.opcode].latency;
+    cycles_left = latency;
     changestate(thread.rob_issued_list[cluster]);
 
     IssueState state;
@@ -674,12 +677,12 @@ int ReorderBufferEntry::issue() {
                     uop.cond = invert_cond(uop.cond);
 
                     /*
-                     * We need to be careful here: we already looked up the synthop for this
-                     * uop according to the old condition, so redo that here so we call the
-                     * correct code for the swapped condition.
+                     * We need to be careful here: the synthop for this uop was
+                     * resolved for the old condition, so switch to the one for
+                     * the swapped condition resolved along with it.
                      */
 
-                    uop.synthop = get_synthcode_for_cond_branch(uop.opcode, uop.cond, uop.size, 0);
+                    swap(uop.synthop, uop.invsynthop);
                     swap(uop.riptaken, uop.ripseq);
                 } else if unlikely (isclass(uop.opcode, OPCLASS_INDIR_BRANCH)) {
                     uop.riptaken = realrip;
@@ -1019,6 +1022,7 @@ bool ReorderBufferEntry::release_mem_lock(bool forced) {
  * When the store is replayed and rescheduled, it must now have all operands ready this time.
  */
 int ReorderBufferEntry::issuestore(LoadStoreQueueEntry& state, Waddr& origaddr, W64 ra, W64 rb, W64 rc, bool rcready, PTEUpdate& pteupdate) {
+    time_this_scope(STAGE_ISSUE_STORE);
     ThreadContext& thread = getthread();
     Queue<LoadStoreQueueEntry, LSQ_SIZE>& LSQ = thread.LSQ;
     LoadStoreAliasPredictor& lsap = thread.lsap;
@@ -1059,6 +1063,7 @@ int ReorderBufferEntry::issuestore(LoadStoreQueueEntry& state, Waddr& origaddr,
     thread.thread_stats.dcache.store.size[sizeshift]++;
 
     state.physaddr = (annul) ? INVALID_PHYSADDR : (physaddr >> 3);
+    thread.update_lsq_shadow(state);
 
 /*
  *     The STQ is then searched for the most recent prior store S to same 64-bit block. If found, U's
@@ -1079,46 +1084,36 @@ int ReorderBufferEntry::issuestore(LoadStoreQueueEntry& state, Waddr& origaddr,
  *
  */
     LoadStoreQueueEntry* sfra = NULL;
+    LSQShadow& shadow = thread.lsq_shadow;
 
-    foreach_backward_before(LSQ, lsq, i) {
-        LoadStoreQueueEntry& stbuf = LSQ[i];
-
-        /* Skip over loads (we only care about the store queue subset): */
-        if likely (!stbuf.store) continue;
-
-        if likely (stbuf.addrvalid) {
-
-            /* Only considered a match if it's not a fence (which doesn't match anything) */
-            if unlikely (stbuf.lfence | stbuf.sfence) continue;
-
-            int x = (stbuf.physaddr - state.physaddr);
-            if(-1 <= x && x <= 1) {
-                 /*
-                  * Stores are unaligned and the load with more than two matching stores
-                  * in qeueu will not be issued, so we can issue stores that overlap
-                  * without any problem.
-                  */
-                sfra = NULL;
-                // sfra = &stbuf;
-                break;
-            }
-        } else {
+    /* Only the store queue subset is searched */
+    LSQMask stores = shadow.store &
+        LSQShadow::older(LSQ.head, lsq->index());
 
-            /*
-             *  Address is unknown: stores to a given word must issue in program order
-             *  to composite data correctly, but we can't do that without the address.
-             *
-             *  This also catches any unresolved store fences (but not load fences).
-             */
+     /*
+      * Resolved stores only match if they are not fences (which don't match
+      * anything). Stores are unaligned and the load with more than two
+      * matching stores in queue will not be issued, so we can issue stores
+      * that overlap without any problem: a match ends the search with no
+      * dependency.
+      */
+    LSQMask matching = stores & shadow.addrvalid &
+        ~(shadow.lfence | shadow.sfence) & shadow.near(state.physaddr);
 
-            if unlikely (stbuf.lfence & !stbuf.sfence) {
-                /* Stores can always pass load fences */
-                continue;
-            }
+     /*
+      *  Address is unknown: stores to a given word must issue in program order
+      *  to composite data correctly, but we can't do that without the address.
+      *
+      *  This also catches any unresolved store fences but not load fences,
+      *  stores can always pass load fences.
+      */
+    LSQMask unresolved = stores & ~shadow.addrvalid &
+        ~(shadow.lfence & ~shadow.sfence);
 
-            sfra = &stbuf;
-            break;
-        }
+    int slot = (matching | unresolved).youngest_before(lsq->index());
+    if (slot >= 0 && unresolved.test(slot)) {
+        sfra = &LSQ[slot];
+        assert(!sfra->addrvalid);
     }
 
     bool ready = (!sfra || (sfra && sfra->addrvalid && sfra->datavalid)) && rcready;
@@ -1199,16 +1194,19 @@ int ReorderBufferEntry::issuestore(LoadStoreQueueEntry& state, Waddr& origaddr,
      * itself and the load after it in program order at commit time.
      */
 
-    foreach_forward_after (LSQ, lsq, i) {
+    LSQMask loads = ~shadow.store & shadow.addrvalid &
+        shadow.near(state.physaddr) &
+        LSQShadow::younger(lsq->index(), LSQ.tail);
+
+    for (int i = loads.oldest_after(lsq->index()); i >= 0;
+            loads.assign(i, 0), i = loads.oldest_after(lsq->index())) {
         LoadStoreQueueEntry& ldbuf = LSQ[i];
 
          /*
           * (see notes on Load Replay Conditions below)
           */
 
-        int x = (ldbuf.physaddr - state.physaddr);
-        if unlikely ((!ldbuf.store) & ldbuf.addrvalid & ldbuf.rob->issued &
-                (-1 <= x && x <= 1)) {
+        if unlikely (ldbuf.rob->issued) {
             /*
              *
              *  Check for the extremely rare case where:
@@ -1369,28 +1367,30 @@ W64 ReorderBufferEntry::get_load_data(LoadStoreQueueEntry& state, W64 data){
 
 
     /* Search the store queue for the most recent store to the same address. */
-    foreach_backward_before(LSQ, lsq, i) {
-        LoadStoreQueueEntry& stbuf = LSQ[i];
-
-        /* Skip over loads (we only care about the store queue subset): */
-        if likely (!stbuf.store) continue;
-
-        if likely (stbuf.addrvalid) {
-            /* Only considered a match if it's not a fence (which doesn't match anything) */
-            if unlikely (stbuf.lfence | stbuf.sfence) continue;
-            if (stbuf.physaddr == state.physaddr) {
-                sfra = &stbuf;
-                break;
-            }
-        } else {
-            if unlikely (stbuf.lfence) {
-                assert(0);  /* this should never happened because issueload() already make sure the dependency. */
-                break;
-            }
-            if unlikely (stbuf.sfence) {
-                continue;
-            }
+    LSQShadow& shadow = thread.lsq_shadow;
+    LSQMask stores = shadow.store &
+        LSQShadow::older(LSQ.head, lsq->index());
+
+    /* Only considered a match if it's not a fence (which doesn't match anything) */
+    LSQMask matching = stores & shadow.addrvalid &
+        ~(shadow.lfence | shadow.sfence) & shadow.same(state.physaddr);
+
+    /* The shadow only compares the low address bits */
+    int slot;
+    while ((slot = matching.youngest_before(lsq->index())) >= 0) {
+        if (LSQ[slot].physaddr == state.physaddr) {
+            sfra = &LSQ[slot];
+            break;
         }
+        matching.assign(slot, 0);
+    }
+
+    /* this should never happened because issueload() already make sure the dependency. */
+    int lfence = (stores & ~shadow.addrvalid & shadow.lfence).youngest_before(lsq->index());
+    if unlikely (lfence >= 0 && (!sfra || LSQShadow::distance(lfence, lsq->index()) <
+                LSQShadow::distance(slot, lsq->index()))) {
+        assert(0);
+        sfra = NULL;
     }
 
     PhysicalRegister& rb = *operands[RB];
@@ -1436,6 +1436,7 @@ W64 ReorderBufferEntry::get_load_data(LoadStoreQueueEntry& state, W64 data){
  * registers and MSR registers).
  */
 int ReorderBufferEntry::issueload(LoadStoreQueueEntry& state, Waddr& origaddr, W64 ra, W64 rb, W64 rc, PTEUpdate& pteupdate) {
+    time_this_scope(STAGE_ISSUE_LOAD);
 
     OooCore& core = getcore();
     ThreadContext& thread = getthread();
@@ -1476,6 +1477,7 @@ int ReorderBufferEntry::issueload(LoadStoreQueueEntry& state, Waddr& origaddr, W
     thread.thread_stats.dcache.load.size[sizeshift]++;
 
     state.physaddr = (annul) ? INVALID_PHYSADDR : (physaddr >> 3);
+    thread.update_lsq_shadow(state);
 
     W64 data;
 
@@ -1502,56 +1504,51 @@ int ReorderBufferEntry::issueload(LoadStoreQueueEntry& state, Waddr& origaddr, W
      *
      */
 
-    int sfra_addr_diff;
-    bool all_sfra_datavalid = true;
-
-    foreach_backward_before(LSQ, lsq, i) {
-        LoadStoreQueueEntry& stbuf = LSQ[i];
+    LSQShadow& shadow = thread.lsq_shadow;
 
-        /* Skip over loads (we only care about the store queue subset): */
-        if likely (!stbuf.store) continue;
+    /* Only the store queue subset is searched */
+    LSQMask stores = shadow.store &
+        LSQShadow::older(LSQ.head, lsq->index());
 
-        if likely (stbuf.addrvalid) {
-            /* Only considered a match if it's not a fence (which doesn't match anything) */
-            if unlikely (stbuf.lfence | stbuf.sfence) continue;
+    /* Only considered a match if it's not a fence (which doesn't match anything) */
+    LSQMask matching = stores & shadow.addrvalid &
+        ~(shadow.lfence | shadow.sfence) & shadow.near(state.physaddr);
 
-            sfra_addr_diff = (stbuf.physaddr - state.physaddr);
-            if(-1 <= sfra_addr_diff && sfra_addr_diff <= 1) {
-                thread.thread_stats.dcache.load.dependency.stq_address_match++;
-                if(sfra == NULL) sfra = &stbuf;
-                all_sfra_datavalid &= stbuf.datavalid;
-                continue;
-            }
+    /*
+     * Unresolved stores younger than the youngest match stop the search:
+     * if load address is mmio then dont let it issue before any unresolved
+     * store, otherwise it waits for memory fences that haven't committed
+     * and, if it is known to alias with prior stores and therefore cannot
+     * be hoisted, for unresolved stores. Loads can always pass store fences.
+     */
+    LSQMask blocking = stores & ~shadow.addrvalid;
+    if likely (!state.mmio) {
+        blocking = blocking & (shadow.lfence |
+                (load_is_known_to_alias_with_store ? ~shadow.sfence :
+                 LSQMask::range(0, 0)));
+    }
+
+    int match = matching.youngest_before(lsq->index());
+    int block = blocking.youngest_before(lsq->index());
+
+    if unlikely (block >= 0 && (match < 0 ||
+                LSQShadow::distance(block, lsq->index()) <
+                LSQShadow::distance(match, lsq->index()))) {
+        sfra = &LSQ[block];
+        assert(!sfra->addrvalid);
+
+        if unlikely (state.mmio) {
+            thread.thread_stats.dcache.load.dependency.mmio++;
+        } else if unlikely (sfra->lfence) {
+            thread.thread_stats.dcache.load.dependency.fence++;
         } else {
-
-            if (sfra != NULL) continue;
-
-            /* If load address is mmio then dont let it issue before unresolved store */
-            if unlikely (state.mmio) {
-                thread.thread_stats.dcache.load.dependency.mmio++;
-                sfra = &stbuf;
-                break;
-            }
-
-            /* Address is unknown: is it a memory fence that hasn't committed? */
-            if unlikely (stbuf.lfence) {
-                thread.thread_stats.dcache.load.dependency.fence++;
-                sfra = &stbuf;
-                break;
-            }
-
-            if unlikely (stbuf.sfence) {
-                /* Loads can always pass store fences */
-                continue;
-            }
-
-            /* Is this load known to alias with prior stores, and therefore cannot be hoisted? */
-            if unlikely (load_is_known_to_alias_with_store) {
-                thread.thread_stats.dcache.load.dependency.predicted_alias_unresolved++;
-                sfra = &stbuf;
-                break;
-            }
+            thread.thread_stats.dcache.load.dependency.predicted_alias_unresolved++;
         }
+    } else if (match >= 0) {
+        sfra = &LSQ[match];
+        assert(sfra->addrvalid);
+        thread.thread_stats.dcache.load.dependency.stq_address_match +=
+            matching.popcount();
     }
 
     thread.thread_stats.dcache.load.dependency.independent += (sfra == NULL);
@@ -1683,6 +1680,7 @@ int ReorderBufferEntry::issueload(LoadStoreQueueEntry& state, Waddr& origaddr, W
     }
 
     state.addrvalid = 1;
+    thread.update_lsq_shadow(state);
     generated_addr = addr;
     original_addr = origaddr;
     annul_flag = annul;
@@ -1763,13 +1761,21 @@ int ReorderBufferEntry::issueload(LoadStoreQueueEntry& state, Waddr& origaddr, W
     request->set_memoryStat(&thread.thread_stats.memory);
 #endif
 
+    /*
+     * Hold on to the request, a fast path hit drops the last reference of
+     * the cache inside access_cache() and dcache_wakeup still reads it.
+     */
+    request->incRefCounter();
     bool L1hit = core.memoryHierarchy->access_cache(request);
 
     if(L1hit) {
         changestate(thread.rob_cache_miss_list); /* This is hack for 'dcache_wakeup' to work */
         core.dcache_wakeup((void*)request);
         thread.thread_stats.dcache.load.issue.hit++;
-    } else {
+    }
+    request->decRefCounter();
+
+    if(!L1hit) {
         thread.thread_stats.dcache.load.issue.miss++;
 
         cycles_left = 0;
@@ -1808,6 +1814,8 @@ void ReorderBufferEntry::issueast(IssueState& state, W64 assistid, W64 ra,
     light_assist_func_t assist_func = light_assistid_to_func[assistid];
     assert(assist_func != NULL);
 
+    core_task_serialize();
+
     Context& ctx = getthread().ctx;
 
     W16 new_flags = raflags;
@@ -1894,6 +1902,7 @@ bool ReorderBufferEntry::probetlb(LoadStoreQueueEntry& state, Waddr& origaddr, W
 #endif
 
     addrgen(state, origaddr, virtpage, ra, rb, rc, pteupdate, addr, exception, pfec, annul);
+    thread.update_lsq_shadow(state);
 
 #ifndef DISABLE_TLB
     /* First check if its a TLB hit or miss */
@@ -2082,6 +2091,7 @@ rob_cont:
 #endif
 
     lsq->physaddr = pteaddr >> 3;
+    thread.update_lsq_shadow(*lsq);
 
     bool L1_hit = core.memoryHierarchy->access_cache(request);
 
@@ -2098,6 +2108,7 @@ rob_cont:
  * @brief 'Tick' each ROB entries in 'TLB-miss' page walk list
  */
 void ThreadContext::tlbwalk() {
+    time_this_scope(STAGE_TLBWALK);
 
     ReorderBufferEntry* rob;
     foreach_list_mutable(rob_tlb_miss_list, rob, entry, nextentry) {
@@ -2120,25 +2131,21 @@ LoadStoreQueueEntry* ReorderBufferEntry::find_nearest_memory_fence() {
     bool ld = isload(uop.opcode);
     bool st = (uop.opcode == OP_st);
 
-    foreach_backward_before(thread.LSQ, lsq, i) {
-        LoadStoreQueueEntry& stbuf = thread.LSQ[i];
-
-        /* Skip over everything except fences */
-        if unlikely (!(stbuf.lfence | stbuf.sfence)) continue;
+    if (!(ld | st)) return NULL;
 
-        /* Skip over fences that have already completed */
-        if unlikely (stbuf.addrvalid) continue;
+    LSQShadow& shadow = thread.lsq_shadow;
 
-        /* Do not allow loads to pass lfence or mfence */
-        /* Do not allow stores to pass sfence or mfence */
-        bool match = (ld) ? stbuf.lfence : (st) ? stbuf.sfence : 0;
-        if unlikely (match) return &stbuf;
-
-        /* Loads can always pass store fences */
-        /* Stores can always pass load fences */
-    }
+    /* Do not allow loads to pass lfence or mfence */
+    /* Do not allow stores to pass sfence or mfence */
+    /* Loads can always pass store fences */
+    /* Stores can always pass load fences */
+    /* Skip over fences that have already completed */
+    LSQMask fences = ((ld) ? shadow.lfence : shadow.sfence) &
+        ~shadow.addrvalid &
+        LSQShadow::older(thread.LSQ.head, lsq->index());
 
-    return NULL;
+    int slot = fences.youngest_before(lsq->index());
+    return (slot >= 0) ? &thread.LSQ[slot] : NULL;
 }
 
 /**
@@ -2181,6 +2188,7 @@ int ReorderBufferEntry::issuefence(LoadStoreQueueEntry& state) {
     state.datavalid = 0;
     state.addrvalid = 0;
     state.physaddr = bitmask(48-3);
+    thread.update_lsq_shadow(state);
 
     changestate(thread.rob_memory_fence_list);
 
@@ -2403,6 +2411,7 @@ void ReorderBufferEntry::fencewakeup() {
     physreg->complete();
     lsq->datavalid = 1;
     lsq->addrvalid = 1;
+    thread.update_lsq_shadow(*lsq);
 
     cycles_left = 0;
     lfrqslot = -1;
@@ -2564,6 +2573,7 @@ void ReorderBufferEntry::release() {
  * @return Outcome of uop issue (success, fail, reply, skipped etc.)
  */
 int OooCore::issue(int cluster) {
+    time_this_scope(STAGE_ISSUE);
 
     int issuecount = 0;
     int maxwidth = clusters[cluster].issue_width;
@@ -2947,6 +2957,7 @@ void ReorderBufferEntry::redispatch(const bitvec<MAX_OPERANDS>& dependent_operan
         lsq->data = 0;
         lsq->invalid = 0;
         lsq->time_stamp = -1;
+        thread.update_lsq_shadow(*lsq);
 
         if (operands[RS]->nonnull()) {
             operands[RS]->unref(*this, thread.threadid);
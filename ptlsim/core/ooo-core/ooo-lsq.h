@@ -0,0 +1,256 @@
+
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef OOOCORE_LSQ_H
+#define OOOCORE_LSQ_H
+
+#include <globals.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Bitmap with one bit per LSQ slot
+ */
+template <int SIZE>
+struct LSQSlotMask {
+    enum { WORDS = (SIZE + 63) / 64 };
+
+    W64 w[WORDS];
+
+    void reset() {
+        foreach (i, WORDS) w[i] = 0;
+    }
+
+    bool test(int slot) const {
+        return bit(w[slot >> 6], slot & 63);
+    }
+
+    void assign(int slot, bool value) {
+        W64 m = 1ULL << (slot & 63);
+        w[slot >> 6] = (value) ? (w[slot >> 6] | m) : (w[slot >> 6] & ~m);
+    }
+
+    bool nonzero() const {
+        W64 any = 0;
+        foreach (i, WORDS) any |= w[i];
+        return any != 0;
+    }
+
+    int popcount() const {
+        int n = 0;
+        foreach (i, WORDS) n += __builtin_popcountll(w[i]);
+        return n;
+    }
+
+    LSQSlotMask operator &(const LSQSlotMask& rhs) const {
+        LSQSlotMask m;
+        foreach (i, WORDS) m.w[i] = w[i] & rhs.w[i];
+        return m;
+    }
+
+    LSQSlotMask operator |(const LSQSlotMask& rhs) const {
+        LSQSlotMask m;
+        foreach (i, WORDS) m.w[i] = w[i] | rhs.w[i];
+        return m;
+    }
+
+    LSQSlotMask operator ~() const {
+        LSQSlotMask m;
+        foreach (i, WORDS) m.w[i] = ~w[i];
+        return m;
+    }
+
+    /* Highest and lowest slot in the mask, -1 if empty */
+    int highest() const {
+        for (int i = WORDS-1; i >= 0; i--) {
+            if (w[i]) return (i * 64) + 63 - __builtin_clzll(w[i]);
+        }
+        return -1;
+    }
+
+    int lowest() const {
+        foreach (i, WORDS) {
+            if (w[i]) return (i * 64) + __builtin_ctzll(w[i]);
+        }
+        return -1;
+    }
+
+    /* Slots [from, to) */
+    static LSQSlotMask range(int from, int to) {
+        LSQSlotMask m;
+        foreach (i, WORDS) {
+            int lo = max(from - i * 64, 0);
+            int hi = min(to - i * 64, 64);
+            m.w[i] = (lo >= hi) ? 0 :
+                ((hi == 64) ? ~0ULL : ((1ULL << hi) - 1)) & ~((1ULL << lo) - 1);
+        }
+        return m;
+    }
+
+    /*
+     * Youngest slot of a mask of entries older than slot 'idx': the
+     * highest slot below 'idx' or, when the older entries wrap around
+     * the end of the queue, the highest slot above it.
+     */
+    int youngest_before(int idx) const {
+        int slot = (*this & range(0, idx)).highest();
+        return (slot >= 0) ? slot : highest();
+    }
+
+    /* Oldest slot of a mask of entries younger than slot 'idx' */
+    int oldest_after(int idx) const {
+        int slot = (*this & range(idx + 1, SIZE)).lowest();
+        return (slot >= 0) ? slot : lowest();
+    }
+};
+
+/*
+ * Store forwarding search
+ *
+ * Loads and stores search the older part of the LSQ for the youngest
+ * store or fence they depend on. Instead of walking the queue one entry
+ * at a time, LoadStoreQueueShadow keeps the fields these searches look
+ * at as bitmaps over all slots plus an array of the low 32 bits of each
+ * physical address. A search compares the key with all addresses using
+ * SIMD instructions, combines the result with the flag bitmaps and the
+ * slots older than the searching entry, and takes the youngest slot with
+ * a bit scan.
+ *
+ * The shadow must be updated whenever the address, addrvalid bit or
+ * type of an allocated LSQ entry changes.
+ */
+template <int SIZE>
+struct LoadStoreQueueShadow {
+    typedef LSQSlotMask<SIZE> mask_t;
+
+    enum { SLOTS = (SIZE + 7) & ~7 };
+
+    W32 addr[SLOTS];
+    mask_t store;
+    mask_t lfence;
+    mask_t sfence;
+    mask_t addrvalid;
+
+    LoadStoreQueueShadow() { reset(); }
+
+    void reset() {
+        foreach (i, SLOTS) addr[i] = 0;
+        store.reset();
+        lfence.reset();
+        sfence.reset();
+        addrvalid.reset();
+    }
+
+    void update(int slot, W64 physaddr, bool is_store, bool is_lfence,
+            bool is_sfence, bool is_addrvalid) {
+        addr[slot] = (W32)physaddr;
+        store.assign(slot, is_store);
+        lfence.assign(slot, is_lfence);
+        sfence.assign(slot, is_sfence);
+        addrvalid.assign(slot, is_addrvalid);
+    }
+
+    /*
+     * Slots whose address is within one 8-byte word of physaddr, the
+     * same test as (int)(addr - physaddr) in [-1, 1]
+     */
+    mask_t near(W64 physaddr) const {
+        mask_t m;
+        m.reset();
+        W32 bias = 1 - (W32)physaddr;
+
+#if defined(__AVX2__)
+        __m256i vbias = _mm256_set1_epi32(bias);
+        __m256i vsign = _mm256_set1_epi32(0x80000000);
+        __m256i vlimit = _mm256_set1_epi32(0x80000003);
+        for (int i = 0; i < SLOTS; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)&addr[i]);
+            v = _mm256_xor_si256(_mm256_add_epi32(v, vbias), vsign);
+            W64 hit = _mm256_movemask_ps(_mm256_castsi256_ps(
+                        _mm256_cmpgt_epi32(vlimit, v)));
+            m.w[i >> 6] |= hit << (i & 63);
+        }
+#elif defined(__SSE2__)
+        __m128i vbias = _mm_set1_epi32(bias);
+        __m128i vsign = _mm_set1_epi32(0x80000000);
+        __m128i vlimit = _mm_set1_epi32(0x80000003);
+        for (int i = 0; i < SLOTS; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)&addr[i]);
+            v = _mm_xor_si128(_mm_add_epi32(v, vbias), vsign);
+            W64 hit = _mm_movemask_ps(_mm_castsi128_ps(
+                        _mm_cmplt_epi32(v, vlimit)));
+            m.w[i >> 6] |= hit << (i & 63);
+        }
+#else
+        foreach (i, SLOTS) {
+            W64 hit = ((W32)(addr[i] + bias) <= 2);
+            m.w[i >> 6] |= hit << (i & 63);
+        }
+#endif
+
+        return m;
+    }
+
+    /* Slots with the same low 32 address bits as physaddr */
+    mask_t same(W64 physaddr) const {
+        mask_t m;
+        m.reset();
+        W32 key = (W32)physaddr;
+
+#if defined(__AVX2__)
+        __m256i vkey = _mm256_set1_epi32(key);
+        for (int i = 0; i < SLOTS; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)&addr[i]);
+            W64 hit = _mm256_movemask_ps(_mm256_castsi256_ps(
+                        _mm256_cmpeq_epi32(v, vkey)));
+            m.w[i >> 6] |= hit << (i & 63);
+        }
+#elif defined(__SSE2__)
+        __m128i vkey = _mm_set1_epi32(key);
+        for (int i = 0; i < SLOTS; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)&addr[i]);
+            W64 hit = _mm_movemask_ps(_mm_castsi128_ps(
+                        _mm_cmpeq_epi32(v, vkey)));
+            m.w[i >> 6] |= hit << (i & 63);
+        }
+#else
+        foreach (i, SLOTS) {
+            W64 hit = (addr[i] == key);
+            m.w[i >> 6] |= hit << (i & 63);
+        }
+#endif
+
+        return m;
+    }
+
+    /* Slots of entries older than slot 'idx', as foreach_backward_before() */
+    static mask_t older(int head, int idx) {
+        if (idx == head) return mask_t::range(0, 0);
+        if (head < idx) return mask_t::range(head, idx);
+        return mask_t::range(head, SIZE) | mask_t::range(0, idx);
+    }
+
+    /* Slots of entries younger than slot 'idx', as foreach_forward_after() */
+    static mask_t younger(int idx, int tail) {
+        int from = add_index_modulo(idx, +1, SIZE);
+        if (from == tail) return mask_t::range(0, 0);
+        if (from < tail) return mask_t::range(from, tail);
+        return mask_t::range(from, SIZE) | mask_t::range(0, tail);
+    }
+
+    /* Number of entries between slot and the younger slot idx */
+    static int distance(int slot, int idx) {
+        return modulo_span(slot, idx, SIZE);
+    }
+};
+
+#endif // OOOCORE_LSQ_H
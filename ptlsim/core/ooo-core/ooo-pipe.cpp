@@ -287,6 +287,7 @@ void ThreadContext::flush_pipeline() {
         ROB[i].changestate(rob_free_list);
     }
     LSQ.reset();
+    lsq_shadow.reset();
     foreach (i, LSQ_SIZE) {
         LSQ[i].coreid = core.get_coreid();
         LSQ[i].core = &core;
@@ -338,8 +339,8 @@ void ThreadContext::reset_fetch_unit(W64 realrip) {
 void ThreadContext::invalidate_smc() {
     if unlikely (smc_invalidate_pending) {
         if (logable(5)) ptl_logfile << "SMC invalidate pending on ", smc_invalidate_rvp, endl;
-        bbcache[ctx.cpu_index].invalidate_page(smc_invalidate_rvp.mfnlo, INVALIDATE_REASON_SMC);
-        if unlikely (smc_invalidate_rvp.mfnlo != smc_invalidate_rvp.mfnhi) bbcache[ctx.cpu_index].invalidate_page(smc_invalidate_rvp.mfnhi, INVALIDATE_REASON_SMC);
+        get_bbcache(ctx.cpu_index).invalidate_page(smc_invalidate_rvp.mfnlo, INVALIDATE_REASON_SMC);
+        if unlikely (smc_invalidate_rvp.mfnlo != smc_invalidate_rvp.mfnhi) get_bbcache(ctx.cpu_index).invalidate_page(smc_invalidate_rvp.mfnhi, INVALIDATE_REASON_SMC);
         smc_invalidate_pending = 0;
     }
 }
@@ -510,6 +511,7 @@ void OooCore::set_unaligned_hint(const RIPVirtPhysBase& rvp, bool value) {
  * @return True unless there is an exception in Code page
  */
 bool ThreadContext::fetch() {
+    time_this_scope(STAGE_FETCH);
     OooCore& core = getcore();
 
     int fetchcount = 0;
@@ -637,13 +639,13 @@ bool ThreadContext::fetch() {
 
         FetchBufferEntry& transop = *fetchq.alloc();
 
-        uopimpl_func_t synthop = NULL;
+        UopExec exec;
 
-        assert(current_basic_block->synthops);
+        assert(current_basic_block->execs);
 
-        if likely (!unaligned_ldst_buf.get(transop, synthop)) {
+        if likely (!unaligned_ldst_buf.get(transop, exec)) {
             transop = current_basic_block->transops[current_basic_block_transop_index];
-            synthop = current_basic_block->synthops[current_basic_block_transop_index];
+            exec = current_basic_block->execs[current_basic_block_transop_index];
         }
 
         transop.unaligned = ((transop.opcode == OP_ld) | (transop.opcode == OP_ldx) | (transop.opcode == OP_st)) &&
@@ -663,11 +665,12 @@ bool ThreadContext::fetch() {
         //
         if unlikely (transop.unaligned) {
             split_unaligned(transop, unaligned_ldst_buf);
-            assert(unaligned_ldst_buf.get(transop, synthop));
+            assert(unaligned_ldst_buf.get(transop, exec));
         }
 
         assert(transop.bbindex == current_basic_block_transop_index);
-        transop.synthop = synthop;
+        transop.synthop = exec.synthop;
+        transop.invsynthop = exec.invsynthop;
 
         current_basic_block_transop_index += (unaligned_ldst_buf.empty());
 
@@ -721,11 +724,11 @@ bool ThreadContext::fetch() {
                 assert(predrip == transop.ripseq);
                 transop.cond = invert_cond(transop.cond);
                 //
-                // We need to be careful here: we already looked up the synthop for this
-                // uop according to the old condition, so redo that here so we call the
-                // correct code for the swapped condition.
+                // We need to be careful here: the synthop for this uop was
+                // resolved for the old condition, so switch to the one for the
+                // swapped condition resolved along with it.
                 //
-                transop.synthop = get_synthcode_for_cond_branch(transop.opcode, transop.cond, transop.size, 0);
+                swap(transop.synthop, transop.invsynthop);
                 swap(transop.riptaken, transop.ripseq);
             }
         }
@@ -780,12 +783,12 @@ BasicBlock* ThreadContext::fetch_or_translate_basic_block(const RIPVirtPhys& rvp
         current_basic_block = NULL;
     }
 
-    BasicBlock* bb = bbcache[ctx.cpu_index](rvp);
+    BasicBlock* bb = get_bbcache(ctx.cpu_index).lookup(ctx, rvp);
 
     if likely (bb) {
         current_basic_block = bb;
     } else {
-        current_basic_block = bbcache[ctx.cpu_index].translate(ctx, rvp);
+        current_basic_block = get_bbcache(ctx.cpu_index).translate(ctx, rvp);
         if (current_basic_block == NULL) return NULL;
         assert(current_basic_block);
     }
@@ -797,10 +800,10 @@ BasicBlock* ThreadContext::fetch_or_translate_basic_block(const RIPVirtPhys& rvp
       */
 
     current_basic_block->acquire();
-    current_basic_block->use(sim_cycle);
+    current_basic_block->use(sim_cycle, ctx.cpu_index);
 
-    if unlikely (!current_basic_block->synthops) synth_uops_for_bb(*current_basic_block);
-    assert(current_basic_block->synthops);
+    if unlikely (!current_basic_block->execs) synth_uops_for_bb(*current_basic_block);
+    assert(current_basic_block->execs);
 
     current_basic_block_transop_index = 0;
     assert(current_basic_block->rip == rvp);
@@ -812,6 +815,7 @@ BasicBlock* ThreadContext::fetch_or_translate_basic_block(const RIPVirtPhys& rvp
  * @brief Allocate and Rename Stages
  */
 void ThreadContext::rename() {
+    time_this_scope(STAGE_RENAME);
 
     int prepcount = 0;
 
@@ -885,6 +889,7 @@ void ThreadContext::rename() {
             lsq.datavalid = 0;
             lsq.addrvalid = 0;
             lsq.invalid = 0;
+            update_lsq_shadow(lsq);
             loads_in_flight += (st == 0);
             stores_in_flight += (st == 1);
         }
@@ -941,6 +946,8 @@ void ThreadContext::rename() {
           */
 
         rob.executable_on_cluster_mask = uop_executable_on_cluster[transop.opcode];
+        rob.executable_on_fu_mask = fuinfo[transop.opcode].fu;
+        rob.latency = fuinfo[transop.opcode].latency;
 
          /*
           * This is used if there is exactly one physical register file per cluster:
@@ -1034,6 +1041,7 @@ void ThreadContext::rename() {
  * @brief  simulate the delay of the front end satges in the real HW
  */
 void ThreadContext::frontend() {
+    time_this_scope(STAGE_FRONTEND);
 
     ReorderBufferEntry* rob;
     foreach_list_mutable(rob_frontend_list, rob, entry, nextentry) {
@@ -1326,6 +1334,7 @@ int ReorderBufferEntry::select_cluster() {
  * @return number of uops dispathced
  */
 int ThreadContext::dispatch() {
+    time_this_scope(STAGE_DISPATCH);
 
     ReorderBufferEntry* rob;
     foreach_list_mutable(rob_ready_to_dispatch_list, rob, entry, nextentry) {
@@ -1420,6 +1429,105 @@ int ThreadContext::dispatch() {
     return core.dispatchcount;
 }
 
+/**
+ * @brief Issue benchmark: feed the uops of bb through the dispatch and issue
+ * stages of the first thread, rounds times
+ *
+ * The uops are renamed here like rename() does, but with every source
+ * operand mapped to the null register so all of them are ready at
+ * dispatch. Each round starts from a flushed pipeline and issues until the
+ * issue queues are empty. Branches of bb must have the same riptaken and
+ * ripseq, so they never redirect fetch.
+ *
+ * @param bb Block of uops, with their execution records
+ * @param rounds Number of times the block is issued
+ *
+ * @return Host ticks spent in the issue stage
+ */
+W64 OooCore::bench_issue(BasicBlock& bb, W64 rounds) {
+    ThreadContext& thread = *threads[0];
+    W64 ticks = 0;
+
+    assert(bb.execs);
+    assert(bb.count <= ROB_SIZE);
+
+    /* Core stats go to the thread's like in runcycle() */
+    set_default_stats(thread.thread_stats.get_default_stats(), false);
+
+    for (W64 round = 0; round < rounds; round++) {
+        thread.flush_pipeline();
+
+        foreach (i, bb.count) {
+            FetchBufferEntry uop(bb.transops[i]);
+            uop.rip = bb.rip;
+            uop.uuid = round * bb.count + i;
+            uop.threadid = thread.threadid;
+            uop.synthop = bb.execs[i].synthop;
+            uop.invsynthop = bb.execs[i].invsynthop;
+            uop.predinfo = BranchPredictorUpdateInfo();
+
+            ReorderBufferEntry& rob = *thread.ROB.alloc();
+            rob.reset();
+            rob.uop = uop;
+            rob.entry_valid = 1;
+            rob.lsq = NULL;
+
+            foreach (j, MAX_OPERANDS) {
+                rob.operands[j] = &physregfiles[0][PHYS_REG_NULL];
+                rob.operands[j]->addref(rob, thread.threadid);
+            }
+
+            rob.executable_on_cluster_mask = uop_executable_on_cluster[uop.opcode];
+            rob.executable_on_fu_mask = fuinfo[uop.opcode].fu;
+            rob.latency = fuinfo[uop.opcode].latency;
+
+            W32 acceptable_phys_reg_files = phys_reg_files_writable_by_uop(uop);
+            PhysicalRegister* physreg = NULL;
+
+            foreach (j, PHYS_REG_FILE_COUNT) {
+                if (bit(acceptable_phys_reg_files, j) && physregfiles[j].remaining()) {
+                    physreg = physregfiles[j].alloc(thread.threadid);
+                    break;
+                }
+            }
+
+            assert(physreg);
+            physreg->flags = FLAG_WAIT;
+            physreg->data = 0xdeadbeefdeadbeefULL;
+            physreg->rob = &rob;
+            physreg->archreg = uop.rd;
+            rob.physreg = physreg;
+
+            rob.changestate(thread.rob_ready_to_dispatch_list);
+        }
+
+        while (!thread.rob_ready_to_dispatch_list.empty()) {
+            dispatchcount = 0;
+            if (thread.dispatch() <= 0)
+                break;
+        }
+
+        W64 start = rdtsc();
+
+        for (;;) {
+            int issuecount = 0;
+
+            foreach_issueq(clock());
+            fu_avail = bitmask(FU_COUNT);
+            for_each_cluster(cluster) { issuecount += issue(cluster); }
+
+            if (!issuecount)
+                break;
+        }
+
+        ticks += rdtsc() - start;
+    }
+
+    thread.flush_pipeline();
+
+    return ticks;
+}
+
  /**
   * @brief Process any ROB entries that just finished producing a result,
   * forwarding data within the same cluster directly to the waiting
@@ -1433,6 +1541,7 @@ int ThreadContext::dispatch() {
   * @return always returns 0
   */
 int ThreadContext::complete(int cluster) {
+    time_this_scope(STAGE_COMPLETE);
 
     int completecount = 0;
     ReorderBufferEntry* rob;
@@ -1467,6 +1576,7 @@ int ThreadContext::complete(int cluster) {
  * @return  always returns 0
  */
 int ThreadContext::transfer(int cluster) {
+    time_this_scope(STAGE_TRANSFER);
 
     ReorderBufferEntry* rob;
     foreach_list_mutable(rob_completed_list[cluster], rob, entry, nextentry) {
@@ -1491,6 +1601,7 @@ int ThreadContext::transfer(int cluster) {
  * @return number of uops
  */
 int ThreadContext::writeback(int cluster) {
+    time_this_scope(STAGE_WRITEBACK);
 
     int wakeupcount = 0;
     ReorderBufferEntry* rob;
@@ -1613,6 +1724,7 @@ int ThreadContext::writeback(int cluster) {
  *  instructions actually committed
  */
 int ThreadContext::commit() {
+    time_this_scope(STAGE_COMMIT);
 
      /*
       * Commit ROB entries *in program order*, stopping at the first ROB that is
@@ -2284,7 +2396,7 @@ int ReorderBufferEntry::commit() {
     }
 
     if likely (uop.eom) {
-        total_insns_committed++;
+        xadd(total_insns_committed, W64(1));
         thread.thread_stats.commit.insns++;
         thread.total_insns_committed_++;
 
@@ -2302,7 +2414,7 @@ int ReorderBufferEntry::commit() {
         ptl_logfile << "ROB Commit Done...\n", flush;
     }
 
-    total_uops_committed++;
+    xadd(total_uops_committed, W64(1));
     thread.thread_stats.commit.uops++;
     thread.total_uops_committed_++;
 
@@ -0,0 +1,131 @@
+
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef OOOCORE_WAKEUP_H
+#define OOOCORE_WAKEUP_H
+
+#include <globals.h>
+#include <superstl.h>
+
+/*
+ * Issue queue wakeup matrix
+ *
+ * Every issue queue entry owns one column of the matrix for as long as it
+ * is in the queue; unlike issue queue slots, columns do not move when an
+ * older entry is removed. Each row belongs to a producer tag and has a
+ * bit set for every column with an operand waiting on that producer, so
+ * a broadcast only visits the entries that really depend on the tag
+ * instead of comparing it with every operand of every entry.
+ *
+ * Rows are selected with (tag % rows). Tags of different threads can
+ * share a row, so the operand tags are still kept per column and checked
+ * when a row is scanned.
+ */
+template <int size, int rows, int operandcount, typename T>
+struct WakeupMatrix {
+    typedef T tag_t;
+
+    /* Columns with the operand still waiting for its producer */
+    bitvec<size> waiting[operandcount];
+
+    /* Producer tag of each waiting operand */
+    T tags[operandcount][size];
+
+    /* Columns with any operand waiting on a tag of the row */
+    bitvec<size> deps[rows];
+
+    WakeupMatrix() { reset(); }
+
+    static int rowof(T tag) {
+        return tag % rows;
+    }
+
+    void reset() {
+        foreach (operand, operandcount) {
+            waiting[operand] = 0;
+        }
+        foreach (row, rows) {
+            deps[row] = 0;
+        }
+    }
+
+    bool pending(int col) const {
+        foreach (operand, operandcount) {
+            if (waiting[operand][col]) return true;
+        }
+        return false;
+    }
+
+    /* Drop all dependencies of a column */
+    void clear(int col) {
+        foreach (operand, operandcount) {
+            if (!waiting[operand][col]) continue;
+            deps[rowof(tags[operand][col])][col] = 0;
+            waiting[operand][col] = 0;
+        }
+    }
+
+     /*
+      * Replace the dependencies of a column. Returns true if any of its
+      * operands has to wait.
+      */
+    bool insert(int col, const T* operands, const T* preready) {
+        clear(col);
+
+        bool any = false;
+        foreach (operand, operandcount) {
+            if likely (preready[operand]) continue;
+            tags[operand][col] = operands[operand];
+            waiting[operand][col] = 1;
+            deps[rowof(operands[operand])][col] = 1;
+            any = true;
+        }
+
+        return any;
+    }
+
+     /*
+      * Mark all operands waiting on tag as ready. Returns the columns
+      * that have no more waiting operands after this wakeup.
+      */
+    bitvec<size> wakeup(T tag) {
+        bitvec<size> woken = 0;
+        bitvec<size>& row = deps[rowof(tag)];
+        if likely (!row) return woken;
+
+        bitvec<size> cols = row;
+        for (int col = cols.lsb(-1); col >= 0; col = cols.nextlsb(col)) {
+            bool left = false;
+            bool shared = false;
+
+            foreach (operand, operandcount) {
+                if (!waiting[operand][col]) continue;
+                if (tags[operand][col] == tag) {
+                    waiting[operand][col] = 0;
+                } else {
+                    left = true;
+                    shared |= (rowof(tags[operand][col]) == rowof(tag));
+                }
+            }
+
+            if likely (!shared) row[col] = 0;
+            if likely (!left) woken[col] = 1;
+        }
+
+        return woken;
+    }
+
+    ostream& printid(ostream& os, int col, int operand) const {
+        if (waiting[operand][col])
+            os << intstring(tags[operand][col], 3);
+        else os << "???";
+        return os;
+    }
+};
+
+#endif // OOOCORE_WAKEUP_H
@@ -57,6 +57,10 @@ namespace OOO_CORE_MODEL {
 
     const char* phys_reg_file_names[PHYS_REG_FILE_COUNT] = {"int", "fp", "st", "br"};
 
+    const char* stage_names[STAGE_COUNT] = {"fetch", "frontend", "rename",
+        "dispatch", "issue", "issue_load", "issue_store", "complete",
+        "transfer", "writeback", "commit", "tlbwalk"};
+
     const char* fu_names[FU_COUNT] = {
         "ldu0",
         "stu0",
@@ -293,6 +297,12 @@ OooCore::OooCore(BaseMachine& machine_, W8 num_threads,
 	run_cycle.connect(signal_mem_ptr(*this, &OooCore::runcycle));
 	marss_register_per_cycle_event(&run_cycle);
 
+    stringbuf profile_group;
+    profile_group << "cores." << core_name;
+    foreach(i, STAGE_COUNT) {
+        stage_profile[i].init(profile_group, stage_names[i]);
+    }
+
     threads = (ThreadContext**)malloc(sizeof(ThreadContext*) * threadcount);
 
     /* Setup Threads */
@@ -892,8 +902,10 @@ bool OooCore::runcycle(void* none) {
                 }
         }
 
-        if(exiting)
+        if(exiting) {
+            core_task_serialize();
             machine.ret_qemu_env = &thread->ctx;
+        }
     }
 
     // return false;
@@ -957,6 +969,115 @@ bool OooCore::runcycle(void* none) {
     return exiting;
 }
 
+/**
+ * @brief Get the first cycle in which this core has work to do
+ *
+ * The core is idle while all of its threads are idle and the issue queues
+ * are empty, so runcycle() would only count cycles and stalls.
+ *
+ * @return First cycle to run, -1 if no thread is running
+ */
+W64 OooCore::get_next_cycle() {
+    W64 idle = W64(-1);
+
+    foreach (i, threadcount) {
+        idle = min(idle, threads[i]->get_idle_cycles());
+        if likely (!idle) return sim_cycle;
+    }
+
+    for_each_cluster(cluster) {
+        int iqcount = 0;
+        issueq_operation_on_cluster_with_result((*this), cluster, iqcount, count);
+        if (iqcount) return sim_cycle;
+    }
+
+    if (idle == W64(-1)) return W64(-1);
+
+    return sim_cycle + idle;
+}
+
+/**
+ * @brief Account for idle cycles that are not simulated
+ *
+ * @param cycles Number of cycles skipped, at most get_next_cycle() - sim_cycle
+ *
+ * Updates the same counters and stats runcycle() would have updated in each
+ * of the skipped cycles.
+ */
+void OooCore::skip_cycles(W64 cycles) {
+    foreach (i, threadcount) {
+        threads[i]->skip_idle_cycles(cycles);
+    }
+
+    for_each_cluster(cluster) {
+        per_cluster_stats_update(issue.width, cluster, [0] += cycles);
+    }
+
+    round_robin_tid = (round_robin_tid + cycles) % threadcount;
+    core_stats.cycles += cycles;
+}
+
+/**
+ * @brief Get number of upcoming cycles in which this thread has no work
+ *
+ * A thread is idle while it waits out a pause with every uop in its ROB
+ * finished and the frontend unable to bring in any new uop.
+ *
+ * @return Number of idle cycles, 0 if thread is busy
+ */
+W64 ThreadContext::get_idle_cycles() {
+    if unlikely (!ctx.running) return W64(-1);
+
+    if likely (!pause_counter) return 0;
+    if (ctx.check_events()) return 0;
+
+    /* Nothing to dispatch, issue, complete or writeback */
+    if (ROB.count != rob_ready_to_commit_queue.count) return 0;
+
+    /* Nothing to rename */
+    if (!fetchq.empty() && ROB.remaining()) return 0;
+
+    /* Nothing to fetch */
+    if (!stall_frontend && !waiting_for_icache_fill && fetchq.remaining())
+        return 0;
+
+    /* Don't skip over the cycle that reports a deadlock */
+    W64 deadlock_cycle = last_commit_at_cycle +
+        (W64)1024*1024*core.threadcount;
+    if (sim_cycle >= deadlock_cycle) return 0;
+
+    return min(pause_counter, deadlock_cycle - sim_cycle);
+}
+
+/**
+ * @brief Account for skipped idle cycles of this thread
+ *
+ * @param cycles Number of cycles skipped
+ */
+void ThreadContext::skip_idle_cycles(W64 cycles) {
+    if unlikely (!ctx.running) return;
+
+    pause_counter -= cycles;
+
+    CORE_STATS(dispatch.width)[0] += cycles;
+
+    if (fetchq.empty()) {
+        thread_stats.frontend.status.fetchq_empty += cycles;
+    } else {
+        thread_stats.frontend.status.rob_full += cycles;
+    }
+    thread_stats.frontend.width[0] += cycles;
+
+    if (stall_frontend) {
+        thread_stats.fetch.stop.stalled += cycles;
+    } else if (waiting_for_icache_fill) {
+        thread_stats.fetch.stop.icache_miss += cycles;
+    } else {
+        thread_stats.fetch.stop.fetchq_full += cycles;
+        thread_stats.fetch.width[0] += cycles;
+    }
+}
+
 /*
  * ReorderBufferEntry
  */
@@ -990,6 +1111,8 @@ void ReorderBufferEntry::reset() {
     lock_acquired = 0;
     consumer_count = 0;
     executable_on_cluster_mask = 0;
+    executable_on_fu_mask = 0;
+    latency = 0;
     pteupdate = 0;
     cluster = -1;
 #ifdef ENABLE_TRANSIENT_VALUE_TRACKING
@@ -1351,6 +1474,8 @@ ostream& LoadStoreQueueEntry::print(ostream& os) const {
  * @return True, if the barrier handled successfully
  */
 bool ThreadContext::handle_barrier() {
+    core_task_serialize();
+
     /* Release resources of everything in the pipeline: */
 
     core_to_external_state();
@@ -1595,6 +1720,39 @@ void OooCore::flush_tlb_virt(Context& ctx, Waddr virtaddr) {
     /* FIXME AVADH DEFCORE */
 }
 
+bool OooCore::warm_tlb(Context& ctx, W64 virtaddr, bool is_icache) {
+    foreach (i, threadcount) {
+        ThreadContext* thread = threads[i];
+        if (thread->ctx.cpu_index != ctx.cpu_index)
+            continue;
+
+#if 1 /* yclin */
+        ThreadContext::stlb.insert(virtaddr);
+#else
+        if (is_icache)
+            thread->itlb.insert(virtaddr, thread->threadid);
+        else
+            thread->dtlb.insert(virtaddr, thread->threadid);
+#endif
+        return true;
+    }
+
+    return false;
+}
+
+bool OooCore::warm_branch(Context& ctx, int type, W64 branchaddr, W64 target) {
+    foreach (i, threadcount) {
+        ThreadContext* thread = threads[i];
+        if (thread->ctx.cpu_index != ctx.cpu_index)
+            continue;
+
+        thread->branchpred.warm(type, branchaddr, target);
+        return true;
+    }
+
+    return false;
+}
+
 void OooCore::check_ctx_changes()
 {
     foreach(i, threadcount) {
@@ -1694,18 +1852,3 @@ namespace OOO_CORE_MODEL {
     OooCoreBuilder defaultCoreBuilder(OOO_CORE_NAME);
 };
 
-namespace OOO_CORE_MODEL {
-    CycleTimer cttotal;
-    CycleTimer ctfetch;
-    CycleTimer ctdecode;
-    CycleTimer ctrename;
-    CycleTimer ctfrontend;
-    CycleTimer ctdispatch;
-    CycleTimer ctissue;
-    CycleTimer ctissueload;
-    CycleTimer ctissuestore;
-    CycleTimer ctcomplete;
-    CycleTimer cttransfer;
-    CycleTimer ctwriteback;
-    CycleTimer ctcommit;
-};
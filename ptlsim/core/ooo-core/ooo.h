@@ -22,6 +22,9 @@
 
 #include <ooo-const.h>
 #include <ooo-stats.h>
+#include <ooo-lsq.h>
+#include <ooo-wakeup.h>
+#include <hostProfile.h>
 
 /* With these disabled, simulation is faster */
 #define ENABLE_CHECKS
@@ -40,16 +43,9 @@
  *
  */
 
-/* #define ENABLE_SIM_TIMING */
-#ifdef ENABLE_SIM_TIMING
-#define time_this_scope(ct) CycleTimerScope ctscope(ct)
-#define start_timer(ct) ct.start()
-#define stop_timer(ct) ct.stop()
-#else
-#define time_this_scope(ct) (0)
-#define start_timer(ct) (0)
-#define stop_timer(ct) (0)
-#endif
+/* Charge host time of a pipeline stage to the core, see hostProfile.h */
+#define time_this_scope(stage) \
+    HostProfileScope stagescope(getcore().stage_profile[stage])
 
 #define CORE_STATS(var) \
     getcore().core_stats.var(getthread().thread_stats.get_default_stats())
@@ -351,7 +347,17 @@ namespace OOO_CORE_MODEL {
             static const int SIZE = size;
 
             assoc_t uopids;
-            assoc_t tags[operandcount];
+
+             /*
+              * Operand dependencies are tracked by column of the wakeup
+              * matrix; columns[slot] is the column of the uop in a slot and
+              * slots[col] maps a column back to its slot.
+              */
+
+            WakeupMatrix<size, ROB_SIZE, operandcount, issueq_tag_t> matrix;
+            W16 columns[size];
+            W16 slots[size];
+            bitvec<size> columns_used;
 
              /*
               * States:
@@ -365,6 +371,7 @@ namespace OOO_CORE_MODEL {
             bitvec<size> valid;
             bitvec<size> issued;
             bitvec<size> allready;
+            bitvec<size> waiting;
             int count;
             byte coreid;
             OooCore* core;
@@ -408,6 +415,10 @@ namespace OOO_CORE_MODEL {
                 return uopids.search(uopid);
             }
 
+            int slot_of_column(int col) const {
+                return slots[col];
+            }
+
             void reset(W8 coreid, OooCore* core);
             void reset(W8 coreid, W8 threadid, OooCore* core);
             void clock();
@@ -478,6 +489,7 @@ namespace OOO_CORE_MODEL {
         RIPVirtPhys rip;
         W64 uuid;
         uopimpl_func_t synthop;
+        uopimpl_func_t invsynthop;
         BranchPredictorUpdateInfo predinfo;
         W16 index;
         W8 threadid;
@@ -517,6 +529,8 @@ namespace OOO_CORE_MODEL {
         W16s lfrqslot;
         W16s iqslot;
         W16  executable_on_cluster_mask;
+        W32  executable_on_fu_mask;
+        W16s latency;
         W8s  cluster;
         W8   coreid;
         OooCore* core;
@@ -653,6 +667,9 @@ namespace OOO_CORE_MODEL {
         return lsq.print(os);
     }
 
+    typedef LoadStoreQueueShadow<LSQ_SIZE> LSQShadow;
+    typedef LSQShadow::mask_t LSQMask;
+
     struct PhysicalRegisterOperandInfo {
         W32 uuid;
         W16 physreg;
@@ -1057,6 +1074,7 @@ namespace OOO_CORE_MODEL {
         Queue<ReorderBufferEntry, ROB_SIZE> ROB;
 
         Queue<LoadStoreQueueEntry, LSQ_SIZE> LSQ;
+        LSQShadow lsq_shadow;
         RegisterRenameTable specrrt;
         RegisterRenameTable commitrrt;
 
@@ -1134,6 +1152,8 @@ namespace OOO_CORE_MODEL {
         void rename();
         bool fetch();
         void tlbwalk();
+        W64 get_idle_cycles();
+        void skip_idle_cycles(W64 cycles);
 
         bool handle_barrier();
         bool handle_exception();
@@ -1149,6 +1169,12 @@ namespace OOO_CORE_MODEL {
         void flush_mem_lock_release_list(int start = 0);
         int get_priority() const;
 
+        /* Copy the fields searched by loads and stores into lsq_shadow */
+        void update_lsq_shadow(const LoadStoreQueueEntry& lsq) {
+            lsq_shadow.update(lsq.index(), lsq.physaddr, lsq.store,
+                    lsq.lfence, lsq.sfence, lsq.addrvalid);
+        }
+
         void dump_smt_state(ostream& os);
         void print_smt_state(ostream& os);
         void print_rob(ostream& os);
@@ -1325,6 +1351,8 @@ namespace OOO_CORE_MODEL {
 
 		/* Pipeline Stages */
         bool runcycle(void*);
+        W64 get_next_cycle();
+        void skip_cycles(W64 cycles);
         void flush_pipeline();
         bool fetch();
         void rename();
@@ -1338,12 +1366,18 @@ namespace OOO_CORE_MODEL {
 
         void flush_tlb(Context& ctx);
         void flush_tlb_virt(Context& ctx, Waddr virtaddr);
+        bool warm_tlb(Context& ctx, W64 virtaddr, bool is_icache);
+        bool warm_branch(Context& ctx, int type, W64 branchaddr, W64 target);
+        W64 bench_issue(BasicBlock& bb, W64 rounds);
 
 		/* Cache Signals and Callbacks */
         Signal dcache_signal;
         Signal icache_signal;
 		Signal run_cycle;
 
+        /* Host time profile of each pipeline stage */
+        HostProfileSite stage_profile[STAGE_COUNT];
+
         bool dcache_wakeup(void *arg);
         bool icache_wakeup(void *arg);
 
@@ -1381,20 +1415,6 @@ namespace OOO_CORE_MODEL {
 
     void add_checker_store(LoadStoreQueueEntry* lsq, W8 sizeshift);
 
-    extern CycleTimer cttotal;
-    extern CycleTimer ctfetch;
-    extern CycleTimer ctdecode;
-    extern CycleTimer ctrename;
-    extern CycleTimer ctfrontend;
-    extern CycleTimer ctdispatch;
-    extern CycleTimer ctissue;
-    extern CycleTimer ctissueload;
-    extern CycleTimer ctissuestore;
-    extern CycleTimer ctcomplete;
-    extern CycleTimer cttransfer;
-    extern CycleTimer ctwriteback;
-    extern CycleTimer ctcommit;
-
 #ifdef DECLARE_STRUCTURES
 	/*
 	 * The following configuration has two integer/store clusters with a single cycle
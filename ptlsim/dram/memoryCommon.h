@@ -4,6 +4,8 @@
 #include <ostream>
 #include <cassert>
 
+#include <sys/mman.h>
+
 namespace DRAM {
 
 enum CommandType {
@@ -248,49 +250,76 @@ class AssociativeTags
         }
 };
 
+/*
+ * Three level table stored as one flat array, indexed by
+ * (tier1 * count1 + tier2) * count2 + tier3. It is allocated with a single
+ * anonymous mmap, backed by huge pages when the host has them reserved, so
+ * an item costs one memory access and setup and teardown are one call each.
+ */
 template<class DataType>
 class Tier3 {
     private:
-        DataType ***m_data;
+        DataType *m_data;
+        size_t m_size;
+        bool m_mapped;
         int m_count[3];
 
+        static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+        void allocate(size_t bytes) {
+            void *data = MAP_FAILED;
+            m_mapped = true;
+#ifdef MAP_HUGETLB
+            m_size = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+            if (bytes >= HUGE_PAGE_SIZE) {
+                data = mmap(NULL, m_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            }
+#endif
+            if (data == MAP_FAILED) {
+                m_size = bytes;
+                data = mmap(NULL, m_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+                if (data != MAP_FAILED && bytes >= HUGE_PAGE_SIZE) {
+                    madvise(data, m_size, MADV_HUGEPAGE);
+                }
+#endif
+            }
+            if (data == MAP_FAILED) {
+                m_mapped = false;
+                data = new DataType[bytes / sizeof(DataType)];
+            }
+            m_data = (DataType*)data;
+        }
+
     public:
         Tier3(int tier1, int tier2, int tier3, DataType value) {
             m_count[0] = tier1;
             m_count[1] = tier2;
             m_count[2] = tier3;
 
-            m_data = new DataType**[tier1];
-            for (int i=0; i<tier1; i+=1) {
-                m_data[i] = new DataType*[tier2];
-                for (int j=0; j<tier2; j+=1) {
-                    m_data[i][j] = new DataType[tier3];
-                    for (int k=0; k<tier3; k+=1) {
-                        m_data[i][j][k] = value;
-                    }
-                }
+            size_t count = (size_t)tier1 * tier2 * tier3;
+            allocate(count * sizeof(DataType));
+            for (size_t i=0; i<count; i+=1) {
+                m_data[i] = value;
             }
         }
 
         virtual ~Tier3() {
-            for (int i=0; i<m_count[0]; i+=1) {
-                for (int j=0; j<m_count[1]; j+=1) {
-                    delete [] m_data[i][j];
-                }
-                delete [] m_data[i];
+            if (m_mapped) {
+                munmap(m_data, m_size);
+            } else {
+                delete [] m_data;
             }
-            delete [] m_data;
         }
 
-        DataType& item(int tier1, int tier2, int tier3) {
-            return m_data[tier1][tier2][tier3];
+        DataType* row(int tier1, int tier2) {
+            return &m_data[((size_t)tier1 * m_count[1] + tier2) * m_count[2]];
         }
 
-        void swap(int tier1, int tier2, int tier3, int tier3P) {
-            DataType *last_tier = m_data[tier1][tier2];
-            DataType temp = last_tier[tier3];
-            last_tier[tier3] = last_tier[tier3P];
-            last_tier[tier3P] = temp;
+        DataType& item(int tier1, int tier2, int tier3) {
+            return row(tier1, tier2)[tier3];
         }
 };
 
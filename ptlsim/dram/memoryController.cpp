@@ -8,6 +8,15 @@ MemoryController::MemoryController(Config &config, MemoryMapping &mapping, int c
     channel_id(chid)
 {
     channel = new Channel(&config);
+
+    bankTransactions_ = new TransactionEntry*[dramconfig.rankcount * dramconfig.bankcount];
+    for (int i=0; i<dramconfig.rankcount * dramconfig.bankcount; ++i) {
+        bankTransactions_[i] = NULL;
+    }
+
+    scheduleClock_ = 0;
+    nextClock_ = 0;
+    changed_ = false;
     
     Coordinates coordinates = {0};
     int refresh_step = dramconfig.rank_timing.refresh_interval/dramconfig.rankcount;
@@ -31,6 +40,7 @@ MemoryController::MemoryController(Config &config, MemoryMapping &mapping, int c
 
 MemoryController::~MemoryController()
 {
+    delete [] bankTransactions_;
     delete channel;
 }
 
@@ -47,6 +57,14 @@ bool MemoryController::addTransaction(long clock, CommandType type, Coordinates
     queueEntry->type = type;
     queueEntry->coordinates = coordinates;
     queueEntry->request = request;
+
+    TransactionEntry *&head = getBankTransactions(coordinates);
+    queueEntry->bankNext = head;
+    if (head) head->bankPrev = queueEntry;
+    head = queueEntry;
+
+    // new transaction may be issued right away
+    wakeAt(clock);
     
     // update dram status
     RankData &rank = channel->getRankData(coordinates);
@@ -61,6 +79,20 @@ bool MemoryController::addTransaction(long clock, CommandType type, Coordinates
     return true;
 }
 
+void MemoryController::removeTransaction(TransactionEntry *transaction)
+{
+    if (transaction->bankPrev) {
+        transaction->bankPrev->bankNext = transaction->bankNext;
+    } else {
+        getBankTransactions(transaction->coordinates) = transaction->bankNext;
+    }
+    if (transaction->bankNext) {
+        transaction->bankNext->bankPrev = transaction->bankPrev;
+    }
+
+    pendingTransactions_.free(transaction);
+}
+
 bool MemoryController::addCommand(long clock, CommandType type, Coordinates &coordinates, void *request)
 {
     int64_t readyTime, issueTime, finishTime;
@@ -71,7 +103,11 @@ bool MemoryController::addCommand(long clock, CommandType type, Coordinates &coo
     } else {
         issueTime = readyTime;
     }
-    if (readyTime > issueTime) return false;
+    if (readyTime > issueTime) {
+        // retry once issue time has moved up to ready time
+        wakeAt(scheduleClock_ + (readyTime - issueTime));
+        return false;
+    }
     
     CommandEntry *queueEntry = pendingCommands_.alloc();
 
@@ -88,12 +124,28 @@ bool MemoryController::addCommand(long clock, CommandType type, Coordinates &coo
     queueEntry->coordinates = coordinates;
     queueEntry->issueTime   = issueTime;
     queueEntry->finishTime  = finishTime;
+
+    changed_ = true;
     
     return true;
 }
 
+/**
+ * @brief Issue and retire commands of this channel
+ *
+ * A pass that issues or retires nothing leaves all state as it is, and the
+ * next pass makes the same decisions until a ready, finish or refresh time
+ * is reached or a transaction arrives. Such a pass records the earliest of
+ * those clocks and schedule() returns right away until then.
+ */
 void MemoryController::schedule(long clock, Signal &accessCompleted_, Signal &lookupCompleted_)
 {
+    if (clock < nextClock_) return;
+
+    scheduleClock_ = clock;
+    nextClock_ = limits<long>::max;
+    changed_ = false;
+
     /** Transaction to Command */
     
     // Refresh policy
@@ -102,7 +154,10 @@ void MemoryController::schedule(long clock, Signal &accessCompleted_, Signal &lo
         for (coordinates.rank = 0; coordinates.rank < dramconfig.rankcount; ++coordinates.rank) {
             RankData &rank = channel->getRankData(coordinates);
             
-            if (clock < rank.refreshTime) continue;
+            if (clock < rank.refreshTime) {
+                wakeAt(rank.refreshTime);
+                continue;
+            }
             
             // Power up
             if (rank.is_sleeping) {
@@ -162,12 +217,9 @@ void MemoryController::schedule(long clock, Signal &accessCompleted_, Signal &lo
                 bank.hitCount = 0;
 
                 bank.readyTransaction.reset();
-                TransactionEntry *transaction2;
-                foreach_list_mutable(pendingTransactions_.list(), transaction2, entry2, nextentry2) {
-                    Coordinates &coordinates2 = transaction2->coordinates;
-                    if (coordinates2.rank == coordinates.rank && 
-                        coordinates2.bank == coordinates.bank && 
-                        coordinates2.row  == coordinates.row) {
+                for (TransactionEntry *transaction2 = getBankTransactions(coordinates);
+                        transaction2; transaction2 = transaction2->bankNext) {
+                    if (transaction2->coordinates.row == coordinates.row) {
                         bank.readyTransaction.add(transaction2->type);
                     }
                 }
@@ -207,7 +259,7 @@ void MemoryController::schedule(long clock, Signal &accessCompleted_, Signal &lo
                 }
             }
             
-            pendingTransactions_.free(transaction);
+            removeTransaction(transaction);
         }
     }
 
@@ -223,6 +275,8 @@ void MemoryController::schedule(long clock, Signal &accessCompleted_, Signal &lo
                 if (bank.rowBuffer == -1 || bank.totalTransaction.totalCount > 0) continue;
                 
                 int64_t idleTime = clock - dramconfig.max_row_idle;
+                // addCommand() takes -1 as issue at ready time
+                if (idleTime < -1) wakeAt(dramconfig.max_row_idle - 1);
                 if (!addCommand(idleTime, COMMAND_precharge, coordinates, NULL)) continue;
                 rank.activeCount -= 1;
                 bank.rowBuffer = -1;
@@ -252,7 +306,10 @@ void MemoryController::schedule(long clock, Signal &accessCompleted_, Signal &lo
         CommandEntry *command;
         foreach_list_mutable(pendingCommands_.list(), command, entry, nextentry) {
             
-            if (clock < command->finishTime) continue; // in-order
+            if (clock < command->finishTime) { // in-order
+                wakeAt(command->finishTime);
+                continue;
+            }
             
             switch (command->type) {
                 case COMMAND_read:
@@ -271,6 +328,21 @@ void MemoryController::schedule(long clock, Signal &accessCompleted_, Signal &lo
             }
             
             pendingCommands_.free(command);
+            changed_ = true;
         }
     }
+
+    if (changed_) nextClock_ = clock + 1;
+}
+
+/**
+ * @brief Get the first DRAM clock at which schedule() has any work to do
+ *
+ * @param clock Current DRAM clock
+ *
+ * @return DRAM clock of next work, or clock if channel is not idle
+ */
+long MemoryController::get_next_clock(long clock)
+{
+    return max(nextClock_, clock);
 }
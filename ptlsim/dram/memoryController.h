@@ -25,9 +25,15 @@ struct TransactionEntry : public FixStateListObject
 
     void *request;
 
+    /* Transactions queued to the same bank */
+    TransactionEntry *bankPrev;
+    TransactionEntry *bankNext;
+
     void init() {
         missed = false;
         request = NULL;
+        bankPrev = NULL;
+        bankNext = NULL;
     }
 };
 
@@ -55,6 +61,25 @@ class MemoryController
 
         int channel_id;
 
+        /* Head of the transaction list of each bank */
+        TransactionEntry **bankTransactions_;
+
+        /* schedule() does nothing before nextClock_ */
+        long scheduleClock_;
+        long nextClock_;
+        bool changed_;
+
+        TransactionEntry *&getBankTransactions(Coordinates &coordinates) {
+            return bankTransactions_[coordinates.rank * dramconfig.bankcount +
+                coordinates.bank];
+        }
+
+        void wakeAt(long clock) {
+            nextClock_ = min(nextClock_, clock);
+        }
+
+        void removeTransaction(TransactionEntry *transaction);
+
     public:
         MemoryController(Config &config, MemoryMapping &mapping, int chid);
         virtual ~MemoryController();
@@ -68,6 +93,7 @@ class MemoryController
         bool addCommand(long clock, CommandType type, Coordinates &coordinates, void *request);
         
         void schedule(long clock, Signal &accessCompleted_, Signal &lookupCompleted_);
+        long get_next_clock(long clock);
 };
 
 };
@@ -350,8 +350,8 @@ void MemoryControllerHub::issue(RequestEntry *request, int cycle, W64 address)
 
 void MemoryControllerHub::retire(RequestEntry *request)
 {
-    request->request->decRefCounter();
     ADD_HISTORY_REM(request->request);
+    request->request->decRefCounter();
     pendingRequests_.free(request);
     
     if(!pendingRequests_.isFull()) {
@@ -503,6 +503,48 @@ void MemoryControllerHub::cycle()
     }
 }
 
+/**
+ * @brief Get the first CPU cycle in which cycle() has any work to do
+ *
+ * DRAM clocks are converted back to CPU cycles the same way cycle() steps
+ * through them, so the returned cycle is the one that processes the first
+ * non-idle DRAM clock.
+ */
+W64 MemoryControllerHub::get_next_cycle()
+{
+    if (pendingRequests_.count() > 0 || !lookup_queue.empty())
+        return sim_cycle;
+
+    long next = limits<long>::max;
+    for (int channel=0; channel<channelcount; ++channel) {
+        next = min(next, controller[channel]->get_next_clock(clock_mem));
+    }
+
+    if (next == limits<long>::max)
+        return W64(-1);
+
+    /* DRAM clock 'next' is processed in k-th call to cycle() from now */
+    long k = ((next - clock_mem + 1) * clock_den - clock_rem + clock_num - 1) / clock_num;
+    return sim_cycle + k - 1;
+}
+
+/**
+ * @brief Advance DRAM clock over idle CPU cycles
+ *
+ * Only energy accounting of channels is done in idle DRAM clocks.
+ */
+void MemoryControllerHub::skip_cycles(W64 cycles)
+{
+    clock_rem += clock_num * (long)cycles;
+    while (clock_rem >= clock_den) {
+        for (int channel=0; channel<channelcount; ++channel) {
+            controller[channel]->channel->cycle(clock_mem);
+        }
+        clock_mem += 1;
+        clock_rem -= clock_den;
+    }
+}
+
 void MemoryControllerHub::annul_request(MemoryRequest *request)
 {
     RequestEntry *queueEntry;
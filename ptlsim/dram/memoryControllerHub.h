@@ -82,6 +82,8 @@ class MemoryControllerHub : public Controller
         bool wait_interconnect_cb(void *arg);
         
         void cycle();
+        W64 get_next_cycle();
+        void skip_cycles(W64 cycles);
         bool lookup_completed_cb(void *arg);
         
         void annul_request(MemoryRequest *request);
@@ -1,8 +1,15 @@
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
 #include <memoryMapping.h>
 #include <memoryStatistics.h>
 
 using namespace DRAM;
 
+namespace {
+
 struct profile_item_t {
     int count;
     int cluster;
@@ -10,85 +17,140 @@ struct profile_item_t {
     int index;
 };
 
-int profile_compare(const void *p1, const void *p2)
+};
+
+/* Higher counts first, ties broken by higher cluster, group and index */
+static bool profile_before(const profile_item_t &i1, const profile_item_t &i2)
 {
-    const profile_item_t &i1 = *(profile_item_t *)p1;
-    const profile_item_t &i2 = *(profile_item_t *)p2;
     if (i1.count != i2.count)
-        return i2.count - i1.count;
+        return i1.count > i2.count;
     if (i1.cluster != i2.cluster)
-        return i2.cluster - i1.cluster;
+        return i1.cluster > i2.cluster;
     if (i1.group != i2.group)
-        return i2.group - i1.group;
-    if (i1.index != i2.index)
-        return i2.index - i1.index;
-    return 0;
+        return i1.group > i2.group;
+    return i1.index > i2.index;
+}
+
+void MemoryMapping::profile_header(MappingProfileHeader &header)
+{
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAPPING_PROFILE_MAGIC, sizeof(header.magic));
+    header.version = MAPPING_PROFILE_VERSION;
+    header.cluster_width = bitfields.cluster.width;
+    header.group_width = bitfields.group.width;
+    header.index_width = bitfields.index.width;
+    header.count = W64(1) << (bitfields.cluster.width +
+            bitfields.group.width + bitfields.index.width);
+}
+
+/*
+ * Map the profile at 'path' read only and return its access counts, or NULL
+ * if there is none or it was written for another memory geometry. Profiles
+ * of older versions are a bare count array and are accepted by their size.
+ */
+const int* MemoryMapping::profile_map(const char *path, void *&base, size_t &size)
+{
+    MappingProfileHeader expected;
+    profile_header(expected);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    base = MAP_FAILED;
+    size = 0;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size = st.st_size;
+        base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (base == MAP_FAILED)
+        return NULL;
+
+    const MappingProfileHeader *header = (const MappingProfileHeader*)base;
+    if (size == sizeof(*header) + expected.count * sizeof(int) &&
+            memcmp(header, &expected, sizeof(expected)) == 0) {
+        return (const int*)(header + 1);
+    }
+    if (size == expected.count * sizeof(int)) {
+        return (const int*)base;
+    }
+
+    ptl_logfile << "Ignoring asym_map_profiling profile ", path,
+                " of another memory geometry", endl;
+    munmap(base, size);
+    return NULL;
 }
 
 void MemoryMapping::profile_read()
 {
     char path[256];
-    FILE* file;
+    void *base;
+    size_t size;
 
     sprintf(path, "%s.dat", config.log_filename.buf);
 
-    file = fopen(path, "rb");
-    if (file) {
-        size_t profile_count_max = 1;
-        profile_count_max <<= bitfields.cluster.width;
-        profile_count_max <<= bitfields.group.width;
-        profile_count_max <<= bitfields.index.width;
-        size_t profile_count = 0;
-
-        profile_item_t *profile_list = new profile_item_t[profile_count_max];
-        for (int i=0; i<(1<<bitfields.cluster.width); i+=1) {
-            for (int j=0; j<(1<<bitfields.group.width); j+=1) {
-                int showthis = 0;
-                for (int k=0; k<(1<<bitfields.index.width); k+=1) {
-                    //mapping_forward.item(i,j,k) = 1;
-
-                    int accesses;
-                    fread(&accesses, sizeof(accesses), 1, file);
-                    if (accesses) {
-                        profile_item_t &profile_item = profile_list[profile_count];
-                        profile_count += 1;
-
-                        profile_item.count = accesses;
-                        profile_item.cluster = i;
-                        profile_item.group = j;
-                        profile_item.index = k;
-                    }
-                }
-            }
-        }
+    const int *counts = profile_map(path, base, size);
+    if (!counts)
+        return;
 
-        qsort(profile_list, profile_count, sizeof(profile_item_t), profile_compare);
-        for (int i=0; i<profile_count/dramconfig.asym_mat_ratio; i+=1) {
-            Coordinates coordinates;
-            coordinates.cluster = profile_list[i].cluster;
-            coordinates.group = profile_list[i].group;
-            coordinates.index = profile_list[i].index;
-            promote(0, coordinates);
-            /*mapping_forward.item(
-                profile_list[i].cluster, 
-                profile_list[i].group, 
-                profile_list[i].index) = 0;*/
-        }
+    int clusters = 1 << bitfields.cluster.width;
+    int groups = 1 << bitfields.group.width;
+    int indices = 1 << bitfields.index.width;
+    size_t row_count = size_t(clusters) * groups * indices;
 
-        delete [] profile_list;
+    size_t profile_count = 0;
+    for (size_t r=0; r<row_count; r+=1) {
+        profile_count += (counts[r] != 0);
+    }
 
-        fclose(file);
+    profile_item_t *profile_list = new profile_item_t[profile_count];
+    profile_item_t *profile_item = profile_list;
+    const int *count = counts;
+    for (int i=0; i<clusters; i+=1) {
+        for (int j=0; j<groups; j+=1) {
+            for (int k=0; k<indices; k+=1, count+=1) {
+                if (*count) {
+                    profile_item->count = *count;
+                    profile_item->cluster = i;
+                    profile_item->group = j;
+                    profile_item->index = k;
+                    profile_item += 1;
+                }
+            }
+        }
+    }
+    munmap(base, size);
+
+    /* Only the hottest slots are promoted, order just those */
+    size_t promote_count = profile_count / dramconfig.asym_mat_ratio;
+    std::nth_element(profile_list, profile_list + promote_count,
+            profile_list + profile_count, profile_before);
+    std::sort(profile_list, profile_list + promote_count, profile_before);
+
+    for (size_t i=0; i<promote_count; i+=1) {
+        Coordinates coordinates;
+        coordinates.cluster = profile_list[i].cluster;
+        coordinates.group = profile_list[i].group;
+        coordinates.index = profile_list[i].index;
+        promote(0, coordinates);
     }
+
+    delete [] profile_list;
 }
 
 void MemoryMapping::profile_write()
 {
     char path[256];
+    char temp_path[272];
     FILE* file;
     int count_a, count_b, count_c;
     int footprint_a, footprint_b, footprint_c;
 
     sprintf(path, "%s.dat", config.log_filename.buf);
+    sprintf(temp_path, "%s.tmp", path);
     
     count_a = 0;
     count_b = 0;
@@ -97,39 +159,51 @@ void MemoryMapping::profile_write()
     footprint_b = 0;
     footprint_c = 0;
 
-    file = fopen(path, "rb");
-    if (file) {
-        exit(0);
-        for (int i=0; i<(1<<bitfields.cluster.width); i+=1) {
-            for (int j=0; j<(1<<bitfields.group.width); j+=1) {
-                for (int k=0; k<(1<<bitfields.index.width); k+=1) {
-                    int accesse_a, accesse_b;
-                    accesse_a = mapping_accesses.item(i,j,k);
-                    fread(&accesse_b, sizeof(accesse_b), 1, file);
-                    count_a += accesse_a;
-                    count_b += accesse_b;
-                    count_c += abs(accesse_a-accesse_b);
-                    footprint_a += (accesse_a != 0);
-                    footprint_b += (accesse_b != 0);
-                    footprint_c += (accesse_a != accesse_b);
-                }
+    MappingProfileHeader header;
+    profile_header(header);
+
+    int *counts = new int[header.count];
+    int *count = counts;
+    for (int i=0; i<(1<<bitfields.cluster.width); i+=1) {
+        for (int j=0; j<(1<<bitfields.group.width); j+=1) {
+            const MappingEntry *row = mapping.row(i,j);
+            for (int k=0; k<(1<<bitfields.index.width); k+=1, count+=1) {
+                *count = row[k].accesses;
             }
         }
-        fclose(file);
     }
-    
-    file = fopen(path, "wb");
+
+    /* Compare against the profile this run started from */
+    void *base;
+    size_t size;
+    const int *previous = profile_map(path, base, size);
+    if (previous) {
+        for (W64 r=0; r<header.count; r+=1) {
+            int accesse_a = counts[r];
+            int accesse_b = previous[r];
+            count_a += accesse_a;
+            count_b += accesse_b;
+            count_c += abs(accesse_a-accesse_b);
+            footprint_a += (accesse_a != 0);
+            footprint_b += (accesse_b != 0);
+            footprint_c += (accesse_a != accesse_b);
+        }
+        munmap(base, size);
+    }
+
+    /* Replace the profile atomically, other runs may have it mapped */
+    file = fopen(temp_path, "wb");
     if (file) {
-        for (int i=0; i<(1<<bitfields.cluster.width); i+=1) {
-            for (int j=0; j<(1<<bitfields.group.width); j+=1) {
-                for (int k=0; k<(1<<bitfields.index.width); k+=1) {
-                    int accesses = mapping_accesses.item(i,j,k);
-                    fwrite(&accesses, sizeof(accesses), 1, file);
-                }
-            }
+        bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(counts, sizeof(int), header.count, file) == header.count;
+        ok &= (fclose(file) == 0);
+        if (ok) {
+            rename(temp_path, path);
+        } else {
+            unlink(temp_path);
         }
-        fclose(file);
     }
+    delete [] counts;
 
     sprintf(path, "%s.sta", config.log_filename.buf);
     file = fopen(path, "w");
@@ -140,15 +214,23 @@ void MemoryMapping::profile_write()
     }
 }
 
+static MappingEntry initial_entry()
+{
+    MappingEntry entry;
+    entry.timestamp = -1;
+    entry.accesses = 0;
+    entry.migrations = 0;
+    entry.forward = -1;
+    entry.backward = -1;
+    return entry;
+}
+
 MemoryMapping::MemoryMapping(Config &config) : 
     dramconfig(config),
     det_counter(config.asym_det_cache_size, 4, 1),
     map_cache(config.asym_map_cache_size, 4, config.offsetcount),
-    mapping_forward(config.clustercount, config.groupcount, config.indexcount, -1),
-    mapping_backward(config.clustercount, config.groupcount, config.indexcount, -1),
-    mapping_accesses(config.clustercount, config.groupcount, config.indexcount, 0),
-    mapping_migrations(config.clustercount, config.groupcount, config.indexcount, 0),
-    mapping_timestamp(config.clustercount, config.groupcount, config.indexcount, -1)
+    mapping(config.clustercount, config.groupcount, config.indexcount,
+            initial_entry())
 {
     //rep_serial = 0;
     last_access_time = 0;
@@ -177,9 +259,10 @@ MemoryMapping::MemoryMapping(Config &config) :
 
     for (int i=0; i<config.clustercount; i+=1) {
         for (int j=0; j<config.groupcount; j+=1) {
+            MappingEntry *row = mapping.row(i,j);
             for (int k=0; k<config.indexcount; k+=1) {
-                mapping_forward.item(i,j,k) = k;
-                mapping_backward.item(i,j,k) = k;
+                row[k].forward = k;
+                row[k].backward = k;
             }
         }
     }
@@ -217,8 +300,8 @@ void MemoryMapping::translate(W64 address, Coordinates &coordinates)
     coordinates.cluster = bitfields.cluster.value(row);
     coordinates.group   = bitfields.group.value(row);
     coordinates.index   = bitfields.index.value(row ^ (row << bitfields.index.shift));
-    coordinates.place   = mapping_forward.item(
-        coordinates.cluster, coordinates.group, coordinates.index);
+    coordinates.place   = mapping.item(
+        coordinates.cluster, coordinates.group, coordinates.index).forward;
 
     W64 tag = (W64)coordinates.cluster;
     tag = (tag << bitfields.group.width) | coordinates.group;
@@ -266,10 +349,10 @@ void MemoryMapping::update(W64 tag)
 
 bool MemoryMapping::allocate(long current_time, Coordinates &coordinates)
 {
-    int &accesses = mapping_accesses.item(
-        coordinates.cluster, coordinates.group, coordinates.index);
-    long &timestamp = mapping_timestamp.item(
+    MappingEntry &entry = mapping.item(
         coordinates.cluster, coordinates.group, coordinates.index);
+    int &accesses = entry.accesses;
+    long &timestamp = entry.timestamp;
 
     /*long count = accesses + 1;
 
@@ -320,16 +403,15 @@ bool MemoryMapping::promote(long clock, Coordinates &coordinates)
     const int cluster = coordinates.cluster;
     const int group = coordinates.group;
     const int index = coordinates.index;
+    MappingEntry *row = mapping.row(cluster, group);
     int place = 0;
 
     if (dramconfig.asym_rep_order) {
         int victim_place = 0;
         long victim_timestamp = 0;
         for (int search_place=0; search_place<dramconfig.asym_mat_group; search_place+=dramconfig.asym_mat_ratio) {
-            int search_index = mapping_backward.item(
-                cluster, group, search_place);
-            long timestamp = mapping_timestamp.item(
-                cluster, group, search_index);
+            int search_index = row[search_place].backward;
+            long timestamp = row[search_index].timestamp;
             if (victim_timestamp == 0 || victim_timestamp > timestamp) {
                 victim_timestamp = timestamp;
                 victim_place = search_place;
@@ -340,10 +422,8 @@ bool MemoryMapping::promote(long clock, Coordinates &coordinates)
         int last_place = 0;
         long last_timestamp = 0;
         for (int search_place=0; search_place<dramconfig.asym_mat_group; search_place+=dramconfig.asym_mat_ratio) {
-            int search_index = mapping_backward.item(
-                cluster, group, search_place);
-            long timestamp = mapping_timestamp.item(
-                cluster, group, search_index);
+            int search_index = row[search_place].backward;
+            long timestamp = row[search_index].timestamp;
             if (last_timestamp < timestamp) {
                 last_timestamp = timestamp;
                 last_place = search_place;
@@ -360,14 +440,13 @@ bool MemoryMapping::promote(long clock, Coordinates &coordinates)
     //int place = rep_serial;
     //rep_serial = (rep_serial + mat_ratio) % mat_group;
 
-    int indexP = mapping_backward.item(cluster, group, place);
-    int placeP = mapping_forward.item(cluster, group, index);
-    mapping_forward.swap(cluster, group, index, indexP);
-    mapping_backward.swap(cluster, group, place, placeP);
+    int indexP = row[place].backward;
+    int placeP = row[index].forward;
+    swap(row[index].forward, row[indexP].forward);
+    swap(row[place].backward, row[placeP].backward);
     coordinates.place = place;
 
-    int &migrations = mapping_migrations.item(
-        coordinates.cluster, coordinates.group, coordinates.index);
+    int &migrations = row[index].migrations;
     migrations += 1;
     return migrations > 1;
 }
@@ -8,6 +8,36 @@
 
 namespace DRAM {
 
+/*
+ * Mapping state of one row slot. Forward maps the slot index to its place and
+ * backward maps a place back to its index, the other fields belong to the
+ * index. They share one record so a translate or promote touches one line.
+ */
+struct MappingEntry {
+    long timestamp;
+    int accesses;
+    int migrations;
+    short forward;
+    short backward;
+};
+
+/*
+ * Header of an asym_map_profiling profile (<logfile>.dat). It is followed by
+ * 'count' int access counts, one per row slot in cluster, group, index order,
+ * so a profile can be mapped and indexed in place.
+ */
+struct MappingProfileHeader {
+    char magic[8];
+    W32 version;
+    W32 cluster_width;
+    W32 group_width;
+    W32 index_width;
+    W64 count;
+};
+
+#define MAPPING_PROFILE_MAGIC "MARSSMAP"
+#define MAPPING_PROFILE_VERSION 1
+
 class MemoryMapping
 {
     private:
@@ -17,13 +47,11 @@ class MemoryMapping
         
         AssociativeTags<W64, int> det_counter;
         AssociativeTags<W64, int> map_cache;
-        Tier3<short> mapping_forward;
-        Tier3<short> mapping_backward;
-        Tier3<int>   mapping_accesses;
-        Tier3<int>   mapping_migrations;
-        Tier3<long>  mapping_timestamp;
+        Tier3<MappingEntry> mapping;
         long last_access_time;
 
+        void profile_header(MappingProfileHeader &header);
+        const int* profile_map(const char *path, void *&base, size_t &size);
         void profile_read();
         void profile_write();
         
@@ -1073,6 +1073,12 @@ struct LockableFullyAssociativeArray {
     return (way < 0) ? NULL : &data[way];
   }
 
+  // Like probe() but leaves the replacement state untouched
+  V* peek(T tag) {
+    int way = tags.match(tag);
+    return (way < 0) ? NULL : &data[way];
+  }
+
   V* select(T tag, T& oldtag) {
     int way = tags.select(tag, oldtag);
 
@@ -1224,6 +1230,10 @@ struct LockableAssociativeArray {
     return sets[setof(addr)].probe(tagof(addr));
   }
 
+  V* peek(T addr) {
+    return sets[setof(addr)].peek(tagof(addr));
+  }
+
   V* select(T addr, T& oldaddr) {
     return sets[setof(addr)].select(tagof(addr), oldaddr);
   }
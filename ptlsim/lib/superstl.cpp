@@ -1410,30 +1410,109 @@ const W64 expand_8bit_to_64bit_lut[256] alignto(8) = {
 
 // Signal
 
-Signal::Signal()
+Signal::EmitHook Signal::emit_hook = NULL;
+
+#define SIGNAL_NAME_BUCKETS 1024
+
+struct SignalName {
+	const Signal* signal;
+	const char* name;
+	SignalName* next;
+};
+
+/*
+ * Name strings are interned and never freed, so get_name() can return them
+ * while other threads clear names of their signals.
+ */
+struct SignalNameString {
+	char* name;
+	SignalNameString* next;
+};
+
+static SignalName* signal_names[SIGNAL_NAME_BUCKETS];
+static SignalNameString* signal_name_strings[SIGNAL_NAME_BUCKETS];
+static Spinlock signal_names_lock;
+
+static inline SignalName** signal_name_bucket(const Signal* signal)
 {
-	// name_ = NULL;
-	func = NULL;
+	return &signal_names[(Waddr(signal) >> 4) % SIGNAL_NAME_BUCKETS];
+}
+
+/* Called with signal_names_lock held */
+static const char* signal_name_intern(const char* name)
+{
+	W32 hash = 0;
+	for(const char* p = name; *p; p++)
+		hash = (hash * 31) + byte(*p);
+
+	SignalNameString** bucket = &signal_name_strings[
+		hash % SIGNAL_NAME_BUCKETS];
+	for(SignalNameString* str = *bucket; str; str = str->next) {
+		if(strequal(str->name, name))
+			return str->name;
+	}
+
+	SignalNameString* str = new SignalNameString();
+	str->name = strdup(name);
+	str->next = *bucket;
+	*bucket = str;
+	return str->name;
 }
 
 Signal::Signal(const char* name)
+	: named_(false), hook_data(NULL)
 {
-	name_ << name;
-	func = NULL;
+	set_name(name);
 }
 
-void Signal::connect(TFunctor* _func) {
-	func = _func;
+void Signal::set_name(const char *name)
+{
+	if(named_)
+		clear_name();
+
+	SignalName* entry = new SignalName();
+	entry->signal = this;
+
+	signal_names_lock.acquire();
+	entry->name = signal_name_intern(name);
+	SignalName** bucket = signal_name_bucket(this);
+	entry->next = *bucket;
+	*bucket = entry;
+	signal_names_lock.release();
+
+	named_ = true;
 }
 
-bool Signal::emit(void *arg) {
-    assert(name_.size() != 0);
-	bool ret_val = (*func)(arg);
-	return ret_val;
+void Signal::clear_name()
+{
+	signal_names_lock.acquire();
+	SignalName** link = signal_name_bucket(this);
+	while(*link && (*link)->signal != this)
+		link = &(*link)->next;
+
+	SignalName* entry = *link;
+	if(entry)
+		*link = entry->next;
+	signal_names_lock.release();
+
+	delete entry;
+	named_ = false;
 }
 
-TFunctor* superstl::signal_fun_ptr(bool (*_fpt)(void *arg)) {
-	TFunctor2 *t = new TFunctor2(_fpt);
-	return (TFunctor*)t;
+const char* Signal::get_name() const
+{
+	const char* name = "";
+
+	signal_names_lock.acquire();
+	for(SignalName* entry = *signal_name_bucket(this); entry;
+			entry = entry->next) {
+		if(entry->signal == this) {
+			name = entry->name;
+			break;
+		}
+	}
+	signal_names_lock.release();
+
+	return name;
 }
 
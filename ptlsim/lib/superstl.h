@@ -1672,7 +1672,7 @@ namespace superstl {
 
     bitvecbase() { resetop(); }
 
-    bitvecbase(const bitvecbase<N>& vec) { foreach (i, N) w[i] = vec.w[i]; }
+    bitvecbase(const bitvecbase<N>& vec) { for (size_t i = 0; i < N; i++) w[i] = vec.w[i]; }
 
     bitvecbase(unsigned long long val) {
       resetop();
@@ -1694,11 +1694,11 @@ namespace superstl {
     }
 
     void orop(const bitvecbase<N>& x) {
-      foreach (i, N) w[i] |= x.w[i];
+      for (size_t i = 0; i < N; i++) w[i] |= x.w[i];
     }
 
     void xorop(const bitvecbase<N>& x) {
-      foreach (i, N) w[i] ^= x.w[i];
+      for (size_t i = 0; i < N; i++) w[i] ^= x.w[i];
     }
 
     void shiftleftop(size_t shift) {
@@ -1715,7 +1715,7 @@ namespace superstl {
         }
 
         // memset(w, static_cast<T>(0), wshift);
-        foreach (i, wshift) { w[i] = 0; }
+        for (size_t i = 0; i < wshift; i++) { w[i] = 0; }
       }
     }
 
@@ -1734,17 +1734,16 @@ namespace superstl {
         }
 
         //memset(w + limit + 1, static_cast<T>(0), N - (limit + 1));
-        foreach (i, N - (limit + 1)) { w[limit + 1 + i] = 0; }
+        for (size_t i = 0; i < N - (limit + 1); i++) { w[limit + 1 + i] = 0; }
       }
     }
 
     void maskop(size_t count) {
-      T m =
-        (!count) ? 0 :
-        (count % BITS_PER_WORD) ? ((T(1) << bitof(count)) - T(1)) :
-        T(-1);
+      if unlikely (wordof(count) >= N) return;
 
-      w[wordof(count)] &= m;
+      // Bits at and above count are cleared, including the whole word
+      // when count is a multiple of the word size
+      w[wordof(count)] &= (T(1) << bitof(count)) - T(1);
 
       for (size_t i = wordof(count)+1; i < N; i++) {
         w[i] = 0;
@@ -1752,24 +1751,24 @@ namespace superstl {
     }
 
     void invertop() {
-      foreach (i, N) w[i] = ~w[i];
+      for (size_t i = 0; i < N; i++) w[i] = ~w[i];
     }
 
     void setallop() {
-      foreach (i, N) w[i] = ~static_cast<T>(0);
+      for (size_t i = 0; i < N; i++) w[i] = ~static_cast<T>(0);
     }
 
     void resetop() { memset(w, 0, N * sizeof(T)); }
 
     bool equalop(const bitvecbase<N>& x) const {
       T t = 0;
-      foreach (i, N) { t |= (w[i] ^ x.w[i]); }
+      for (size_t i = 0; i < N; i++) { t |= (w[i] ^ x.w[i]); }
       return (t == 0);
     }
 
     bool nonzeroop() const {
       T t = 0;
-      foreach (i, N) { t |= w[i]; }
+      for (size_t i = 0; i < N; i++) { t |= w[i]; }
       return (t != 0);
     }
 
@@ -1805,7 +1804,7 @@ namespace superstl {
 
     // find index of first "1" bit starting from low end
     size_t lsbop(size_t notfound) const {
-      foreach (i, N) {
+      for (size_t i = 0; i < N; i++) {
         T t = w[i];
         if likely (t) return (i * BITS_PER_WORD) + __builtin_ctzl(t);
       }
@@ -3929,67 +3928,132 @@ namespace superstl {
     ~ScopedLock() { lock.release(); }
   };
 
-  class TFunctor {
-	  public:
-		  virtual bool operator()(void* arg) = 0;
-  };
-
-  template<class T>
-	  class TFunctor1 : public TFunctor {
-		  private:
-			  bool (T::*fpt)(void *arg);
-			  T& obj;
-
-		  public:
-			  TFunctor1(T& _obj, bool (T::*_fpt)(void *arg)) :
-				  obj(_obj) {
-					  fpt = _fpt;
-				  };
-
-			  virtual bool operator()(void *arg) {
-				  return (obj.*fpt)(arg);
-			  };
-	  };
-
-  class TFunctor2 : public TFunctor {
+  /*
+   * Callback of a Signal
+   *
+   * Holds the object and its member function pointer inline and calls them
+   * through a thunk instantiated for the object type, so connecting a
+   * signal does not allocate and emitting it does not need a virtual call.
+   */
+  class SignalDelegate {
 	  private:
-		  bool (*fpt)(void *arg);
+		  struct Generic { };
+		  typedef bool (Generic::*GenericMemFn)(void *arg);
+		  typedef bool (*Thunk)(const SignalDelegate& d, void *arg);
+
+		  void* obj;
+		  Thunk thunk;
+		  union {
+			  GenericMemFn align;
+			  char bytes[sizeof(GenericMemFn)];
+		  } fn;
+
+		  template<class T>
+			  static bool member_thunk(const SignalDelegate& d, void *arg) {
+				  bool (T::*fpt)(void *arg);
+				  memcpy(&fpt, d.fn.bytes, sizeof(fpt));
+				  return (((T*)d.obj)->*fpt)(arg);
+			  }
 
-	  public:
-		  TFunctor2(bool (*_fpt)(void *arg)) :
-			  fpt(_fpt) {}
-		  virtual bool operator()(void *arg) {
+		  static bool function_thunk(const SignalDelegate& d, void *arg) {
+			  bool (*fpt)(void *arg);
+			  memcpy(&fpt, d.fn.bytes, sizeof(fpt));
 			  return (*fpt)(arg);
 		  }
+
+	  public:
+		  SignalDelegate() : obj(NULL), thunk(NULL) { }
+
+		  template<class T>
+			  SignalDelegate(T& _obj, bool (T::*_fpt)(void *arg)) {
+				  // Fails to compile if the member pointer does not fit
+				  typedef char fits[(sizeof(_fpt) <= sizeof(fn.bytes)) ? 1 : -1]
+					  __attribute__((unused));
+				  obj = (void*)&_obj;
+				  thunk = &member_thunk<T>;
+				  memcpy(fn.bytes, &_fpt, sizeof(_fpt));
+			  }
+
+		  SignalDelegate(bool (*_fpt)(void *arg)) {
+			  obj = NULL;
+			  thunk = &function_thunk;
+			  memcpy(fn.bytes, &_fpt, sizeof(_fpt));
+		  }
+
+		  bool connected() const { return thunk != NULL; }
+
+		  bool operator()(void *arg) const {
+			  return (*thunk)(*this, arg);
+		  }
   };
 
   template<class T>
-	  TFunctor* signal_mem_ptr(T& _obj, bool (T::*_fpt)(void *arg)) {
-		  TFunctor1<T> *t = new TFunctor1<T>(_obj, _fpt);
-		  return (TFunctor*)t;
+	  SignalDelegate signal_mem_ptr(T& _obj, bool (T::*_fpt)(void *arg)) {
+		  return SignalDelegate(_obj, _fpt);
 	  }
 
-  TFunctor* signal_fun_ptr(bool (*_fpt)(void *arg));
+  static inline SignalDelegate signal_fun_ptr(bool (*_fpt)(void *arg)) {
+	  return SignalDelegate(_fpt);
+  }
 
+  /*
+   * Signal names are kept in a side table and only looked up for logging,
+   * emitting a signal only touches its delegate.
+   */
   class Signal {
 	  private:
-		  stringbuf name_;
-		  TFunctor* func;
+		  SignalDelegate func;
+		  bool named_;
+
+		  void clear_name();
 
 	  public:
-		  Signal();
+		  /* Called by emit() instead of the connected function, if set */
+		  typedef bool (*EmitHook)(Signal& signal, void *arg);
+		  static EmitHook emit_hook;
+
+		  /* Data of the emit hook for this signal */
+		  void* hook_data;
+
+		  Signal() : named_(false), hook_data(NULL) { }
 		  Signal(const char* name);
 
-          ~Signal() {}
+		  /* Names are keyed by address, so a copy gets its own entry */
+		  Signal(const Signal& other)
+			  : func(other.func), named_(false), hook_data(other.hook_data) {
+			  if unlikely (other.named_) set_name(other.get_name());
+		  }
 
-		  bool emit(void *arg) ;
-		  void connect(TFunctor* _func);
-		  const char* get_name() {
-			  return name_.buf;
+		  Signal& operator =(const Signal& other) {
+			  if unlikely (this == &other) return *this;
+			  func = other.func;
+			  hook_data = other.hook_data;
+			  if unlikely (other.named_) set_name(other.get_name());
+			  else if unlikely (named_) clear_name();
+			  return *this;
 		  }
-		  void set_name(const char *name) {
-			  name_ << name;
+
+          ~Signal() {
+			  if unlikely (named_) clear_name();
+		  }
+
+		  bool emit(void *arg) {
+			  assert(func.connected());
+			  if unlikely (emit_hook)
+				  return (*emit_hook)(*this, arg);
+			  return func(arg);
+		  }
+
+		  bool call(void *arg) {
+			  return func(arg);
+		  }
+
+		  void connect(const SignalDelegate& _func) {
+			  func = _func;
 		  }
+
+		  const char* get_name() const;
+		  void set_name(const char *name);
   };
 
 
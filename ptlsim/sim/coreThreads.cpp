@@ -0,0 +1,815 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <globals.h>
+#include <ptlsim.h>
+#include <coreThreads.h>
+#include <hostProfile.h>
+#include <memoryHierarchy.h>
+#include <statsBuilder.h>
+
+#include <sched.h>
+
+using namespace Memory;
+
+__thread int core_task = -1;
+__thread bool core_task_serial = false;
+
+CoreThreads coreThreads;
+
+/* Stats of traffic between core tasks and the shared memory hierarchy */
+struct CoreThreadsStats : public Statable
+{
+    StatObj<W64> quanta;
+    StatObj<W64> boundary_messages;
+    StatObj<W64> message_retries;
+    StatObj<W64> late_wakeups;
+    StatObj<W64> late_wakeup_cycles;
+
+    CoreThreadsStats()
+        : Statable("core_threads")
+          , quanta("quanta", this)
+          , boundary_messages("boundary_messages", this)
+          , message_retries("message_retries", this)
+          , late_wakeups("late_wakeups", this)
+          , late_wakeup_cycles("late_wakeup_cycles", this)
+    { }
+} coreThreadsStats;
+
+/* Spin iterations before a waiting thread starts giving up its host CPU */
+#define CORE_THREADS_SPIN_LIMIT 4096
+
+static inline void spin_wait(int& spins)
+{
+    if likely (spins < CORE_THREADS_SPIN_LIMIT) {
+        spins++;
+        cpu_pause();
+    } else {
+        sched_yield();
+    }
+    barrier();
+}
+
+CoreThreads::CoreThreads()
+{
+    taskCount_ = 0;
+    threadCount_ = 0;
+    quantum_ = 1;
+    memoryHierarchy_ = NULL;
+
+    quantumStart_ = 0;
+    quantumEnd_ = 0;
+    exiting_ = false;
+    aborted_ = false;
+
+    generation_ = 0;
+    doneCount_ = 0;
+    tokens_ = 0;
+    applied_ = 0;
+
+    started_ = false;
+    created_ = false;
+    parked_ = false;
+    quit_ = false;
+    jmpEnvInstalled_ = false;
+
+    pthread_mutex_init(&parkLock_, NULL);
+    pthread_cond_init(&parkCond_, NULL);
+
+    foreach(i, NUM_SIM_CORES) {
+        tasks_[i].owner = this;
+        tasks_[i].index = i;
+        tasks_[i].state = TASK_IDLE;
+        tasks_[i].result = false;
+        tasks_[i].aborted = false;
+        tasks_[i].applied = 0;
+        tasks_[i].boundaryMessages = 0;
+        tasks_[i].events = NULL;
+        signals_[i] = NULL;
+    }
+}
+
+CoreThreads::~CoreThreads()
+{
+    join_workers();
+
+    foreach(i, NUM_SIM_CORES) {
+        delete tasks_[i].events;
+    }
+}
+
+/**
+ * @brief Start running per-cycle signals on host threads
+ *
+ * Worker threads are created on first start and parked by stop(), so
+ * switching between simulation and emulation does not create new threads.
+ *
+ * @param signals Per-cycle signals, one task per signal
+ * @param threads Number of tasks allowed to run at the same time
+ * @param quantum Number of cycles tasks run between synchronizations
+ * @param memoryHierarchy Memory hierarchy deferred actions are applied to
+ */
+void CoreThreads::start(dynarray<Signal*>& signals, int threads, W64 quantum,
+        MemoryHierarchy *memoryHierarchy)
+{
+    assert(signals.count() <= NUM_SIM_CORES);
+    assert(threads > 0);
+
+    if(created_ && taskCount_ != signals.count()) {
+        join_workers();
+    }
+
+    taskCount_ = signals.count();
+    threadCount_ = min(threads, taskCount_);
+    quantum_ = max(quantum, W64(1));
+    memoryHierarchy_ = memoryHierarchy;
+
+    quantumStart_ = sim_cycle;
+    quantumEnd_ = sim_cycle;
+    exiting_ = false;
+    aborted_ = false;
+
+    foreach(i, taskCount_) {
+        signals_[i] = signals[i];
+        tasks_[i].state = TASK_DONE;
+        tasks_[i].actions.clear();
+        tasks_[i].messages.clear();
+        tasks_[i].applied = 0;
+
+        if(!tasks_[i].events)
+            tasks_[i].events = new EventQueue();
+    }
+
+    if(memoryHierarchy_)
+        memoryHierarchy_->set_private_L1();
+
+    coreThreadsStats.set_default_stats(global_stats);
+
+    tokens_ = threadCount_;
+    applied_ = taskCount_;
+
+    if(!created_) {
+        parked_ = false;
+        quit_ = false;
+
+        for(int i = 1; i < taskCount_; i++) {
+            tasks_[i].generation = generation_;
+            int rc = pthread_create(&tasks_[i].thread, NULL, worker_main,
+                    &tasks_[i]);
+            assert(rc == 0);
+        }
+
+        created_ = true;
+    } else {
+        pthread_mutex_lock(&parkLock_);
+        parked_ = false;
+        pthread_cond_broadcast(&parkCond_);
+        pthread_mutex_unlock(&parkLock_);
+    }
+
+    started_ = true;
+}
+
+/**
+ * @brief Park worker threads until next start()
+ *
+ * Deferred actions of cycles the simulation thread has not reached yet are
+ * applied right away.
+ */
+void CoreThreads::stop()
+{
+    if(!started_)
+        return;
+
+    apply_cycle(W64(-1));
+
+    pthread_mutex_lock(&parkLock_);
+    parked_ = true;
+    pthread_mutex_unlock(&parkLock_);
+    barrier();
+
+    started_ = false;
+}
+
+void CoreThreads::join_workers()
+{
+    if(!created_)
+        return;
+
+    pthread_mutex_lock(&parkLock_);
+    quit_ = true;
+    pthread_cond_broadcast(&parkCond_);
+    pthread_mutex_unlock(&parkLock_);
+
+    for(int i = 1; i < taskCount_; i++) {
+        pthread_join(tasks_[i].thread, NULL);
+    }
+
+    created_ = false;
+    started_ = false;
+    quit_ = false;
+}
+
+void* CoreThreads::worker_main(void *arg)
+{
+    Task *task = (Task*)arg;
+    task->owner->worker(*task);
+    return NULL;
+}
+
+void CoreThreads::worker(Task& task)
+{
+    for(;;) {
+        int spins = 0;
+
+        while(generation_ == task.generation) {
+            if unlikely (parked_ || quit_) {
+                pthread_mutex_lock(&parkLock_);
+                while(parked_ && !quit_)
+                    pthread_cond_wait(&parkCond_, &parkLock_);
+                pthread_mutex_unlock(&parkLock_);
+
+                if(quit_)
+                    return;
+            }
+
+            spin_wait(spins);
+        }
+
+        task.generation = generation_;
+        run_task(task);
+    }
+}
+
+void CoreThreads::acquire_token()
+{
+    int spins = 0;
+
+    for(;;) {
+        int tokens = tokens_;
+
+        if likely (tokens > 0 && cmpxchg(tokens_, tokens - 1, tokens) == tokens)
+            return;
+
+        spin_wait(spins);
+    }
+}
+
+void CoreThreads::release_token()
+{
+    xadd(tokens_, 1);
+}
+
+void CoreThreads::run_task(Task& task)
+{
+    acquire_token();
+
+    barrier();
+    task.state = TASK_RUNNING;
+    task.result = false;
+    task.aborted = false;
+    task.events->reset(quantumStart_);
+
+    core_task = task.index;
+    core_task_serial = false;
+
+    /* QEMU exceptions raised in a serialized section longjmp back here */
+    if(setjmp(task.jmp_env) == 0) {
+        for(task.cycle = quantumStart_; task.cycle < quantumEnd_;
+                task.cycle++) {
+            sim_cycle = task.cycle;
+            host_profile_cycle();
+
+            if(clocks_cpu_controllers())
+                memoryHierarchy_->clock_cpu_controller(task.index);
+
+            run_events(task);
+
+            if(signals_[task.index]->emit(NULL)) {
+                task.result = true;
+                break;
+            }
+        }
+    } else {
+        host_profile_abort();
+        task.aborted = true;
+    }
+
+    if unlikely (task.result || task.aborted)
+        drain_events(task);
+
+    if(core_task_serial)
+        restore_jmp_env();
+
+    core_task = -1;
+    core_task_serial = false;
+
+    release_token();
+
+    barrier();
+    task.state = TASK_DONE;
+    xadd(doneCount_, 1);
+}
+
+/* Execute Events of the task private queue due in current cycle */
+void CoreThreads::run_events(Task& task)
+{
+    Event *event;
+    while((event = task.events->pop(sim_cycle))) {
+        assert(event->execute());
+        task.events->free(event);
+    }
+}
+
+/* Hand Events left in the private queue of a stopped task to the shared one */
+void CoreThreads::drain_events(Task& task)
+{
+    while(!task.events->empty()) {
+        Event *event = task.events->pop(task.events->next_clock());
+
+        if(core_task_deferring()) {
+            defer_event_at(event->get_signal(), event->get_clock(),
+                    event->get_arg());
+        } else {
+            memoryHierarchy_->add_event_at(event->get_signal(),
+                    event->get_clock(), event->get_arg());
+        }
+        task.events->free(event);
+    }
+}
+
+/* Run all tasks through the next quantum, starting at current cycle */
+void CoreThreads::run_quantum()
+{
+    W64 cycle = sim_cycle;
+
+    quantumStart_ = cycle;
+    quantumEnd_ = cycle + quantum_;
+    if(config.stop_at_cycle > cycle)
+        quantumEnd_ = min(quantumEnd_, W64(config.stop_at_cycle));
+
+    foreach(i, taskCount_) {
+        tasks_[i].state = TASK_IDLE;
+        tasks_[i].actions.clear();
+        tasks_[i].messages.clear();
+        tasks_[i].applied = 0;
+    }
+    doneCount_ = 0;
+    applied_ = 0;
+
+    barrier();
+    generation_++;
+
+    {
+        HostProfilePause pause;
+        run_task(tasks_[0]);
+    }
+    sim_cycle = cycle;
+
+    int spins = 0;
+    while(doneCount_ < taskCount_)
+        spin_wait(spins);
+
+    /* Stop the quantum after the first cycle in which a task stopped */
+    W64 end = quantumEnd_;
+    exiting_ = false;
+    aborted_ = false;
+
+    foreach(i, taskCount_) {
+        Task& task = tasks_[i];
+
+        if(task.result || task.aborted)
+            end = min(end, task.cycle + 1);
+        exiting_ |= task.result;
+        aborted_ |= task.aborted;
+
+        coreThreadsStats.boundary_messages += task.boundaryMessages;
+        task.boundaryMessages = 0;
+    }
+
+    quantumEnd_ = end;
+    coreThreadsStats.quanta++;
+}
+
+/**
+ * @brief Run one cycle of all tasks
+ *
+ * Called from the simulation thread after it clocked the memory hierarchy.
+ * At the first cycle of a quantum all tasks run through the whole quantum,
+ * the simulation thread runs the first task itself. Every cycle then applies
+ * the deferred actions tasks recorded in that cycle.
+ *
+ * @return true if any of the signals returned true, reported in the last
+ * cycle of the quantum
+ */
+bool CoreThreads::run_cycle()
+{
+    assert(started_);
+
+    if(sim_cycle >= quantumEnd_)
+        run_quantum();
+
+    apply_cycle(sim_cycle);
+
+    if(sim_cycle + 1 < quantumEnd_)
+        return false;
+
+    /* Tasks that ran past a stopped task leave actions of later cycles */
+    apply_cycle(W64(-1));
+
+    if unlikely (aborted_) {
+        /* Hand the exception to QEMU on the simulation thread, as
+         * cpu_loop_exit() does for the serial loop */
+        stop();
+        Context& ctx = contextof(0);
+        set_cpu_env((CPUX86State*)&ctx);
+        longjmp(ctx.jmp_env, 1);
+    }
+
+    return exiting_;
+}
+
+bool CoreThreads::at_quantum_boundary() const
+{
+    return !started_ || sim_cycle >= quantumEnd_;
+}
+
+bool CoreThreads::lower_done(int index) const
+{
+    for(int i = 0; i < index; i++) {
+        if(tasks_[i].state != TASK_DONE)
+            return false;
+    }
+
+    return true;
+}
+
+bool CoreThreads::can_serialize(int index) const
+{
+    if(!lower_done(index))
+        return false;
+
+    for(int i = index + 1; i < taskCount_; i++) {
+        int state = tasks_[i].state;
+        if(state != TASK_WAITING && state != TASK_DONE)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Wait for this task's turn to touch shared state
+ *
+ * Returns once all lower tasks are done and all higher tasks wait here or are
+ * done, with the deferred actions of all lower tasks and this one applied.
+ */
+void CoreThreads::serialize()
+{
+    Task& task = tasks_[core_task];
+
+    release_token();
+    barrier();
+    task.state = TASK_WAITING;
+
+    int spins = 0;
+    for(;;) {
+        barrier();
+        if(can_serialize(task.index))
+            break;
+        spin_wait(spins);
+    }
+
+    acquire_token();
+    task.state = TASK_SERIAL;
+    core_task_serial = true;
+
+    apply(task.index);
+    install_jmp_env(task);
+}
+
+/**
+ * @brief Let this task see what lower tasks did in the current cycle
+ *
+ * Without a quantum, once all lower tasks are done their deferred actions are
+ * applied and this task goes on in parallel with the higher ones. Until then
+ * it serializes. No other task touches shared state in between: higher tasks
+ * wait for this one before they do. With a quantum this does nothing.
+ */
+void CoreThreads::order()
+{
+    if(is_relaxed())
+        return;
+
+    barrier();
+    if(lower_done(core_task)) {
+        apply(core_task - 1);
+    } else {
+        serialize();
+    }
+}
+
+/* Apply all actions of tasks up to given one */
+void CoreThreads::apply(int upto)
+{
+    for(; applied_ <= upto; applied_++) {
+        apply_actions(tasks_[applied_], W64(-1));
+    }
+}
+
+/* Apply actions of all tasks recorded up to given cycle, in task order */
+void CoreThreads::apply_cycle(W64 cycle)
+{
+    retry_messages();
+
+    foreach(i, taskCount_) {
+        apply_actions(tasks_[i], cycle);
+    }
+}
+
+void CoreThreads::apply_actions(Task& task, W64 cycle)
+{
+    dynarray<CoreDeferredAction>& actions = task.actions;
+
+    for(; task.applied < actions.count(); task.applied++) {
+        CoreDeferredAction& action = actions[task.applied];
+        if(action.cycle > cycle)
+            break;
+        apply_action(task, action);
+    }
+}
+
+void CoreThreads::apply_action(Task& task, CoreDeferredAction& action)
+{
+    switch(action.type) {
+        case CoreDeferredAction::EVENT:
+            if(action.value == action.cycle) {
+                memoryHierarchy_->add_event((Signal*)action.ptr, 0,
+                        action.arg);
+            } else {
+                memoryHierarchy_->add_event_at((Signal*)action.ptr,
+                        action.value, action.arg);
+            }
+            break;
+        case CoreDeferredAction::CONTROLLER_FULL:
+            memoryHierarchy_->set_controller_full(
+                    (Controller*)action.ptr, bool(action.value));
+            break;
+        case CoreDeferredAction::INTERCONNECT_FULL:
+            memoryHierarchy_->set_interconnect_full(
+                    (Interconnect*)action.ptr, bool(action.value));
+            break;
+        case CoreDeferredAction::LOCK_PROBE:
+            interlocks.probe(action.value);
+            break;
+        case CoreDeferredAction::STORE:
+            memcpy(action.ptr, &action.value, action.size);
+            break;
+        case CoreDeferredAction::SMC_DIRTY:
+            cpu_physical_memory_set_dirty(action.value);
+            break;
+        case CoreDeferredAction::MESSAGE:
+            if(!send_message(task.messages[action.value]))
+                retryMessages_.push(task.messages[action.value]);
+            break;
+        default:
+            assert(0);
+    }
+}
+
+bool CoreThreads::send_message(CoreDeferredMessage& copy)
+{
+    Message& message = *memoryHierarchy_->get_message();
+    message.sender = copy.sender;
+    message.origin = copy.origin;
+    message.dest = copy.dest;
+    message.request = copy.request;
+    message.hasData = copy.hasData;
+    message.isShared = copy.isShared;
+    message.arg = copy.arg;
+
+    bool success = copy.interconnect->get_controller_request_signal()->
+        emit(&message);
+    memoryHierarchy_->free_message(&message);
+
+    if(success)
+        copy.request->decRefCounter();
+
+    return success;
+}
+
+/* Send messages shared interconnects did not accept before, oldest first */
+void CoreThreads::retry_messages()
+{
+    int count = retryMessages_.count();
+    if likely (!count)
+        return;
+
+    int pending = 0;
+    foreach(i, count) {
+        if(!send_message(retryMessages_[i])) {
+            retryMessages_[pending++] = retryMessages_[i];
+            coreThreadsStats.message_retries++;
+        }
+    }
+    retryMessages_.resize(pending);
+}
+
+void CoreThreads::count_late_wakeup()
+{
+    /* Cores already simulated up to the end of the quantum */
+    if(sim_cycle >= quantumEnd_)
+        return;
+
+    coreThreadsStats.late_wakeups++;
+    coreThreadsStats.late_wakeup_cycles += quantumEnd_ - sim_cycle;
+}
+
+void CoreThreads::install_jmp_env(Task& task)
+{
+    Context& ctx = contextof(0);
+
+    memcpy(savedJmpEnv_, ctx.jmp_env, sizeof(jmp_buf));
+    memcpy(ctx.jmp_env, task.jmp_env, sizeof(jmp_buf));
+    jmpEnvInstalled_ = true;
+}
+
+void CoreThreads::restore_jmp_env()
+{
+    if(!jmpEnvInstalled_)
+        return;
+
+    memcpy(contextof(0).jmp_env, savedJmpEnv_, sizeof(jmp_buf));
+    jmpEnvInstalled_ = false;
+}
+
+/**
+ * @brief Add a memory hierarchy event from a core task
+ *
+ * Delay 0 events run right away, as in the serial loop. Core tasks only
+ * reach the core's own CPU Controller and caches, shared ones are behind
+ * messages and deferred events.
+ *
+ * With a quantum, events due within it run in the task as well. Later ones,
+ * and all events without a quantum, go to the shared event queue in core
+ * order.
+ */
+void CoreThreads::defer_event(Signal *signal, int delay, void *arg)
+{
+    W64 clock = sim_cycle + delay;
+
+    if(delay == 0) {
+        assert(signal->emit(arg));
+        return;
+    }
+
+    if(!clocks_cpu_controllers() || clock >= quantumEnd_) {
+        defer_event_at(signal, clock, arg);
+        return;
+    }
+
+    EventQueue *events = tasks_[core_task].events;
+    Event *event = events->alloc();
+    event->setup(signal, clock, arg);
+    events->insert(event);
+}
+
+void CoreThreads::defer_event_at(Signal *signal, W64 clock, void *arg)
+{
+    CoreDeferredAction& action = defer(CoreDeferredAction::EVENT);
+    action.ptr = signal;
+    action.arg = arg;
+    action.value = clock;
+}
+
+/**
+ * @brief Record a message from a core task to a shared interconnect
+ *
+ * The message is sent in the cycle it was recorded in by the simulation
+ * thread, and resent every cycle until the interconnect accepts it.
+ *
+ * @return true, the message is always accepted
+ */
+bool CoreThreads::defer_message(Interconnect *interconnect, Message *message)
+{
+    Task& task = tasks_[core_task];
+
+    CoreDeferredAction& action = defer(CoreDeferredAction::MESSAGE);
+    action.value = task.messages.count();
+
+    CoreDeferredMessage& copy = task.messages.push();
+    copy.interconnect = interconnect;
+    copy.request = message->request;
+    copy.sender = message->sender;
+    copy.origin = message->origin;
+    copy.dest = message->dest;
+    copy.arg = message->arg;
+    copy.hasData = message->hasData;
+    copy.isShared = message->isShared;
+
+    /* Keep the request until the interconnect accepted the message */
+    copy.request->incRefCounter();
+    task.boundaryMessages++;
+
+    return true;
+}
+
+void CoreThreads::defer_controller_full(Controller *controller, bool flag)
+{
+    CoreDeferredAction& action = defer(CoreDeferredAction::CONTROLLER_FULL);
+    action.ptr = controller;
+    action.value = flag;
+}
+
+void CoreThreads::defer_interconnect_full(Interconnect *interconnect,
+        bool flag)
+{
+    CoreDeferredAction& action = defer(
+            CoreDeferredAction::INTERCONNECT_FULL);
+    action.ptr = interconnect;
+    action.value = flag;
+}
+
+void CoreThreads::defer_lock_probe(W64 lockaddr)
+{
+    CoreDeferredAction& action = defer(CoreDeferredAction::LOCK_PROBE);
+    action.value = lockaddr;
+}
+
+void CoreThreads::defer_store(Waddr hostaddr, W64 data, int sizeshift)
+{
+    CoreDeferredAction& action = defer(CoreDeferredAction::STORE);
+    action.ptr = (void*)hostaddr;
+    action.size = 1 << min(sizeshift, 3);
+    action.value = data;
+}
+
+void CoreThreads::defer_smc_dirty(W64 ramaddr)
+{
+    CoreDeferredAction& action = defer(CoreDeferredAction::SMC_DIRTY);
+    action.value = ramaddr;
+}
+
+/**
+ * @brief Load from guest RAM as seen by the current task
+ *
+ * @return Data in RAM with the task's own deferred stores applied, and
+ * without a quantum the stores of lower tasks too
+ */
+W64 CoreThreads::load(Waddr hostaddr, int sizeshift)
+{
+    int bytes = 1 << min(sizeshift, 3);
+    W64 data = 0;
+    byte *buf = (byte*)&data;
+
+    order();
+    memcpy(buf, (void*)hostaddr, bytes);
+
+    /* Serialized tasks have their stores in RAM already */
+    if(core_task_serial)
+        return data;
+
+    dynarray<CoreDeferredAction>& actions = tasks_[core_task].actions;
+    foreach(i, actions.count()) {
+        CoreDeferredAction& action = actions[i];
+        if(action.type != CoreDeferredAction::STORE)
+            continue;
+
+        Waddr start = max(hostaddr, (Waddr)action.ptr);
+        Waddr end = min(hostaddr + bytes, (Waddr)action.ptr + action.size);
+        if(start >= end)
+            continue;
+
+        memcpy(buf + (start - hostaddr),
+                (byte*)&action.value + (start - (Waddr)action.ptr),
+                end - start);
+    }
+
+    return data;
+}
+
+/**
+ * @brief Check SMC dirty bit of a RAM page as seen by the current task
+ */
+bool CoreThreads::smc_isdirty(W64 ramaddr)
+{
+    W64 page = ramaddr >> TARGET_PAGE_BITS;
+
+    order();
+    if(core_task_serial)
+        return cpu_physical_memory_is_dirty(ramaddr);
+
+    dynarray<CoreDeferredAction>& actions = tasks_[core_task].actions;
+    foreach(i, actions.count()) {
+        CoreDeferredAction& action = actions[i];
+        if(action.type == CoreDeferredAction::SMC_DIRTY &&
+                (action.value >> TARGET_PAGE_BITS) == page)
+            return true;
+    }
+
+    return cpu_physical_memory_is_dirty(ramaddr);
+}
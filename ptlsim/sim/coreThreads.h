@@ -0,0 +1,262 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef CORE_THREADS_H
+#define CORE_THREADS_H
+
+#include <globals.h>
+
+#include <setjmp.h>
+#include <pthread.h>
+
+namespace Memory {
+    struct Controller;
+    struct Interconnect;
+    struct Message;
+    class MemoryRequest;
+    class EventQueue;
+    class MemoryHierarchy;
+};
+
+extern "C" __thread W64 sim_cycle;
+
+/*
+ * Core Threads
+ *
+ * With -core-threads each per-cycle signal (one per core) is run on its own
+ * host thread, at most 'core-threads' of them at the same time.
+ *
+ * A core runs freely as long as it only touches its own state: pipeline,
+ * private caches, Context and TLB. Everything other cores can observe is
+ * recorded in a per core list instead: memory hierarchy events and full flags,
+ * interlock probes, stores to guest RAM and SMC dirty pages. Loads and SMC
+ * checks look at their own core's list before guest RAM.
+ *
+ * Without a quantum results are the same as with the serial loop: a core sees
+ * everything lower cores did earlier in the same cycle. Loads, SMC checks and
+ * interlock probes call core_task_order() first. If all lower cores are done
+ * it applies their lists and the core goes on, otherwise the core serializes.
+ * Messages to shared interconnects serialize, so the sender sees whether they
+ * were accepted. Delay 0 events run right away in the core task.
+ *
+ * Anything else (QEMU helpers, assists, BB translation, interlock updates,
+ * cache flush) calls core_task_serialize() first. It waits until all lower
+ * cores are done and all higher cores are done or waiting in
+ * core_task_serialize() themselves, applies the lists of lower cores and its
+ * own, and the core then runs the rest of its cycle directly. Lists of
+ * remaining cores are applied in core order once all cores are done.
+ *
+ * So each cycle first runs every core up to its first serialized operation,
+ * in any interleaving but touching only private state, and then the
+ * serialized rest of each core in core order. This order does not depend on
+ * the number of host threads, so any 'core-threads' value gives the same
+ * results, and they match '-core-threads 0'.
+ *
+ * With -sync-quantum N each task runs N cycles at a time instead of one, with
+ * its own sim_cycle. Events of its CPU Controller and L1 caches that fall
+ * into the quantum are kept in a task private queue, so a core sees its own
+ * L1 hits without waiting for other cores. Messages into shared interconnects
+ * are recorded like stores and deferred actions are tagged with the cycle
+ * they were recorded in. The simulation thread then clocks the shared caches
+ * and memory through the same N cycles, applying the actions of each cycle in
+ * core order. Responses from the shared hierarchy reach a core at the next
+ * quantum, these late wakeups are counted in the 'core_threads' stats.
+ * Cores do not see the stores of other cores made within the same quantum.
+ */
+
+/* Index of the core task run by this thread, -1 outside of core tasks */
+extern __thread int core_task;
+
+/* Current core task has passed core_task_serialize() */
+extern __thread bool core_task_serial;
+
+static inline bool core_task_deferring()
+{
+    return core_task >= 0 && !core_task_serial;
+}
+
+struct CoreDeferredAction {
+    enum {
+        EVENT,
+        CONTROLLER_FULL,
+        INTERCONNECT_FULL,
+        LOCK_PROBE,
+        STORE,
+        SMC_DIRTY,
+        MESSAGE,
+    };
+
+    W8 type;
+    W8 size;
+    void *ptr;
+    void *arg;
+    W64 value;
+    W64 cycle;
+};
+
+/* Copy of a Message sent by a core task to a shared interconnect */
+struct CoreDeferredMessage {
+    Memory::Interconnect *interconnect;
+    Memory::MemoryRequest *request;
+    void *sender;
+    void *origin;
+    void *dest;
+    void *arg;
+    bool hasData;
+    bool isShared;
+};
+
+class CoreThreads {
+    public:
+        CoreThreads();
+        ~CoreThreads();
+
+        void start(dynarray<Signal*>& signals, int threads, W64 quantum,
+                Memory::MemoryHierarchy *memoryHierarchy);
+        void stop();
+        bool run_cycle();
+
+        bool is_started() const { return started_; }
+
+        /* Tasks run a quantum and only see their own deferred actions */
+        bool is_relaxed() const { return quantum_ > 1; }
+        bool at_quantum_boundary() const;
+
+        /* Core tasks clock their own CPU Controller */
+        bool clocks_cpu_controllers() const {
+            return started_ && quantum_ > 1 && memoryHierarchy_ != NULL;
+        }
+
+        void serialize();
+        void order();
+
+        void defer_event(Signal *signal, int delay, void *arg);
+        bool defer_message(Memory::Interconnect *interconnect,
+                Memory::Message *message);
+        void defer_controller_full(Memory::Controller *controller, bool flag);
+        void defer_interconnect_full(Memory::Interconnect *interconnect,
+                bool flag);
+        void defer_lock_probe(W64 lockaddr);
+        void defer_store(Waddr hostaddr, W64 data, int sizeshift);
+        void defer_smc_dirty(W64 ramaddr);
+
+        W64 load(Waddr hostaddr, int sizeshift);
+        bool smc_isdirty(W64 ramaddr);
+
+        void core_wakeup() {
+            if unlikely (started_ && core_task < 0)
+                count_late_wakeup();
+        }
+
+    private:
+        enum {
+            TASK_IDLE,
+            TASK_RUNNING,
+            TASK_WAITING,
+            TASK_SERIAL,
+            TASK_DONE,
+        };
+
+        struct Task {
+            CoreThreads *owner;
+            int index;
+            pthread_t thread;
+            W64 generation;
+
+            int state;
+            bool result;
+            bool aborted;
+            jmp_buf jmp_env;
+            W64 cycle;
+
+            dynarray<CoreDeferredAction> actions;
+            dynarray<CoreDeferredMessage> messages;
+            int applied;
+            W64 boundaryMessages;
+
+            Memory::EventQueue *events;
+        } __attribute__ ((aligned (64)));
+
+        Task tasks_[NUM_SIM_CORES];
+        Signal *signals_[NUM_SIM_CORES];
+        int taskCount_;
+        int threadCount_;
+        W64 quantum_;
+        Memory::MemoryHierarchy *memoryHierarchy_;
+
+        /* Cycles run by the tasks, [quantumStart_, quantumEnd_) */
+        W64 quantumStart_;
+        W64 quantumEnd_;
+        bool exiting_;
+        bool aborted_;
+
+        /* Messages a shared interconnect did not accept yet */
+        dynarray<CoreDeferredMessage> retryMessages_;
+
+        /* Shared between threads, spin loops re-read them after barrier() */
+        W64 generation_;
+        int doneCount_;
+        int tokens_;
+        int applied_;
+
+        bool started_;
+        bool created_;
+        bool parked_;
+        bool quit_;
+        pthread_mutex_t parkLock_;
+        pthread_cond_t parkCond_;
+
+        jmp_buf savedJmpEnv_;
+        bool jmpEnvInstalled_;
+
+        static void* worker_main(void *arg);
+        void worker(Task& task);
+        void run_task(Task& task);
+        void run_events(Task& task);
+        void drain_events(Task& task);
+        void run_quantum();
+        void join_workers();
+
+        void acquire_token();
+        void release_token();
+        bool can_serialize(int index) const;
+        bool lower_done(int index) const;
+
+        void apply(int upto);
+        void apply_cycle(W64 cycle);
+        void apply_actions(Task& task, W64 cycle);
+        void apply_action(Task& task, CoreDeferredAction& action);
+        bool send_message(CoreDeferredMessage& message);
+        void retry_messages();
+        void count_late_wakeup();
+        void defer_event_at(Signal *signal, W64 clock, void *arg);
+        void install_jmp_env(Task& task);
+        void restore_jmp_env();
+
+        CoreDeferredAction& defer(int type) {
+            CoreDeferredAction& action = tasks_[core_task].actions.push();
+            action.type = type;
+            action.cycle = sim_cycle;
+            return action;
+        }
+};
+
+extern CoreThreads coreThreads;
+
+static inline void core_task_serialize()
+{
+    if unlikely (core_task_deferring())
+        coreThreads.serialize();
+}
+
+static inline void core_task_order()
+{
+    if unlikely (core_task_deferring())
+        coreThreads.order();
+}
+
+#endif // CORE_THREADS_H
@@ -0,0 +1,220 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <globals.h>
+#include <deltaCheckpoint.h>
+
+#include <sys/stat.h>
+
+DeltaCheckpoint::DeltaCheckpoint()
+    : map(NULL)
+    , map_size(0)
+    , header(NULL)
+    , index(NULL)
+    , data(NULL)
+{
+}
+
+DeltaCheckpoint::~DeltaCheckpoint()
+{
+    close();
+}
+
+static bool write_at(int fd, const void *buf, W64 size, W64 offset)
+{
+    const byte *p = (const byte*)buf;
+
+    while (size > 0) {
+        ssize_t n = pwrite(fd, p, size, offset);
+
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        p += n;
+        size -= n;
+        offset += n;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Write a delta checkpoint file
+ *
+ * The file is written under a temporary name and renamed when complete, so
+ * a crash never leaves a truncated delta behind.
+ *
+ * @param filename Name of the delta file
+ * @param parent Name of the checkpoint this delta applies on
+ * @param ram_size Size of guest RAM offsets
+ * @param page_size Size of each page
+ * @param pages RAM offsets of the pages to write, sorted in place
+ * @param page_data Returns the host address of the page at given offset
+ *
+ * @return true if the file is written
+ */
+bool DeltaCheckpoint::write(const char *filename, const char *parent,
+        W64 ram_size, W32 page_size, dynarray<W64>& pages,
+        const void* (*page_data)(W64 addr))
+{
+    DeltaCheckpointHeader hdr;
+    W64 count = pages.size();
+
+    if (strlen(parent) >= DELTA_CHECKPOINT_NAME_SIZE)
+        return false;
+
+    sort(pages.data, pages.size(), DefaultComparator<W64>());
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, DELTA_CHECKPOINT_MAGIC, sizeof(hdr.magic));
+    hdr.version = DELTA_CHECKPOINT_VERSION;
+    hdr.page_size = page_size;
+    hdr.ram_size = ram_size;
+    hdr.page_count = count;
+    hdr.index_offset = sizeof(hdr);
+    hdr.data_offset = ceil(hdr.index_offset + (count * sizeof(W64)),
+            (W64)page_size);
+    strcpy(hdr.parent, parent);
+
+    stringbuf tmpname;
+    tmpname << filename, ".tmp";
+
+    int fd = ::open(tmpname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+
+    bool ok = write_at(fd, &hdr, sizeof(hdr), 0) &&
+        write_at(fd, pages.data, count * sizeof(W64), hdr.index_offset);
+
+    for (W64 i = 0; ok && i < count; i++) {
+        ok = write_at(fd, page_data(pages[i]), page_size,
+                hdr.data_offset + (i * page_size));
+    }
+
+    /* Holes left by the page alignment are read back as zeros */
+    if (ok)
+        ok = (ftruncate(fd, hdr.data_offset + (count * page_size)) == 0);
+
+    ok = (::close(fd) == 0) && ok;
+
+    if (ok)
+        ok = (rename(tmpname, filename) == 0);
+
+    if (!ok)
+        unlink(tmpname);
+
+    return ok;
+}
+
+/**
+ * @brief Map a delta checkpoint file
+ *
+ * @param filename Name of the delta file
+ *
+ * @return false if the file can't be read or is not a valid delta
+ */
+bool DeltaCheckpoint::open(const char *filename)
+{
+    close();
+
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (W64)st.st_size < sizeof(DeltaCheckpointHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (addr == MAP_FAILED)
+        return false;
+
+    map = (byte*)addr;
+    map_size = st.st_size;
+    header = (const DeltaCheckpointHeader*)map;
+
+    W64 count = header->page_count;
+    bool valid = !memcmp(header->magic, DELTA_CHECKPOINT_MAGIC,
+            sizeof(header->magic)) &&
+        header->version == DELTA_CHECKPOINT_VERSION &&
+        header->page_size > 0 &&
+        header->parent[DELTA_CHECKPOINT_NAME_SIZE - 1] == '\0' &&
+        header->index_offset <= map_size &&
+        count <= (map_size - header->index_offset) / sizeof(W64) &&
+        header->data_offset <= map_size &&
+        count <= (map_size - header->data_offset) / header->page_size;
+
+    if (!valid) {
+        close();
+        return false;
+    }
+
+    index = (const W64*)(map + header->index_offset);
+    data = map + header->data_offset;
+
+    return true;
+}
+
+void DeltaCheckpoint::close()
+{
+    if (map)
+        munmap(map, map_size);
+
+    map = NULL;
+    map_size = 0;
+    header = NULL;
+    index = NULL;
+    data = NULL;
+}
+
+/**
+ * @brief Find the page at given RAM offset
+ *
+ * @param addr Page aligned RAM offset
+ *
+ * @return Page data in the mapping, NULL if the delta doesn't have it
+ */
+const void* DeltaCheckpoint::find(W64 addr) const
+{
+    W64 lower = 0;
+    W64 upper = header->page_count;
+
+    while (lower < upper) {
+        W64 mid = (lower + upper) / 2;
+
+        if (index[mid] < addr)
+            lower = mid + 1;
+        else
+            upper = mid;
+    }
+
+    if (lower < header->page_count && index[lower] == addr)
+        return page(lower);
+
+    return NULL;
+}
+
+/**
+ * @brief Get the name of the delta file of a checkpoint
+ *
+ * @param filename Set to the file name
+ * @param dir Directory of delta files
+ * @param name Name of the checkpoint
+ */
+void delta_checkpoint_filename(stringbuf& filename, const char *dir,
+        const char *name)
+{
+    filename.reset();
+    filename << dir, "/", name, ".delta";
+}
@@ -0,0 +1,81 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef DELTA_CHECKPOINT_H
+#define DELTA_CHECKPOINT_H
+
+#include <globals.h>
+#include <superstl.h>
+
+/*
+ * Delta Checkpoints
+ *
+ * With -simpoint-delta-dir only the first simpoint is saved as a full savevm
+ * checkpoint. The following simpoints still save device state and disk
+ * snapshots with savevm but leave guest RAM out of it: the RAM pages that
+ * were dirtied since the previous simpoint are written to
+ * '<dir>/<name>.delta' instead, which names the previous checkpoint as its
+ * parent.
+ *
+ * A delta file holds a header, the sorted RAM offsets of its pages and the
+ * page data, aligned to the page size so the file can be mapped and pages
+ * copied straight out of the mapping. Restoring a delta loads the full
+ * checkpoint at the root of its chain and copies each page from the newest
+ * delta that has it.
+ */
+
+#define DELTA_CHECKPOINT_MAGIC "MARSSDLT"
+#define DELTA_CHECKPOINT_VERSION 1
+#define DELTA_CHECKPOINT_NAME_SIZE 256
+
+struct DeltaCheckpointHeader {
+    char magic[8];
+    W32 version;
+    W32 page_size;
+    W64 ram_size;
+    W64 page_count;
+    W64 index_offset;
+    W64 data_offset;
+    char parent[DELTA_CHECKPOINT_NAME_SIZE];
+};
+
+class DeltaCheckpoint {
+    public:
+        DeltaCheckpoint();
+        ~DeltaCheckpoint();
+
+        static bool write(const char *filename, const char *parent,
+                W64 ram_size, W32 page_size, dynarray<W64>& pages,
+                const void* (*page_data)(W64 addr));
+
+        bool open(const char *filename);
+        void close();
+
+        const char* parent() const { return header->parent; }
+        W64 ram_size() const { return header->ram_size; }
+        W32 page_size() const { return header->page_size; }
+        W64 page_count() const { return header->page_count; }
+
+        W64 page_addr(W64 i) const { return index[i]; }
+        const void* page(W64 i) const {
+            return data + (i * header->page_size);
+        }
+
+        const void* find(W64 addr) const;
+
+    private:
+        byte *map;
+        W64 map_size;
+        const DeltaCheckpointHeader *header;
+        const W64 *index;
+        const byte *data;
+};
+
+void delta_checkpoint_filename(stringbuf& filename, const char *dir,
+        const char *name);
+
+#endif // DELTA_CHECKPOINT_H
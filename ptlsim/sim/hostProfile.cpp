@@ -0,0 +1,289 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <globals.h>
+#include <ptlsim.h>
+#include <hostProfile.h>
+#include <statsBuilder.h>
+
+#include <pthread.h>
+
+__thread bool host_profile_active = false;
+__thread HostProfileScope *host_profile_scope = NULL;
+
+W64 host_profile_interval = 0;
+
+/* All sites, zero initialized before any constructor adds to it */
+static HostProfileSite *sites;
+
+/* Sites created while core threads are running */
+static pthread_mutex_t sites_lock = PTHREAD_MUTEX_INITIALIZER;
+
+HostProfileSite host_profile_memory_hierarchy("machine", "memory_hierarchy");
+HostProfileSite host_profile_qemu_io("machine", "qemu_io");
+HostProfileSite host_profile_cores("machine", "cores");
+HostProfileSite host_profile_cpu_controller("memory", "cpu_controller");
+HostProfileSite host_profile_memory_controller("memory", "memory_controller");
+
+/* Stats of one site */
+struct HostProfileEntry : public Statable
+{
+    StatObj<W64> calls;
+    StatObj<W64> ticks;
+    StatObj<W64> usec;
+
+    HostProfileEntry(stringbuf& name, Statable *parent)
+        : Statable(name, parent)
+          , calls("calls", this)
+          , ticks("ticks", this)
+          , usec("usec", this)
+    { }
+};
+
+/* Group of sites, like 'cores.ooo_0' */
+struct HostProfileGroup : public Statable
+{
+    HostProfileGroup(stringbuf& name, Statable *parent)
+        : Statable(name, parent)
+    { }
+};
+
+struct HostProfileStats : public Statable
+{
+    StatObj<W64> interval;
+    StatObj<W64> sampled_cycles;
+
+    dynarray<HostProfileGroup*> groups;
+    dynarray<stringbuf*> paths;
+
+    HostProfileStats()
+        : Statable("host_profile")
+          , interval("interval", this)
+          , sampled_cycles("sampled_cycles", this)
+    {
+        disable_dump();
+    }
+
+    /* Find or create the group node of a dotted path */
+    Statable* group(const char *path)
+    {
+        foreach(i, paths.count()) {
+            if(*paths[i] == path)
+                return groups[i];
+        }
+
+        Statable *parent = this;
+        const char *dot = strrchr(path, '.');
+        stringbuf name;
+
+        if(dot) {
+            stringbuf outer;
+            foreach(i, dot - path) outer << path[i];
+            parent = group(outer);
+            name << (dot + 1);
+        } else {
+            name << path;
+        }
+
+        HostProfileGroup *node = new HostProfileGroup(name, parent);
+        stringbuf *node_path = new stringbuf();
+        *node_path << path;
+        groups.push(node);
+        paths.push(node_path);
+        return node;
+    }
+} hostProfileStats;
+
+/* Sampled cycles, counted by the simulation thread only */
+static W64 sampled_cycles = 0;
+
+HostProfileSite::HostProfileSite()
+{
+    also = NULL;
+    entry = NULL;
+    next = NULL;
+    foreach(i, HOST_PROFILE_SLOTS) {
+        calls[i] = 0;
+        ticks[i] = 0;
+    }
+}
+
+HostProfileSite::HostProfileSite(const char *group, const char *name)
+{
+    also = NULL;
+    entry = NULL;
+    next = NULL;
+    foreach(i, HOST_PROFILE_SLOTS) {
+        calls[i] = 0;
+        ticks[i] = 0;
+    }
+    init(group, name);
+}
+
+/* Add a site to the list, with sites_lock held */
+static void add_site(HostProfileSite *site, const char *group,
+        const char *name)
+{
+    site->group.reset();
+    site->group << group;
+    site->name.reset();
+    site->name << name;
+    site->next = sites;
+    sites = site;
+}
+
+void HostProfileSite::init(const char *group, const char *name)
+{
+    pthread_mutex_lock(&sites_lock);
+    add_site(this, group, name);
+    pthread_mutex_unlock(&sites_lock);
+}
+
+W64 HostProfileSite::total_calls() const
+{
+    W64 total = 0;
+    foreach(i, HOST_PROFILE_SLOTS) total += calls[i];
+    return total;
+}
+
+W64 HostProfileSite::total_ticks() const
+{
+    W64 total = 0;
+    foreach(i, HOST_PROFILE_SLOTS) total += ticks[i];
+    return total;
+}
+
+/* Find or create a site, signals of the same name share one site */
+static HostProfileSite* get_site(const char *group, const char *name)
+{
+    pthread_mutex_lock(&sites_lock);
+
+    HostProfileSite *site = sites;
+    while(site && (site->group != group || site->name != name))
+        site = site->next;
+
+    if(!site) {
+        site = new HostProfileSite();
+        add_site(site, group, name);
+    }
+
+    pthread_mutex_unlock(&sites_lock);
+    return site;
+}
+
+/* Site of a signal, looked up on its first timed emit */
+static HostProfileSite& signal_site(Signal& signal)
+{
+    if unlikely (!signal.hook_data) {
+        signal.hook_data = get_site("signals", signal.get_name());
+    }
+
+    return *(HostProfileSite*)signal.hook_data;
+}
+
+static bool profile_emit(Signal& signal, void *arg)
+{
+    if likely (!host_profile_active)
+        return signal.call(arg);
+
+    HostProfileScope scope(signal_site(signal));
+    return signal.call(arg);
+}
+
+/**
+ * @brief Enable or disable host profiling
+ *
+ * @param interval Time one of every 'interval' cycles, 0 disables profiling
+ */
+void host_profile_setup(W64 interval)
+{
+    host_profile_interval = interval;
+    host_profile_active = false;
+    Signal::emit_hook = (interval) ? profile_emit : NULL;
+
+    if(interval)
+        hostProfileStats.enable_dump();
+    else
+        hostProfileStats.disable_dump();
+}
+
+/* Start a cycle of the machine loop, no scope is running here */
+void host_profile_machine_cycle()
+{
+    host_profile_scope = NULL;
+    host_profile_cycle();
+    if unlikely (host_profile_active)
+        sampled_cycles++;
+}
+
+/* Scopes of this thread were left by longjmp */
+void host_profile_abort()
+{
+    host_profile_scope = NULL;
+}
+
+/**
+ * @brief Charge the emits of a memory hierarchy signal to an event type
+ *
+ * @param signal Signal of a controller or interconnect
+ * @param owner Name of the controller or interconnect
+ * @param type Event type, the signal name without owner name
+ */
+void host_profile_event_type(Signal& signal, const char *owner,
+        const char *type)
+{
+    while(*type == '_' || *type == '-')
+        type++;
+
+    stringbuf name;
+    name << owner, "_", type;
+
+    HostProfileSite *site = get_site("signals", name);
+    site->also = get_site("memory", type);
+    signal.hook_data = site;
+}
+
+/**
+ * @brief Write all profile sites into given Stats
+ *
+ * @param stats Stats to update
+ */
+void host_profile_update_stats(Stats *stats)
+{
+    if(!host_profile_interval)
+        return;
+
+    W64 hz = get_native_core_freq_hz();
+    if(!hz) hz = 1;
+
+    for(HostProfileSite *site = sites; site; site = site->next) {
+        if(site->entry || !site->total_calls())
+            continue;
+
+        site->entry = new HostProfileEntry(site->name,
+                hostProfileStats.group(site->group));
+    }
+
+    hostProfileStats.set_default_stats(stats, true, true);
+
+    hostProfileStats.interval = host_profile_interval;
+    hostProfileStats.sampled_cycles = sampled_cycles;
+
+    for(HostProfileSite *site = sites; site; site = site->next) {
+        if(!site->entry)
+            continue;
+
+        W64 calls = site->total_calls();
+        W64 ticks = site->total_ticks();
+        W64 usec = W64((double(ticks) * double(host_profile_interval) *
+                    1000000.0) / double(hz));
+
+        site->entry->calls = calls;
+        site->entry->ticks = ticks;
+        site->entry->usec = usec;
+    }
+}
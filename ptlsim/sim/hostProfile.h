@@ -0,0 +1,159 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef HOST_PROFILE_H
+#define HOST_PROFILE_H
+
+#include <globals.h>
+#include <superstl.h>
+
+extern "C" __thread W64 sim_cycle;
+extern __thread int core_task;
+
+/*
+ * Host Profile
+ *
+ * With -host-profile N one out of every N simulated cycles is timed with
+ * rdtsc. The host time of a timed cycle is charged to profile sites: the
+ * pipeline stages of each core, every Signal that is emitted and the parts
+ * of the machine loop. Each site only counts its self time, time spent in
+ * sites entered from it is charged to those sites instead, so the sites of
+ * a cycle add up to the host time of the cycle on each thread. The signals
+ * of the memory hierarchy are also summed up by event type, like all
+ * 'Cache_Hit' signals of all caches.
+ *
+ * Sites are dumped in the 'host_profile' stats section, grouped by
+ * 'machine', 'cores.<core name>', 'signals' and 'memory'. Besides the
+ * sampled rdtsc ticks each site reports the estimated time of the whole
+ * run in microseconds, ticks * N scaled by the host frequency.
+ *
+ * Counters are kept per core task, so core threads never update the same
+ * counter.
+ */
+
+#define HOST_PROFILE_SLOTS (NUM_SIM_CORES + 1)
+
+class Stats;
+struct HostProfileEntry;
+
+struct HostProfileSite {
+    stringbuf group;
+    stringbuf name;
+
+    /* Another site charged with the same time, a memory event type */
+    HostProfileSite *also;
+
+    W64 calls[HOST_PROFILE_SLOTS];
+    W64 ticks[HOST_PROFILE_SLOTS];
+
+    HostProfileEntry *entry;
+    HostProfileSite *next;
+
+    HostProfileSite();
+    HostProfileSite(const char *group, const char *name);
+
+    void init(const char *group, const char *name);
+
+    void charge(W64 t) {
+        int slot = core_task + 1;
+        calls[slot]++;
+        ticks[slot] += t;
+        if unlikely (also) also->charge(t);
+    }
+
+    W64 total_calls() const;
+    W64 total_ticks() const;
+};
+
+/* Current cycle of this thread is timed */
+extern __thread bool host_profile_active;
+
+/* Innermost running HostProfileScope of this thread */
+struct HostProfileScope;
+extern __thread HostProfileScope *host_profile_scope;
+
+extern W64 host_profile_interval;
+
+static inline void host_profile_cycle()
+{
+    host_profile_active = host_profile_interval &&
+        (sim_cycle % host_profile_interval) == 0;
+}
+
+/*
+ * Charge the host time until the end of the enclosing block to a site,
+ * if the current cycle is timed
+ */
+struct HostProfileScope {
+    HostProfileSite *site;
+    HostProfileScope *outer;
+    W64 start;
+    W64 nested;
+
+    HostProfileScope(HostProfileSite& s) {
+        site = NULL;
+        if unlikely (host_profile_active) enter(s);
+    }
+
+    ~HostProfileScope() {
+        if unlikely (site) leave();
+    }
+
+    void enter(HostProfileSite& s) {
+        site = &s;
+        outer = host_profile_scope;
+        host_profile_scope = this;
+        nested = 0;
+        start = rdtsc();
+    }
+
+    void leave() {
+        W64 t = rdtsc() - start;
+        host_profile_scope = outer;
+        if (outer) outer->nested += t;
+        site->charge(t - min(nested, t));
+    }
+};
+
+/*
+ * Keep the host time of the enclosing block out of the running scope, for a
+ * core task run by the simulation thread that times its own cycles
+ */
+struct HostProfilePause {
+    HostProfileScope *scope;
+    bool active;
+    W64 start;
+
+    HostProfilePause() {
+        scope = host_profile_scope;
+        active = host_profile_active;
+        start = (scope) ? rdtsc() : 0;
+        host_profile_scope = NULL;
+    }
+
+    ~HostProfilePause() {
+        host_profile_scope = scope;
+        host_profile_active = active;
+        if unlikely (scope) scope->nested += rdtsc() - start;
+    }
+};
+
+/* Sites of the machine loop */
+extern HostProfileSite host_profile_memory_hierarchy;
+extern HostProfileSite host_profile_qemu_io;
+extern HostProfileSite host_profile_cores;
+extern HostProfileSite host_profile_cpu_controller;
+extern HostProfileSite host_profile_memory_controller;
+
+void host_profile_setup(W64 interval);
+void host_profile_machine_cycle();
+void host_profile_abort();
+void host_profile_event_type(Signal& signal, const char *owner,
+        const char *type);
+void host_profile_update_stats(Stats *stats);
+
+#endif // HOST_PROFILE_H
@@ -15,6 +15,9 @@
 #include <basecore.h>
 #include <statsBuilder.h>
 #include <memoryHierarchy.h>
+#include <coreThreads.h>
+#include <hostProfile.h>
+#include <sampling.h>
 
 #include <cstdarg>
 
@@ -37,6 +40,10 @@ BaseMachine::BaseMachine(const char *name)
 
     context_used = 0;
     coreid_counter = 0;
+
+    foreach (i, NUM_SIM_CORES) {
+        warm_cores[i] = NULL;
+    }
 }
 
 BaseMachine::~BaseMachine()
@@ -228,8 +235,15 @@ int BaseMachine::run(PTLsimConfig& config)
 
     // Run each core
     bool exiting = false;
+    bool threaded = start_core_threads(config);
 
     for (;;) {
+        /* Skipping stops at start_log_at_iteration, so logging is enabled
+         * below in the cycle it was asked for */
+        if unlikely (config.skip_idle_cycles &&
+                coreThreads.at_quantum_boundary())
+            skip_idle_cycles(config);
+
         if unlikely ((!logenable) &&
                 iterations >= config.start_log_at_iteration &&
                 !config.log_user_only) {
@@ -238,6 +252,11 @@ int BaseMachine::run(PTLsimConfig& config)
             logenable = 1;
         }
 
+        if unlikely (threaded && logenable) {
+            coreThreads.stop();
+            threaded = false;
+        }
+
         if(sim_cycle % 1000 == 0)
             update_progress();
 
@@ -255,20 +274,38 @@ int BaseMachine::run(PTLsimConfig& config)
                 ((W64)ptl_logfile.tellp() > config.log_file_size))
             backup_and_reopen_logfile();
 
-        memoryHierarchyPtr->clock();
-        clock_qemu_io_events();
+        host_profile_machine_cycle();
 
-		foreach (i, coremodel.per_cycle_signals.size()) {
-			if (logable(4))
-				ptl_logfile << "Per-Cycle-Signal : " <<
-					coremodel.per_cycle_signals[i]->get_name() << endl;
-			exiting |= coremodel.per_cycle_signals[i]->emit(NULL);
-		}
+        {
+            HostProfileScope scope(host_profile_memory_hierarchy);
+            memoryHierarchyPtr->clock();
+        }
+
+        {
+            HostProfileScope scope(host_profile_qemu_io);
+            clock_qemu_io_events();
+        }
+
+        {
+            HostProfileScope scope(host_profile_cores);
+
+            if (threaded) {
+                exiting |= coreThreads.run_cycle();
+            } else {
+                foreach (i, coremodel.per_cycle_signals.size()) {
+                    if (logable(4))
+                        ptl_logfile << "Per-Cycle-Signal : " <<
+                            coremodel.per_cycle_signals[i]->get_name() << endl;
+                    exiting |= coremodel.per_cycle_signals[i]->emit(NULL);
+                }
+            }
+        }
 
         sim_cycle++;
         iterations++;
 
         if unlikely (config.stop_at_insns <= total_insns_committed ||
+                sampling_stop_at_insns <= total_insns_committed ||
                 config.stop_at_cycle <= sim_cycle) {
             ptl_logfile << "Stopping simulation loop at specified limits (", sim_cycle, " cycles, ", total_insns_committed, " commits)", endl;
             exiting = 1;
@@ -281,6 +318,8 @@ int BaseMachine::run(PTLsimConfig& config)
         }
     }
 
+    coreThreads.stop();
+
     if(logable(1))
         ptl_logfile << "Exiting out-of-order core at ", total_insns_committed, " commits, ", total_uops_committed, " uops and ", iterations, " iterations (cycles)", endl;
 
@@ -289,6 +328,102 @@ int BaseMachine::run(PTLsimConfig& config)
     return exiting;
 }
 
+/**
+ * @brief Start running cores on host threads if configured and possible
+ *
+ * Logging and the checker need cores to run one after the other, and cores
+ * sharing an L1 interconnect touch each other's caches, so these fall back
+ * to the single threaded loop. A sync quantum without core threads runs all
+ * cores on the simulation thread.
+ *
+ * @return true if run_cycle() of coreThreads is used this run
+ */
+bool BaseMachine::start_core_threads(PTLsimConfig& config)
+{
+    int count = coremodel.per_cycle_signals.count();
+    int threads = config.core_threads;
+    W64 quantum = config.sync_quantum;
+
+    if likely (!threads && quantum <= 1)
+        return false;
+
+    if (logenable || config.log_user_only || config.checker_enabled ||
+            count < 2 || count > NUM_SIM_CORES ||
+            !memoryHierarchyPtr->has_private_L1()) {
+        if (logable(1))
+            ptl_logfile << "Running cores single threaded", endl;
+        return false;
+    }
+
+    /* Each core task clocks the CPU Controller of its own core */
+    if (quantum > 1 &&
+            memoryHierarchyPtr->get_cpu_controller_count() != count) {
+        if (logable(1))
+            ptl_logfile << "Cores do not map to CPU Controllers, ",
+                        "not using a sync quantum", endl;
+        quantum = 1;
+    }
+
+    coreThreads.start(coremodel.per_cycle_signals, max(threads, 1), quantum,
+            memoryHierarchyPtr);
+    return true;
+}
+
+/* Round cycle up to next multiple of period */
+static inline W64 next_period_cycle(W64 cycle, W64 period)
+{
+    return ((cycle + period - 1) / period) * period;
+}
+
+/**
+ * @brief Fast-forward over cycles in which nothing is simulated
+ *
+ * Jumps sim_cycle to the earliest of the next memory event, the next QEMU IO
+ * event and the first cycle any core has work to do. Skipped cycles are
+ * accounted by the cores and memory hierarchy. The jump never passes a cycle
+ * that updates progress, dumps time stats, starts logging or stops the
+ * simulation, so all of these still happen in their cycle.
+ */
+void BaseMachine::skip_idle_cycles(PTLsimConfig& config)
+{
+    W64 next = W64(-1);
+
+    foreach (i, cores.count()) {
+        next = min(next, cores[i]->get_next_cycle());
+        if likely (next <= sim_cycle) return;
+    }
+
+    next = min(next, memoryHierarchyPtr->get_next_cycle());
+    next = min(next, get_next_qemu_io_event_cycle());
+    next = min(next, next_period_cycle(sim_cycle, 1000));
+
+    if (time_stats_file)
+        next = min(next, next_period_cycle(sim_cycle, config.time_stats_period));
+
+    if (config.stop_at_cycle > 0)
+        next = min(next, config.stop_at_cycle - 1);
+
+    if (!logenable && !config.log_user_only &&
+            config.start_log_at_iteration > iterations)
+        next = min(next, sim_cycle + (config.start_log_at_iteration - iterations));
+
+    if (next <= sim_cycle) return;
+
+    W64 cycles = next - sim_cycle;
+
+    if (logable(4))
+        ptl_logfile << "Skipping ", cycles, " idle cycles at cycle ",
+                    sim_cycle, endl;
+
+    foreach (i, cores.count()) {
+        cores[i]->skip_cycles(cycles);
+    }
+    memoryHierarchyPtr->skip_cycles(cycles);
+
+    sim_cycle += cycles;
+    iterations += cycles;
+}
+
 void BaseMachine::flush_tlb(Context& ctx)
 {
     foreach(i, cores.count()) {
@@ -305,6 +440,98 @@ void BaseMachine::flush_tlb_virt(Context& ctx, Waddr virtaddr)
     }
 }
 
+/**
+ * @brief Prepare for functional warming while QEMU fast-forwards
+ *
+ * Cores are reset here instead of in the first run, so the first run starts
+ * with the caches, TLBs and branch predictors warmed up.
+ */
+void BaseMachine::warm_start()
+{
+    if (first_run) {
+        foreach (i, cores.count()) {
+            cores[i]->reset();
+        }
+        first_run = 0;
+    }
+
+    foreach (i, NUM_SIM_CORES) {
+        warm_cores[i] = NULL;
+    }
+}
+
+/**
+ * @brief Warm the TLBs of the core that runs ctx and find that core
+ *
+ * @param ctx Context that made the access
+ * @param virtaddr Virtual address of the access
+ * @param is_icache Access is an instruction fetch
+ *
+ * @return Core running ctx, NULL if there is none
+ */
+BaseCore* BaseMachine::get_warm_core(Context& ctx, W64 virtaddr,
+        bool is_icache)
+{
+    BaseCore* core = warm_cores[ctx.cpu_index];
+
+    if likely (core && core->warm_tlb(ctx, virtaddr, is_icache))
+        return core;
+
+    core = NULL;
+    foreach (i, cores.count()) {
+        if (cores[i]->warm_tlb(ctx, virtaddr, is_icache)) {
+            core = cores[i];
+            break;
+        }
+    }
+
+    warm_cores[ctx.cpu_index] = core;
+    return core;
+}
+
+/**
+ * @brief Warm TLBs and caches with an access that QEMU emulated
+ *
+ * @param ctx Context that made the access
+ * @param virtaddr Virtual address of the access
+ * @param physaddr Physical address of the access
+ * @param is_icache Access is an instruction fetch
+ * @param is_write Access is a store
+ */
+void BaseMachine::warm_access(Context& ctx, W64 virtaddr, W64 physaddr,
+        bool is_icache, bool is_write)
+{
+    BaseCore* core = get_warm_core(ctx, virtaddr, is_icache);
+
+    if unlikely (!core)
+        return;
+
+    memoryHierarchyPtr->warm_access(core->get_coreid(), physaddr,
+            is_icache, is_write);
+}
+
+/**
+ * @brief Train the branch predictor of the core that runs ctx
+ *
+ * @param ctx Context that executed the branch
+ * @param type Branch hint flags
+ * @param branchaddr Address after the branch instruction
+ * @param target Next rip after the branch
+ */
+void BaseMachine::warm_branch(Context& ctx, int type, W64 branchaddr,
+        W64 target)
+{
+    BaseCore* core = warm_cores[ctx.cpu_index];
+
+    if likely (core && core->warm_branch(ctx, type, branchaddr, target))
+        return;
+
+    foreach (i, cores.count()) {
+        if (cores[i]->warm_branch(ctx, type, branchaddr, target))
+            return;
+    }
+}
+
 void BaseMachine::dump_state(ostream& os)
 {
     foreach(i, cores.count()) {
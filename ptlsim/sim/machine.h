@@ -65,7 +65,14 @@ struct BaseMachine: public PTLsimMachine {
     virtual void update_stats();
     virtual void flush_tlb(Context& ctx);
     virtual void flush_tlb_virt(Context& ctx, Waddr virtaddr);
+    virtual void warm_start();
+    virtual void warm_access(Context& ctx, W64 virtaddr, W64 physaddr,
+            bool is_icache, bool is_write);
+    virtual void warm_branch(Context& ctx, int type, W64 branchaddr,
+            W64 target);
     void flush_all_pipelines();
+    void skip_idle_cycles(PTLsimConfig& config);
+    bool start_core_threads(PTLsimConfig& config);
     virtual void reset();
 	virtual void dump_configuration(ostream& os) const;
 	virtual void shutdown();
@@ -75,6 +82,11 @@ struct BaseMachine: public PTLsimMachine {
     W8 context_counter;
     W8 coreid_counter;
 
+    /* Core running each context, looked up on its first warming access */
+    Core::BaseCore* warm_cores[NUM_SIM_CORES];
+    Core::BaseCore* get_warm_core(Context& ctx, W64 virtaddr,
+            bool is_icache);
+
     Context& get_next_context();
     W8 get_next_coreid();
 	void config_changed();
@@ -38,12 +38,19 @@ extern "C" {
 #include <sysemu.h>
 #include <qemu-objects.h>
 #include <monitor.h>
+#include <qemu-timer.h>
+#include <block.h>
+#include <block/raw-posix-aio.h>
+#include <arch_init.h>
 }
 
+#include <sys/wait.h>
+
 #include <ptl-qemu.h>
 #include <ptlsim.h>
 
 #include <cacheConstants.h>
+#include <deltaCheckpoint.h>
 
 #define __INSIDE_MARSS_QEMU__
 #include <ptlcalls.h>
@@ -483,7 +490,7 @@ W64 Context::virt_to_pte_phys_addr(W64 rawvirt, byte& level) {
 
     assert(level > 0);
 
-    setup_qemu_switch();
+    setup_qemu_switch_ctx(*this);
 
     // First check if PAE bit is enabled or not
     if(cr[4] & CR4_PAE_MASK) {
@@ -599,7 +606,7 @@ dofault:
     ret_addr = -1;
 
 finish:
-    setup_ptlsim_switch();
+    setup_ptlsim_switch_ctx(*this);
     return ret_addr;
 }
 
@@ -613,7 +620,7 @@ int Context::copy_from_vm(void* target, Waddr source, int bytes, PageFaultErrorC
     int n = 0 ;
     pfec = 0;
 
-    setup_qemu_switch_all_ctx(*this);
+    setup_qemu_switch_ctx(*this);
 
     if(logable(10))
         ptl_logfile << "Copying from userspace ", bytes, " bytes from ",
@@ -638,7 +645,7 @@ int Context::copy_from_vm(void* target, Waddr source, int bytes, PageFaultErrorC
             if(logable(10))
                 ptl_logfile << "Unable to read code from ",
                             hexstring(source, 64), endl;
-            setup_ptlsim_switch_all_ctx(*this);
+            setup_ptlsim_switch_ctx(*this);
             /*
              * restore the exception index as it will be
              * restore when we try to commit this entry from ROB
@@ -693,7 +700,7 @@ int Context::copy_from_vm(void* target, Waddr source, int bytes, PageFaultErrorC
             if(logable(10))
                 ptl_logfile << "Unable to read code from ",
                             hexstring(source + n, 64), endl;
-            setup_ptlsim_switch_all_ctx(*this);
+            setup_ptlsim_switch_ctx(*this);
             /*
              * restore the exception index as it will be
              * restore when we try to commit this entry from ROB
@@ -724,7 +731,7 @@ int Context::copy_from_vm(void* target, Waddr source, int bytes, PageFaultErrorC
 
     if(logable(109)) ptl_logfile << endl;
 
-    setup_ptlsim_switch_all_ctx(*this);
+    setup_ptlsim_switch_ctx(*this);
 
     if(logable(10))
         ptl_logfile << "Copy done..\n";
@@ -778,7 +785,6 @@ Waddr Context::check_and_translate(Waddr virtaddr, int sizeshift, bool store, bo
     } else {
         tlb_addr = tlb_table[mmu_index][index].addr_write;
     }
-	Waddr host_virtaddr;
     if(logable(10)) {
         ptl_logfile << "mmu_index:", mmu_index, " index:", index,
                     " virtaddr:", hexstring(virtaddr, 64),
@@ -802,13 +808,8 @@ Waddr Context::check_and_translate(Waddr virtaddr, int sizeshift, bool store, bo
         /* we find valid TLB entry, return the physical address for it */
         mmio = 0;
 
-        host_virtaddr = (Waddr)(virtaddr + tlb_table[mmu_index][index].addend);
-        if (unlikely(get_phys_memory_address(host_virtaddr, paddr) < 0))
-        {
-            // Since the entry is in the TLB, it should also have a mapping, so this case should never arise
-            printf("ERROR: Cannot find mapping for host virtual addr %lx\n", (unsigned long)virtaddr);
-            assert(0);
-        }
+        /* tlb_set_page() keeps the guest physical page next to the host one */
+        paddr = (Waddr)(virtaddr + tlb_table[mmu_index][index].phys_addend);
         if (paddr > qemu_ram_size) {
             if (qemu_ram_size < 0xe0000000 ) {
                 printf("ERROR: guest physical address 0x%llx is out of bounds\n", paddr);
@@ -948,10 +949,23 @@ void Context::propagate_x86_exception(byte exception, W32 errorcode , Waddr virt
 W64 Context::loadvirt(Waddr virtaddr, int sizeshift) {
     Waddr addr = virtaddr;
     assert(virtaddr > 0xffff);
-    setup_qemu_switch_all_ctx(*this);
-    W64 data = 0;
 
+    /* Core tasks read RAM directly and see their own pending stores */
+    if unlikely (core_task_deferring()) {
+        Waddr hostaddr;
+        if(get_ram_host_addr(virtaddr, 1 << min(sizeshift, 3), false,
+                    hostaddr))
+            return coreThreads.load(hostaddr, sizeshift);
+    }
+
+    /* Devices behind MMIO may touch any CPU, RAM only this one */
     bool mmio = is_mmio_addr(virtaddr, 0);
+    if unlikely (mmio)
+        setup_qemu_switch_all_ctx(*this);
+    else
+        setup_qemu_switch_ctx(*this);
+
+    W64 data = 0;
 
     if likely (!kernel_mode && !mmio) {
         switch(sizeshift) {
@@ -1004,7 +1018,10 @@ W64 Context::loadvirt(Waddr virtaddr, int sizeshift) {
                     "] data[", hexstring(data, 64), "] origaddr[",
                     hexstring(virtaddr, 64), "]\n";
 
-    setup_ptlsim_switch_all_ctx(*this);
+    if unlikely (mmio)
+        setup_ptlsim_switch_all_ctx(*this);
+    else
+        setup_ptlsim_switch_ctx(*this);
 
     return data;
 }
@@ -1049,19 +1066,27 @@ W64 Context::loadphys(Waddr addr, bool internal, int sizeshift) {
     W64 data = 0;
     Waddr orig_addr = addr;
     addr = floor(addr, 8);
-    setup_qemu_switch_all_ctx(*this);
+    /* Plain host load, no QEMU state involved */
     data = ldq_raw((uint8_t*)addr);
 
     if(logable(10))
         ptl_logfile << "Context::loadphys addr[", hexstring(addr, 64),
                     "] data[", hexstring(data, 64), "] origaddr[",
                     hexstring(orig_addr, 64), "]\n";
-    setup_ptlsim_switch_all_ctx(*this);
     return data;
 }
 
 W64 Context::storemask_virt(Waddr virtaddr, W64 data, byte bytemask, int sizeshift) {
-    setup_qemu_switch_all_ctx(*this);
+    /* Stores of core tasks reach RAM in their turn */
+    if unlikely (core_task_deferring()) {
+        Waddr hostaddr;
+        if(get_ram_host_addr(virtaddr, 1 << min(sizeshift, 3), true,
+                    hostaddr)) {
+            coreThreads.defer_store(hostaddr, data, sizeshift);
+            return data;
+        }
+    }
+
     Waddr paddr = floor(virtaddr, 8);
 
     if(logable(10))
@@ -1069,7 +1094,9 @@ W64 Context::storemask_virt(Waddr virtaddr, W64 data, byte bytemask, int sizeshi
                     " with bytemask ", bytemask, " data: ", hexstring(
                             data, 64), endl;
 
+    /* Devices behind MMIO may touch any CPU, RAM only this one */
     if(is_mmio_addr(virtaddr, 1)) {
+        setup_qemu_switch_all_ctx(*this);
         switch(sizeshift) {
             case 0: {
                         stb_kernel(virtaddr, (W8)data);
@@ -1090,9 +1117,11 @@ W64 Context::storemask_virt(Waddr virtaddr, W64 data, byte bytemask, int sizeshi
             ptl_logfile << "MMIO WRITE addr: ", hexstring(virtaddr, 64),
                         " data: ", hexstring(data, 64), " size: ",
                         sizeshift, endl;
+        setup_ptlsim_switch_all_ctx(*this);
         return data;
     }
 
+    setup_qemu_switch_ctx(*this);
     switch(sizeshift) {
         case 0: // byte write
             (kernel_mode) ? stb_kernel(virtaddr, data) :
@@ -1112,6 +1141,7 @@ W64 Context::storemask_virt(Waddr virtaddr, W64 data, byte bytemask, int sizeshi
                 stq_user(virtaddr, data);
             break;
     }
+    setup_ptlsim_switch_ctx(*this);
     if(logable(10))
         ptl_logfile << "Context::storemask addr[", hexstring(paddr, 64),
                     "] data[", hexstring(data, 64), "]\n";
@@ -1201,7 +1231,7 @@ W64 Context::store_internal(Waddr addr, W64 data, byte bytemask) {
 
 W64 Context::storemask(Waddr paddr, W64 data, byte bytemask) {
     W64 old_data = 0;
-    setup_qemu_switch_all_ctx(*this);
+    /* Plain host access, no QEMU state involved */
     if(logable(10))
         ptl_logfile << "Trying to write to addr: ", hexstring(paddr, 64),
                     " with bytemask ", bytemask, " data: ", hexstring(
@@ -1256,7 +1286,7 @@ void Context::handle_page_fault(Waddr virtaddr, int is_write) {
 
 bool Context::try_handle_fault(Waddr virtaddr, int store) {
 
-    setup_qemu_switch_all_ctx(*this);
+    setup_qemu_switch_ctx(*this);
 
     if(logable(10))
         ptl_logfile << "Trying to fill tlb for addr: ", (void*)virtaddr, endl;
@@ -1267,7 +1297,7 @@ bool Context::try_handle_fault(Waddr virtaddr, int store) {
 
     cr[2] = cr2;
 
-    setup_ptlsim_switch_all_ctx(*this);
+    setup_ptlsim_switch_ctx(*this);
     if(fault) {
         if(logable(10))
             ptl_logfile << "Fault for addr: ", (void*)virtaddr, endl, flush;
@@ -1284,9 +1314,36 @@ bool Context::try_handle_fault(Waddr virtaddr, int store) {
     return true;
 }
 
+HostPhysMap host_phys_map;
+
+HostPhysMap::~HostPhysMap()
+{
+    for (W64 i = 0; i < (PAGE_COUNT >> LEAF_BITS); i++) {
+        delete [] leaves[i];
+    }
+}
+
+void HostPhysMap::add(Waddr host_vaddr, Waddr guest_paddr)
+{
+    W64 page = host_vaddr >> TARGET_PAGE_BITS;
+    assert(page < PAGE_COUNT);
+
+    W64*& leaf = leaves[page >> LEAF_BITS];
+    if unlikely (!leaf) {
+        /* Core threads may fill their TLBs at the same time */
+        W64* new_leaf = new W64[LEAF_SIZE];
+        memset(new_leaf, 0, LEAF_SIZE * sizeof(W64));
+        if (cmpxchg(leaf, new_leaf, (W64*)NULL) != NULL) {
+            delete [] new_leaf;
+        }
+    }
+
+    leaf[page & (LEAF_SIZE - 1)] = (guest_paddr & TARGET_PAGE_MASK) | 1;
+}
+
 extern "C" void ptl_add_phys_memory_mapping(int8_t cpu_index, uint64_t host_vaddr, uint64_t guest_paddr)
 {
-  contextof(cpu_index).hvirt_gphys_map[(Waddr)host_vaddr] = (Waddr)guest_paddr;
+  host_phys_map.add((Waddr)host_vaddr, (Waddr)guest_paddr);
 }
 
 void ptl_quit()
@@ -1435,6 +1492,471 @@ stringbuf* get_simpoint_chk_name()
     return name;
 }
 
+/* Last simpoint checkpoint, the parent of the next delta checkpoint */
+static stringbuf delta_parent;
+
+/**
+ * @brief End of the guest RAM offsets
+ */
+static W64 ram_end()
+{
+    RAMBlock *block;
+    W64 end = 0;
+
+    QLIST_FOREACH(block, &ram_list.blocks, next) {
+        end = max(end, (W64)(block->offset + block->length));
+    }
+
+    return end;
+}
+
+static const void* ram_page(W64 addr)
+{
+    return qemu_get_ram_ptr(addr);
+}
+
+/**
+ * @brief Start recording the RAM pages dirtied from now on
+ *
+ * Uses the MIGRATION_DIRTY_FLAG of each page, set by QEMU on every write
+ * to a page once the flag is cleared.
+ */
+static void reset_delta_pages()
+{
+    RAMBlock *block;
+
+    cpu_physical_memory_set_dirty_tracking(1);
+
+    QLIST_FOREACH(block, &ram_list.blocks, next) {
+        cpu_physical_memory_reset_dirty(block->offset,
+                block->offset + block->length, MIGRATION_DIRTY_FLAG);
+    }
+}
+
+/**
+ * @brief Save a checkpoint as a delta of delta_parent
+ *
+ * Device state and disk snapshots are saved by savevm without guest RAM,
+ * the RAM pages dirtied since the parent go to the delta file.
+ *
+ * @param chk_name Name of the checkpoint
+ *
+ * @return false if the delta file can't be written
+ */
+static bool create_delta_checkpoint(const char* chk_name)
+{
+    RAMBlock *block;
+    dynarray<W64> pages;
+
+    cpu_physical_sync_dirty_bitmap(0, TARGET_PHYS_ADDR_MAX);
+
+    QLIST_FOREACH(block, &ram_list.blocks, next) {
+        for (W64 addr = block->offset; addr < block->offset + block->length;
+                addr += TARGET_PAGE_SIZE) {
+            if (cpu_physical_memory_get_dirty(addr, MIGRATION_DIRTY_FLAG))
+                pages.push(addr);
+        }
+    }
+
+    stringbuf filename;
+    delta_checkpoint_filename(filename, config.simpoint_delta_dir,
+            chk_name);
+
+    if (!DeltaCheckpoint::write(filename, delta_parent, ram_end(),
+                TARGET_PAGE_SIZE, pages, ram_page)) {
+        ptl_logfile << "WARNING: Can't write delta checkpoint ",
+                    filename, ": ", strerror(errno), endl;
+        return false;
+    }
+
+    ram_save_skip_pages = 1;
+    create_checkpoint(chk_name);
+    ram_save_skip_pages = 0;
+
+    if (!config.quiet)
+        cout << "MARSSx86::Saved ", pages.size(), " dirty pages of ",
+             chk_name, " in ", filename, endl;
+
+    return true;
+}
+
+/**
+ * @brief Save a simpoint checkpoint, as a delta with -simpoint-delta-dir
+ *
+ * @param chk_name Name of the checkpoint
+ */
+static void create_simpoint_checkpoint(const char* chk_name)
+{
+    if (!config.simpoint_delta_dir.set()) {
+        create_checkpoint(chk_name);
+        return;
+    }
+
+    /* The first simpoint and any that can't be saved as delta are full */
+    if (!delta_parent.set() || !create_delta_checkpoint(chk_name))
+        create_checkpoint(chk_name);
+
+    reset_delta_pages();
+    delta_parent = chk_name;
+}
+
+/**
+ * @brief Load a checkpoint given to -loadvm
+ *
+ * A delta checkpoint is restored by loading the full checkpoint at the
+ * root of its chain and copying each page from the newest delta that has
+ * it, then its own device state and disk snapshots are loaded.
+ *
+ * @param name Name of the checkpoint
+ *
+ * @return 0 on success
+ */
+int ptl_load_checkpoint(const char *name)
+{
+    stringbuf filename;
+
+    if (config.simpoint_delta_dir.set())
+        delta_checkpoint_filename(filename, config.simpoint_delta_dir, name);
+
+    if (!config.simpoint_delta_dir.set() || access(filename, F_OK) != 0)
+        return load_vmstate(name);
+
+    /* Newest first, the root is the first parent without a delta */
+    dynarray<DeltaCheckpoint*> chain;
+    stringbuf root;
+    root = name;
+    int ret = -EINVAL;
+
+    while (access(filename, F_OK) == 0) {
+        DeltaCheckpoint *delta = new DeltaCheckpoint();
+        chain.push(delta);
+
+        if (!delta->open(filename)) {
+            cerr << "MARSSx86::Can't read delta checkpoint ", filename,
+                 endl;
+            goto out;
+        }
+
+        if (delta->ram_size() != ram_end() ||
+                delta->page_size() != TARGET_PAGE_SIZE) {
+            cerr << "MARSSx86::Delta checkpoint ", filename,
+                 " doesn't match the guest RAM size", endl;
+            goto out;
+        }
+
+        foreach (i, chain.size()) {
+            if (root == chain[i]->parent()) {
+                cerr << "MARSSx86::Delta checkpoint ", filename,
+                     " is its own parent", endl;
+                goto out;
+            }
+        }
+
+        root = delta->parent();
+        delta_checkpoint_filename(filename, config.simpoint_delta_dir, root);
+    }
+
+    if (!config.quiet)
+        cout << "MARSSx86::Loading checkpoint ", name, " from ", root,
+             " and ", chain.size(), " deltas", endl;
+
+    ret = load_vmstate(root);
+    if (ret < 0)
+        goto out;
+
+    {
+        W64 pages = ram_end() / TARGET_PAGE_SIZE;
+        W64 *restored = new W64[(pages + 63) / 64];
+        memset(restored, 0, ((pages + 63) / 64) * sizeof(W64));
+
+        foreach (i, chain.size()) {
+            DeltaCheckpoint *delta = chain[i];
+
+            for (W64 p = 0; p < delta->page_count(); p++) {
+                W64 addr = delta->page_addr(p);
+                W64 page = addr / TARGET_PAGE_SIZE;
+
+                if (page >= pages || bit(restored[page / 64], page % 64))
+                    continue;
+
+                memcpy(qemu_get_ram_ptr(addr), delta->page(p),
+                        TARGET_PAGE_SIZE);
+                restored[page / 64] |= (1ULL << (page % 64));
+            }
+        }
+
+        delete [] restored;
+    }
+
+    ret = load_vmstate(name);
+
+out:
+    foreach (i, chain.size()) {
+        delete chain[i];
+    }
+
+    return ret;
+}
+
+/* Running and failed children of -simpoint-fork and -sweep */
+static int forked_children = 0;
+static int failed_children = 0;
+
+/**
+ * @brief Reap finished children
+ *
+ * @param max_running Wait until at most this many children are running
+ */
+static void reap_children(int max_running)
+{
+    while (forked_children > 0) {
+        int status;
+        bool block = (forked_children > max_running);
+        pid_t pid = waitpid(-1, &status, (block) ? 0 : WNOHANG);
+
+        if (pid == 0)
+            break;
+
+        if (pid < 0) {
+            if (errno == EINTR)
+                continue;
+            forked_children = 0;
+            break;
+        }
+
+        forked_children--;
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            ptl_logfile << "WARNING: Child " << pid <<
+                " failed with status " << status << endl;
+            cerr << "MARSSx86::Child " << pid <<
+                " failed with status " << status << endl;
+            failed_children++;
+        }
+    }
+}
+
+/**
+ * @brief Fork a child once less than jobs children are running
+ *
+ * Nothing in flight or buffered is shared with the child, the child still
+ * has to call setup_forked_child().
+ *
+ * @param jobs Maximum number of running children, 0 for one per host CPU
+ *
+ * @return Return value of fork()
+ */
+static pid_t fork_child(W64 jobs)
+{
+    int max_jobs = jobs;
+    if (max_jobs <= 0)
+        max_jobs = max(1, (int)sysconf(_SC_NPROCESSORS_ONLN));
+
+    reap_children(max_jobs - 1);
+
+    qemu_aio_flush();
+    bdrv_flush_all();
+    ptl_logfile << flush;
+    cout << flush;
+    cerr << flush;
+
+    pid_t pid = fork();
+
+    if (pid > 0)
+        forked_children++;
+
+    return pid;
+}
+
+/**
+ * @brief Give a forked child its own host state and disk overlays
+ */
+static void setup_forked_child()
+{
+    /* Threads, host timers and AIO pipes are not shared with the parent */
+    paio_fork_child();
+    fork_child_timer_alarm();
+
+    if (bdrv_freeze_all() < 0) {
+        cerr << "MARSSx86::Forked child can't freeze its disk images\n";
+        _exit(1);
+    }
+
+    forked_children = 0;
+    failed_children = 0;
+}
+
+/**
+ * @brief Add per child log and stats files to a configuration
+ *
+ * @param cmd Configuration to add to
+ * @param suffix Suffix of the file names of the child
+ * @param default_stats Stats file used if none is configured, can be NULL
+ */
+static void add_child_files(stringbuf& cmd, const char* suffix,
+        const char* default_stats)
+{
+    cmd << "-logfile " << config.log_filename << "." << suffix;
+    if (config.stats_filename.set()) {
+        cmd << " -stats " << config.stats_filename << "." << suffix;
+    } else if (config.yaml_stats_filename.set()) {
+        cmd << " -yamlstats " << config.yaml_stats_filename << "." <<
+            suffix;
+    } else if (default_stats) {
+        cmd << " -yamlstats " << default_stats << "." << suffix;
+    }
+}
+
+/**
+ * @brief Turn a forked child into a simulation of its simpoint
+ *
+ * @param ctx CPU Context that reached the simpoint
+ * @param chk_name Name of the simpoint, added to log and stats file names
+ */
+static void start_simpoint_child(Context& ctx, const char* chk_name)
+{
+    setup_forked_child();
+
+    simpoint_enabled = 0;
+    ctx.simpoint_decr = 0;
+    tb_flush(&ctx);
+
+    stringbuf cmd;
+    add_child_files(cmd, chk_name, NULL);
+    cmd << " -kill-after-run -run";
+
+    ptl_machine_configure(cmd.buf);
+}
+
+/**
+ * @brief Fork a child that simulates the simpoint reached by ctx
+ *
+ * Guest memory is shared copy-on-write with the child and the disk images
+ * are frozen, both processes write to their own temporary overlay.
+ *
+ * @param ctx CPU Context that reached the simpoint
+ * @param chk_name Name of the simpoint
+ *
+ * @return true in the child
+ */
+static bool fork_simpoint(Context& ctx, const char* chk_name)
+{
+    pid_t pid = fork_child(config.simpoint_fork_jobs);
+
+    if (pid < 0) {
+        ptl_logfile << "WARNING: Can't fork simpoint child, " <<
+            "creating checkpoint instead\n";
+        create_checkpoint(chk_name);
+        return false;
+    }
+
+    if (pid == 0) {
+        start_simpoint_child(ctx, chk_name);
+        return true;
+    }
+
+    if (bdrv_freeze_all() < 0) {
+        cerr << "MARSSx86::Can't freeze disk images after fork\n";
+        ptl_quit();
+    }
+
+    if (!config.quiet)
+        cout << "MARSSx86::Forked simpoint ", chk_name, " as process ",
+             pid, endl;
+
+    return false;
+}
+
+/**
+ * @brief Run each configuration of the -sweep file in a forked child
+ *
+ * The loaded VM is never run in this process, it stays the pristine copy
+ * every child gets copy-on-write from fork(). Each child builds its
+ * machine from scratch, simulates up to -stopinsns and writes its own log
+ * and stats files, suffixed with the number of its configuration. The
+ * first configuration is number 0.
+ *
+ * Returns only in the children, the parent exits once all children are
+ * done.
+ */
+static void run_sweep()
+{
+    dynarray<stringbuf*> runs;
+    ifstream sweep_file(config.sweep_file);
+
+    if (!sweep_file) {
+        cerr << "MARSSx86::Sweep file ", config.sweep_file,
+             " not found", endl;
+        exit(1);
+    }
+
+    for (;;) {
+        std::string line;
+        std::getline(sweep_file, line);
+
+        if (!sweep_file)
+            break;
+
+        /* Drop comments and blank lines */
+        size_t comment = line.find(COMMENT_CHAR);
+        if (comment != std::string::npos)
+            line.erase(comment);
+
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos)
+            continue;
+
+        size_t end = line.find_last_not_of(" \t\r");
+
+        stringbuf *run = new stringbuf();
+        *run << line.substr(start, end - start + 1).c_str();
+        runs.push(run);
+    }
+
+    if (!config.quiet)
+        cout << "MARSSx86::Sweeping ", runs.size(), " configurations of ",
+             config.sweep_file, endl;
+
+    foreach (i, runs.size()) {
+        stringbuf suffix;
+        suffix << i;
+
+        stringbuf cmd;
+        add_child_files(cmd, suffix, config.sweep_file);
+        cmd << " " << *runs[i] << " -kill-after-run -run";
+
+        pid_t pid = fork_child(config.sweep_jobs);
+
+        if (pid < 0) {
+            cerr << "MARSSx86::Can't fork sweep child ", i, endl;
+            failed_children++;
+            continue;
+        }
+
+        if (pid == 0) {
+            setup_forked_child();
+            ptl_machine_configure(cmd.buf);
+            return;
+        }
+
+        ptl_logfile << "Sweep configuration ", i, " '", *runs[i],
+                    "' runs as process ", pid, endl;
+
+        if (!config.quiet)
+            cout << "MARSSx86::Sweep configuration ", i, " runs as process ",
+                 pid, endl;
+    }
+
+    reap_children(0);
+
+    if (!config.quiet)
+        cout << "MARSSx86::Sweep done, ", failed_children, " of ",
+             runs.size(), " configurations failed", endl;
+
+    ptl_logfile << flush;
+    exit((failed_children) ? 1 : 0);
+}
+
 void init_simpoints()
 {
     /* First check if we are simulating only one core or not */
@@ -1458,6 +1980,68 @@ uint8_t ptl_fast_fwd_enabled = 0;
 
 uint8_t sim_update_clock_offset = 1;
 
+/**
+ * @brief Flag to indicate if QEMU translates blocks with calls that pass
+ * emulated accesses and branches to the simulated machine
+ *
+ * Translated blocks are shared by all CPUs, so this is set once any CPU
+ * reaches its warming window. Only CPUs with Context::warming set warm the
+ * machine.
+ */
+uint8_t ptl_warm_enabled = 0;
+
+/* Instructions of each CPU that are warmed at the end of fast-forward */
+static W64 warm_insns[NUM_SIM_CORES];
+
+/* Machine warmed by the fast-forwarded instructions */
+static PTLsimMachine* warm_machine = NULL;
+
+/* Last branch of each CPU, its target is the next fetched rip */
+struct WarmBranch {
+    W64 branchaddr;
+    int type;
+    bool valid;
+};
+
+static WarmBranch warm_branches[NUM_SIM_CORES];
+
+/* Create a checkpoint instead of simulating after fast-forward */
+static bool fast_fwd_to_checkpoint = false;
+
+/**
+ * @brief Split fast-forward and warming instructions among all CPUs
+ *
+ * @param fwd_insns Instructions to fast-forward, including warming ones
+ * @param warm Instructions that warm the machine at the end
+ */
+static void fast_fwd_cpus(W64 fwd_insns, W64 warm)
+{
+    W64 per_cpu_fast_fwd = fwd_insns / NUM_SIM_CORES;
+
+    W64 per_cpu_warm = 0;
+    if (warm > 0 && per_cpu_fast_fwd > 1) {
+        per_cpu_warm = min(warm / NUM_SIM_CORES, per_cpu_fast_fwd - 1);
+    }
+
+    ptl_logfile << "All CPU context will be fast-forwared to " <<
+        per_cpu_fast_fwd << " instructions.\n";
+
+    if (per_cpu_warm) {
+        ptl_logfile << "Last " << per_cpu_warm << " fast-forwarded " <<
+            "instructions of each CPU will warm the machine.\n";
+    }
+
+    ptl_warm_enabled = 0;
+
+    foreach (i, NUM_SIM_CORES) {
+        Context& ctx = contextof(i);
+        ctx.simpoint_decr = per_cpu_fast_fwd - per_cpu_warm;
+        ctx.warming = 0;
+        warm_insns[i] = per_cpu_warm;
+        tb_flush(&ctx);
+    }
+}
+
 /**
  * @brief Set CPU's simpoint_decr count to fast-forward simulation mode
  */
@@ -1476,17 +2060,152 @@ void set_cpu_fast_fwd()
         fwd_insns = config.fast_fwd_user_insns;
     }
 
-    /* Set each CPU's counter specified from config.fast_fwd_insns */
-    W64 per_cpu_fast_fwd = fwd_insns / NUM_SIM_CORES;
+    /* Warmed state can't be saved into a checkpoint, so only warm when
+     * fast-forward switches to simulation */
+    fast_fwd_to_checkpoint = (config.fast_fwd_checkpoint.size() > 0);
 
-    ptl_logfile << "All CPU context will be fast-forwared to " <<
-        per_cpu_fast_fwd << " instructions.\n";
+    fast_fwd_cpus(fwd_insns, (fast_fwd_to_checkpoint) ? 0 :
+            config.fast_fwd_warm_insns);
+}
+
+/**
+ * @brief Fast-forward all CPUs between two samples of a sampled run
+ *
+ * @param fwd_insns Instructions to fast-forward, including warming ones
+ * @param warm_insns Instructions that warm the machine at the end
+ */
+void set_cpu_sample_fast_fwd(W64 fwd_insns, W64 warm_insns)
+{
+    fast_fwd_to_checkpoint = false;
+
+    if (fwd_insns / NUM_SIM_CORES == 0) {
+        /* Nothing to emulate, start next sample right away */
+        start_simulation = 1;
+        return;
+    }
+
+    ptl_fast_fwd_enabled = 1;
+    fast_fwd_cpus(fwd_insns, warm_insns);
+}
+
+/**
+ * @brief CPU has reached its warming window, let it emulate the remaining
+ * instructions while warming the simulated machine
+ *
+ * @param ctx CPU Context that reached its warming window
+ */
+static void start_warming(Context& ctx)
+{
+    ctx.simpoint_decr = warm_insns[ctx.cpu_index];
+    warm_insns[ctx.cpu_index] = 0;
+    ctx.warming = 1;
+
+    if (ptl_warm_enabled)
+        return;
+
+    warm_machine = setup_sim_machine();
+    if (!warm_machine) {
+        /* Nothing to warm, fast-forward all remaining instructions */
+        return;
+    }
+
+    warm_machine->warm_start();
 
     foreach (i, NUM_SIM_CORES) {
-        Context& ctx = contextof(i);
-        ctx.simpoint_decr = per_cpu_fast_fwd;
-        tb_flush(&ctx);
+        warm_branches[i].valid = false;
+    }
+
+    ptl_logfile << "Warming simulated machine from cycle " << sim_cycle <<
+        " with CPU " << int(ctx.cpu_index) << "\n";
+
+    /* Translate all blocks again with warming calls */
+    ptl_warm_enabled = 1;
+    foreach (i, NUM_SIM_CORES) {
+        tb_flush(&contextof(i));
+    }
+}
+
+/**
+ * @brief Find guest physical address of an emulated access without
+ * changing QEMU's TLB
+ *
+ * @param ctx CPU Context of the access
+ * @param virtaddr Virtual address of the access
+ * @param is_code Access is an instruction fetch
+ *
+ * @return Physical address, -1 for MMIO or unmapped address
+ */
+static W64 warm_translate(Context& ctx, W64 virtaddr, bool is_code)
+{
+    int mmu_index = cpu_mmu_index((CPUState*)&ctx);
+    int index = (virtaddr >> TARGET_PAGE_BITS) & (CPU_TLB_SIZE - 1);
+    W64 tlb_addr = (is_code) ? ctx.tlb_table[mmu_index][index].addr_code :
+        ctx.tlb_table[mmu_index][index].addr_read;
+
+    if likely ((virtaddr & TARGET_PAGE_MASK) ==
+            (tlb_addr & (TARGET_PAGE_MASK | TLB_INVALID_MASK))) {
+        if (tlb_addr & ~TARGET_PAGE_MASK)
+            return (W64)-1;
+
+        return virtaddr + ctx.tlb_table[mmu_index][index].phys_addend;
     }
+
+    /* Access is before QEMU's TLB fill, walk the page table */
+    target_phys_addr_t page = cpu_get_phys_page_debug((CPUState*)&ctx,
+            virtaddr & TARGET_PAGE_MASK);
+    if (page == (target_phys_addr_t)-1)
+        return (W64)-1;
+
+    return page + (virtaddr & ~TARGET_PAGE_MASK);
+}
+
+void ptl_warm_access(CPUX86State* cpu, uint64_t virtaddr, uint8_t is_write)
+{
+    Context& ctx = contextof(cpu->cpu_index);
+
+    if unlikely (!warm_machine || !ctx.warming)
+        return;
+    W64 physaddr = warm_translate(ctx, virtaddr, false);
+
+    if unlikely (physaddr == (W64)-1)
+        return;
+
+    warm_machine->warm_access(ctx, virtaddr, physaddr, false, is_write);
+}
+
+void ptl_warm_fetch(CPUX86State* cpu, uint64_t virtaddr)
+{
+    Context& ctx = contextof(cpu->cpu_index);
+
+    if unlikely (!warm_machine || !ctx.warming)
+        return;
+    WarmBranch& branch = warm_branches[ctx.cpu_index];
+
+    /* Blocks end at branches, so a pending branch goes to this fetch */
+    if (branch.valid) {
+        warm_machine->warm_branch(ctx, branch.type, branch.branchaddr,
+                virtaddr);
+        branch.valid = false;
+    }
+
+    W64 physaddr = warm_translate(ctx, virtaddr, true);
+
+    if unlikely (physaddr == (W64)-1)
+        return;
+
+    warm_machine->warm_access(ctx, virtaddr, physaddr, true, false);
+}
+
+void ptl_warm_branch(CPUX86State* cpu, uint64_t branchaddr, int type)
+{
+    if unlikely (!contextof(cpu->cpu_index).warming)
+        return;
+
+    WarmBranch& branch = warm_branches[cpu->cpu_index];
+
+    branch.branchaddr = branchaddr;
+    branch.type = type;
+    branch.valid = true;
 }
 
 /**
@@ -1599,13 +2318,17 @@ static void cpu_fast_fwded(Context& ctx)
         }
 
         ptl_fast_fwd_enabled = 0;
+        ptl_warm_enabled = 0;
+        warm_machine = NULL;
 
         foreach (i, NUM_SIM_CORES) {
+            warm_insns[i] = 0;
+            contextof(i).warming = 0;
             contextof(i).stopped = 0;
             tb_flush(&contextof(i));
         }
 
-        if (config.fast_fwd_checkpoint.size() > 0) {
+        if (fast_fwd_to_checkpoint) {
             create_checkpoint(config.fast_fwd_checkpoint.buf);
             ptl_quit();
         } else {
@@ -1630,14 +2353,33 @@ void ptl_simpoint_reached(int cpuid)
     if (simpoint_enabled) {
 
         stringbuf* chk_name = get_simpoint_chk_name();
-        create_checkpoint(chk_name->buf);
+
+        if (config.simpoint_fork) {
+            if (fork_simpoint(ctx, chk_name->buf)) {
+                delete chk_name;
+                return;
+            }
+        } else {
+            create_simpoint_checkpoint(chk_name->buf);
+        }
 
         set_next_simpoint(&ctx);
 
         delete chk_name;
+
+        if (!simpoint_enabled && config.simpoint_fork) {
+            /* All simpoints are forked, wait for them and quit */
+            reap_children(0);
+            ptl_quit();
+        }
     }
 
-    if (config.fast_fwd_insns > 0 || config.fast_fwd_user_insns > 0) {
+    if (ptl_fast_fwd_enabled) {
+        if (warm_insns[cpuid]) {
+            start_warming(ctx);
+            return;
+        }
+
         cpu_fast_fwded(ctx);
     }
 }
@@ -1655,6 +2397,10 @@ void ptl_qemu_initialized(void)
         run_tests();
     }
 
+    if (config.sweep_file.set()) {
+        run_sweep();
+    }
+
     if (simpoint_enabled) {
         set_next_simpoint(&contextof(0));
     }
@@ -44,10 +44,11 @@ extern "C" {
  * type		: W64 (unsigned long long)
  * working	: This variable represents a simulation clock cycle in PTLsim and
  *              it is used by QEMU to calculate wall clock time in simulation
- *              mode
+ *              mode. It is thread local, cores running ahead in a sync
+ *              quantum on their own host thread keep their own cycle.
  */
 typedef unsigned long long W64;
-extern W64 sim_cycle;
+extern __thread W64 sim_cycle;
 
 /*
  * in_simulation
@@ -133,6 +134,15 @@ void ptl_reconfigure(const char* config_str);
  */
 void ptl_config_from_file(const char *filename);
 
+/*
+ * ptl_load_checkpoint
+ * name         : name of the checkpoint given to -loadvm
+ * returns int  : 0 on success, negative value on error
+ * working      : Load a savevm checkpoint, or a delta checkpoint saved in
+ *                -simpoint-delta-dir with all the checkpoints it builds on
+ */
+int ptl_load_checkpoint(const char *name);
+
 /*
  * ptl_simulate
  * returns bool : 0 indicates that simulation is completed don't return
@@ -254,6 +264,51 @@ extern uint8_t ptl_fast_fwd_enabled;
  */
 void set_cpu_fast_fwd(void);
 
+/**
+ * @brief Indicate if fast-forwarded instructions warm the simulated caches,
+ * TLBs and branch predictors
+ *
+ * Set once a CPU reaches the last 'fast-fwd-warm-insns' instructions of its
+ * fast-forward window, checked by QEMU when translating a block.
+ */
+extern uint8_t ptl_warm_enabled;
+
+/* Branch types passed to ptl_warm_branch */
+#define PTL_WARM_BRANCH_UNCOND   0
+#define PTL_WARM_BRANCH_COND     (1 << 0)
+#define PTL_WARM_BRANCH_INDIRECT (1 << 1)
+#define PTL_WARM_BRANCH_CALL     (1 << 2)
+#define PTL_WARM_BRANCH_RET      (1 << 3)
+
+/* Instruction fetch is warmed once per line of this size */
+#define PTL_WARM_LINE_BITS 6
+
+/**
+ * @brief Warm a data access of an emulated instruction
+ *
+ * @param ctx CPU Context of the access
+ * @param virtaddr Virtual address of the access
+ * @param is_write Set for stores
+ */
+void ptl_warm_access(CPUX86State* ctx, uint64_t virtaddr, uint8_t is_write);
+
+/**
+ * @brief Warm an instruction fetch of an emulated instruction
+ *
+ * @param ctx CPU Context of the fetch
+ * @param virtaddr Virtual address of the fetched instruction
+ */
+void ptl_warm_fetch(CPUX86State* ctx, uint64_t virtaddr);
+
+/**
+ * @brief Warm a branch, its target is the address of the next fetch
+ *
+ * @param ctx CPU Context of the branch
+ * @param branchaddr Address following the branch instruction
+ * @param type PTL_WARM_BRANCH_* flags
+ */
+void ptl_warm_branch(CPUX86State* ctx, uint64_t branchaddr, int type);
+
 /**
  * @brief Initialize simulator structures after QEMU's initialization
  *
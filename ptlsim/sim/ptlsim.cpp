@@ -23,6 +23,7 @@
 #include <bson/bson.h>
 #include <bson/mongo.h>
 #include <machine.h>
+#include <basecore.h>
 #include <statelist.h>
 #include <decode.h>
 
@@ -35,6 +36,8 @@
 #endif
 
 #include <test.h>
+#include <hostProfile.h>
+#include <sampling.h>
 /*
  * DEPRECATED CONFIG OPTIONS:
  perfect_cache
@@ -56,7 +59,7 @@ ofstream ptl_rip_trace;
 ofstream trace_mem_logfile;
 ofstream yaml_stats_file;
 bool logenable = 0;
-W64 sim_cycle = 0;
+__thread W64 sim_cycle = 0;
 W64 unhalted_cycle_count = 0;
 W64 iterations = 0;
 W64 total_uops_executed = 0;
@@ -138,6 +141,20 @@ struct SimStats : public Statable
         { }
     } performance;
 
+    struct qemu_switch : public Statable
+    {
+        StatObj<W64> to_qemu;
+        StatObj<W64> to_ptlsim;
+        StatObj<W64> nested;
+
+        qemu_switch(Statable *parent)
+            : Statable("qemu_switch", parent)
+              , to_qemu("to_qemu", this)
+              , to_ptlsim("to_ptlsim", this)
+              , nested("nested", this)
+        { }
+    } qemu_switch;
+
     StatString tags;
 
     SimStats()
@@ -145,6 +162,7 @@ struct SimStats : public Statable
           , version(this)
           , run(this)
           , performance(this)
+          , qemu_switch(this)
           , tags("tags", this)
     {
         tags.set_split(",");
@@ -184,11 +202,13 @@ void ConfigurationParser<PTLsimConfig>::reset() {
   snapshot_now.reset();
   time_stats_logfile = "";
   time_stats_period = 10000;
+  host_profile = 0;
 
   start_at_rip = INVALIDRIP;
   fast_fwd_insns = 0;
   fast_fwd_user_insns = 0;
   fast_fwd_checkpoint = "";
+  fast_fwd_warm_insns = 0;
 
   // memory model
   use_memory_model = 0;
@@ -214,8 +234,13 @@ void ConfigurationParser<PTLsimConfig>::reset() {
   dumpcode_filename = "test.dat";
   dump_at_end = 0;
   bbcache_dump_filename.reset();
+  bbcache_filename.reset();
 
   machine_config = "";
+  skip_idle_cycles = 0;
+  core_threads = 0;
+  sync_quantum = 0;
+  shared_bbcache = 0;
 
   ///
   /// memory hierarchy implementation
@@ -233,6 +258,7 @@ void ConfigurationParser<PTLsimConfig>::reset() {
 
   // Test Framework
   run_tests = 0;
+  uop_bench = 0;
 
   // Utilities/Tools
   execute_after_kill = "";
@@ -244,6 +270,20 @@ void ConfigurationParser<PTLsimConfig>::reset() {
   simpoint_file = "";
   simpoint_interval = 10e6;
   simpoint_chk_name = "simpoint";
+  simpoint_fork = 0;
+  simpoint_fork_jobs = 0;
+  simpoint_delta_dir = "";
+
+  // Sampling options
+  sampling_detail_insns = 0;
+  sampling_ff_insns = 0;
+  sampling_warm_insns = 0;
+  sampling_count = 0;
+  sampling_logfile = "";
+
+  // Sweep options
+  sweep_file = "";
+  sweep_jobs = 0;
 }
 
 template <>
@@ -280,11 +320,13 @@ void ConfigurationParser<PTLsimConfig>::setup() {
   add(snapshot_now,                 "snapshot-now",         "Take statistical snapshot immediately, using specified name");
   add(time_stats_logfile,           "time-stats-logfile",   "File to write time-series statistics (new)");
   add(time_stats_period,            "time-stats-period",    "Frequency of capturing time-stats (in cycles)");
+  add(host_profile,                 "host-profile",         "Measure host time of one in every <host-profile> cycles per core stage, signal and memory event (0 = off)");
   section("Trace Start/Stop Point");
   add(start_at_rip,                 "startrip",             "Start at rip <startrip>");
   add(fast_fwd_insns,               "fast-fwd-insns",       "Fast Fwd each CPU by <N> instructions");
   add(fast_fwd_user_insns,          "fast-fwd-user-insns",  "Fast Fwd each CPU by <N> user level instructions");
   add(fast_fwd_checkpoint,          "fast-fwd-checkpoint",  "Create a checkpoint <chk-name> after fast-forwarding");
+  add(fast_fwd_warm_insns,          "fast-fwd-warm-insns",  "Warm caches, TLBs and branch predictors during the last <N> fast-forwarded instructions");
   add(stop_at_insns,                "stopinsns",            "Stop after executing <stopinsns> user instructions");
   add(stop_at_cycle,                "stopcycle",            "Stop after <stop> cycles");
   add(stop_at_iteration,            "stopiter",             "Stop after <stop> iterations (does not apply to cycle-accurate cores)");
@@ -314,11 +356,16 @@ void ConfigurationParser<PTLsimConfig>::setup() {
   add(dumpcode_filename,            "dumpcode",             "Save page of user code at final rip to file <dumpcode>");
   add(dump_at_end,                  "dump-at-end",          "Set breakpoint and dump core before first instruction executed on return to native mode");
   add(bbcache_dump_filename,        "bbdump",               "Basic block cache dump filename");
+  add(bbcache_filename,             "bbcache-file",         "Reuse basic block translations stored in this file and add new ones at exit");
 
  add(verify_cache,               "verify-cache",                   "run simulation with storing actual data in cache");
 
   section("Core Configuration");
   add(machine_config, "machine", "Name of machine configuration to simulate");
+  add(skip_idle_cycles, "skip-idle-cycles", "Fast-forward over cycles in which cores and memory have no work");
+  add(core_threads, "core-threads", "Run each core on its own host thread, at most <core-threads> at a time (0 = single threaded)");
+  add(sync_quantum, "sync-quantum", "Let cores run up to <sync-quantum> cycles ahead of shared caches and memory before synchronizing (0 or 1 = every cycle)");
+  add(shared_bbcache, "shared-bbcache", "Share one basic block cache between all cores instead of one per core");
 
  ///
  /// following are for the new memory hierarchy implementation:
@@ -338,6 +385,7 @@ void ConfigurationParser<PTLsimConfig>::setup() {
   // Test Framework
   section("Unit Test Framework");
   add(run_tests,            "run-tests",            "Run Test cases");
+  add(uop_bench,            "uop-bench",            "Issue a block of ALU uops this many times on each core, print the issue throughput and exit");
 
   // Utilities/Tools
   section("options for tools/utilities");
@@ -350,6 +398,20 @@ void ConfigurationParser<PTLsimConfig>::setup() {
   add(simpoint_file, "simpoint", "Create simpoint based checkpoints from given 'simpoint' file");
   add(simpoint_interval, "simpoint-interval", "Number of instructions in each interval");
   add(simpoint_chk_name, "simpoint-chk-name", "Checkpoint name prefix");
+  add(simpoint_fork, "simpoint-fork", "Fork a child that simulates each simpoint up to -stopinsns, instead of creating checkpoints");
+  add(simpoint_fork_jobs, "simpoint-fork-jobs", "Maximum number of simpoint children running at once, 0 for one per host CPU");
+  add(simpoint_delta_dir, "simpoint-delta-dir", "Save simpoints after the first one as deltas of dirty RAM pages in this directory, also used to restore them");
+
+  section("Sampling Options");
+  add(sampling_detail_insns, "sampling-detail", "Simulate <D> instructions in detail in each sample, 0 disables sampling");
+  add(sampling_ff_insns, "sampling-ff", "Fast-forward <U> instructions between samples");
+  add(sampling_warm_insns, "sampling-warm", "Warm caches, TLBs and branch predictors during the last <W> fast-forwarded instructions before each sample");
+  add(sampling_count, "sampling-count", "Stop after <N> samples, 0 samples until the simulation stops");
+  add(sampling_logfile, "sampling-logfile", "File to write statistics of each sample");
+
+  section("Sweep Options");
+  add(sweep_file, "sweep", "Simulate each configuration line of this file in a child forked from the loaded VM, then exit");
+  add(sweep_jobs, "sweep-jobs", "Maximum number of sweep children running at once, 0 for one per host CPU");
 };
 
 #ifndef CONFIG_ONLY
@@ -610,6 +672,23 @@ if ((config.loglevel > 0) & (config.start_log_at_rip == INVALIDRIP) & (config.st
     current_bbcache_dump_filename = config.bbcache_dump_filename;
   }
 
+  if (config.bbcache_filename != bbfile.filename) {
+    if (config.bbcache_filename.set()) bbfile.open(config.bbcache_filename);
+    else bbfile.close();
+  }
+
+  if (config.host_profile != host_profile_interval) {
+    host_profile_setup(config.host_profile);
+  }
+
+  if (config.shared_bbcache != bbcache_shared) {
+    // Blocks cached so far belong to the other layout
+    foreach (i, NUM_SIM_CORES) {
+      bbcache[i].flush(-1);
+    }
+    bbcache_shared = config.shared_bbcache;
+  }
+
 #ifdef __x86_64__
   config.start_log_at_rip = signext64(config.start_log_at_rip, 48);
   config.start_at_rip = signext64(config.start_at_rip, 48);
@@ -903,7 +982,7 @@ extern "C" void ptl_machine_configure(const char* config_str_) {
 
     ptl_machine.disable_dump();
 
-    if(config.run_tests) {
+    if(config.run_tests || config.uop_bench) {
         in_simulation = 1;
     }
 }
@@ -936,7 +1015,6 @@ void enable_checker() {
     }
 
     checker_context = new Context();
-    memset(checker_context, 0, sizeof(Context));
 }
 
 void setup_checker(W8 contextid) {
@@ -950,7 +1028,6 @@ void setup_checker(W8 contextid) {
       in_simulation = 0;
       tb_flush(ptl_contexts[0]);
       in_simulation = 1;
-      memset(checker_context, 0, sizeof(Context));
 
       /* Copy the context of given contextid */
       memcpy(checker_context, ptl_contexts[contextid], sizeof(Context));
@@ -967,7 +1044,7 @@ void setup_checker(W8 contextid) {
 
 void clear_checker() {
     assert(checker_context);
-    memset(checker_context, 0, sizeof(Context));
+    new(checker_context) Context();
 }
 
 bool is_checker_valid() {
@@ -1010,7 +1087,7 @@ void execute_checker() {
       // TODO : currently we skip the context switch from checker
       // we 0 out the checker_context so it will setup when next time
       // some one calls setup_checker
-      memset(checker_context, 0, sizeof(Context));
+      clear_checker();
     }
 
     in_simulation = 1;
@@ -1056,39 +1133,66 @@ void compare_checker(W8 context_id, W64 flagmask) {
         ptl_logfile << "Checker Context:\n" << *checker_context << endl << flush;
 
         cout << "\n*******************Failed checker***************\n";
-        memset(checker_context, 0, sizeof(Context));
+        clear_checker();
         // assert(0);
     }
 }
 
-void setup_qemu_switch_all_ctx(Context& last_ctx) {
-	foreach(c, contextcount) {
-		Context& ctx = contextof(c);
-		if(&ctx != &last_ctx)
-			ctx.setup_qemu_switch();
+/*
+ * Contexts are only converted when their first QEMU section opens and their
+ * last one closes, nested sections just make the context QEMU's current CPU.
+ * Guest memory accesses and helpers that only touch their own CPU switch that
+ * context alone, the _all_ctx variants are for QEMU code that may touch any
+ * CPU (devices, interrupts, exceptions that return to QEMU).
+ */
+void setup_qemu_switch_ctx(Context& ctx) {
+	core_task_serialize();
+
+	if(ctx.qemu_sections++ == 0) {
+		ctx.setup_qemu_switch();
+		simstats.qemu_switch.to_qemu++;
+	} else {
+		set_cpu_env((CPUX86State*)&ctx);
+		simstats.qemu_switch.nested++;
+	}
+}
+
+void setup_ptlsim_switch_ctx(Context& ctx) {
+	core_task_serialize();
+
+	assert(ctx.qemu_sections > 0);
+	if(--ctx.qemu_sections == 0) {
+		ctx.setup_ptlsim_switch();
+		simstats.qemu_switch.to_ptlsim++;
 	}
+}
+
+void setup_qemu_switch_all_ctx(Context& last_ctx) {
+	setup_qemu_switch_except_ctx(last_ctx);
 
 	/* last_ctx must setup after all other ctx are set */
-	last_ctx.setup_qemu_switch();
+	setup_qemu_switch_ctx(last_ctx);
 }
 
 void setup_qemu_switch_except_ctx(const Context& const_ctx) {
 	foreach(c, contextcount) {
 		Context& ctx = contextof(c);
 		if(&ctx != &const_ctx)
-			ctx.setup_qemu_switch();
+			setup_qemu_switch_ctx(ctx);
 	}
 }
 
 void setup_ptlsim_switch_all_ctx(Context& last_ctx) {
 	foreach(c, contextcount) {
 		Context& ctx = contextof(c);
-		if(&ctx != &last_ctx)
-			ctx.setup_ptlsim_switch();
+		if(&ctx != &last_ctx && ctx.qemu_sections)
+			setup_ptlsim_switch_ctx(ctx);
 	}
 
 	/* last_ctx must setup after all other ctx are set */
-	last_ctx.setup_ptlsim_switch();
+	if(last_ctx.qemu_sections)
+		setup_ptlsim_switch_ctx(last_ctx);
+	set_cpu_env((CPUX86State*)&last_ctx);
 }
 
 /* This function is auto-generated by dstbuild_bson.py script at compile time */
@@ -1180,6 +1284,14 @@ static void set_run_stats()
     RUN_STAT(kernel_stats);
     RUN_STAT(global_stats);
 #undef RUN_STAT
+
+    host_profile_update_stats(user_stats);
+    host_profile_update_stats(kernel_stats);
+    host_profile_update_stats(global_stats);
+
+    sampling_update_stats(user_stats);
+    sampling_update_stats(kernel_stats);
+    sampling_update_stats(global_stats);
 }
 
 static void setup_sim_stats()
@@ -1257,7 +1369,12 @@ static void dump_machine_configuration(PTLsimMachine *machine)
 	}
 }
 
-extern "C" uint8_t ptl_simulate() {
+/**
+ * @brief Find the simulation machine and initialize it on first use
+ *
+ * @return Machine to simulate, NULL if it can't be found or initialized
+ */
+PTLsimMachine* setup_sim_machine() {
 	PTLsimMachine* machine = NULL;
 	char* machinename = config.core_name;
 	if likely (curr_ptl_machine != NULL) {
@@ -1269,20 +1386,15 @@ extern "C" uint8_t ptl_simulate() {
 	if (!machine) {
 		ptl_logfile << "Cannot find core named '" << machinename << "'" << endl;
 		cerr << "Cannot find core named '" << machinename << "'" << endl;
-		return 0;
+		return NULL;
 	}
 
-    // If config.run_tests is enabled, then run testcases
-    if(config.run_tests) {
-        run_tests();
-    }
-
 	if (!machine->initialized) {
 		ptl_logfile << "Initializing core '" << machinename << "'" << endl;
 		if (!machine->init(config)) {
 			ptl_logfile << "Cannot initialize simulation machine; check the configuration!" << endl;
             config.run = 0;
-			return 0;
+			return NULL;
 		}
 		machine->initialized = 1;
 		machine->first_run = 1;
@@ -1333,9 +1445,87 @@ extern "C" uint8_t ptl_simulate() {
         }
 	}
 
+	return machine;
+}
+
+/**
+ * @brief Measure the uop issue throughput of each core of the machine
+ *
+ * Builds a block with the ALU mix of a typical integer loop body and lets
+ * every core issue it config.uop_bench times through its own dispatch and
+ * issue stages, see BaseCore::bench_issue.
+ *
+ * @param machine Machine with the cores to measure
+ */
+static void run_uop_bench(BaseMachine& machine)
+{
+    static const int ops[] = {OP_add, OP_sub, OP_and, OP_xor, OP_or,
+        OP_mov, OP_sel, OP_add, OP_sub, OP_br};
+    BasicBlock* tmpl = new BasicBlock();
+    RIPVirtPhys rvp;
+
+    setzero(rvp);
+    rvp.rip = 0x400000;
+    tmpl->reset(rvp);
+
+    foreach (i, lengthof(ops)) {
+        TransOp& op = tmpl->transops[i];
+        op.init(ops[i], REG_temp0, REG_rax, REG_rbx, REG_zero, 3, 0, 0,
+                (ops[i] == OP_mov) ? 0 : SETFLAG_ZF|SETFLAG_CF|SETFLAG_OF);
+        op.cond = (ops[i] == OP_sel || ops[i] == OP_br) ? COND_ne : 0;
+        op.bbindex = i;
+
+        /* Both directions go to the same place, the branch never redirects */
+        op.riptaken = 0x400100;
+        op.ripseq = 0x400100;
+    }
+    tmpl->count = lengthof(ops);
+
+    BasicBlock* bb = tmpl->clone();
+    delete tmpl;
+    synth_uops_for_bb(*bb);
+
+    foreach (i, machine.cores.count()) {
+        W64 ticks = machine.cores[i]->bench_issue(*bb, config.uop_bench);
+
+        if (!ticks) {
+            cout << "Core ", i, " can't run the issue benchmark", endl;
+            continue;
+        }
+
+        W64 uops = config.uop_bench * bb->count;
+        cout << "Core ", i, " issued ", uops, " uops at ",
+             W64(uops / ticks_to_native_seconds(ticks)), " uops/sec", endl;
+    }
+
+    bb->free();
+}
+
+extern "C" uint8_t ptl_simulate() {
+    // If config.run_tests is enabled, then run testcases
+    if(config.run_tests) {
+        run_tests();
+    }
+
+	PTLsimMachine* machine = setup_sim_machine();
+	if (!machine)
+		return 0;
+
+    if(config.uop_bench) {
+        run_uop_bench(*(BaseMachine*)machine);
+        exit(0);
+    }
+
+	/*
+	 * QEMU owns all contexts here. An exception may have left simulation
+	 * in the middle of a QEMU section, so close all sections at once.
+	 */
 	foreach(ctx_no, contextcount) {
 		Context& ctx = contextof(ctx_no);
-		ctx.setup_ptlsim_switch();
+		if(ctx.qemu_sections) {
+			ctx.qemu_sections = 1;
+			setup_ptlsim_switch_ctx(ctx);
+		}
 		ctx.running = 1;
 	}
 
@@ -1365,6 +1555,8 @@ extern "C" uint8_t ptl_simulate() {
 		ptl_logfile << endl;
     }
 
+	sampling_start_sample();
+
 	machine->run(config);
 
 	if (config.stop_at_insns <= total_insns_committed || config.kill == true
@@ -1372,6 +1564,11 @@ extern "C" uint8_t ptl_simulate() {
 		machine->stopped = 1;
 	}
 
+	bool sample_done = sampling_sample_done();
+	if (sample_done && !sampling_end_sample()) {
+		machine->stopped = 1;
+	}
+
 	ptl_stable_state = 1;
 
     if(machine->ret_qemu_env)
@@ -1386,10 +1583,25 @@ extern "C" uint8_t ptl_simulate() {
             ptl_logfile << endl << flush;
         }
 
+		if (sample_done) {
+			/* Emulate up to the next sample, its pipelines start empty */
+			machine->first_run = 1;
+			sim_update_clock_offset = 1;
+
+			foreach(ctx_no, contextcount) {
+				contextof(ctx_no).old_eip = 0;
+			}
+
+			sampling_fast_fwd();
+			return 0;
+		}
+
 		/* Tell QEMU that we will come back to simulate */
 		return 1;
 	}
 
+	sampling_stop();
+
 
 	W64 tsc_at_end = rdtsc();
 	curr_ptl_machine = NULL;
@@ -1415,6 +1627,11 @@ extern "C" uint8_t ptl_simulate() {
 	ptl_logfile << sb << flush;
 	cerr << sb << flush;
 
+	if (sampling_enabled()) {
+		sampling_dump_summary(ptl_logfile);
+		sampling_dump_summary(cerr);
+	}
+
 #if 1 /* yclin */
   //ptl_logfile << DRAM::memoryDistribution;
 #endif
@@ -1567,6 +1784,19 @@ void clock_qemu_io_events()
     }
 }
 
+/**
+ * @brief Get the cycle of earliest pending QEMU IO event, -1 if none
+ */
+W64 get_next_qemu_io_event_cycle()
+{
+    W64 next = W64(-1);
+    QemuIOSignal *signal;
+    foreach_list_mutable(qemuIOEvents->list(), signal, entry, prev) {
+        next = min(next, signal->cycle);
+    }
+    return next;
+}
+
 extern "C" void add_qemu_io_event(QemuIOCB fn, void *arg, int delay)
 {
     QemuIOSignal* signal = qemuIOEvents->alloc();
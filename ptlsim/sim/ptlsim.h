@@ -64,6 +64,13 @@ struct PTLsimMachine : public Statable {
   virtual void dump_configuration(ostream& os) const;
   virtual void reset(){};
   virtual void shutdown(){};
+
+  // Functional warming while QEMU fast-forwards
+  virtual void warm_start(){};
+  virtual void warm_access(Context& ctx, W64 virtaddr, W64 physaddr,
+          bool is_icache, bool is_write){};
+  virtual void warm_branch(Context& ctx, int type, W64 branchaddr,
+          W64 target){};
   static void addmachine(const char* name, PTLsimMachine* machine);
   static void removemachine(const char* name, PTLsimMachine* machine);
   static PTLsimMachine* getmachine(const char* name);
@@ -82,6 +89,8 @@ struct PTLsimMachine : public Statable {
   }
 };
 
+PTLsimMachine* setup_sim_machine();
+
 void setup_qemu_switch_all_ctx(Context& last_ctx);
 void setup_qemu_switch_except_ctx(const Context& const_ctx);
 void setup_ptlsim_switch_all_ctx(Context& const_ctx);
@@ -102,14 +111,14 @@ void compare_checker(W8 context_id, W64 flagmask);
 
 struct TransOpBuffer {
   TransOp uops[MAX_TRANSOP_BUFFER_SIZE];
-  uopimpl_func_t synthops[MAX_TRANSOP_BUFFER_SIZE];
+  UopExec execs[MAX_TRANSOP_BUFFER_SIZE];
   int index;
   int count;
 
-  bool get(TransOp& uop, uopimpl_func_t& synthop) {
+  bool get(TransOp& uop, UopExec& exec) {
     if (!count) return false;
     uop = uops[index];
-    synthop = synthops[index];
+    exec = execs[index];
     index++;
     if (index >= count) { count = 0; index = 0; }
     return true;
@@ -164,7 +173,7 @@ struct PTLsimStats;
 
 extern ofstream ptl_logfile;
 extern ofstream trace_mem_logfile;
-extern W64 sim_cycle;
+extern __thread W64 sim_cycle;
 extern W64 user_insn_commits;
 extern W64 iterations;
 extern W64 total_uops_executed;
@@ -196,6 +205,7 @@ struct PTLsimConfig {
   W64 fast_fwd_insns;
   W64 fast_fwd_user_insns;
   stringbuf fast_fwd_checkpoint;
+  W64 fast_fwd_warm_insns;
 
   // Logging
   bool quiet;
@@ -223,6 +233,7 @@ struct PTLsimConfig {
   stringbuf time_stats_logfile;
   W64 time_stats_period;
   stringbuf stats_format;
+  W64 host_profile;
 
   // memory model:
   bool use_memory_model;
@@ -254,9 +265,14 @@ struct PTLsimConfig {
   stringbuf dumpcode_filename;
   bool dump_at_end;
   stringbuf bbcache_dump_filename;
+  stringbuf bbcache_filename;
 
   // Machine configurations
   stringbuf machine_config;
+  bool skip_idle_cycles;
+  W64 core_threads;
+  W64 sync_quantum;
+  bool shared_bbcache;
 
   ///
   /// for memory hierarchy implementaion
@@ -275,6 +291,7 @@ struct PTLsimConfig {
 
   // Test Framework
   bool run_tests;
+  W64 uop_bench;
 
   //Utilities/Tools
   stringbuf execute_after_kill;
@@ -286,6 +303,20 @@ struct PTLsimConfig {
   stringbuf simpoint_file;
   W64 simpoint_interval;
   stringbuf simpoint_chk_name;
+  bool simpoint_fork;
+  W64 simpoint_fork_jobs;
+  stringbuf simpoint_delta_dir;
+
+  // Sampling options
+  W64 sampling_detail_insns;
+  W64 sampling_ff_insns;
+  W64 sampling_warm_insns;
+  W64 sampling_count;
+  stringbuf sampling_logfile;
+
+  // Sweep options
+  stringbuf sweep_file;
+  W64 sweep_jobs;
 
   void reset();
 
@@ -313,6 +344,7 @@ void force_logging_enabled();
 
 void init_qemu_io_events();
 void clock_qemu_io_events();
+W64 get_next_qemu_io_event_cycle();
 
 /**
  * @brief Convert nano-seconds to Simulation Cycles
@@ -334,5 +366,6 @@ float simcycles_to_ns(W64 cycles);
 
 void set_next_simpoint(Context& ctx);
 stringbuf* get_simpoint_chk_name();
+void set_cpu_sample_fast_fwd(W64 fwd_insns, W64 warm_insns);
 
 #endif // _PTLSIM_H_
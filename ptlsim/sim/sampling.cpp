@@ -0,0 +1,199 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <globals.h>
+#include <ptlsim.h>
+#include <sampling.h>
+#include <statsBuilder.h>
+
+W64 sampling_stop_at_insns = infinity;
+
+/* Start of the running sample */
+static bool in_sample = false;
+static W64 sample_start_insns;
+static W64 sample_start_cycle;
+
+static SampleSeries sample_ipc;
+static W64 sampled_insns = 0;
+static W64 sampled_cycles = 0;
+
+static ofstream *sampling_logfile = NULL;
+static stringbuf sampling_logfile_name;
+
+struct SamplingStats : public Statable
+{
+    StatObj<W64> samples;
+    StatObj<W64> insns;
+    StatObj<W64> cycles;
+    StatObj<double> ipc;
+    StatObj<double> ipc_stddev;
+    StatObj<double> ipc_ci95;
+
+    SamplingStats()
+        : Statable("sampling")
+          , samples("samples", this)
+          , insns("insns", this)
+          , cycles("cycles", this)
+          , ipc("ipc", this)
+          , ipc_stddev("ipc_stddev", this)
+          , ipc_ci95("ipc_ci95", this)
+    {
+        disable_dump();
+    }
+} samplingStats;
+
+bool sampling_enabled()
+{
+    return config.sampling_detail_insns > 0;
+}
+
+static void open_logfile()
+{
+    if (config.sampling_logfile == sampling_logfile_name)
+        return;
+
+    if (sampling_logfile) {
+        sampling_logfile->close();
+        delete sampling_logfile;
+        sampling_logfile = NULL;
+    }
+
+    sampling_logfile_name = config.sampling_logfile;
+
+    if (config.sampling_logfile.set()) {
+        sampling_logfile = new ofstream(config.sampling_logfile.buf);
+        *sampling_logfile << "sample,start_insn,start_cycle,insns,cycles,ipc\n";
+    }
+}
+
+/**
+ * @brief Start the detailed window of a sample, if sampling is enabled
+ *
+ * Called each time the simulation is entered, the window goes on until
+ * sampling_stop_at_insns instructions are committed.
+ */
+void sampling_start_sample()
+{
+    if (!sampling_enabled() || in_sample)
+        return;
+
+    open_logfile();
+
+    in_sample = true;
+    sample_start_insns = total_insns_committed;
+    sample_start_cycle = sim_cycle;
+    sampling_stop_at_insns = total_insns_committed +
+        config.sampling_detail_insns;
+
+    if (logable(1)) {
+        ptl_logfile << "Starting sample ", sample_ipc.count, " at ",
+                    total_insns_committed, " commits, cycle ", sim_cycle,
+                    endl;
+    }
+}
+
+/**
+ * @brief Check if the running sample has committed all its instructions
+ */
+bool sampling_sample_done()
+{
+    return in_sample && sampling_stop_at_insns <= total_insns_committed;
+}
+
+/**
+ * @brief Record the running sample
+ *
+ * @return false if this was the last sample
+ */
+bool sampling_end_sample()
+{
+    W64 insns = total_insns_committed - sample_start_insns;
+    W64 cycles = sim_cycle - sample_start_cycle;
+    double ipc = (cycles) ? double(insns) / double(cycles) : 0;
+
+    in_sample = false;
+    sampling_stop_at_insns = infinity;
+
+    sample_ipc.add(ipc);
+    sampled_insns += insns;
+    sampled_cycles += cycles;
+
+    if (sampling_logfile) {
+        *sampling_logfile << (sample_ipc.count - 1), ",",
+                          sample_start_insns, ",", sample_start_cycle, ",",
+                          insns, ",", cycles, ",", ipc, "\n";
+        sampling_logfile->flush();
+    }
+
+    if (logable(1)) {
+        ptl_logfile << "Sample ", (sample_ipc.count - 1), " done: ", insns,
+                    " insns in ", cycles, " cycles, ipc ", ipc, endl;
+    }
+
+    return !(config.sampling_count &&
+            sample_ipc.count >= config.sampling_count);
+}
+
+/**
+ * @brief Fast-forward to the next sample in emulation mode
+ */
+void sampling_fast_fwd()
+{
+    W64 warm = min(config.sampling_warm_insns, config.sampling_ff_insns);
+    set_cpu_sample_fast_fwd(config.sampling_ff_insns, warm);
+}
+
+/**
+ * @brief Simulation is stopped, drop the sample that is running
+ */
+void sampling_stop()
+{
+    in_sample = false;
+    sampling_stop_at_insns = infinity;
+}
+
+/**
+ * @brief Print the IPC estimated from all samples
+ *
+ * @param os Stream to print to
+ */
+void sampling_dump_summary(ostream& os)
+{
+    if (!sample_ipc.count)
+        return;
+
+    os << "Sampled ", sample_ipc.count, " samples of ",
+       config.sampling_detail_insns, " insns: ipc ", sample_ipc.mean(),
+       " +/- ", sample_ipc.ci95(), " (95% confidence, stddev ",
+       sample_ipc.stddev(), ")", endl;
+}
+
+/**
+ * @brief Write the summary of all samples into given Stats
+ *
+ * @param stats Stats to update
+ */
+void sampling_update_stats(Stats *stats)
+{
+    if (!sample_ipc.count)
+        return;
+
+    samplingStats.enable_dump();
+    samplingStats.set_default_stats(stats);
+
+    W64 count = sample_ipc.count;
+    double mean = sample_ipc.mean();
+    double stddev = sample_ipc.stddev();
+    double ci95 = sample_ipc.ci95();
+
+    samplingStats.samples = count;
+    samplingStats.insns = sampled_insns;
+    samplingStats.cycles = sampled_cycles;
+    samplingStats.ipc = mean;
+    samplingStats.ipc_stddev = stddev;
+    samplingStats.ipc_ci95 = ci95;
+}
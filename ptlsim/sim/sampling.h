@@ -0,0 +1,88 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <globals.h>
+#include <superstl.h>
+
+/*
+ * Periodic Sampling
+ *
+ * With -sampling-detail D a run is split into samples like SMARTS does:
+ * each sample simulates D instructions in detail, then QEMU fast-forwards
+ * -sampling-ff U instructions of which the last -sampling-warm W also warm
+ * the caches, TLBs and branch predictors, and the next sample starts. The
+ * first sample starts when the simulation starts. Sampling goes on until
+ * the simulation is stopped or -sampling-count samples are taken.
+ *
+ * Each sample is written as one line to -sampling-logfile and the IPC of
+ * all samples is summed up in the 'sampling' stats section, with the
+ * half width of its 95% confidence interval.
+ */
+
+/*
+ * Mean and confidence interval of a series of samples, using the normal
+ * approximation that needs about 30 samples to hold
+ */
+struct SampleSeries {
+    W64 count;
+    double sum;
+    double sum_sq;
+
+    SampleSeries() { reset(); }
+
+    void reset() {
+        count = 0;
+        sum = 0;
+        sum_sq = 0;
+    }
+
+    void add(double value) {
+        count++;
+        sum += value;
+        sum_sq += value * value;
+    }
+
+    double mean() const {
+        return (count) ? sum / count : 0;
+    }
+
+    /* Sample standard deviation */
+    double stddev() const {
+        if (count < 2)
+            return 0;
+
+        double var = (sum_sq - (sum * sum) / count) / (count - 1);
+        return (var > 0) ? sqrt(var) : 0;
+    }
+
+    /* Half width of the 95% confidence interval of the mean */
+    double ci95() const {
+        if (count < 2)
+            return 0;
+
+        return 1.96 * stddev() / sqrt(double(count));
+    }
+};
+
+class Stats;
+
+/* Committed instruction count that ends the running sample */
+extern W64 sampling_stop_at_insns;
+
+bool sampling_enabled();
+void sampling_start_sample();
+bool sampling_sample_done();
+bool sampling_end_sample();
+void sampling_fast_fwd();
+void sampling_stop();
+void sampling_dump_summary(ostream& os);
+void sampling_update_stats(Stats *stats);
+
+#endif // SAMPLING_H
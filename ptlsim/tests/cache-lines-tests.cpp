@@ -0,0 +1,81 @@
+
+#include <gtest/gtest.h>
+
+// We disable Assert of Simulator
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <memoryHierarchy.h>
+#include <cacheLines.h>
+
+using namespace Memory;
+
+namespace {
+
+    /*
+     * Run same random access stream on CacheLines and on the AssociativeArray
+     * it replaced, both must pick the same ways and evict the same tags.
+     */
+    template<int SETS, int WAYS, int LINE_SIZE>
+    void check_same_as_associative_array(int addrLines)
+    {
+        typedef AssociativeArray<W64, CacheLine, SETS, WAYS, LINE_SIZE> array_t;
+
+        array_t *array = new array_t();
+        CacheLines *lines = new CacheLines(SETS, WAYS, LINE_SIZE, 1, 1, 1);
+
+        srand(7);
+
+        foreach(i, 200000) {
+            W64 addr = W64(rand() % addrLines) * LINE_SIZE + (rand() % LINE_SIZE);
+            int op = rand() % 100;
+
+            if(op < 60) {
+                CacheLine *expected = array->probe(addr);
+                CacheLine *line = lines->probe(addr);
+                ASSERT_EQ(expected == NULL, line == NULL);
+            } else if(op < 95) {
+                W64 expectedTag = -1;
+                W64 oldTag = -1;
+                array->select(addr, expectedTag);
+                lines->insert(addr, oldTag);
+                ASSERT_EQ(expectedTag, oldTag);
+            } else {
+                ASSERT_EQ(array->invalidate(addr), lines->invalidate(addr));
+            }
+        }
+
+        delete array;
+        delete lines;
+    }
+
+    TEST(CacheLines, SameAsAssociativeArray)
+    {
+        check_same_as_associative_array<64, 8, 64>(2000);
+        check_same_as_associative_array<1024, 16, 64>(40000);
+        check_same_as_associative_array<32, 3, 64>(200);
+        check_same_as_associative_array<16, 1, 128>(100);
+    }
+
+    TEST(CacheLines, Geometry)
+    {
+        /* Non power of two set count, as in a 12M 16 way cache */
+        CacheLines lines(12288, 16, 64, 30, 1, 1);
+
+        ASSERT_EQ(12 * 1024 * 1024, lines.get_size());
+        ASSERT_EQ(12288, lines.get_set_count());
+        ASSERT_EQ(16, lines.get_way_count());
+        ASSERT_EQ(64, lines.get_line_size());
+        ASSERT_EQ(6, lines.get_line_bits());
+        ASSERT_EQ(30, lines.get_access_latency());
+
+        W64 oldTag = -1;
+        ASSERT_EQ(NULL, lines.probe(0x12345678));
+        CacheLine *line = lines.insert(0x12345678, oldTag);
+        ASSERT_EQ(W64(-1), oldTag);
+        ASSERT_EQ(line, lines.probe(0x12345640));
+        ASSERT_EQ(0x12345640, lines.tagOf(0x12345678));
+
+        ASSERT_LE(0, lines.invalidate(0x12345678));
+        ASSERT_EQ(NULL, lines.probe(0x12345678));
+    }
+};
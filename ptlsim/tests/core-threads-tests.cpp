@@ -0,0 +1,384 @@
+
+#include <gtest/gtest.h>
+
+// We disable Assert of Simulator
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <coreThreads.h>
+#include <memoryHierarchy.h>
+#include <machine.h>
+
+using namespace Memory;
+
+namespace {
+
+    const int TASKS = 4;
+
+    W64 memory[TASKS + 1];
+    int serialOrder[TASKS];
+    int serialCount;
+    W64 seenBefore[TASKS];
+    W64 seenAfter[TASKS];
+
+    /*
+     * Every task stores its id to its own slot and to the shared last slot,
+     * odd tasks then serialize and record their turn and the shared slot.
+     */
+    template<int ID>
+    bool store_task(void *arg)
+    {
+        coreThreads.defer_store((Waddr)&memory[ID], ID + 1, 3);
+        coreThreads.defer_store((Waddr)&memory[TASKS], ID + 1, 3);
+
+        seenBefore[ID] = coreThreads.load((Waddr)&memory[TASKS], 3);
+
+        if(ID & 1) {
+            core_task_serialize();
+            serialOrder[serialCount++] = ID;
+            seenAfter[ID] = memory[TASKS];
+        }
+
+        return ID == 2;
+    }
+
+    void run_tasks(int threads)
+    {
+        Signal signals[TASKS];
+        dynarray<Signal*> list;
+
+        signals[0].connect(signal_fun_ptr(store_task<0>));
+        signals[1].connect(signal_fun_ptr(store_task<1>));
+        signals[2].connect(signal_fun_ptr(store_task<2>));
+        signals[3].connect(signal_fun_ptr(store_task<3>));
+
+        foreach(i, TASKS) {
+            signals[i].set_name("store_task");
+            list.push(&signals[i]);
+        }
+
+        foreach(cycle, 20) {
+            memset(memory, 0, sizeof(memory));
+            serialCount = 0;
+
+            coreThreads.start(list, threads, 1, NULL);
+            ASSERT_TRUE(coreThreads.run_cycle());
+            coreThreads.stop();
+
+            /* Serialized parts run in core order */
+            ASSERT_EQ(2, serialCount);
+            ASSERT_EQ(1, serialOrder[0]);
+            ASSERT_EQ(3, serialOrder[1]);
+
+            /* Tasks see their own store last before their turn */
+            foreach(i, TASKS) {
+                ASSERT_EQ(W64(i + 1), seenBefore[i]);
+            }
+
+            /* and stores of all lower tasks after it */
+            ASSERT_EQ(W64(2), seenAfter[1]);
+            ASSERT_EQ(W64(4), seenAfter[3]);
+
+            /* Stores reach memory in core order */
+            foreach(i, TASKS) {
+                ASSERT_EQ(W64(i + 1), memory[i]);
+            }
+            ASSERT_EQ(W64(TASKS), memory[TASKS]);
+        }
+    }
+
+    TEST(CoreThreads, SameResultForAnyThreadCount)
+    {
+        /* Needs a build with enough simulated cores */
+        if(NUM_SIM_CORES < TASKS)
+            return;
+
+        run_tasks(1);
+        run_tasks(2);
+        run_tasks(TASKS);
+    }
+
+    W64 legacySeen[TASKS];
+
+    /*
+     * Store as core models do: deferred in a core task, directly in the
+     * legacy loop.
+     */
+    void task_store(W64 *addr, W64 data)
+    {
+        if(core_task_deferring())
+            coreThreads.defer_store((Waddr)addr, data, 3);
+        else
+            *addr = data;
+    }
+
+    W64 task_load(W64 *addr)
+    {
+        if(core_task_deferring())
+            return coreThreads.load((Waddr)addr, 3);
+        return *addr;
+    }
+
+    /*
+     * Every task reads the shared slot, then adds its id to its own slot
+     * and to the shared one.
+     */
+    template<int ID>
+    bool legacy_task(void *arg)
+    {
+        legacySeen[ID] = task_load(&memory[TASKS]);
+        task_store(&memory[ID], task_load(&memory[ID]) + ID + 1);
+        task_store(&memory[TASKS], legacySeen[ID] + ID + 1);
+        return false;
+    }
+
+    void connect_legacy_tasks(Signal *signals, dynarray<Signal*>& list)
+    {
+        signals[0].connect(signal_fun_ptr(legacy_task<0>));
+        signals[1].connect(signal_fun_ptr(legacy_task<1>));
+        signals[2].connect(signal_fun_ptr(legacy_task<2>));
+        signals[3].connect(signal_fun_ptr(legacy_task<3>));
+
+        foreach(i, TASKS) {
+            signals[i].set_name("legacy_task");
+            list.push(&signals[i]);
+        }
+    }
+
+    /*
+     * Compare with the legacy loop that emits per-cycle signals one after
+     * the other, any thread count has to give exactly the same results.
+     */
+    TEST(CoreThreads, LegacyLoopBaseline)
+    {
+        const int CYCLES = 3;
+        Signal signals[TASKS];
+        dynarray<Signal*> list;
+        W64 legacyMemory[TASKS + 1];
+        W64 legacyResult[TASKS];
+
+        if(NUM_SIM_CORES < TASKS)
+            return;
+
+        connect_legacy_tasks(signals, list);
+
+        memset(memory, 0, sizeof(memory));
+        foreach(cycle, CYCLES) {
+            foreach(i, TASKS) {
+                ASSERT_FALSE(list[i]->emit(NULL));
+            }
+        }
+        memcpy(legacyMemory, memory, sizeof(memory));
+        memcpy(legacyResult, legacySeen, sizeof(legacySeen));
+
+        /* Each core sees the shared store of the core before it */
+        foreach(i, TASKS) {
+            ASSERT_EQ(W64(CYCLES - 1) * (TASKS * (TASKS + 1) / 2) +
+                    (i * (i + 1) / 2), legacySeen[i]);
+        }
+
+        for(int threads = 1; threads <= TASKS; threads *= 2) {
+            memset(memory, 0, sizeof(memory));
+            memset(legacySeen, 0, sizeof(legacySeen));
+
+            W64 saved_cycle = sim_cycle;
+            coreThreads.start(list, threads, 1, NULL);
+            foreach(cycle, CYCLES) {
+                ASSERT_FALSE(coreThreads.run_cycle());
+                sim_cycle++;
+            }
+            coreThreads.stop();
+            sim_cycle = saved_cycle;
+
+            foreach(i, TASKS + 1) {
+                ASSERT_EQ(legacyMemory[i], memory[i]);
+            }
+            foreach(i, TASKS) {
+                ASSERT_EQ(legacyResult[i], legacySeen[i]);
+            }
+        }
+    }
+
+    TEST(CoreThreads, LoadSeesOwnStores)
+    {
+        Signal signal("load_task");
+        dynarray<Signal*> list;
+
+        if(NUM_SIM_CORES < 2)
+            return;
+
+        memory[0] = 0x1122334455667788ULL;
+
+        struct Task {
+            static bool run(void *arg) {
+                coreThreads.defer_store((Waddr)&memory[0] + 2, 0xaabb, 1);
+                coreThreads.defer_store((Waddr)&memory[0] + 7, 0xcc, 0);
+
+                EXPECT_EQ(0x1122334455667788ULL, memory[0]);
+                EXPECT_EQ(0xcc223344aabb7788ULL,
+                        coreThreads.load((Waddr)&memory[0], 3));
+                EXPECT_EQ(0xaabbU, coreThreads.load((Waddr)&memory[0] + 2, 1));
+                EXPECT_EQ(0xbb77U, coreThreads.load((Waddr)&memory[0] + 1, 1));
+                return false;
+            }
+        };
+
+        signal.connect(signal_fun_ptr(Task::run));
+        list.push(&signal);
+        list.push(&signal);
+
+        coreThreads.start(list, 1, 1, NULL);
+        ASSERT_FALSE(coreThreads.run_cycle());
+        coreThreads.stop();
+
+        ASSERT_EQ(0xcc223344aabb7788ULL, memory[0]);
+    }
+
+    const int QUANTUM = 8;
+    const W64 QUANTUM_START = 1000;
+
+    int quantumCycles[TASKS];
+
+    /* Tasks store the cycle they run in, task 1 stops after 5 cycles */
+    template<int ID>
+    bool quantum_task(void *arg)
+    {
+        quantumCycles[ID]++;
+        coreThreads.defer_store((Waddr)&memory[ID], sim_cycle, 3);
+        return ID == 1 && sim_cycle == QUANTUM_START + QUANTUM + 5;
+    }
+
+    void run_quantum_tasks(int threads)
+    {
+        Signal signals[TASKS];
+        dynarray<Signal*> list;
+
+        signals[0].connect(signal_fun_ptr(quantum_task<0>));
+        signals[1].connect(signal_fun_ptr(quantum_task<1>));
+        signals[2].connect(signal_fun_ptr(quantum_task<2>));
+        signals[3].connect(signal_fun_ptr(quantum_task<3>));
+
+        foreach(i, TASKS) {
+            signals[i].set_name("quantum_task");
+            list.push(&signals[i]);
+            quantumCycles[i] = 0;
+        }
+        memset(memory, 0, sizeof(memory));
+
+        W64 saved_cycle = sim_cycle;
+        sim_cycle = QUANTUM_START;
+        coreThreads.start(list, threads, QUANTUM, NULL);
+
+        bool exiting = false;
+        while(!exiting) {
+            exiting = coreThreads.run_cycle();
+
+            /* Stores are applied in the cycle they were done in */
+            foreach(i, TASKS) {
+                if(!exiting) {
+                    ASSERT_EQ(sim_cycle, memory[i]);
+                }
+            }
+
+            sim_cycle++;
+        }
+
+        /* Quantum ends with the cycle task 1 stopped in */
+        ASSERT_EQ(QUANTUM_START + QUANTUM + 6, sim_cycle);
+        ASSERT_EQ(QUANTUM + 6, quantumCycles[1]);
+
+        /* Other tasks completed the quantum and their stores are applied */
+        coreThreads.stop();
+        foreach(i, TASKS) {
+            if(i == 1)
+                continue;
+            ASSERT_EQ(2 * QUANTUM, quantumCycles[i]);
+            ASSERT_EQ(QUANTUM_START + 2 * QUANTUM - 1, memory[i]);
+        }
+
+        sim_cycle = saved_cycle;
+    }
+
+    TEST(CoreThreads, SyncQuantum)
+    {
+        if(NUM_SIM_CORES < TASKS)
+            return;
+
+        run_quantum_tasks(1);
+        run_quantum_tasks(TASKS);
+    }
+
+    MemoryHierarchy *eventMemory;
+    Signal *recordSignal;
+    int eventTask[TASKS];
+    W64 eventSeen[TASKS];
+    bool eventDone[TASKS];
+
+    bool record_event(void *arg)
+    {
+        int id = int((Waddr)arg);
+
+        eventTask[id] = core_task;
+        eventSeen[id] = task_load(&memory[id]);
+        eventDone[id] = true;
+        return true;
+    }
+
+    /* Tasks store to their slot, add a delay 0 event and check it ran */
+    template<int ID>
+    bool event_task(void *arg)
+    {
+        eventDone[ID] = false;
+        task_store(&memory[ID], ID + 1);
+        eventMemory->add_event(recordSignal, 0, (void*)(Waddr)ID);
+        EXPECT_TRUE(eventDone[ID]);
+        return false;
+    }
+
+    /*
+     * Delay 0 events of core tasks run right away in the task, as they do
+     * in the serial loop, and see the stores the core made before them.
+     */
+    TEST(CoreThreads, DelayZeroEventInTask)
+    {
+        Signal signals[TASKS];
+        Signal record("record_event");
+        dynarray<Signal*> list;
+
+        if(NUM_SIM_CORES < TASKS)
+            return;
+
+        BaseMachine* machine = (BaseMachine*)(
+                PTLsimMachine::getmachine("base"));
+        eventMemory = new MemoryHierarchy(*machine);
+        recordSignal = &record;
+        record.connect(signal_fun_ptr(record_event));
+
+        signals[0].connect(signal_fun_ptr(event_task<0>));
+        signals[1].connect(signal_fun_ptr(event_task<1>));
+        signals[2].connect(signal_fun_ptr(event_task<2>));
+        signals[3].connect(signal_fun_ptr(event_task<3>));
+
+        foreach(i, TASKS) {
+            signals[i].set_name("event_task");
+            list.push(&signals[i]);
+        }
+
+        for(int threads = 1; threads <= TASKS; threads *= 2) {
+            memset(memory, 0, sizeof(memory));
+
+            coreThreads.start(list, threads, 1, eventMemory);
+            ASSERT_FALSE(coreThreads.run_cycle());
+            coreThreads.stop();
+
+            foreach(i, TASKS) {
+                ASSERT_TRUE(eventDone[i]);
+                ASSERT_EQ(i, eventTask[i]);
+                ASSERT_EQ(W64(i + 1), eventSeen[i]);
+                ASSERT_EQ(W64(i + 1), memory[i]);
+            }
+        }
+
+        delete eventMemory;
+        eventMemory = NULL;
+    }
+};
@@ -0,0 +1,92 @@
+
+#include <gtest/gtest.h>
+
+// We disable Assert of Simulator
+#define DISABLE_ASSERT
+#include <globals.h>
+#include <superstl.h>
+#include <deltaCheckpoint.h>
+
+namespace {
+
+    static byte ram[16][512];
+
+    static const void* ram_page(W64 addr)
+    {
+        return ram[addr / 512];
+    }
+
+    /* Pages are written sorted and read back from the mapping */
+    TEST(DeltaCheckpoint, WriteRead)
+    {
+        char filename[] = "/tmp/delta-test-XXXXXX";
+        int fd = mkstemp(filename);
+        ASSERT_TRUE(fd >= 0);
+        close(fd);
+
+        foreach (i, 16) {
+            memset(ram[i], i + 1, 512);
+        }
+
+        dynarray<W64> pages;
+        pages.push(9 * 512);
+        pages.push(2 * 512);
+        pages.push(14 * 512);
+
+        ASSERT_TRUE(DeltaCheckpoint::write(filename, "simpoint_sp_0",
+                    sizeof(ram), 512, pages, ram_page));
+
+        DeltaCheckpoint delta;
+        ASSERT_TRUE(delta.open(filename));
+        ASSERT_STREQ("simpoint_sp_0", delta.parent());
+        ASSERT_EQ(sizeof(ram), delta.ram_size());
+        ASSERT_EQ(512U, delta.page_size());
+        ASSERT_EQ(W64(3), delta.page_count());
+
+        ASSERT_EQ(W64(2 * 512), delta.page_addr(0));
+        ASSERT_EQ(W64(9 * 512), delta.page_addr(1));
+        ASSERT_EQ(W64(14 * 512), delta.page_addr(2));
+
+        /* Page data is aligned in the file */
+        ASSERT_EQ(0U, ((Waddr)delta.page(0)) % 512);
+        ASSERT_EQ(0, memcmp(ram[9], delta.page(1), 512));
+
+        ASSERT_TRUE(delta.find(14 * 512) != NULL);
+        ASSERT_EQ(0, memcmp(ram[14], delta.find(14 * 512), 512));
+        ASSERT_TRUE(delta.find(0) == NULL);
+        ASSERT_TRUE(delta.find(3 * 512) == NULL);
+        ASSERT_TRUE(delta.find(15 * 512) == NULL);
+
+        delta.close();
+        unlink(filename);
+    }
+
+    /* Truncated or foreign files are not opened */
+    TEST(DeltaCheckpoint, Invalid)
+    {
+        char filename[] = "/tmp/delta-test-XXXXXX";
+        int fd = mkstemp(filename);
+        ASSERT_TRUE(fd >= 0);
+        ASSERT_EQ(8, write(fd, "QEVM\0\0\0\3", 8));
+        close(fd);
+
+        DeltaCheckpoint delta;
+        ASSERT_FALSE(delta.open(filename));
+
+        dynarray<W64> pages;
+        pages.push(0);
+        pages.push(512);
+        ASSERT_TRUE(DeltaCheckpoint::write(filename, "base", sizeof(ram),
+                    512, pages, ram_page));
+        ASSERT_TRUE(truncate(filename, 1024) == 0);
+        ASSERT_FALSE(delta.open(filename));
+
+        ASSERT_FALSE(delta.open("/nonexistent/file.delta"));
+
+        unlink(filename);
+
+        stringbuf name;
+        delta_checkpoint_filename(name, "/ckpt", "simpoint_sp_3");
+        ASSERT_STREQ("/ckpt/simpoint_sp_3.delta", name.buf);
+    }
+};
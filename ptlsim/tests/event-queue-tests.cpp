@@ -0,0 +1,238 @@
+
+#include <gtest/gtest.h>
+
+// We disable Assert of Simulator
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <machine.h>
+#include <memoryHierarchy.h>
+#include <statelist.h>
+
+using namespace Memory;
+
+namespace {
+
+    /* Records the order in which event arguments are executed */
+    dynarray<W64> fired;
+
+    bool record_cb(void *arg)
+    {
+        fired.push((W64)arg);
+        return true;
+    }
+
+    W64 executed;
+
+    bool count_cb(void *arg)
+    {
+        executed++;
+        return true;
+    }
+
+    void drain(EventQueue &queue, W64 cycle)
+    {
+        Event *event;
+        while((event = queue.pop(cycle))) {
+            event->execute();
+            queue.free(event);
+        }
+    }
+
+    void add(EventQueue &queue, Signal *signal, W64 clock, W64 arg)
+    {
+        Event *event = queue.alloc();
+        event->setup(signal, clock, (void*)arg);
+        queue.insert(event);
+    }
+
+    TEST(EventQueue, SameCycleOrder)
+    {
+        EventQueue queue;
+        Signal sig("record");
+        sig.connect(signal_fun_ptr(record_cb));
+        fired.clear();
+
+        add(queue, &sig, 5, 0);
+        add(queue, &sig, 3, 1);
+        add(queue, &sig, 5, 2);
+        add(queue, &sig, 3, 3);
+        add(queue, &sig, 4, 4);
+
+        ASSERT_EQ(3, queue.next_clock());
+
+        drain(queue, 2);
+        ASSERT_EQ(0, fired.count());
+
+        drain(queue, 5);
+        ASSERT_EQ(5, fired.count());
+        ASSERT_EQ(1, fired[0]);
+        ASSERT_EQ(3, fired[1]);
+        ASSERT_EQ(4, fired[2]);
+        ASSERT_EQ(0, fired[3]);
+        ASSERT_EQ(2, fired[4]);
+        ASSERT_TRUE(queue.empty());
+    }
+
+    TEST(EventQueue, OverflowEvents)
+    {
+        EventQueue queue;
+        Signal sig("record");
+        sig.connect(signal_fun_ptr(record_cb));
+        fired.clear();
+
+        W64 far = EVENT_WHEEL_SIZE * 3 + 7;
+
+        /* Events beyond the wheel must still run in insertion order with
+         * events added later for the same cycle */
+        add(queue, &sig, far, 0);
+        add(queue, &sig, far, 1);
+        add(queue, &sig, far - 1, 2);
+
+        ASSERT_EQ(far - 1, queue.next_clock());
+
+        for(W64 cycle = 0; cycle < far - 10; cycle++)
+            drain(queue, cycle);
+
+        add(queue, &sig, far, 3);
+        ASSERT_EQ(0, fired.count());
+
+        drain(queue, far);
+        ASSERT_EQ(4, fired.count());
+        ASSERT_EQ(2, fired[0]);
+        ASSERT_EQ(0, fired[1]);
+        ASSERT_EQ(1, fired[2]);
+        ASSERT_EQ(3, fired[3]);
+        ASSERT_EQ(W64(-1), queue.next_clock());
+    }
+
+    TEST(EventQueue, GrowsBeyondPool)
+    {
+        EventQueue queue;
+        Signal sig("count");
+        sig.connect(signal_fun_ptr(count_cb));
+        executed = 0;
+
+        foreach(i, 3 * EVENT_POOL_CHUNK)
+            add(queue, &sig, 1 + (i % 50), i);
+
+        ASSERT_EQ(3 * EVENT_POOL_CHUNK, queue.count());
+
+        drain(queue, 100);
+        ASSERT_EQ(3 * EVENT_POOL_CHUNK, executed);
+        ASSERT_TRUE(queue.empty());
+    }
+
+    /*
+     * Event queue as it was before EventQueue: sorted linked list where each
+     * new event walks the list from head to find its place.
+     */
+    struct SortedEvent : public FixStateListObject
+    {
+        Signal *signal;
+        W64 clock;
+        void *arg;
+
+        void init() { signal = NULL; clock = -1; arg = NULL; }
+    };
+
+    struct SortedEventQueue
+    {
+        FixStateList<SortedEvent, 2048> queue;
+
+        void add_event(Signal *signal, int delay, void *arg)
+        {
+            SortedEvent *event = queue.alloc();
+            event->signal = signal;
+            event->clock = sim_cycle + delay;
+            event->arg = arg;
+
+            SortedEvent *entry;
+            foreach_list_mutable(queue.list(), entry, e, preve) {
+                if(event->clock < entry->clock) {
+                    queue.unlink(event);
+                    queue.insert_after(event, (SortedEvent*)(entry->prev));
+                    return;
+                }
+            }
+        }
+
+        void clock()
+        {
+            while(!queue.empty()) {
+                SortedEvent *event = queue.head();
+                if(event->clock > sim_cycle)
+                    break;
+                queue.free(event);
+                event->signal->emit(event->arg);
+            }
+        }
+    };
+
+    /*
+     * Delay mix seen by memory events: mostly single cycle pipeline and
+     * queue hops, some cache and directory latencies, a few DRAM accesses.
+     */
+    int get_delay(RandomNumberGenerator &rand)
+    {
+        int r = rand.random32() % 100;
+        if(r < 55) return 1;
+        if(r < 75) return 2 + rand.random32() % 4;
+        if(r < 92) return 10 + rand.random32() % 20;
+        return 100 + rand.random32() % 300;
+    }
+
+    /* Events added to the queue in each simulated cycle */
+    const int EVENTS_PER_CYCLE = 8;
+    const int BENCH_CYCLES = 200000;
+
+    TEST(EventQueue, Throughput)
+    {
+        BaseMachine* machine = (BaseMachine*)(PTLsimMachine::getmachine("base"));
+        MemoryHierarchy* saved = machine->memoryHierarchyPtr;
+        W64 saved_cycle = sim_cycle;
+
+        Signal sig("count");
+        sig.connect(signal_fun_ptr(count_cb));
+
+        RandomNumberGenerator rand;
+        W64 start;
+        double sorted_secs, wheel_secs;
+
+        /* Old sorted list */
+        SortedEventQueue *sorted = new SortedEventQueue();
+        rand.reseed(1);
+        executed = 0;
+        start = rdtsc();
+        for(sim_cycle = 0; sim_cycle < BENCH_CYCLES; sim_cycle++) {
+            sorted->clock();
+            foreach(i, EVENTS_PER_CYCLE)
+                sorted->add_event(&sig, get_delay(rand), NULL);
+        }
+        sorted_secs = ticks_to_native_seconds(rdtsc() - start);
+        W64 sorted_executed = executed;
+        delete sorted;
+
+        /* Timing wheel through marss_add_event */
+        machine->memoryHierarchyPtr = new MemoryHierarchy(*machine);
+        rand.reseed(1);
+        executed = 0;
+        start = rdtsc();
+        for(sim_cycle = 0; sim_cycle < BENCH_CYCLES; sim_cycle++) {
+            machine->memoryHierarchyPtr->clock();
+            foreach(i, EVENTS_PER_CYCLE)
+                marss_add_event(&sig, get_delay(rand), NULL);
+        }
+        wheel_secs = ticks_to_native_seconds(rdtsc() - start);
+
+        ASSERT_EQ(sorted_executed, executed);
+
+        W64 total = BENCH_CYCLES * EVENTS_PER_CYCLE;
+        cout << "EventQueue throughput: sorted list ",
+             W64(total / sorted_secs), " events/sec, timing wheel ",
+             W64(total / wheel_secs), " events/sec", endl;
+
+        delete machine->memoryHierarchyPtr;
+        machine->memoryHierarchyPtr = saved;
+        sim_cycle = saved_cycle;
+    }
+};
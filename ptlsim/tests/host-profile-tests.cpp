@@ -0,0 +1,95 @@
+
+#include <gtest/gtest.h>
+
+// We disable Assert of Simulator
+#define DISABLE_ASSERT
+#include <globals.h>
+#include <superstl.h>
+#include <hostProfile.h>
+
+namespace {
+
+    static W64 spin(int n)
+    {
+        W64 x = 0;
+        foreach (i, n) {
+            x += rdtsc();
+            barrier();
+        }
+        return x;
+    }
+
+    static HostProfileSite* emit_site;
+
+    static bool emit_cb(void *arg)
+    {
+        HostProfileScope scope(*emit_site);
+        spin(100);
+        return arg != NULL;
+    }
+
+    /* Nested scopes only charge their self time to a site */
+    TEST(HostProfile, SelfTime)
+    {
+        static HostProfileSite outer("test", "outer");
+        static HostProfileSite inner("test", "inner");
+
+        host_profile_active = true;
+        W64 start = rdtsc();
+        {
+            HostProfileScope outer_scope(outer);
+            spin(1000);
+            {
+                HostProfileScope inner_scope(inner);
+                spin(1000);
+            }
+            {
+                HostProfileScope inner_scope(inner);
+                spin(1000);
+            }
+        }
+        W64 total = rdtsc() - start;
+        host_profile_active = false;
+
+        ASSERT_EQ(W64(1), outer.total_calls());
+        ASSERT_EQ(W64(2), inner.total_calls());
+        ASSERT_TRUE(outer.total_ticks() > 0);
+        ASSERT_TRUE(inner.total_ticks() > 0);
+        ASSERT_LE(outer.total_ticks() + inner.total_ticks(), total);
+        ASSERT_TRUE(host_profile_scope == NULL);
+
+        /* Nothing is timed in cycles that are not sampled */
+        {
+            HostProfileScope outer_scope(outer);
+            spin(1000);
+        }
+        ASSERT_EQ(W64(1), outer.total_calls());
+    }
+
+    /* Every emit of a signal is charged to a site of its name */
+    TEST(HostProfile, SignalEmit)
+    {
+        static HostProfileSite callback("test", "callback");
+        emit_site = &callback;
+
+        Signal signal("test-signal");
+        signal.connect(signal_fun_ptr(emit_cb));
+
+        host_profile_setup(1);
+        host_profile_machine_cycle();
+        ASSERT_TRUE(host_profile_active);
+
+        ASSERT_TRUE(signal.emit((void*)1));
+        ASSERT_FALSE(signal.emit(NULL));
+
+        HostProfileSite *site = (HostProfileSite*)signal.hook_data;
+        ASSERT_TRUE(site != NULL);
+        ASSERT_STREQ("test-signal", site->name.buf);
+        ASSERT_EQ(W64(2), site->total_calls());
+        ASSERT_EQ(W64(2), callback.total_calls());
+
+        host_profile_setup(0);
+        ASSERT_TRUE(signal.emit((void*)1));
+        ASSERT_EQ(W64(2), site->total_calls());
+    }
+};
@@ -42,6 +42,28 @@ namespace {
         }
     }
 
+    /* Removing bits from a multi word bitvec, also at word boundaries */
+    TEST(Logic, BitvecRemove)
+    {
+        foreach (index, 256) {
+            bitvec<256> vec;
+            vec.setall();
+
+            bitvec<256> removed = vec.remove(index, 1);
+            ASSERT_EQ(255, removed.popcount()) << "index " << index;
+            ASSERT_FALSE(removed[255]);
+        }
+
+        bitvec<256> vec = 0;
+        vec[63] = 1;
+        vec[64] = 1;
+        vec[130] = 1;
+        vec = vec.remove(64, 1);
+        ASSERT_TRUE(vec[63]);
+        ASSERT_TRUE(vec[129]);
+        ASSERT_EQ(2, vec.popcount());
+    }
+
     /* Test simulation freq related functions */
     TEST(Sim, SimFreq)
     {
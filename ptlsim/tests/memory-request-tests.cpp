@@ -0,0 +1,74 @@
+
+#include <gtest/gtest.h>
+
+// We disable Assert of Simulator
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <memoryHierarchy.h>
+
+#include <sstream>
+
+using namespace Memory;
+
+namespace {
+
+    TEST(RequestPool, ReleaseOnLastReference)
+    {
+        RequestPool *pool = new RequestPool();
+
+        MemoryRequest *request = pool->get_free_request();
+        request->incRefCounter();
+        request->incRefCounter();
+        ASSERT_EQ(1, pool->used_list().count);
+
+        request->decRefCounter();
+        ASSERT_EQ(1, pool->used_list().count);
+
+        request->decRefCounter();
+        ASSERT_EQ(0, pool->used_list().count);
+
+        /* Released request is reused only after all other free requests */
+        MemoryRequest *next = pool->get_free_request();
+        ASSERT_NE(request, next);
+
+        delete pool;
+    }
+
+    TEST(RequestPool, NeverRunsOut)
+    {
+        RequestPool *pool = new RequestPool();
+
+        foreach(i, 10 * REQUEST_POOL_SIZE) {
+            MemoryRequest *request = pool->get_free_request();
+            request->incRefCounter();
+            request->decRefCounter();
+        }
+
+        ASSERT_EQ(0, pool->used_list().count);
+
+        delete pool;
+    }
+
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+    TEST(RequestHistory, KeepsNewestHistory)
+    {
+        using std::ostringstream;
+        RequestHistory history;
+
+        history << "{+L1} ", "{-L1} ";
+        ostringstream os;
+        os << history;
+        ASSERT_EQ("{+L1} {-L1} ", os.str());
+
+        foreach(i, MEM_REQUEST_HISTORY_SIZE) {
+            history << "x";
+        }
+        history << "{+L2} ";
+
+        ostringstream os2;
+        os2 << history;
+        ASSERT_EQ(3 + MEM_REQUEST_HISTORY_SIZE, os2.str().size());
+        ASSERT_EQ("{+L2} ", os2.str().substr(os2.str().size() - 6));
+    }
+#endif
+};
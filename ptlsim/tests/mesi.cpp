@@ -8,6 +8,7 @@
 #include <memoryHierarchy.h>
 #include <coherentCache.h>
 #include <mesiLogic.h>
+#include <globalDirectory.h>
 #include <machine.h>
 
 using namespace Memory;
@@ -405,4 +406,63 @@ namespace {
         ASSERT_EQ(st, exc);
         r();
     }
+
+#if NUM_SIM_CORES > 1
+
+    W8 warm_state(CacheController *cont, W64 addr)
+    {
+        CacheLine *line = cont->probe_line(addr);
+        return (line) ? line->state : MESI_INVALID;
+    }
+
+    TEST(MesiWarm, TwoCores)
+    {
+        BaseMachine* machine = (BaseMachine*)(PTLsimMachine::getmachine("base"));
+        MemoryHierarchy* mem = new MemoryHierarchy(*machine);
+        DirectoryController *dir = new DirectoryController(0, "warm_dir", mem);
+        const char *names[2] = {"warm_l2_0", "warm_l2_1"};
+        CacheController *c[2];
+
+        foreach (i, 2) {
+            c[i] = new CacheController(i, names[i], mem, CacheType(0));
+            c[i]->set_lowest_private(true);
+            c[i]->set_coherence_logic(new MESILogic(c[i], c[i]->get_stats(),
+                        mem));
+            c[i]->set_directory(dir);
+            dir->add_cache_controller(c[i]);
+        }
+
+        W64 addr = 0x7654340;
+
+        c[0]->warm(0, addr, mread, false);
+        ASSERT_EQ(warm_state(c[0], addr), exc);
+
+        c[1]->warm(1, addr, mread, false);
+        ASSERT_EQ(warm_state(c[0], addr), sh);
+        ASSERT_EQ(warm_state(c[1], addr), sh);
+
+        c[1]->warm(1, addr, mwrite, false);
+        ASSERT_EQ(warm_state(c[0], addr), in);
+        ASSERT_EQ(warm_state(c[1], addr), mod);
+
+        c[0]->warm(0, addr, mread, false);
+        ASSERT_EQ(warm_state(c[0], addr), sh);
+        ASSERT_EQ(warm_state(c[1], addr), sh);
+
+        c[0]->warm(0, addr, mwrite, false);
+        ASSERT_EQ(warm_state(c[0], addr), mod);
+        ASSERT_EQ(warm_state(c[1], addr), in);
+
+        /* Fill the directory set of the line from core 1, replacing its
+         * entry must evict the line from core 0 */
+        W64 set_stride = DIR_SET * DIR_LINE_SIZE;
+
+        for (int i = 1; i <= DIR_WAY; i++)
+            c[1]->warm(1, addr + (i * set_stride), mread, false);
+
+        ASSERT_TRUE(Directory::get_directory().probe(addr) == NULL);
+        ASSERT_EQ(warm_state(c[0], addr), in);
+    }
+
+#endif
 };
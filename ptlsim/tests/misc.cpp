@@ -5,6 +5,7 @@
 #include <ptlsim.h>
 #include <ptl-qemu.h>
 #include <superstl.h>
+#include <decode.h>
 
 void read_simpoint_file();
 int get_simpoint(int id);
@@ -111,4 +112,307 @@ namespace {
         EXPECT_STREQ("test_sp_0", name->buf);
         delete name;
     }
+
+    TEST(HostPhysMap, Lookup)
+    {
+        HostPhysMap *map = new HostPhysMap();
+        Waddr paddr;
+
+        ASSERT_FALSE(map->lookup(0x7f0012345678ULL, paddr));
+
+        map->add(0x7f0012345000ULL, 0x1234000);
+        map->add(0x7f0012346000ULL, 0x200000000ULL);
+        map->add(0x1000, 0);
+
+        ASSERT_TRUE(map->lookup(0x7f0012345678ULL, paddr));
+        ASSERT_EQ(0x1234678U, paddr);
+        ASSERT_TRUE(map->lookup(0x7f0012346fffULL, paddr));
+        ASSERT_EQ(0x200000fffULL, paddr);
+
+        /* Guest page zero is a valid mapping */
+        ASSERT_TRUE(map->lookup(0x1010, paddr));
+        ASSERT_EQ(0x10U, paddr);
+
+        ASSERT_FALSE(map->lookup(0x7f0012347000ULL, paddr));
+        ASSERT_FALSE(map->lookup(0x7fffffffffffULL, paddr));
+        ASSERT_FALSE(map->lookup(0xffff800000000000ULL, paddr));
+
+        /* Remapping a host page replaces its guest page */
+        map->add(0x7f0012345000ULL, 0x5000);
+        ASSERT_TRUE(map->lookup(0x7f0012345008ULL, paddr));
+        ASSERT_EQ(0x5008U, paddr);
+
+        delete map;
+    }
+
+    TEST(SharedBBCache, FindByAddressSpace)
+    {
+        BasicBlockCache *cache = new BasicBlockCache();
+        BasicBlock *bb = new BasicBlock();
+        BasicBlock *bbs[3];
+        RIPVirtPhys rvp;
+
+        setzero(rvp);
+        rvp.rip = 0x400000;
+        bb->reset(rvp);
+
+        foreach(i, 3) {
+            bbs[i] = bb->clone();
+        }
+        delete bb;
+
+        /* Same rip in two user address spaces and in kernel */
+        bbs[0]->asid = 0x1000;
+        bbs[1]->asid = 0x2000;
+        bbs[2]->asid = 0;
+        bbs[2]->rip.kernel = 1;
+
+        foreach(i, 3) {
+            cache->add_shared(bbs[i]);
+        }
+        ASSERT_EQ(3, cache->count);
+
+        ASSERT_EQ(bbs[0], cache->find(rvp, 0x1000));
+        ASSERT_EQ(bbs[1], cache->find(rvp, 0x2000));
+        ASSERT_TRUE(cache->find(rvp, 0x3000) == NULL);
+
+        rvp.kernel = 1;
+        ASSERT_EQ(bbs[2], cache->find(rvp, 0));
+
+        /* Mode bits are part of the key */
+        rvp.use64 = 1;
+        ASSERT_TRUE(cache->find(rvp, 0) == NULL);
+
+        /* Adding a block twice does not link it twice */
+        cache->add_shared(bbs[0]);
+        ASSERT_EQ(3, cache->count);
+
+        foreach(i, 3) {
+            cache->remove(bbs[i]);
+            bbs[i]->free();
+        }
+        ASSERT_EQ(0, cache->count);
+
+        delete cache;
+    }
+
+    TEST(SharedBBCache, UsageStamps)
+    {
+        BasicBlock *tmpl = new BasicBlock();
+        tmpl->reset();
+        BasicBlock *bb = tmpl->clone();
+        delete tmpl;
+
+        ASSERT_EQ(0U, bb->last_use());
+
+        bb->use(100, 0);
+        bb->use(50, NUM_SIM_CORES - 1);
+        ASSERT_EQ(100U, bb->last_use());
+
+        bb->acquire();
+        bb->acquire();
+        ASSERT_FALSE(bb->release());
+        ASSERT_TRUE(bb->release());
+
+        bb->free();
+    }
+
+    TEST(BasicBlockArena, Generations)
+    {
+        BasicBlock *tmpl = new BasicBlock();
+        dynarray<BasicBlock*> bbs;
+
+        tmpl->reset();
+        tmpl->count = MAX_BB_UOPS;
+
+        /* Blocks are carved out of the newest chunk in order */
+        size_t bytes = (sizeof(BasicBlockBase) +
+                MAX_BB_UOPS * (sizeof(TransOp) + sizeof(UopExec)) + 15) & ~15;
+        BasicBlock *last = tmpl->clone();
+        W64 first = BasicBlockArena::generation_of(last);
+        bbs.push(last);
+
+        while (BasicBlockArena::generation_of(last) == first) {
+            BasicBlock *prev = last;
+            last = tmpl->clone();
+            bbs.push(last);
+            if (BasicBlockArena::generation_of(last) == first) {
+                ASSERT_EQ((byte*)prev + bytes, (byte*)last);
+            }
+        }
+        delete tmpl;
+
+        ASSERT_EQ(first + 1, BasicBlockArena::generation_of(last));
+        ASSERT_EQ(first + 1, bbarena.reclaim_generation(0));
+
+        /* Freeing all blocks of a full generation recycles its chunk */
+        int chunks = bbarena.chunks;
+        foreach(i, bbs.length - 1) {
+            bbs[i]->free();
+        }
+        ASSERT_EQ(chunks - 1, bbarena.chunks);
+
+        last->free();
+    }
+
+    TEST(BasicBlockFile, SaveAndReload)
+    {
+        char path[] = "/tmp/bbfile-test-XXXXXX";
+        int fd = mkstemp(path);
+        ASSERT_GE(fd, 0);
+        close(fd);
+        unlink(path);
+
+        RIPVirtPhys rvp;
+        setzero(rvp);
+        rvp.rip = 0x401000;
+        rvp.use64 = 1;
+
+        byte code[16] = { 0x48, 0x01, 0xd8, 0xc3 };
+
+        BasicBlockFile *file = new BasicBlockFile();
+        TraceDecoder *trans = new TraceDecoder(rvp);
+        trans->valid_byte_count = sizeof(code);
+        trans->bb.count = 3;
+        trans->bb.bytes = 4;
+        trans->bb.transops[0].init(OP_add, REG_rax, REG_rax, REG_rbx, REG_zero, 3);
+        /* Internal load from a host table at an immediate address */
+        trans->bb.transops[1].init(OP_ld, REG_temp0, REG_temp0, REG_imm, REG_zero, 0, (Waddr)code);
+        trans->bb.transops[1].internal = 1;
+        trans->bb.transops[2].init(OP_jmp, REG_rip, REG_temp0, REG_zero, REG_zero, 3);
+
+        bool stale;
+        file->open(path);
+        ASSERT_TRUE(file->find(*trans, code, stale) == NULL);
+        file->add(*trans, code);
+        file->close();
+        ASSERT_FALSE(file->is_open());
+
+        /* A fresh decoder state finds it again in the mapped file */
+        TraceDecoder *fresh = new TraceDecoder(rvp);
+        fresh->valid_byte_count = sizeof(code);
+        file->open(path);
+        ASSERT_EQ(1, file->records.length);
+
+        const BasicBlockFileRecord *record = file->find(*fresh, code, stale);
+        ASSERT_TRUE(record != NULL);
+        ASSERT_FALSE(stale);
+
+        /* The file keeps the table address relative to bbfile */
+        ASSERT_EQ((W64s)((Waddr)code - (Waddr)&bbfile), record->transops()[1].rbimm);
+
+        file->restore(*record, fresh->bb);
+        ASSERT_EQ(0x401000U, (W64)fresh->bb.rip);
+        ASSERT_EQ(3, fresh->bb.count);
+        ASSERT_EQ(OP_add, fresh->bb.transops[0].opcode);
+        ASSERT_EQ(REG_rbx, fresh->bb.transops[0].rb);
+        ASSERT_EQ((W64s)(Waddr)code, fresh->bb.transops[1].rbimm);
+
+        /* Changed code bytes or another mode do not match */
+        code[1] = 0x29;
+        ASSERT_TRUE(file->find(*fresh, code, stale) == NULL);
+        ASSERT_TRUE(stale);
+        code[1] = 0x01;
+
+        fresh->use64 = 0;
+        ASSERT_TRUE(file->find(*fresh, code, stale) == NULL);
+        ASSERT_FALSE(stale);
+
+        /* Too few valid bytes to check the code */
+        fresh->use64 = 1;
+        fresh->valid_byte_count = 3;
+        ASSERT_TRUE(file->find(*fresh, code, stale) == NULL);
+
+        file->close();
+        unlink(path);
+
+        delete trans;
+        delete fresh;
+        delete file;
+    }
+
+    TEST(UopExec, SameAsLookup)
+    {
+        BasicBlock *tmpl = new BasicBlock();
+        RIPVirtPhys rvp;
+
+        setzero(rvp);
+        rvp.rip = 0x400000;
+        tmpl->reset(rvp);
+
+        /* ALU mix of a typical integer loop body ending in a branch */
+        static const int ops[] = {OP_add, OP_sub, OP_and, OP_xor, OP_or,
+            OP_mov, OP_sel, OP_add, OP_sub, OP_br};
+        int nops = lengthof(ops);
+
+        foreach(i, nops) {
+            TransOp& op = tmpl->transops[i];
+            op.init(ops[i], REG_temp0, REG_rax, REG_rbx, REG_zero, 3, 0, 0,
+                    (ops[i] == OP_mov) ? 0 : SETFLAG_ZF|SETFLAG_CF|SETFLAG_OF);
+            op.cond = (ops[i] == OP_sel || ops[i] == OP_br) ? COND_ne : 0;
+            op.bbindex = i;
+        }
+        tmpl->count = nops;
+
+        BasicBlock *bb = tmpl->clone();
+        delete tmpl;
+
+        synth_uops_for_bb(*bb);
+        ASSERT_TRUE(bb->execs == bb->execs_space());
+
+        /* Copies of the block keep their records */
+        BasicBlock *copy = bb->clone();
+        ASSERT_TRUE(copy->execs == copy->execs_space());
+        ASSERT_EQ(0, memcmp(bb->execs, copy->execs, nops * sizeof(UopExec)));
+        copy->free();
+
+        foreach(i, nops) {
+            const TransOp& op = bb->transops[i];
+            const UopExec& exec = bb->execs[i];
+            ASSERT_TRUE(exec.synthop);
+
+            if(isclass(op.opcode, OPCLASS_COND_BRANCH)) {
+                ASSERT_TRUE(exec.invsynthop ==
+                        get_synthcode_for_cond_branch(op.opcode,
+                            invert_cond(op.cond), op.size, 0));
+            } else {
+                ASSERT_TRUE(exec.invsynthop == NULL);
+            }
+        }
+
+        /* Operands that set and clear each of the flags */
+        static const W64 values[] = {0, 1, 0x7fffffffffffffffULL,
+            0x8000000000000000ULL, 0xffffffffffffffffULL};
+
+        foreach(i, nops) {
+            const TransOp& op = bb->transops[i];
+            uopimpl_func_t func = get_synthcode_for_uop(op.opcode,
+                    op.size, op.setflags, op.cond, op.extshift, 0,
+                    op.internal);
+
+            foreach(a, lengthof(values)) {
+                foreach(b, lengthof(values)) {
+                    foreach(flags, 2) {
+                        IssueState expected, state;
+                        W16 raflags = (flags) ? FLAG_ZF|FLAG_CF : 0;
+
+                        setzero(expected);
+                        setzero(state);
+                        expected.brreg.riptaken = state.brreg.riptaken = 0x400100;
+                        expected.brreg.ripseq = state.brreg.ripseq = 0x400010;
+
+                        func(expected, values[a], values[b], 0, raflags,
+                                raflags, 0);
+                        bb->execs[i].synthop(state, values[a], values[b], 0,
+                                raflags, raflags, 0);
+
+                        ASSERT_EQ(expected.reg.rddata, state.reg.rddata);
+                        ASSERT_EQ(W64(expected.reg.rdflags), W64(state.reg.rdflags));
+                    }
+                }
+            }
+        }
+
+        bb->free();
+    }
 };
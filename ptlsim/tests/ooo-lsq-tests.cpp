@@ -0,0 +1,103 @@
+
+#include <gtest/gtest.h>
+
+// We disable Assert of Simulator
+#define DISABLE_ASSERT
+#include <globals.h>
+#include <superstl.h>
+#include <logic.h>
+#include <ooo-lsq.h>
+
+namespace {
+
+    /* Queue positions as used by the foreach_* queue macros */
+    template <int SIZE>
+    struct TestQueue {
+        static const int size = SIZE;
+        int head;
+        int tail;
+    };
+
+    struct TestEntry {
+        int idx;
+        int index() const { return idx; }
+    };
+
+    /* Searches with the shadow must visit LSQ slots in the same order as the walks */
+    template <int SIZE>
+    void check_searches(RandomNumberGenerator& rand)
+    {
+        typedef LoadStoreQueueShadow<SIZE> shadow_t;
+        typedef typename shadow_t::mask_t mask_t;
+
+        shadow_t* shadow = new shadow_t();
+        W64 physaddr[SIZE];
+        TestQueue<SIZE> Q;
+
+        foreach (iter, 200) {
+            int count = 1 + rand.random32() % (SIZE - 1);
+            Q.head = rand.random32() % SIZE;
+            Q.tail = add_index_modulo(Q.head, count, SIZE);
+
+            /* Addresses of a few neighbouring words, some differing only in high bits */
+            W64 base = (rand.random32() | (W64(rand.random32() & 0x1fff) << 32));
+            foreach (i, SIZE) {
+                physaddr[i] = base + (rand.random32() % 6);
+                if (rand.random32() % 8 == 0)
+                    physaddr[i] += W64(1 + rand.random32() % 3) << 32;
+                physaddr[i] &= bitmask(45);
+                shadow->update(i, physaddr[i], rand.random32() & 1,
+                        rand.random32() % 4 == 0, rand.random32() % 4 == 0,
+                        rand.random32() & 1);
+            }
+
+            TestEntry entry;
+            entry.idx = add_index_modulo(Q.head, rand.random32() % count, SIZE);
+            TestEntry* E = &entry;
+
+            W64 key = base + (rand.random32() % 6);
+            mask_t near = shadow->near(key);
+            mask_t same = shadow->same(key);
+            mask_t subset = near & shadow->store;
+
+            mask_t older = shadow_t::older(Q.head, entry.idx);
+            int expected = -1;
+            int n = 0;
+            foreach_backward_before(Q, E, i) {
+                ASSERT_TRUE(older.test(i));
+                n++;
+
+                int x = (physaddr[i] - key);
+                ASSERT_EQ((-1 <= x && x <= 1), near.test(i));
+                ASSERT_EQ((W32)physaddr[i] == (W32)key, same.test(i));
+
+                if (expected < 0 && subset.test(i)) expected = i;
+            }
+            ASSERT_EQ(n, older.popcount());
+            ASSERT_EQ(expected, (subset & older).youngest_before(entry.idx));
+
+            mask_t younger = shadow_t::younger(entry.idx, Q.tail);
+            expected = -1;
+            n = 0;
+            foreach_forward_after(Q, E, i) {
+                ASSERT_TRUE(younger.test(i));
+                n++;
+                if (expected < 0 && subset.test(i)) expected = i;
+            }
+            ASSERT_EQ(n, younger.popcount());
+            ASSERT_EQ(expected, (subset & younger).oldest_after(entry.idx));
+        }
+
+        delete shadow;
+    }
+
+    TEST(LoadStoreQueueShadow, SameAsQueueWalk)
+    {
+        RandomNumberGenerator rand;
+        rand.reseed(17);
+
+        check_searches<60>(rand);
+        check_searches<114>(rand);
+        check_searches<256>(rand);
+    }
+};
@@ -0,0 +1,140 @@
+
+#include <gtest/gtest.h>
+
+// We disable Assert of Simulator
+#define DISABLE_ASSERT
+#include <globals.h>
+#include <superstl.h>
+#include <logic.h>
+#include <ooo-wakeup.h>
+
+namespace {
+
+    const int OPERANDS = 4;
+
+    /*
+     * Issue queue slots tracked both with one associative tag array per
+     * operand, collapsed on every removal, and with the wakeup matrix
+     * columns. Both must agree on which slots still wait for operands.
+     */
+    template <int SIZE, int ROWS>
+    struct TestQueue {
+        FullyAssociativeTags16bit<SIZE, SIZE> tags[OPERANDS];
+        WakeupMatrix<SIZE, ROWS, OPERANDS, W16> matrix;
+        W16 columns[SIZE];
+        W16 slots[SIZE];
+        bitvec<SIZE> columns_used;
+        bitvec<SIZE> waiting;
+        int count;
+
+        TestQueue() {
+            foreach (i, OPERANDS) tags[i].reset();
+            matrix.reset();
+            columns_used = 0;
+            waiting = 0;
+            count = 0;
+        }
+
+        void set(int slot, const W16* operands, const W16* preready) {
+            foreach (i, OPERANDS) {
+                if (preready[i])
+                    tags[i].invalidateslot(slot);
+                else tags[i].insertslot(slot, operands[i]);
+            }
+            waiting[slot] = matrix.insert(columns[slot], operands, preready);
+        }
+
+        void insert(const W16* operands, const W16* preready) {
+            int slot = count++;
+            int col = (~columns_used).lsb();
+            columns_used[col] = 1;
+            columns[slot] = col;
+            slots[col] = slot;
+            set(slot, operands, preready);
+        }
+
+        void remove(int slot) {
+            foreach (i, OPERANDS) tags[i].collapse(slot);
+
+            int col = columns[slot];
+            matrix.clear(col);
+            columns_used[col] = 0;
+            for (int i = slot; i < count - 1; i++) {
+                columns[i] = columns[i + 1];
+                slots[columns[i]] = i;
+            }
+            waiting = waiting.remove(slot, 1);
+            count--;
+        }
+
+        void broadcast(W16 tag) {
+            foreach (i, OPERANDS) tags[i].invalidate(tag);
+
+            bitvec<SIZE> woken = matrix.wakeup(tag);
+            for (int col = woken.lsb(-1); col >= 0; col = woken.nextlsb(col)) {
+                int slot = slots[col];
+                ASSERT_LT(slot, count);
+                ASSERT_EQ(col, columns[slot]);
+                waiting[slot] = 0;
+            }
+        }
+
+        void check() {
+            bitvec<SIZE> expected = 0;
+            foreach (i, OPERANDS) expected |= tags[i].valid;
+            ASSERT_TRUE(expected == waiting);
+
+            foreach (slot, count) {
+                ASSERT_EQ(expected[slot], matrix.pending(columns[slot]));
+                ASSERT_EQ(slot, slots[columns[slot]]);
+            }
+        }
+    };
+
+    template <int SIZE, int ROWS>
+    void check_wakeup(RandomNumberGenerator& rand)
+    {
+        TestQueue<SIZE, ROWS>* q = new TestQueue<SIZE, ROWS>();
+        W16 operands[OPERANDS];
+        W16 preready[OPERANDS];
+
+        foreach (iter, 20000) {
+            int action = rand.random32() % 8;
+
+            if (action < 3 && q->count < SIZE) {
+                /* Producers from two threads with the same ROB indices */
+                foreach (i, OPERANDS) {
+                    operands[i] = (rand.random32() % 48) |
+                        ((rand.random32() & 1) << 12);
+                    preready[i] = (rand.random32() % 3 == 0);
+                }
+                q->insert(operands, preready);
+            } else if (action < 5 && q->count) {
+                q->remove(rand.random32() % q->count);
+            } else if (action < 6 && q->count) {
+                foreach (i, OPERANDS) {
+                    operands[i] = (rand.random32() % 48);
+                    preready[i] = (rand.random32() % 2);
+                }
+                q->set(rand.random32() % q->count, operands, preready);
+            } else {
+                q->broadcast((rand.random32() % 48) |
+                        ((rand.random32() & 1) << 12));
+            }
+
+            q->check();
+        }
+
+        delete q;
+    }
+
+    TEST(WakeupMatrix, SameAsTagBroadcast)
+    {
+        RandomNumberGenerator rand;
+        rand.reseed(18);
+
+        check_wakeup<16, 128>(rand);
+        check_wakeup<60, 192>(rand);
+        check_wakeup<256, 40>(rand);
+    }
+};
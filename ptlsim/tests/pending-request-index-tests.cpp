@@ -0,0 +1,70 @@
+
+#include <gtest/gtest.h>
+
+// We disable Assert of Simulator
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <pendingRequestIndex.h>
+
+using namespace Memory;
+
+namespace {
+
+    TEST(PendingRequestIndex, KeepsAddOrder)
+    {
+        PendingRequestIndex<16> index;
+
+        ASSERT_EQ(-1, index.first(0x40));
+
+        index.add(5, 0x40);
+        index.add(2, 0x80);
+        index.add(9, 0x40);
+        index.add(1, 0x40);
+
+        ASSERT_EQ(5, index.first(0x40));
+        ASSERT_EQ(9, index.next(5));
+        ASSERT_EQ(1, index.next(9));
+        ASSERT_EQ(-1, index.next(1));
+
+        ASSERT_EQ(2, index.first(0x80));
+        ASSERT_EQ(-1, index.next(2));
+
+        index.remove(9);
+        ASSERT_EQ(1, index.next(5));
+
+        index.remove(5);
+        ASSERT_EQ(1, index.first(0x40));
+
+        /* Removing an entry that is not in index is a no-op */
+        index.remove(5);
+        ASSERT_EQ(1, index.first(0x40));
+    }
+
+    TEST(PendingRequestIndex, CollidingLines)
+    {
+        PendingRequestIndex<4> index;
+
+        /* All lines fall into the same bucket of an 8 bucket index */
+        index.add(0, 3);
+        index.add(1, 11);
+        index.add(2, 3);
+        index.add(3, 19);
+
+        ASSERT_EQ(0, index.first(3));
+        ASSERT_EQ(2, index.next(0));
+        ASSERT_EQ(-1, index.next(2));
+        ASSERT_EQ(1, index.first(11));
+        ASSERT_EQ(3, index.first(19));
+        ASSERT_EQ(-1, index.first(27));
+
+        /* Re-adding an entry moves it to the end of its new line */
+        index.add(0, 11);
+        ASSERT_EQ(2, index.first(3));
+        ASSERT_EQ(1, index.first(11));
+        ASSERT_EQ(0, index.next(1));
+
+        index.reset();
+        ASSERT_EQ(-1, index.first(3));
+        ASSERT_EQ(-1, index.first(11));
+    }
+};
@@ -0,0 +1,76 @@
+
+#include <gtest/gtest.h>
+
+// We disable Assert of Simulator
+#define DISABLE_ASSERT
+#include <globals.h>
+#include <ptlsim.h>
+#include <sampling.h>
+
+namespace {
+
+    /* Mean, deviation and confidence interval of a sample series */
+    TEST(Sampling, Series)
+    {
+        SampleSeries series;
+        ASSERT_EQ(0, series.mean());
+        ASSERT_EQ(0, series.ci95());
+
+        series.add(2.0);
+        ASSERT_DOUBLE_EQ(2.0, series.mean());
+        ASSERT_EQ(0, series.stddev());
+
+        series.add(4.0);
+        series.add(4.0);
+        series.add(4.0);
+        series.add(5.0);
+        series.add(5.0);
+        series.add(7.0);
+        series.add(9.0);
+
+        ASSERT_EQ(W64(8), series.count);
+        ASSERT_DOUBLE_EQ(5.0, series.mean());
+        ASSERT_NEAR(2.138, series.stddev(), 0.001);
+        ASSERT_NEAR(1.96 * series.stddev() / sqrt(8.0), series.ci95(),
+                1e-9);
+
+        series.reset();
+        ASSERT_EQ(W64(0), series.count);
+    }
+
+    /* Samples end after their detailed instructions, up to the count */
+    TEST(Sampling, Windows)
+    {
+        config.sampling_detail_insns = 100;
+        config.sampling_count = 2;
+
+        total_insns_committed = 1000;
+        sim_cycle = 5000;
+
+        sampling_start_sample();
+        ASSERT_EQ(W64(1100), sampling_stop_at_insns);
+        ASSERT_FALSE(sampling_sample_done());
+
+        /* Entering the simulation again keeps the running sample */
+        total_insns_committed = 1050;
+        sampling_start_sample();
+        ASSERT_EQ(W64(1100), sampling_stop_at_insns);
+
+        total_insns_committed = 1100;
+        sim_cycle = 5200;
+        ASSERT_TRUE(sampling_sample_done());
+        ASSERT_TRUE(sampling_end_sample());
+        ASSERT_EQ(infinity, sampling_stop_at_insns);
+        ASSERT_FALSE(sampling_sample_done());
+
+        sampling_start_sample();
+        total_insns_committed = 1200;
+        ASSERT_TRUE(sampling_sample_done());
+        ASSERT_FALSE(sampling_end_sample());
+
+        config.sampling_detail_insns = 0;
+        config.sampling_count = 0;
+        sampling_start_sample();
+        ASSERT_FALSE(sampling_sample_done());
+    }
+};
@@ -0,0 +1,127 @@
+
+#include <gtest/gtest.h>
+
+// We disable Assert of Simulator
+#define DISABLE_ASSERT
+#include <globals.h>
+#include <superstl.h>
+
+namespace {
+
+    struct Base {
+        int calls;
+        void* last;
+
+        Base() : calls(0), last(NULL) { }
+        virtual ~Base() { }
+
+        bool member_cb(void *arg) {
+            calls++;
+            last = arg;
+            return true;
+        }
+
+        virtual bool virtual_cb(void *arg) {
+            return false;
+        }
+    };
+
+    struct Derived : public Base {
+        virtual bool virtual_cb(void *arg) {
+            calls += 10;
+            return arg != NULL;
+        }
+    };
+
+    static int function_calls = 0;
+
+    static bool function_cb(void *arg)
+    {
+        function_calls++;
+        return arg == NULL;
+    }
+
+    /* Delegates call the connected member or plain function */
+    TEST(Signal, Dispatch)
+    {
+        Derived obj;
+        Signal member("member");
+        Signal virt("virtual");
+        Signal function("function");
+
+        member.connect(signal_mem_ptr((Base&)obj, &Base::member_cb));
+        virt.connect(signal_mem_ptr((Base&)obj, &Base::virtual_cb));
+        function.connect(signal_fun_ptr(function_cb));
+
+        int value;
+        ASSERT_TRUE(member.emit(&value));
+        ASSERT_EQ(1, obj.calls);
+        ASSERT_EQ(&value, obj.last);
+
+        ASSERT_TRUE(virt.emit(&value));
+        ASSERT_EQ(11, obj.calls);
+
+        ASSERT_TRUE(function.emit(NULL));
+        ASSERT_FALSE(function.emit(&value));
+        ASSERT_EQ(2, function_calls);
+    }
+
+    /* Names live in a side table for as long as the signal */
+    TEST(Signal, Names)
+    {
+        Signal *signals[64];
+
+        foreach (i, 64) {
+            stringbuf name;
+            name << "signal_", i;
+            signals[i] = new Signal(name);
+        }
+
+        foreach (i, 64) {
+            stringbuf name;
+            name << "signal_", i;
+            ASSERT_STREQ(name.buf, signals[i]->get_name());
+        }
+
+        signals[3]->set_name("renamed");
+        ASSERT_STREQ("renamed", signals[3]->get_name());
+        const char *renamed = signals[3]->get_name();
+
+        foreach (i, 64) {
+            delete signals[i];
+        }
+
+        /* Names stay valid once their signal is gone and are shared */
+        ASSERT_STREQ("renamed", renamed);
+        Signal again("renamed");
+        ASSERT_EQ(renamed, again.get_name());
+
+        Signal unnamed;
+        ASSERT_STREQ("", unnamed.get_name());
+    }
+
+    /* Copies keep the name and the connection, each with its own entry */
+    TEST(Signal, Copy)
+    {
+        Base obj;
+        Signal *orig = new Signal("orig");
+        orig->connect(signal_mem_ptr(obj, &Base::member_cb));
+
+        Signal copy(*orig);
+        Signal assigned("other");
+        assigned = *orig;
+
+        delete orig;
+
+        ASSERT_STREQ("orig", copy.get_name());
+        ASSERT_STREQ("orig", assigned.get_name());
+        ASSERT_TRUE(copy.emit(&obj));
+        ASSERT_TRUE(assigned.emit(&obj));
+        ASSERT_EQ(2, obj.calls);
+
+        Signal unnamed;
+        assigned = unnamed;
+        ASSERT_STREQ("", assigned.get_name());
+        ASSERT_STREQ("orig", copy.get_name());
+    }
+};
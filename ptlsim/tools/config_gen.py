@@ -147,14 +147,10 @@ machine_core_option_add = '''
         machine.add_option("%s", machine.coreid_counter, "%s", %s);
 '''
 
-cache_typedef_cacheline = '''
-typedef CacheLines<%s, %s, %s, %s> %sCacheLines;
-
-'''
-
 cache_case_stmt = '''
         case %s:
-            return new %s(%s_READ_PORTS, %s_WRITE_PORTS);
+            return new CacheLines(%s_SETS, %s_ASSOC, %s_LINE_SIZE,
+                    %s_LATENCY, %s_READ_PORTS, %s_WRITE_PORTS);
 '''
 
 cache_line_func = '''
@@ -689,7 +685,6 @@ def generate_cache_logic(config, options):
         of.write("#include <memoryRequest.h>\n")
         of.write("#include <cacheLines.h>\n")
         of.write("\nnamespace Memory {\n\n")
-        typedefs = {}
         for cache, cfg in config["cache"].items():
             # First write all params
             for param,val in cfg["params"].items():
@@ -699,30 +694,18 @@ def generate_cache_logic(config, options):
             size = get_cache_size(cfg["params"]["SIZE"])
             assoc = cfg["params"]["ASSOC"]
             l_size = cfg["params"]["LINE_SIZE"]
-            lat = cfg["params"]["LATENCY"]
             sets = (size / l_size) / assoc
-            c_pfx = cache.upper() + "_"
 
-            of.write("#define %s_%s %d\n" % (cache.upper(), "SETS",
+            of.write("#define %s_%s %d\n\n" % (cache.upper(), "SETS",
                 sets))
 
-            # Now write typedef CacheLine
-            of.write(cache_typedef_cacheline % (
-                c_pfx + "SETS",
-                c_pfx + "ASSOC",
-                c_pfx + "LINE_SIZE",
-                c_pfx + "LATENCY",
-                c_pfx))
-
-            typedefs[cache] = c_pfx + "CacheLines"
-
         # Now write function 'get_cachelines'
         of.write("\nCacheLinesBase* get_cachelines(int cache_type)\n")
         of.write("{\n")
         of.write("\tswitch(cache_type) {\n")
         for cache in config["cache"].keys():
-            of.write(cache_case_stmt % (cache.upper(),
-                typedefs[cache], cache.upper(), cache.upper()))
+            c = cache.upper()
+            of.write(cache_case_stmt % (c, c, c, c, c, c, c))
         of.write("\t\tdefault: assert(0);\n\t}\n")
         of.write("}\n")
         of.write("};\n")
@@ -217,7 +217,7 @@ union ProcessorMiscInfo {
   (0 << 24)) /* APIC ID (must be patched later!) */
 
 bool assist_cpuid(Context& ctx) {
-	ASSIST_IN_QEMU(helper_cpuid);
+	ASSIST_IN_QEMU_CTX(helper_cpuid);
   ctx.eip = ctx.reg_nextrip;
   return true;
 }
@@ -236,9 +236,9 @@ W64 l_assist_sti(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags,
 	flags = current_flags;
 
 	// Update in QEMU's flags
-    ctx.setup_qemu_switch();
+    setup_qemu_switch_ctx(ctx);
     helper_sti();
-    ctx.setup_ptlsim_switch();
+    setup_ptlsim_switch_ctx(ctx);
 
 	if(logable(4)) ptl_logfile << "[cpu ", ctx.cpu_index, "]sti called rip ", (void*)ctx.eip, endl;
 
@@ -259,9 +259,9 @@ W64 l_assist_cli(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags,
 	flags = current_flags;
 
 	// Update in QEMU's flags
-    ctx.setup_qemu_switch();
+    setup_qemu_switch_ctx(ctx);
     helper_cli();
-    ctx.setup_ptlsim_switch();
+    setup_ptlsim_switch_ctx(ctx);
 
 	if(logable(4)) ptl_logfile << "[cpu ", ctx.cpu_index, "]cli called at rip ", (void*)ctx.eip, endl;
 
@@ -334,7 +334,7 @@ bool assist_ljmp(Context& ctx) {
 
 // BCD Assist
 bool assist_bcd_aas(Context& ctx) {
-	ASSIST_IN_QEMU(helper_aas);
+	ASSIST_IN_QEMU_CTX(helper_aas);
 	ctx.eip = ctx.reg_nextrip;
 	return true;
 }
@@ -516,19 +516,18 @@ bool assist_pause(Context& ctx) {
 
 // TODO : Convert RDTSC to Light Assist
 bool assist_rdtsc(Context& ctx) {
-    ASSIST_IN_QEMU(helper_rdtsc);
+    ASSIST_IN_QEMU_CTX(helper_rdtsc);
     ctx.eip = ctx.reg_nextrip;
     return true;
 }
 
 bool assist_pushf(Context& ctx) {
-	setup_qemu_switch_except_ctx(ctx);
-	ctx.setup_qemu_switch();
+	/* Read the flags and push them in one QEMU section */
+	setup_qemu_switch_ctx(ctx);
 	W64 flags = helper_read_eflags();
-	ctx.setup_ptlsim_switch();
-	// now push the flags on the stack
 	ctx.regs[R_ESP] -= 8;
 	ctx.storemask_virt(ctx.regs[R_ESP], flags, 0xff, 8);
+	setup_ptlsim_switch_ctx(ctx);
 	ctx.eip = ctx.reg_nextrip;
 	return true;
 }
@@ -537,9 +536,9 @@ W64 l_assist_pushf(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags,
 		W16 rbflags, W16 rcflags, W16& flags) {
 
 	// RA contains the latest flags contains ZAPS, CF, OF and IF
-	ctx.setup_qemu_switch();
+	setup_qemu_switch_ctx(ctx);
 	W64 stable_flags = helper_read_eflags();
-	ctx.setup_ptlsim_switch();
+	setup_ptlsim_switch_ctx(ctx);
 
 	W64 flagmask = (setflags_to_x86_flags[7]);
         stable_flags &= ~(flagmask);
@@ -590,9 +589,9 @@ W64 l_assist_popf(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags,
 	W64 flagmask = (setflags_to_x86_flags[7]) | IF_MASK ;
 	flags = (W16)(ra & flagmask);
 
-    ctx.setup_qemu_switch();
+    setup_qemu_switch_ctx(ctx);
     helper_write_eflags(stable_flags, mask);
-    ctx.setup_ptlsim_switch();
+    setup_ptlsim_switch_ctx(ctx);
 
 	return stable_flags;
 }
@@ -728,8 +727,7 @@ bool assist_write_debug_reg(Context& ctx) {
   W64 value = ctx.reg_ar1;
   W64 regid = ctx.reg_ar2;
 
-  setup_qemu_switch_except_ctx(ctx);
-  ctx.setup_qemu_switch();
+  setup_qemu_switch_all_ctx(ctx);
 
   int i;
   if(regid < 4) {
@@ -745,6 +743,7 @@ bool assist_write_debug_reg(Context& ctx) {
   } else {
 	  ctx.dr[regid] = value;
   }
+  setup_ptlsim_switch_all_ctx(ctx);
   ctx.eip = ctx.reg_nextrip;
   return true;
 }
@@ -835,8 +834,7 @@ bool assist_ioport_in(Context& ctx) {
   W64 port = ctx.reg_ar1;
   W64 sizeshift = ctx.reg_ar2;
 
-  setup_qemu_switch_except_ctx(ctx);
-  ctx.setup_qemu_switch();
+  setup_qemu_switch_all_ctx(ctx);
   W64 value;
   if(sizeshift == 0) {
 	  value = helper_inb(port);
@@ -845,7 +843,7 @@ bool assist_ioport_in(Context& ctx) {
   } else {
 	  value = helper_inl(port);
   }
-  ctx.setup_ptlsim_switch();
+  setup_ptlsim_switch_all_ctx(ctx);
 
   ctx.regs[R_EAX] = x86_merge(ctx.regs[R_EAX], value, sizeshift);
   ctx.eip = ctx.reg_nextrip;
@@ -859,8 +857,7 @@ W64 l_assist_ioport_in(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags,
 	W64 sizeshift = rb;
 	W64 old_eax = rc;
 
-	setup_qemu_switch_except_ctx(ctx);
-	ctx.setup_qemu_switch();
+	setup_qemu_switch_all_ctx(ctx);
 	W64 value;
 	if(sizeshift == 0) {
 		value = helper_inb(port);
@@ -891,8 +888,7 @@ bool assist_ioport_out(Context& ctx) {
   W64 sizeshift = ctx.reg_ar2;
   W64 value = x86_merge(0, ctx.regs[R_EAX], sizeshift);
 
-  setup_qemu_switch_except_ctx(ctx);
-  ctx.setup_qemu_switch();
+  setup_qemu_switch_all_ctx(ctx);
   if(sizeshift == 0) {
 	  helper_outb(port, value);
   } else if(sizeshift == 1) {
@@ -900,7 +896,7 @@ bool assist_ioport_out(Context& ctx) {
   } else {
 	  helper_outl(port, value);
   }
-  ctx.setup_ptlsim_switch();
+  setup_ptlsim_switch_all_ctx(ctx);
   ctx.eip = ctx.reg_nextrip;
   return true;
 }
@@ -912,8 +908,7 @@ W64 l_assist_ioport_out(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags,
 	W64 sizeshift = rb;
 	W64 value = x86_merge(0, rc, sizeshift);
 
-	setup_qemu_switch_except_ctx(ctx);
-	ctx.setup_qemu_switch();
+	setup_qemu_switch_all_ctx(ctx);
     assert(port < MAX_IOPORTS);
 	if(sizeshift == 0) {
 		helper_outb(port, value);
@@ -942,17 +937,16 @@ W64 l_assist_pause(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags,
 W64 l_assist_popcnt(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags,
         W16 rbflags, W16 rcflags, W16& flags) {
     W64 sizeshift = rb;
-    setup_qemu_switch_except_ctx(ctx);
-    ctx.setup_qemu_switch();
+    setup_qemu_switch_ctx(ctx);
     helper_popcnt(ra,sizeshift);
-    setup_ptlsim_switch_all_ctx(ctx);
+    setup_ptlsim_switch_ctx(ctx);
 
     return 0;
 }
 
 bool assist_mmx_emms(Context& ctx) {
   ctx.eip = ctx.reg_selfrip;
-  ASSIST_IN_QEMU(helper_emms);
+  ASSIST_IN_QEMU_CTX(helper_emms);
   ctx.eip = ctx.reg_nextrip;
   return true;
 }
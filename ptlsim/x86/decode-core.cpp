@@ -13,6 +13,7 @@
 
 BasicBlockCache bbcache[NUM_SIM_CORES];
 W8 BasicBlockCache::cpuid_counter = 0;
+bool bbcache_shared = 0;
 
 struct BasicBlockChunkListHashtableLinkManager {
     static inline BasicBlockChunkList* objof(selflistlink* link) {
@@ -383,7 +384,8 @@ void split_unaligned(const TransOp& transop, TransOpBuffer& buf) {
     ag.unaligned = 0;
     ag.rd = REG_temp9;
     ag.rc = REG_zero;
-    buf.synthops[idx] = get_synthcode_for_uop(OP_add, 3, 0, 0, 0, 0, 0);
+    buf.execs[idx].synthop = get_synthcode_for_uop(OP_add, 3, 0, 0, 0, 0, 0);
+    buf.execs[idx].invsynthop = NULL;
 
     idx = buf.put();
     TransOp& lo = buf.uops[idx];
@@ -394,7 +396,8 @@ void split_unaligned(const TransOp& transop, TransOpBuffer& buf) {
     lo.cond = LDST_ALIGN_LO;
     lo.unaligned = 0;
     lo.eom = 0;
-    buf.synthops[idx] = NULL; // loads and stores are not synthesized
+    buf.execs[idx].synthop = NULL; // loads and stores are not synthesized
+    buf.execs[idx].invsynthop = NULL;
 
     idx = buf.put();
     TransOp& hi = buf.uops[idx];
@@ -405,7 +408,8 @@ void split_unaligned(const TransOp& transop, TransOpBuffer& buf) {
     hi.cond = LDST_ALIGN_HI;
     hi.unaligned = 0;
     hi.som = 0;
-    buf.synthops[idx] = NULL; // loads and stores are not synthesized
+    buf.execs[idx].synthop = NULL; // loads and stores are not synthesized
+    buf.execs[idx].invsynthop = NULL;
 
     if (ld) {
         // ld rd = [ra+rb]        =>   ld.lo rd = [rt]           and    ld.hi rd = [rt],rd
@@ -1683,8 +1687,45 @@ bool assist_invalid_opcode(Context& ctx) {
 
 static const bool log_code_page_ops = 0;
 
+typedef HashtableKeyManager<RIPVirtPhys, BB_CACHE_SIZE> BasicBlockKeyManager;
+
+//
+// Find the block of rvp translated in address space asid. Blocks of
+// several address spaces may have the same rip in the shared cache,
+// so the whole chain is searched instead of stopping at the first rip.
+//
+BasicBlock* BasicBlockCache::find(const RIPVirtPhys& rvp, W64 asid) {
+    selflistlink* link = sets[lowbits(BasicBlockKeyManager::hash(rvp), log2(BB_CACHE_SIZE))];
+
+    while (link) {
+        BasicBlock* bb = BasicBlockHashtableLinkManager::objof(link);
+        if likely ((bb->rip == rvp) && (bb->asid == asid) &&
+                (bb->rip.use64 == rvp.use64) && (bb->rip.kernel == rvp.kernel) &&
+                (bb->rip.df == rvp.df)) {
+            return bb;
+        }
+        link = link->next;
+    }
+
+    return NULL;
+}
+
+//
+// Add a block to the shared cache. Unlike add(), this keeps blocks of
+// other address spaces with the same rip.
+//
+void BasicBlockCache::add_shared(BasicBlock* bb) {
+    if unlikely (bb->hashlink.linked()) return;
+
+    bb->hashlink.addto(sets[lowbits(BasicBlockKeyManager::hash(bb->rip), log2(BB_CACHE_SIZE))]);
+    count++;
+}
+
 bool BasicBlockCache::invalidate(BasicBlock* bb, int reason) {
     BasicBlockChunkList* pagelist;
+
+    core_task_serialize();
+
     if unlikely (bb->refcount) {
         if(logable(8))
             ptl_logfile << "Warning: basic block ", bb, " ", *bb, " is still in use somewhere (refcount ", bb->refcount, ")", endl;
@@ -1755,6 +1796,8 @@ void BasicBlockCache::add_page(BasicBlock* bb)
 // when we run out of memory (it may will allocate any memory).
 //
 bool BasicBlockCache::invalidate_page(Waddr mfn, int reason) {
+    core_task_serialize();
+
     //
     // We may try to invalidate the special invalid mfn if SMC
     // occurs on a page where the high virtual page is invalid.
@@ -1794,92 +1837,57 @@ bool BasicBlockCache::invalidate_page(Waddr mfn, int reason) {
 }
 
 //
-// Scan through the BB cache and try to free up
-// <bytesreq> bytes, starting with the least
-// recently used BBs.
+// Free the cached basic blocks of all generations before <generation>.
+// Blocks used since the previous reclaim are copied to the newest
+// generation instead, so hot code survives while the old chunks are
+// recycled as a whole.
 //
-int BasicBlockCache::reclaim(size_t bytesreq, int urgency) {
-    bool DEBUG = 1; // logable(1);
+int BasicBlockCache::reclaim(W64 generation) {
+    bool DEBUG = logable(1);
 
     if (!count) return 0;
 
-    if (DEBUG) ptl_logfile << "Reclaiming cached basic blocks at ", sim_cycle, " cycles, ", total_insns_committed, " commits:", endl;
+    core_task_serialize();
+
+    if (DEBUG) ptl_logfile << "Reclaiming cached basic blocks before generation ", generation, " at ", sim_cycle, " cycles, ", total_insns_committed, " commits:", endl;
 
     if (DECODERSTAT)
         DECODERSTAT->reclaim_rounds++;
 
-    W64 oldest = limits<W64>::max;
-    W64 newest = 0;
-    W64 average = 0;
-    W64 total_bytes = 0;
-
-    int n = 0;
+    int before = count;
+    int reclaimed_objs = 0;
+    int moved_objs = 0;
 
     Iterator iter(this);
     BasicBlock* bb;
 
     while ((bb = iter.next())) {
-        oldest = min(oldest, bb->lastused);
-        newest = max(newest, bb->lastused);
-        average += bb->lastused;
-        total_bytes += sizeof(bb);
-        n++;
-    }
+        if (BasicBlockArena::generation_of(bb) >= generation) continue;
 
-    assert(count == n);
-    assert(n > 0);
-    average /= n;
-
-    //if unlikely (urgency >= MAX_URGENCY) {
-    //  //
-    //  // The allocator is so strapped for memory, we need to free
-    //  // everything possible at all costs:
-    //  //
-    //  average = infinity;
-    //}
-
-    if (DEBUG) {
-        ptl_logfile << "Before:", endl;
-        ptl_logfile << "  Basic blocks:   ", intstring(count, 12), endl;
-        ptl_logfile << "  Bytes occupied: ", intstring(total_bytes, 12), endl;
-        ptl_logfile << "  Oldest cycle:   ", intstring(oldest, 12), endl;
-        ptl_logfile << "  Average cycle:  ", intstring(average, 12), endl;
-        ptl_logfile << "  Newest cycle:   ", intstring(newest, 12), endl;
-    }
-
-    //
-    // Reclaim all objects older than the average
-    //
-    n = 0;
-    W64 reclaimed_bytes = 0;
-    int reclaimed_objs = 0;
-
-    iter.reset(this);
-    while ((bb = iter.next())) {
         if unlikely (bb->refcount) {
             //
             // We cannot invalidate anything that's still in the pipeline.
             // If this is required, the pipeline must be flushed before
             // the forced invalidation can occur.
             //
-            ptl_logfile << "Warning: eligible bb ", bb, " ", bb->rip, " (lastused ", bb->lastused, ") still has refcount ", bb->refcount, endl;
+            if (DEBUG) ptl_logfile << "Warning: eligible bb ", bb, " ", bb->rip, " (lastused ", bb->last_use(), ") still has refcount ", bb->refcount, endl;
             continue;
         }
 
-        // We use '<=' to guarantee even a uniform distribution will eventually be reclaimed:
-        if likely (bb->lastused <= average) {
-            reclaimed_bytes += sizeof(bb);
-            reclaimed_objs++;
+        if (bb->last_use() > bbarena.last_reclaim) {
+            move(bb);
+            moved_objs++;
+        } else {
             invalidate(bb, INVALIDATE_REASON_RECLAIM);
+            reclaimed_objs++;
         }
-        n++;
     }
 
     if (DEBUG) {
-        ptl_logfile << "After:", endl;
-        ptl_logfile << "  Basic blocks:   ", intstring(reclaimed_objs, 12), " BBs reclaimed", endl;
-        ptl_logfile << "  Bytes occupied: ", intstring(reclaimed_bytes, 12), " bytes reclaimed", endl;
-        ptl_logfile << "  New pool size:  ", intstring(count, 12), " BBs", endl;
+        ptl_logfile << "  Basic blocks:   ", intstring(before, 12), " BBs before", endl;
+        ptl_logfile << "  Reclaimed:      ", intstring(reclaimed_objs, 12), " BBs", endl;
+        ptl_logfile << "  Moved:          ", intstring(moved_objs, 12), " BBs", endl;
+        ptl_logfile << "  Arena chunks:   ", intstring(bbarena.chunks, 12), endl;
         ptl_logfile.flush();
     }
 
@@ -1892,24 +1900,45 @@ int BasicBlockCache::reclaim(size_t bytesreq, int urgency) {
         BasicBlockChunkList* page;
         int pages_freed = 0;
 
-        if (DEBUG) ptl_logfile << "Scanning ", bbpages.count, " code pages:", endl;
         while ((page = iter.next())) {
-            if (page->empty()) {
-                if (!page->refcount) {
-                    if (DEBUG) ptl_logfile << "  mfn ", page->mfn, " has no entries; freeing", endl;
-                    bbpages.remove(page);
-                    delete page;
-                    pages_freed++;
-                } else {
-                    if (DEBUG) ptl_logfile << "  mfn ", page->mfn, " still has refs to it: cannot free it yet", endl;
-                }
+            if (page->empty() && !page->refcount) {
+                bbpages.remove(page);
+                delete page;
+                pages_freed++;
             }
         }
 
         if (DEBUG) ptl_logfile << "Freed ", pages_freed, " empty pages", endl;
     }
 
-    return n;
+    return reclaimed_objs;
+}
+
+//
+// Copy a basic block to the newest generation, keeping its place
+// in the cache and in the page lists.
+//
+BasicBlock* BasicBlockCache::move(BasicBlock* bb) {
+    BasicBlock* newbb = bb->clone();
+
+    memcpy(newbb->lastused, bb->lastused, sizeof(bb->lastused));
+
+    remove(bb);
+    if (bbcache_shared) {
+        add_shared(newbb);
+    } else {
+        add(newbb);
+    }
+
+    bb->mfnlo_loc.chunk->data[bb->mfnlo_loc.index] = newbb;
+
+    int page_crossing = ((lowbits(bb->rip, 12) + (bb->bytes-1)) >> 12);
+    if (page_crossing) {
+        bb->mfnhi_loc.chunk->data[bb->mfnhi_loc.index] = newbb;
+    }
+
+    bb->free();
+    return newbb;
 }
 
 //
@@ -1965,7 +1994,14 @@ bool assist_exec_page_fault(Context& ctx) {
     Waddr bbcache_rip = ctx.reg_ar2;
 
     ctx.eip = ctx.reg_selfrip;
-    assert(bbcache[ctx.cpu_index].invalidate(RIPVirtPhys(bbcache_rip).update(ctx), INVALIDATE_REASON_SPURIOUS));
+    RIPVirtPhys rvp = RIPVirtPhys(bbcache_rip).update(ctx);
+    BasicBlockCache& cache = get_bbcache(ctx.cpu_index);
+    if (bbcache_shared) {
+        BasicBlock* bb = cache.find(rvp, bbcache_asid(ctx, rvp));
+        assert(!bb || cache.invalidate(bb, INVALIDATE_REASON_SPURIOUS));
+    } else {
+        assert(cache.invalidate(rvp, INVALIDATE_REASON_SPURIOUS));
+    }
     ctx.handle_page_fault(faultaddr, 2);
 
     return true;
@@ -2330,6 +2366,12 @@ ostream& printflags(ostream& os, W64 flags) {
 // references to some of the basic blocks.
 //
 BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
+    // Count in the stats of the translating core, the cache may be shared
+    W8 cpuid = ctx.cpu_index;
+    W64 asid = bbcache_asid(ctx, rvp);
+
+    core_task_serialize();
+
     if unlikely ((rvp.rip == config.start_log_at_rip) && (rvp.rip != 0xffffffffffffffffULL)) {
         config.start_log_at_iteration = 0;
         logenable = 1;
@@ -2347,9 +2389,13 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
        }
        */
 
-    BasicBlock* bb = get(rvp);
-    if likely (bb && bb->context_id == ctx.cpu_index) {
-        return bb;
+    BasicBlock* bb;
+    if (bbcache_shared) {
+        bb = find(rvp, asid);
+        if likely (bb) return bb;
+    } else {
+        bb = get(rvp);
+        if likely (bb && bb->context_id == ctx.cpu_index) return bb;
     }
 
     bb = NULL;
@@ -2376,17 +2422,37 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
         assert(trans.valid_byte_count == 0);
     }
 
-    for (;;) {
-        if (!trans.translate()) break;
+    const BasicBlockFileRecord* record = NULL;
+    if unlikely (bbfile.is_open()) {
+        bool stale;
+        record = bbfile.find(trans, insnbuf, stale);
+        if (record) DECODERSTAT->bbfile.hits++;
+        else DECODERSTAT->bbfile.misses++;
+        if (stale) DECODERSTAT->bbfile.stale++;
     }
 
-    if(trans.handle_exec_fault) {
-        return NULL;
+    if (record) {
+        bbfile.restore(*record, trans.bb);
+    } else {
+        for (;;) {
+            if (!trans.translate()) break;
+        }
+
+        if(trans.handle_exec_fault) {
+            return NULL;
+        }
+
+        trans.bb.hitcount = 0;
+        trans.bb.predcount = 0;
+
+        if unlikely (bbfile.is_open()) bbfile.add(trans, insnbuf);
     }
 
-    trans.bb.hitcount = 0;
-    trans.bb.predcount = 0;
+    if unlikely (bbarena.chunks >= BB_ARENA_MAX_CHUNKS) bbcache_reclaim();
+
     bb = trans.bb.clone();
+    bb->asid = asid;
+    bb->context_id = ctx.cpu_index;
     //
     // Acquire a reference to the new basic block right away,
     // since we make allocations below that might reclaim it
@@ -2394,7 +2460,16 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
     //
     bb->acquire();
 
-    add(bb);
+    //
+    // Other cores may use a shared block without serializing,
+    // so it must be complete before it becomes visible.
+    //
+    if (bbcache_shared) {
+        synth_uops_for_bb(*bb);
+        add_shared(bb);
+    } else {
+        add(bb);
+    }
     W64 ct = this->count;
     DECODERSTAT->bbcache.count = ct;
     DECODERSTAT->bbcache.inserts++;
@@ -2450,8 +2525,6 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
         ptl_logfile << "End of basic block: rip ", trans.bb.rip, " -> taken rip 0x", (void*)(Waddr)trans.bb.rip_taken, ", not taken rip 0x", (void*)(Waddr)trans.bb.rip_not_taken, endl;
     }
 
-    bb->context_id = ctx.cpu_index;
-
     translate_timer.stop();
 
     bb->release();
@@ -2552,9 +2625,17 @@ ostream& BasicBlockCache::print(ostream& os) {
 }
 
 void bbcache_reclaim(size_t bytes, int urgency) {
-    foreach(i, NUM_SIM_CORES) {
-        bbcache[i].reclaim(bytes, urgency);
+    W64 generation = bbarena.reclaim_generation(bytes);
+
+    if (bbcache_shared) {
+        bbcache[0].reclaim(generation);
+    } else {
+        foreach(i, NUM_SIM_CORES) {
+            bbcache[i].reclaim(generation);
+        }
     }
+
+    bbarena.last_reclaim = sim_cycle;
 }
 
 void init_decode() {
@@ -2564,6 +2645,7 @@ void shutdown_decode() {
     foreach(i, NUM_SIM_CORES) {
         bbcache[i].flush(0);
     }
+    bbfile.close();
     if (bbcache_dump_file) bbcache_dump_file.close();
 }
 
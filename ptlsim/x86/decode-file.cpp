@@ -0,0 +1,327 @@
+//
+// PTLsim: Cycle Accurate x86-64 Simulator
+// Persistent basic block cache
+//
+
+#include <globals.h>
+#include <ptlsim.h>
+#include <decode.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+BasicBlockFile bbfile;
+
+static W64 bbfile_hash(const void* data, size_t bytes, W64 hash = 0xcbf29ce484222325ULL) {
+    const byte* p = (const byte*)data;
+
+    for (size_t i = 0; i < bytes; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+//
+// Translations embed the numbers of assists and addresses of decoder
+// tables, so a file is only valid for the simulator binary that wrote
+// it. Table addresses are stored relative to bbfile (see bbfile_relocate),
+// which keeps files valid when the binary is loaded at another address.
+//
+static W64 bbfile_build() {
+    struct stat st;
+    setzero(st);
+    stat("/proc/self/exe", &st);
+
+    W64 hash = bbfile_hash(&st.st_ino, sizeof(st.st_ino));
+    hash = bbfile_hash(&st.st_size, sizeof(st.st_size), hash);
+    hash = bbfile_hash(&st.st_mtime, sizeof(st.st_mtime), hash);
+
+    W32 sizes[2] = { sizeof(BasicBlockBase), sizeof(TransOp) };
+    return bbfile_hash(sizes, sizeof(sizes), hash);
+}
+
+//
+// Internal loads that are not relative to the context read a host table
+// (like translate_fcmpcc_to_x87) at an immediate address. Add <delta> to
+// those addresses: -&bbfile when storing a translation, +&bbfile when
+// restoring one.
+//
+static void bbfile_relocate(TransOp* ops, int count, W64 delta) {
+    foreach (i, count) {
+        TransOp& op = ops[i];
+        if (isload(op.opcode) && op.internal && (op.ra != REG_ctx) && (op.rb == REG_imm)) {
+            op.rbimm += delta;
+        }
+    }
+}
+
+static inline int bbfile_slot(W64 rip) {
+    return foldbits<16>(rip) & (BBFILE_INDEX_SIZE - 1);
+}
+
+static inline bool bbfile_same_mode(const BasicBlockFileRecord& a, const BasicBlockFileRecord& b) {
+    return (a.use64 == b.use64) && (a.use32 == b.use32) && (a.ss32 == b.ss32) &&
+        (a.kernel == b.kernel) && (a.df == b.df) && (a.pe == b.pe) &&
+        (a.vm86 == b.vm86) && (a.cs_base == b.cs_base) && (a.hflags == b.hflags);
+}
+
+//
+// Decoder state a translation depends on, besides its code bytes
+//
+static void bbfile_set_mode(BasicBlockFileRecord& record, const TraceDecoder& trans) {
+    new(&record) BasicBlockFileRecord();
+    record.rip = trans.bb.rip.rip;
+    record.use64 = trans.use64;
+    record.use32 = trans.use32;
+    record.ss32 = trans.ss32;
+    record.kernel = trans.kernel;
+    record.df = trans.dirflag;
+    record.pe = trans.pe;
+    record.vm86 = trans.vm86;
+    record.cs_base = trans.cs_base;
+    record.hflags = trans.hflags;
+}
+
+BasicBlockFile::BasicBlockFile() {
+    map = NULL;
+    mapsize = 0;
+    loaded = 0;
+    build = 0;
+    foreach (i, BBFILE_INDEX_SIZE) index[i] = -1;
+}
+
+void BasicBlockFile::insert(BasicBlockFileRecord* record) {
+    int slot = bbfile_slot(record->rip);
+    next.push(index[slot]);
+    index[slot] = records.length;
+    records.push(record);
+}
+
+bool BasicBlockFile::contains(const BasicBlockFileRecord& record) {
+    for (int i = index[bbfile_slot(record.rip)]; i >= 0; i = next[i]) {
+        const BasicBlockFileRecord& other = *records[i];
+        if ((other.rip == record.rip) && (other.codebytes == record.codebytes) &&
+                (other.codehash == record.codehash) && bbfile_same_mode(other, record)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//
+// Add the records of a mapped file that are not known yet. Returns the
+// number of records added, or -1 if the file is not a valid cache file
+// of this simulator binary.
+//
+int BasicBlockFile::load(byte* data, size_t size, bool copy) {
+    const BasicBlockFileHeader* header = (const BasicBlockFileHeader*)data;
+
+    if ((size < sizeof(*header)) || memcmp(header->magic, BBFILE_MAGIC, sizeof(header->magic)) ||
+            (header->version != BBFILE_VERSION) || (header->build != build)) {
+        return -1;
+    }
+
+    byte* p = data + sizeof(*header);
+    byte* end = data + size;
+    int n = 0;
+
+    for (W32 i = 0; i < header->count; i++) {
+        BasicBlockFileRecord* record = (BasicBlockFileRecord*)p;
+
+        // Stop at a truncated record
+        if ((size_t)(end - p) < sizeof(*record)) break;
+        if ((record->size < sizeof(*record)) || (record->size > (size_t)(end - p))) break;
+        if (record->size != sizeof(*record) + (record->base.count * sizeof(TransOp))) break;
+
+        p += record->size;
+
+        if (copy) {
+            if (contains(*record)) continue;
+            BasicBlockFileRecord* dup = (BasicBlockFileRecord*)malloc(record->size);
+            memcpy(dup, record, record->size);
+            record = dup;
+        }
+
+        insert(record);
+        n++;
+    }
+
+    return n;
+}
+
+void BasicBlockFile::open(const char* path) {
+    close();
+
+    filename = path;
+    build = bbfile_build();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        ptl_logfile << "Basic block cache file ", path, " does not exist yet", endl;
+        return;
+    }
+
+    struct stat st;
+    void* base = MAP_FAILED;
+    if ((fstat(fd, &st) == 0) && (st.st_size > 0)) {
+        mapsize = st.st_size;
+        base = mmap(NULL, mapsize, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+
+    if (base == MAP_FAILED) {
+        mapsize = 0;
+        return;
+    }
+
+    map = (byte*)base;
+    int n = load(map, mapsize, false);
+
+    if (n < 0) {
+        ptl_logfile << "Ignoring basic block cache file ", path, " of another simulator binary", endl;
+        munmap(map, mapsize);
+        map = NULL;
+        mapsize = 0;
+        return;
+    }
+
+    loaded = records.length;
+    ptl_logfile << "Loaded ", n, " basic blocks from ", path, endl;
+}
+
+//
+// Find a translation of the block trans is about to decode. Records are
+// validated lazily: the code bytes are only compared here, and a record
+// whose bytes changed sets <stale>.
+//
+const BasicBlockFileRecord* BasicBlockFile::find(const TraceDecoder& trans, const byte* insnbuf, bool& stale) {
+    BasicBlockFileRecord mode;
+    bbfile_set_mode(mode, trans);
+    stale = 0;
+
+    for (int i = index[bbfile_slot(mode.rip)]; i >= 0; i = next[i]) {
+        const BasicBlockFileRecord& record = *records[i];
+
+        if ((record.rip != mode.rip) || !bbfile_same_mode(record, mode)) continue;
+        if (record.codebytes > trans.valid_byte_count) continue;
+
+        if (record.codehash == bbfile_hash(insnbuf, record.codebytes)) return &record;
+        stale = 1;
+    }
+
+    return NULL;
+}
+
+//
+// Copy a stored translation into the decoder's block, which already
+// holds the rip and mode of the new translation.
+//
+void BasicBlockFile::restore(const BasicBlockFileRecord& record, BasicBlock& bb) {
+    RIPVirtPhys rip = bb.rip;
+
+    static_cast<BasicBlockBase&>(bb) = record.base;
+    memcpy(bb.transops, record.transops(), record.base.count * sizeof(TransOp));
+    bbfile_relocate(bb.transops, bb.count, (Waddr)&bbfile);
+
+    bb.rip = rip;
+    bb.hashlink.reset();
+    bb.mfnlo_loc.reset();
+    bb.mfnhi_loc.reset();
+    bb.execs = NULL;
+    bb.refcount = 0;
+    bb.hitcount = 0;
+    bb.predcount = 0;
+}
+
+void BasicBlockFile::add(const TraceDecoder& trans, const byte* insnbuf) {
+    const BasicBlock& bb = trans.bb;
+    size_t size = sizeof(BasicBlockFileRecord) + (bb.count * sizeof(TransOp));
+    BasicBlockFileRecord* record = (BasicBlockFileRecord*)malloc(size);
+
+    bbfile_set_mode(*record, trans);
+    record->size = size;
+    record->codebytes = bb.bytes;
+    record->codehash = bbfile_hash(insnbuf, bb.bytes);
+
+    record->base = bb;
+    record->base.hashlink.reset();
+    record->base.execs = NULL;
+    record->base.refcount = 0;
+    setzero(record->base.lastused);
+    memcpy((TransOp*)record->transops(), bb.transops, bb.count * sizeof(TransOp));
+    bbfile_relocate((TransOp*)record->transops(), bb.count, -(Waddr)&bbfile);
+
+    insert(record);
+}
+
+//
+// Write all known records to the file. Records other runs added since
+// this one mapped the file are merged in first, and the file is replaced
+// atomically so runs sharing it never see a partial file.
+//
+void BasicBlockFile::save() {
+    stringbuf temp_path;
+    temp_path << filename, ".tmp.", getpid();
+
+    int fd = ::open(filename, O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if ((fstat(fd, &st) == 0) && (st.st_size > 0)) {
+            void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (base != MAP_FAILED) {
+                load((byte*)base, st.st_size, true);
+                munmap(base, st.st_size);
+            }
+        }
+        ::close(fd);
+    }
+
+    BasicBlockFileHeader header;
+    setzero(header);
+    memcpy(header.magic, BBFILE_MAGIC, sizeof(header.magic));
+    header.version = BBFILE_VERSION;
+    header.count = records.length;
+    header.build = build;
+    foreach (i, records.length) header.bytes += records[i]->size;
+
+    FILE* file = fopen(temp_path, "wb");
+    if (!file) return;
+
+    bool ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+    foreach (i, records.length) {
+        if (!ok) break;
+        ok = (fwrite(records[i], records[i]->size, 1, file) == 1);
+    }
+    ok &= (fclose(file) == 0);
+
+    if (ok) {
+        rename(temp_path, filename);
+        ptl_logfile << "Saved ", records.length, " basic blocks (", records.length - loaded, " new) to ", filename, endl;
+    } else {
+        unlink(temp_path);
+    }
+}
+
+void BasicBlockFile::close() {
+    if (!is_open()) return;
+
+    if (records.length > loaded) save();
+
+    for (int i = loaded; i < records.length; i++) {
+        ::free(records[i]);
+    }
+
+    if (map) munmap(map, mapsize);
+    map = NULL;
+    mapsize = 0;
+    loaded = 0;
+
+    records.clear();
+    next.clear();
+    foreach (i, BBFILE_INDEX_SIZE) index[i] = -1;
+
+    filename.reset();
+}
@@ -26,7 +26,7 @@ W64 l_assist_x87_fist(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags, W16 rbf
 	W64 result;
 	int size = (int)rb;
 
-	ctx.setup_qemu_switch();
+	setup_qemu_switch_ctx(ctx);
 
 	switch (size) {
 		case 1: result = (W64)helper_fist_ST0(); break;
@@ -35,20 +35,20 @@ W64 l_assist_x87_fist(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags, W16 rbf
 		default: assert(0);
 	}
 
-	ctx.setup_ptlsim_switch();
+	setup_ptlsim_switch_ctx(ctx);
 
 	return result;
 }
 
 bool assist_x87_fprem(Context& ctx) {
-    ASSIST_IN_QEMU(helper_fprem);
+    ASSIST_IN_QEMU_CTX(helper_fprem);
     ctx.eip = ctx.reg_nextrip;
     return true;
 }
 
 #define make_two_input_x87_func_with_pop(name, expr) \
 bool assist_x87_##name(Context& ctx) { \
-	ASSIST_IN_QEMU(helper_##name); \
+	ASSIST_IN_QEMU_CTX(helper_##name); \
 	ctx.eip = ctx.reg_nextrip; \
   return true; \
 }
@@ -98,7 +98,7 @@ make_two_input_x87_func_with_pop(fyl2xp1, st1u.d = x87_fyl2xp1(st1u.d, st0u.d));
 make_two_input_x87_func_with_pop(fpatan, st1u.d = x87_fpatan(st1u.d, st0u.d));
 
 bool assist_x87_fscale(Context& ctx) {
-	ASSIST_IN_QEMU(helper_fscale);
+	ASSIST_IN_QEMU_CTX(helper_fscale);
   ctx.eip = ctx.reg_nextrip;
   return true;
 }
@@ -107,7 +107,7 @@ bool assist_x87_fscale(Context& ctx) {
 
 #define make_unary_x87_func(name, expr) \
 bool assist_x87_##name(Context& ctx) { \
-	ASSIST_IN_QEMU(helper_##name); \
+	ASSIST_IN_QEMU_CTX(helper_##name); \
 	ctx.eip = ctx.reg_nextrip; \
   return true; \
 }
@@ -118,14 +118,14 @@ make_unary_x87_func(fcos, cos(ra.d));
 make_unary_x87_func(f2xm1, exp2(ra.d) - 1);
 
 bool assist_x87_frndint(Context& ctx) {
-	ASSIST_IN_QEMU(helper_frndint);
+	ASSIST_IN_QEMU_CTX(helper_frndint);
     ctx.eip = ctx.reg_nextrip;
   return true;
 }
 
 #define make_two_output_x87_func_with_push(name, expr) \
 bool assist_x87_##name(Context& ctx) { \
-	ASSIST_IN_QEMU(helper_##name); \
+	ASSIST_IN_QEMU_CTX(helper_##name); \
 	ctx.eip = ctx.reg_nextrip; \
   return true; \
 }
@@ -139,7 +139,7 @@ make_two_output_x87_func_with_push(fptan, (st1u.d = 1.0, st0u.d = tan(st0u.d)));
 make_two_output_x87_func_with_push(fxtract, (st1u.d = significand(st0u.d), st0u.d = ilogb(st0u.d)));
 
 bool assist_x87_fprem1(Context& ctx) {
-	ASSIST_IN_QEMU(helper_fprem1);
+	ASSIST_IN_QEMU_CTX(helper_fprem1);
 //	ctx.setup_qemu_switch();
 //	helper_fprem1();
 	ctx.eip = ctx.reg_nextrip;
@@ -163,7 +163,7 @@ bool assist_x87_fprem1(Context& ctx) {
 //}
 
 bool assist_x87_fxam(Context& ctx) {
-    ASSIST_IN_QEMU(helper_fxam_ST0);
+    ASSIST_IN_QEMU_CTX(helper_fxam_ST0);
 //	ctx.setup_qemu_switch();
 //	helper_fxam_ST0();
 	ctx.eip = ctx.reg_nextrip;
@@ -270,7 +270,7 @@ bool assist_x87_frstor(Context& ctx) {
 }
 
 bool assist_x87_fclex(Context& ctx) {
-	ASSIST_IN_QEMU(helper_fclex);
+	ASSIST_IN_QEMU_CTX(helper_fclex);
 //	ctx.setup_qemu_switch();
 //	helper_fclex();
 	ctx.eip = ctx.reg_nextrip;
@@ -301,7 +301,7 @@ bool assist_x87_finit(Context& ctx) {
 bool assist_x87_fxch(Context& ctx) {
 	int reg = ctx.reg_ar1;
 
-	ASSIST_IN_QEMU(helper_fxchg_ST0_STN, reg);
+	ASSIST_IN_QEMU_CTX(helper_fxchg_ST0_STN, reg);
 
 	ctx.eip = ctx.reg_nextrip;
   return true;
@@ -330,8 +330,15 @@ bool assist_x87_fldenv(Context& ctx) {
 bool assist_x87_fbstp(Context& ctx) {
 
     Waddr ptr = ctx.reg_ar1;
-    ASSIST_IN_QEMU(helper_fbst_ST0, ptr);
-    ASSIST_IN_QEMU(helper_fpop);
+
+    /* Store and pop in one QEMU section */
+    ctx.eip = ctx.reg_selfrip;
+    ptl_stable_state = 1;
+    setup_qemu_switch_all_ctx(ctx);
+    helper_fbst_ST0(ptr);
+    helper_fpop();
+    setup_ptlsim_switch_all_ctx(ctx);
+    ptl_stable_state = 0;
     ctx.eip = ctx.reg_nextrip;
 
     return true;
@@ -359,7 +366,7 @@ bool assist_x87_fnsave(Context& ctx) {
 bool assist_x87_fldcw(Context& ctx) {
 
     W16 val = ctx.reg_ar1;
-    ASSIST_IN_QEMU(helper_fldcw, val);
+    ASSIST_IN_QEMU_CTX(helper_fldcw, val);
 
     /* Update the rounding control from fpcw to mxcsr */
     int rounding = (ctx.fpuc >> 10) & 3;
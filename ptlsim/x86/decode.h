@@ -27,6 +27,16 @@
 	setup_ptlsim_switch_all_ctx(ctx); \
     ptl_stable_state = 0;
 
+// Same for helpers that only touch the state of ctx itself (x87, CPUID...),
+// other contexts stay in PTLsim format.
+#define ASSIST_IN_QEMU_CTX(func_name, ...) \
+	ctx.eip = ctx.reg_selfrip; \
+    ptl_stable_state = 1; \
+	setup_qemu_switch_ctx(ctx); \
+	func_name(__VA_ARGS__);		\
+	setup_ptlsim_switch_ctx(ctx); \
+    ptl_stable_state = 0;
+
 struct RexByte {
   // a.k.a., b, x, r, w
   byte extbase:1, extindex:1, extreg:1, mode64:1, insnbits:4;
@@ -632,6 +642,9 @@ struct BasicBlockCache: public SelfHashtable<RIPVirtPhys, BasicBlock, BB_CACHE_S
       cpuid = cpuid_counter++;
   }
 
+  BasicBlock* lookup(Context& ctx, const RIPVirtPhys& rvp);
+  BasicBlock* find(const RIPVirtPhys& rvp, W64 asid);
+  void add_shared(BasicBlock* bb);
   BasicBlock* translate(Context& ctx, const RIPVirtPhys& rvp);
   void translate_in_place(BasicBlock& targetbb, Context& ctx, Waddr rip);
   BasicBlock* translate_and_clone(Context& ctx, Waddr rip);
@@ -640,7 +653,8 @@ struct BasicBlockCache: public SelfHashtable<RIPVirtPhys, BasicBlock, BB_CACHE_S
   bool invalidate_page(Waddr mfn, int reason);
   int get_page_bb_count(Waddr mfn);
   void add_page(BasicBlock* bb);
-  int reclaim(size_t reqbytes = 0, int urgency = 0);
+  int reclaim(W64 generation);
+  BasicBlock* move(BasicBlock* bb);
   void flush(int8_t context_id);
   W8 cpuid;
   static W8 cpuid_counter;
@@ -650,8 +664,95 @@ struct BasicBlockCache: public SelfHashtable<RIPVirtPhys, BasicBlock, BB_CACHE_S
 
 extern BasicBlockCache bbcache[NUM_SIM_CORES];
 
+void bbcache_reclaim(size_t bytes = 0, int urgency = 0);
+
+//
+// With -shared-bbcache all cores use the cache of core 0. Cores only
+// look blocks up while running freely; inserts, invalidations and
+// reclaims call core_task_serialize() first, which guarantees no other
+// core runs at the same time, so lookups need no lock.
+//
+extern bool bbcache_shared;
+
+static inline BasicBlockCache& get_bbcache(int cpuid) {
+  return bbcache[(bbcache_shared) ? 0 : cpuid];
+}
+
+//
+// Address space of a block in the shared cache: kernel code is mapped
+// the same way in every address space, user code is only shared between
+// contexts with the same page table root.
+//
+static inline W64 bbcache_asid(const Context& ctx, const RIPVirtPhys& rvp) {
+  return (rvp.kernel) ? 0 : ctx.cr[3];
+}
+
 extern ofstream bbcache_dump_file;
 
+//
+// Persistent basic block cache (-bbcache-file). Each translation is
+// stored with the decoder state it depends on and a hash of its code
+// bytes. Later runs map the file and reuse a translation on a bbcache
+// miss once its code bytes are found unchanged; new translations are
+// added to the file at exit.
+//
+#define BBFILE_MAGIC "MARSSBBC"
+#define BBFILE_VERSION 2
+
+static const int BBFILE_INDEX_SIZE = 65536;
+
+struct BasicBlockFileHeader {
+  char magic[8];
+  W32 version;
+  W32 count;
+  W64 build;
+  W64 bytes;
+};
+
+struct BasicBlockFileRecord {
+  W32 size;
+  W16 codebytes;
+  byte use64, use32, ss32, kernel, df, pe, vm86, pad[3];
+  W64 rip;
+  W64 cs_base;
+  W64 hflags;
+  W64 codehash;
+  BasicBlockBase base;
+
+  const TransOp* transops() const { return (const TransOp*)(this + 1); }
+};
+
+struct BasicBlockFile {
+  stringbuf filename;
+  W64 build;
+  byte* map;
+  size_t mapsize;
+  int loaded;
+
+  // Records with the same rip are chained through next
+  dynarray<BasicBlockFileRecord*> records;
+  dynarray<int> next;
+  int index[BBFILE_INDEX_SIZE];
+
+  BasicBlockFile();
+
+  bool is_open() const { return filename.set(); }
+  void open(const char* filename);
+  void close();
+
+  const BasicBlockFileRecord* find(const TraceDecoder& trans, const byte* insnbuf, bool& stale);
+  void restore(const BasicBlockFileRecord& record, BasicBlock& bb);
+  void add(const TraceDecoder& trans, const byte* insnbuf);
+
+private:
+  void insert(BasicBlockFileRecord* record);
+  bool contains(const BasicBlockFileRecord& record);
+  int load(byte* data, size_t size, bool copy);
+  void save();
+};
+
+extern BasicBlockFile bbfile;
+
 static const char* decode_type_names[DECODE_TYPE_COUNT] = {
   "fast", "complex", "x87", "sse", "assist"
 };
@@ -669,4 +770,21 @@ extern DecoderStats* decoder_stats[NUM_SIM_CORES];
 
 void set_decoder_stats(Statable *parent, int vcpuid);
 
+//
+// Find the cached translation of rvp for ctx and count the lookup in the
+// stats of its core.
+//
+inline BasicBlock* BasicBlockCache::lookup(Context& ctx, const RIPVirtPhys& rvp) {
+  BasicBlock* bb = (bbcache_shared) ? find(rvp, bbcache_asid(ctx, rvp)) : get(rvp);
+  DecoderStats* stats = decoder_stats[ctx.cpu_index];
+
+  stats->bbcache_lookups.accesses++;
+  if likely (bb) {
+    stats->bbcache_lookups.hits++;
+    if unlikely (bb->context_id != ctx.cpu_index) stats->bbcache_lookups.cross_core_hits++;
+  }
+
+  return bb;
+}
+
 #endif // _DECODE_H_
@@ -65,6 +65,46 @@ struct DecoderStats : public Statable
     cache bbcache;
     cache pagecache;
 
+    struct lookups : public Statable
+    {
+        StatObj<W64> accesses;
+        StatObj<W64> hits;
+        StatObj<W64> cross_core_hits;
+
+        StatEquation<W64, double, StatObjFormulaDiv> hit_ratio;
+        StatEquation<W64, double, StatObjFormulaDiv> cross_core_hit_ratio;
+
+        lookups(const char* name, Statable *parent)
+            : Statable(name, parent)
+              , accesses("accesses", this)
+              , hits("hits", this)
+              , cross_core_hits("cross_core_hits", this)
+              , hit_ratio("hit_ratio", this)
+              , cross_core_hit_ratio("cross_core_hit_ratio", this)
+        {
+            hit_ratio.add_elem(&hits);
+            hit_ratio.add_elem(&accesses);
+            cross_core_hit_ratio.add_elem(&cross_core_hits);
+            cross_core_hit_ratio.add_elem(&accesses);
+        }
+    };
+
+    lookups bbcache_lookups;
+
+    struct bbfile : public Statable
+    {
+        StatObj<W64> hits;
+        StatObj<W64> misses;
+        StatObj<W64> stale;
+
+        bbfile(Statable *parent)
+            : Statable("bbfile", parent)
+              , hits("hits", this)
+              , misses("misses", this)
+              , stale("stale", this)
+        { }
+    } bbfile;
+
     StatObj<W64> reclaim_rounds;
 
     DecoderStats(Statable *parent)
@@ -75,6 +115,8 @@ struct DecoderStats : public Statable
           , page_crossings(this)
           , bbcache("bbcache", this)
           , pagecache("pagecache", this)
+          , bbcache_lookups("bbcache_lookups", this)
+          , bbfile(this)
           , reclaim_rounds("reclaim_rounds", this)
     { }
 };
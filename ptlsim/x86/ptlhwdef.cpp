@@ -496,22 +496,141 @@ void BasicBlock::reset(const RIPVirtPhys& rip) {
 // in scope. Don't call this with non-cloned() blocks.
 //
 void BasicBlock::free() {
-  if (synthops) delete[] synthops;
-  synthops = NULL;
-  ::free(this);
+  bbarena.release(this);
 }
 
+BasicBlockArena bbarena;
+
+void BasicBlockArena::new_chunk() {
+  Chunk* chunk = freelist;
+
+  if (chunk) {
+    freelist = chunk->next;
+    free_chunks--;
+  } else {
+    //
+    // Map twice the chunk size and cut an aligned chunk out of it,
+    // so chunkof() can find the chunk of any block.
+    //
+    size_t size = 2 * BB_ARENA_CHUNK_SIZE;
+    byte* raw = (byte*)mmap(NULL, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+
+    if unlikely (raw == MAP_FAILED) {
+      cerr << "Cannot map basic block arena chunk below 4 GB", endl;
+      assert(false);
+    }
+
+    byte* start = (byte*)(((Waddr)raw + BB_ARENA_CHUNK_SIZE - 1) & ~(Waddr)(BB_ARENA_CHUNK_SIZE - 1));
+    byte* end = start + BB_ARENA_CHUNK_SIZE;
+    if (start > raw) munmap(raw, start - raw);
+    if (end < raw + size) munmap(end, (raw + size) - end);
+
+#ifdef MADV_HUGEPAGE
+    madvise(start, BB_ARENA_CHUNK_SIZE, MADV_HUGEPAGE);
+#endif
+    chunk = (Chunk*)start;
+  }
+
+  chunk->prev = newest;
+  chunk->next = NULL;
+  chunk->generation = generation++;
+  chunk->used = (sizeof(Chunk) + 63) & ~63;
+  chunk->live = 0;
+
+  if (newest) newest->next = chunk;
+  else oldest = chunk;
+  newest = chunk;
+  chunks++;
+}
+
+void BasicBlockArena::retire(Chunk* chunk) {
+  if (chunk->prev) chunk->prev->next = chunk->next;
+  else oldest = chunk->next;
+  if (chunk->next) chunk->next->prev = chunk->prev;
+  else newest = chunk->prev;
+  chunks--;
+
+  if (free_chunks < BB_ARENA_MAX_FREE_CHUNKS) {
+    chunk->next = freelist;
+    freelist = chunk;
+    free_chunks++;
+  } else {
+    munmap(chunk, BB_ARENA_CHUNK_SIZE);
+  }
+}
+
+void* BasicBlockArena::alloc(size_t bytes) {
+  bytes = (bytes + 15) & ~15;
+  assert(bytes <= BB_ARENA_CHUNK_SIZE - sizeof(Chunk) - 64);
+
+  if unlikely (!newest || (newest->used + bytes > BB_ARENA_CHUNK_SIZE)) {
+    Chunk* full = newest;
+    new_chunk();
+    if (full && !full->live) retire(full);
+  }
+
+  void* p = (byte*)newest + newest->used;
+  newest->used += bytes;
+  newest->live++;
+  return p;
+}
+
+void BasicBlockArena::release(void* p) {
+  Chunk* chunk = chunkof(p);
+
+  chunk->live--;
+  assert(chunk->live >= 0);
+
+  // The newest chunk still takes new blocks
+  if (!chunk->live && chunk != newest) retire(chunk);
+}
+
+//
+// Find the first generation to keep so that freeing the older ones
+// frees at least <bytes> bytes, or half of all chunks if <bytes> is 0.
+// The newest generation is always kept.
+//
+W64 BasicBlockArena::reclaim_generation(size_t bytes) {
+  if (!newest) return 0;
+
+  int limit = (bytes) ? chunks : max(chunks / 2, 1);
+  size_t freed = 0;
+  int n = 0;
+  Chunk* chunk = oldest;
+
+  while ((chunk != newest) && (n < limit)) {
+    if (bytes && (freed >= bytes)) break;
+    freed += BB_ARENA_CHUNK_SIZE;
+    n++;
+    chunk = chunk->next;
+  }
+
+  return chunk->generation;
+}
+
+//
+// The clone has room for the execution records of its uops after them.
+// They are copied if this block has them, otherwise synth_uops_for_bb()
+// fills them in.
+//
 BasicBlock* BasicBlock::clone() {
-  BasicBlock* bb = (BasicBlock*)malloc(sizeof(BasicBlockBase) + (count * sizeof(TransOp)));
+  BasicBlock* bb = (BasicBlock*)bbarena.alloc(sizeof(BasicBlockBase) + (count * (sizeof(TransOp) + sizeof(UopExec))));
 
   memcpy(bb, this, sizeof(BasicBlockBase));
 
-  bb->synthops = NULL;
   // hashlink, mfnlo_loc, mfnhi_loc are always updated after cloning
   bb->hashlink.reset();
-  bb->use(0);
+  setzero(bb->lastused);
 
   foreach (i, count) bb->transops[i] = this->transops[i];
+
+  bb->execs = NULL;
+  if (execs) {
+    bb->execs = bb->execs_space();
+    foreach (i, count) bb->execs[i] = execs[i];
+  }
+
   return bb;
 }
 
@@ -194,9 +194,10 @@ using std::map;
 //
 
 #include <globals.h>
-extern "C" W64 sim_cycle;
+extern "C" __thread W64 sim_cycle;
 #include <logic.h>
 #include <config.h>
+#include <coreThreads.h>
 
 //
 // Exceptions:
@@ -244,6 +245,15 @@ static inline const char* exception_name(W64 exception) {
 //
 struct Context;
 
+//
+// Switch the registers of one context between PTLsim and QEMU format, for
+// QEMU code that only touches that context. Calls nest, the context is only
+// converted at the outermost pair, so a sequence of helpers and guest memory
+// accesses can share one switch. See ptlsim.cpp.
+//
+void setup_qemu_switch_ctx(Context& ctx);
+void setup_ptlsim_switch_ctx(Context& ctx);
+
 struct RIPVirtPhysBase {
   W64 rip;
   W64 mfnlo:28, use64:1, kernel:1, padlo:2, mfnhi:28, df:1, padhi:3;
@@ -787,6 +797,41 @@ struct RunstateInfo {
   W64 time[4];
 };
 
+//
+// Guest physical page of each host page backing guest RAM, filled from
+// QEMU's tlb_set_page() through ptl_add_phys_memory_mapping(). It is shared
+// by all contexts and indexed directly by host page number in two levels,
+// with leaves allocated on first use, so a lookup is two dependent loads
+// and needs no lock.
+//
+class HostPhysMap {
+public:
+  HostPhysMap() { memset(leaves, 0, sizeof(leaves)); }
+  ~HostPhysMap();
+
+  void add(Waddr host_vaddr, Waddr guest_paddr);
+
+  bool lookup(Waddr host_vaddr, Waddr& guest_paddr) const {
+    W64 page = host_vaddr >> TARGET_PAGE_BITS;
+    const W64* leaf = (page < PAGE_COUNT) ? leaves[page >> LEAF_BITS] : NULL;
+    W64 entry = (leaf) ? leaf[page & (LEAF_SIZE - 1)] : 0;
+    guest_paddr = (entry & TARGET_PAGE_MASK) + (host_vaddr & ~TARGET_PAGE_MASK);
+    return entry != 0;
+  }
+
+private:
+  // Host user space addresses are below 2^47
+  static const int HOST_VADDR_BITS = 47;
+  static const int LEAF_BITS = 18;
+  static const W64 PAGE_COUNT = 1ULL << (HOST_VADDR_BITS - TARGET_PAGE_BITS);
+  static const W64 LEAF_SIZE = 1ULL << LEAF_BITS;
+
+  // Entries are guest page | 1, zero when not mapped
+  W64* leaves[PAGE_COUNT >> LEAF_BITS];
+};
+
+extern HostPhysMap host_phys_map;
+
 //
 // This is the complete x86 user-visible context for a single VCPU.
 // It includes both the renamable registers (commitarf) as well as
@@ -829,7 +874,14 @@ struct Context: public CPUX86State {
   W64 reg_fpstack;
   W64 page_fault_addr;
   W64 exec_fault_addr;
-  map<Waddr, Waddr> hvirt_gphys_map;
+
+  // Open setup_qemu_switch_ctx() calls, registers are in QEMU format while
+  // this is not zero. New contexts belong to QEMU.
+  int qemu_sections;
+
+  // CPU reached its warming window, its emulated accesses and branches
+  // warm the simulated machine
+  bool warming;
 
 
   void change_runstate(int new_state) { running = new_state; }
@@ -845,6 +897,7 @@ struct Context: public CPUX86State {
   }
 
   void setup_qemu_switch() {
+	  core_task_serialize();
 	  old_eip = eip;
 	  set_eip_qemu();
 	  set_cpu_env((CPUX86State*)this);
@@ -914,19 +967,36 @@ struct Context: public CPUX86State {
 
   int get_phys_memory_address(Waddr host_vaddr, Waddr &guest_paddr)
   {
-    map<Waddr, Waddr>::iterator it;
-    if ((it = hvirt_gphys_map.find(host_vaddr & TARGET_PAGE_MASK)) == hvirt_gphys_map.end())
-    {
-      guest_paddr=0;
+    if (!host_phys_map.lookup(host_vaddr, guest_paddr)) {
+      guest_paddr = 0;
       return -1;
     }
-
-    guest_paddr = it->second + (host_vaddr & ~TARGET_PAGE_MASK);
     return 0;
   }
 
   int copy_from_vm(void* target, Waddr source, int bytes) ;
 
+  /*
+   * Host address of guest RAM at virtaddr if the TLB maps it as plain RAM
+   * for the whole access, in which case QEMU would access it directly too
+   */
+  bool get_ram_host_addr(Waddr virtaddr, int bytes, bool store,
+		  Waddr& hostaddr) {
+	  int mmu_idx = kernel_mode ? 0 : MMU_USER_IDX;
+	  int index = (virtaddr >> TARGET_PAGE_BITS) & (CPU_TLB_SIZE - 1);
+	  CPUTLBEntry *tlb_entry = &tlb_table[mmu_idx][index];
+	  target_ulong tlb_addr = store ? tlb_entry->addr_write :
+		  tlb_entry->addr_read;
+
+	  if((virtaddr & TARGET_PAGE_MASK) != tlb_addr)
+		  return false;
+	  if(((virtaddr + bytes - 1) & TARGET_PAGE_MASK) != tlb_addr)
+		  return false;
+
+	  hostaddr = virtaddr + tlb_entry->addend;
+	  return true;
+  }
+
   W64 loadvirt(Waddr virtaddr, int sizeshift=3);
   W64 loadphys(Waddr addr, bool internal=0, int sizeshift=3);
 
@@ -952,10 +1022,13 @@ struct Context: public CPUX86State {
       ram_addr = qemu_ram_addr_from_host_nofail((void*)ram_addr);
 		  // (unsigned long)(phys_ram_base);
 
+	  if unlikely (core_task_deferring())
+		  return coreThreads.smc_isdirty(ram_addr);
+
 	  bool dirty = false;
-	  setup_qemu_switch();
+	  setup_qemu_switch_ctx(*this);
 	  dirty = cpu_physical_memory_is_dirty(ram_addr);
-	  setup_ptlsim_switch();
+	  setup_ptlsim_switch_ctx(*this);
 
 	  return dirty;
   }
@@ -976,9 +1049,15 @@ struct Context: public CPUX86State {
       ram_addr = qemu_ram_addr_from_host_nofail((void*)ram_addr);
 		  // (unsigned long)(phys_ram_base);
 
-	  setup_qemu_switch();
+	  if unlikely (core_task_deferring()) {
+		  if(!coreThreads.smc_isdirty(ram_addr))
+			  coreThreads.defer_smc_dirty(ram_addr);
+		  return;
+	  }
+
+	  setup_qemu_switch_ctx(*this);
 	  cpu_physical_memory_set_dirty(ram_addr);
-	  setup_ptlsim_switch();
+	  setup_ptlsim_switch_ctx(*this);
   }
 
   void smc_cleardirty(Waddr virtaddr) {
@@ -987,7 +1066,16 @@ struct Context: public CPUX86State {
 
   void init();
 
-  Context() : invalid_reg(-1), reg_zero(0), reg_ctx((Waddr)this) { }
+  // The QEMU state starts zeroed, as QEMU allocates it with qemu_mallocz()
+  Context() : CPUX86State(), use32(0), use64(0), kernel_mode(0), running(0),
+    dirty(0), virt_addr_mask(0), internal_eflags(0), old_eip(0),
+    cycles_at_last_mode_switch(0), insns_at_last_mode_switch(0),
+    user_instructions_commited(0), kernel_instructions_commited(0),
+    exception(0), reg_trace(0), reg_selfrip(0), reg_nextrip(0), reg_ar1(0),
+    reg_ar2(0), invalid_reg(-1), reg_zero(0), reg_ctx((Waddr)this),
+    reg_fptag(0), reg_flags(0), reg_fptos(0), reg_fpstack(0),
+    page_fault_addr(0), exec_fault_addr(0), qemu_sections(1),
+    warming(0) { }
 
   W64 virt_to_pte_phys_addr(Waddr virtaddr, byte& level);
 
@@ -1603,6 +1691,17 @@ struct BasicBlock;
 
 typedef void (*uopimpl_func_t)(IssueState& state, W64 ra, W64 rb, W64 rc, W16 raflags, W16 rbflags, W16 rcflags);
 
+//
+// Execution record of a uop, resolved once per basic block by
+// synth_uops_for_bb(). Conditional branches also get the code for
+// the inverted condition, so the cores can flip a predicted or
+// mispredicted branch without looking it up again.
+//
+struct UopExec {
+  uopimpl_func_t synthop;
+  uopimpl_func_t invsynthop;
+};
+
 
 //
 // List of all BBs on a physical page (for SMC invalidation)
@@ -1698,23 +1797,32 @@ struct BasicBlockBase {
   byte type:4, repblock:1, invalidblock:1, call:1, ret:1;
   byte marked:1, mfence:1, x87:1, sse:1, nondeterministic:1, brtype:3;
   W64 usedregs;
-  uopimpl_func_t* synthops;
+  UopExec* execs;
   int refcount;
   W32 hitcount;
   W32 predcount;
   W32 confidence;
-  W64 lastused;
+  // Each core stamps its own slot, so cores sharing a block never race
+  W64 lastused[NUM_SIM_CORES];
   W64 lasttarget;
+  W64 asid;
   W16 context_id;
 
+  // Cores sharing a block may acquire and release it from several threads
   void acquire() {
-    refcount++;
+    xadd(refcount, 1);
   }
 
   bool release() {
-    refcount--;
-    assert(refcount >= 0);
-    return (!refcount);
+    int old = xadd(refcount, -1);
+    assert(old > 0);
+    return (old == 1);
+  }
+
+  W64 last_use() const {
+    W64 last = 0;
+    foreach (i, NUM_SIM_CORES) last = max(last, lastused[i]);
+    return last;
   }
 };
 
@@ -1725,11 +1833,69 @@ struct BasicBlock: public BasicBlockBase {
   void reset(const RIPVirtPhys& rip);
   BasicBlock* clone();
   void free();
-  void use(W64 counter) { lastused = counter; };
+  void use(W64 counter, int cpuid) { lastused[cpuid] = counter; };
+
+  // Execution records, kept right after the uops of a clone()d block
+  UopExec* execs_space() { return (UopExec*)&transops[count]; }
 };
 
 ostream& operator <<(ostream& os, const BasicBlock& bb);
 
+//
+// Cached basic blocks only hold the uops they decoded, followed by their
+// execution records. They are carved, in translation order, out of large
+// chunks mapped below 4 GB (the page lists keep 32-bit block pointers).
+// Each chunk is one generation: freeing a block only counts it as dead,
+// and a chunk is recycled as a whole once all its blocks are dead.
+//
+static const size_t BB_ARENA_CHUNK_SIZE = 2 * 1024 * 1024;
+static const int BB_ARENA_MAX_CHUNKS = 128;
+static const int BB_ARENA_MAX_FREE_CHUNKS = 4;
+
+struct BasicBlockArena {
+  struct Chunk {
+    Chunk* prev;
+    Chunk* next;
+    W64 generation;
+    size_t used;
+    int live;
+  };
+
+  // Chunks from oldest to newest generation, blocks come from the newest
+  Chunk* oldest;
+  Chunk* newest;
+  Chunk* freelist;
+  int chunks;
+  int free_chunks;
+  W64 generation;
+  W64 last_reclaim;
+
+  BasicBlockArena() {
+    oldest = newest = freelist = NULL;
+    chunks = free_chunks = 0;
+    generation = 0;
+    last_reclaim = 0;
+  }
+
+  void* alloc(size_t bytes);
+  void release(void* p);
+  W64 reclaim_generation(size_t bytes);
+
+  static Chunk* chunkof(const void* p) {
+    return (Chunk*)((Waddr)p & ~(Waddr)(BB_ARENA_CHUNK_SIZE - 1));
+  }
+
+  static W64 generation_of(const void* p) {
+    return chunkof(p)->generation;
+  }
+
+private:
+  void new_chunk();
+  void retire(Chunk* chunk);
+};
+
+extern BasicBlockArena bbarena;
+
 //
 // Printing and information
 //
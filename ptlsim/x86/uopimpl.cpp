@@ -1788,12 +1788,17 @@ uopimpl_func_t get_synthcode_for_uop(int op, int size, bool setflags, int cond,
   return func;
 }
 
+//
+// Fill in the execution records of a block made by BasicBlock::clone()
+//
 void synth_uops_for_bb(BasicBlock& bb) {
-  bb.synthops = new uopimpl_func_t[bb.count];
+  bb.execs = bb.execs_space();
   foreach (i, bb.count) {
     const TransOp& transop = bb.transops[i];
-    uopimpl_func_t func = get_synthcode_for_uop(transop.opcode, transop.size, transop.setflags, transop.cond, transop.extshift, 0, transop.internal);
-    bb.synthops[i] = func;
+    UopExec& exec = bb.execs[i];
+    exec.synthop = get_synthcode_for_uop(transop.opcode, transop.size, transop.setflags, transop.cond, transop.extshift, 0, transop.internal);
+    exec.invsynthop = (isclass(transop.opcode, OPCLASS_COND_BRANCH))
+      ? get_synthcode_for_cond_branch(transop.opcode, invert_cond(transop.cond), transop.size, 0) : NULL;
   }
 }
 
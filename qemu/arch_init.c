@@ -246,6 +246,25 @@ static void sort_ram_list(void)
     qemu_free(blocks);
 }
 
+#ifdef MARSS_QEMU
+/* Save VM states without guest RAM, ptlsim saves the pages of delta
+ * checkpoints in its own files */
+int ram_save_skip_pages = 0;
+#endif
+
+static void ram_save_block_list(QEMUFile *f)
+{
+    RAMBlock *block;
+
+    qemu_put_be64(f, ram_bytes_total() | RAM_SAVE_FLAG_MEM_SIZE);
+
+    QLIST_FOREACH(block, &ram_list.blocks, next) {
+        qemu_put_byte(f, strlen(block->idstr));
+        qemu_put_buffer(f, (uint8_t *)block->idstr, strlen(block->idstr));
+        qemu_put_be64(f, block->length);
+    }
+}
+
 int ram_save_live(Monitor *mon, QEMUFile *f, int stage, void *opaque)
 {
     ram_addr_t addr;
@@ -263,6 +282,18 @@ int ram_save_live(Monitor *mon, QEMUFile *f, int stage, void *opaque)
         return 0;
     }
 
+#ifdef MARSS_QEMU
+    if (ram_save_skip_pages) {
+        /* Only the block list is saved, the dirty bitmap is left as is */
+        if (stage == 1) {
+            sort_ram_list();
+            ram_save_block_list(f);
+        }
+        qemu_put_be64(f, RAM_SAVE_FLAG_EOS);
+        return 1;
+    }
+#endif
+
     if (stage == 1) {
         RAMBlock *block;
         bytes_transferred = 0;
@@ -284,13 +315,7 @@ int ram_save_live(Monitor *mon, QEMUFile *f, int stage, void *opaque)
         /* Enable dirty memory tracking */
         cpu_physical_memory_set_dirty_tracking(1);
 
-        qemu_put_be64(f, ram_bytes_total() | RAM_SAVE_FLAG_MEM_SIZE);
-
-        QLIST_FOREACH(block, &ram_list.blocks, next) {
-            qemu_put_byte(f, strlen(block->idstr));
-            qemu_put_buffer(f, (uint8_t *)block->idstr, strlen(block->idstr));
-            qemu_put_be64(f, block->length);
-        }
+        ram_save_block_list(f);
     }
 
     bytes_transferred_last = bytes_transferred;
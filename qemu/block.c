@@ -1518,6 +1518,111 @@ void bdrv_flush_all(void)
     }
 }
 
+#ifdef MARSS_QEMU
+/*
+ * Move the open image of bs into a new anonymous BlockDriverState that
+ * becomes the read-only backing of a temporary qcow2 overlay opened in bs.
+ * Devices keep using bs, all later writes go to the overlay.
+ */
+static int bdrv_freeze(BlockDriverState *bs)
+{
+    BlockDriverState *base;
+    BlockDriver *bdrv_qcow2;
+    QEMUOptionParameter *options;
+    char tmp_filename[PATH_MAX];
+    int64_t total_size;
+    int ret;
+
+    total_size = bdrv_getlength(bs);
+    if (total_size < 0) {
+        return total_size;
+    }
+
+    get_tmp_filename(tmp_filename, sizeof(tmp_filename));
+
+    /* The backing file name is only informative, base is attached below */
+    bdrv_qcow2 = bdrv_find_format("qcow2");
+    options = parse_option_parameters("", bdrv_qcow2->create_options, NULL);
+    set_option_parameter_int(options, BLOCK_OPT_SIZE,
+                             total_size & BDRV_SECTOR_MASK);
+    set_option_parameter(options, BLOCK_OPT_BACKING_FILE, bs->filename);
+    ret = bdrv_create(bdrv_qcow2, tmp_filename, options);
+    free_option_parameters(options);
+    if (ret < 0) {
+        return ret;
+    }
+
+    base = bdrv_new("");
+    base->total_sectors = bs->total_sectors;
+    base->read_only = 1;
+    base->keep_read_only = 1;
+    base->open_flags = bs->open_flags;
+    base->encrypted = bs->encrypted;
+    base->valid_key = bs->valid_key;
+    base->sg = bs->sg;
+    base->drv = bs->drv;
+    base->opaque = bs->opaque;
+    pstrcpy(base->filename, sizeof(base->filename), bs->filename);
+    pstrcpy(base->backing_file, sizeof(base->backing_file), bs->backing_file);
+    pstrcpy(base->backing_format, sizeof(base->backing_format),
+            bs->backing_format);
+    base->is_temporary = bs->is_temporary;
+    base->backing_hd = bs->backing_hd;
+    base->file = bs->file;
+    base->growable = bs->growable;
+    base->buffer_alignment = bs->buffer_alignment;
+    base->enable_write_cache = bs->enable_write_cache;
+
+    bs->is_temporary = 1;
+    ret = bdrv_open_common(bs, tmp_filename, base->open_flags | BDRV_O_RDWR,
+                           bdrv_qcow2);
+    if (ret < 0) {
+        unlink(tmp_filename);
+
+        /* bdrv_open_common already dropped its own state, put back base */
+        bs->total_sectors = base->total_sectors;
+        bs->open_flags = base->open_flags;
+        bs->encrypted = base->encrypted;
+        bs->valid_key = base->valid_key;
+        bs->drv = base->drv;
+        bs->opaque = base->opaque;
+        pstrcpy(bs->filename, sizeof(bs->filename), base->filename);
+        pstrcpy(bs->backing_file, sizeof(bs->backing_file),
+                base->backing_file);
+        bs->is_temporary = base->is_temporary;
+        bs->file = base->file;
+        bs->buffer_alignment = base->buffer_alignment;
+        qemu_free(base);
+        return ret;
+    }
+
+    bs->backing_hd = base;
+    return 0;
+}
+
+/*
+ * Freeze all writable drives, so a forked child and its parent each write
+ * their own overlay on top of the images at fork time.
+ */
+int bdrv_freeze_all(void)
+{
+    BlockDriverState *bs;
+    int ret;
+
+    QTAILQ_FOREACH(bs, &bdrv_states, list) {
+        if (bs->drv && !bdrv_is_read_only(bs) && !bs->sg &&
+            (!bdrv_is_removable(bs) || bdrv_is_inserted(bs))) {
+            ret = bdrv_freeze(bs);
+            if (ret < 0) {
+                return ret;
+            }
+        }
+    }
+
+    return 0;
+}
+#endif
+
 int bdrv_has_zero_init(BlockDriverState *bs)
 {
     assert(bs->drv);
@@ -145,6 +145,9 @@ BlockDriverAIOCB *bdrv_aio_ioctl(BlockDriverState *bs,
 /* Ensure contents are flushed to disk.  */
 int bdrv_flush(BlockDriverState *bs);
 void bdrv_flush_all(void);
+#ifdef MARSS_QEMU
+int bdrv_freeze_all(void);
+#endif
 void bdrv_close_all(void);
 
 int bdrv_discard(BlockDriverState *bs, int64_t sector_num, int nb_sectors);
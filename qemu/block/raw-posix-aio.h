@@ -27,6 +27,9 @@
 
 /* posix-aio-compat.c - thread pool based implementation */
 int paio_init(void);
+#ifdef MARSS_QEMU
+void paio_fork_child(void);
+#endif
 BlockDriverAIOCB *paio_submit(BlockDriverState *bs, int fd,
         int64_t sector_num, QEMUIOVector *qiov, int nb_sectors,
         BlockDriverCompletionFunc *cb, void *opaque, int type);
@@ -614,6 +614,45 @@ BlockDriverAIOCB *paio_ioctl(BlockDriverState *bs, int fd,
     return &acb->common;
 }
 
+#ifdef MARSS_QEMU
+/*
+ * In a forked child the worker threads of the parent are gone and the
+ * notification pipe is shared with the parent, so start over with a new
+ * pipe and no threads.  No request may be in flight at fork time.
+ */
+void paio_fork_child(void)
+{
+    PosixAioState *s = posix_aio_state;
+    int fds[2];
+
+    if (!s)
+        return;
+
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+    cur_threads = 0;
+    idle_threads = 0;
+    QTAILQ_INIT(&request_list);
+
+    qemu_aio_set_fd_handler(s->rfd, NULL, NULL, NULL, NULL, NULL);
+    close(s->rfd);
+    close(s->wfd);
+
+    if (qemu_pipe(fds) == -1) {
+        die("pipe");
+    }
+
+    s->rfd = fds[0];
+    s->wfd = fds[1];
+
+    fcntl(s->rfd, F_SETFL, O_NONBLOCK);
+    fcntl(s->wfd, F_SETFL, O_NONBLOCK);
+
+    qemu_aio_set_fd_handler(s->rfd, posix_aio_read, NULL, posix_aio_flush,
+        posix_aio_process_queue, s);
+}
+#endif
+
 int paio_init(void)
 {
     struct sigaction act;
@@ -1128,6 +1128,26 @@ fail:
     return err;
 }
 
+#ifdef MARSS_QEMU
+/* Host timers are not inherited by a forked child, start its own one */
+void fork_child_timer_alarm(void)
+{
+    struct qemu_alarm_timer *t = alarm_timer;
+
+    if (!t)
+        return;
+
+    if (t->start(t)) {
+        fprintf(stderr, "Failed to restart %s alarm timer after fork\n",
+                t->name);
+        return;
+    }
+
+    t->pending = 1;
+    qemu_rearm_alarm_timer(t);
+}
+#endif
+
 void quit_timers(void)
 {
     struct qemu_alarm_timer *t = alarm_timer;
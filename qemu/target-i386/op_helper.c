@@ -614,6 +614,21 @@ void helper_simpoint(void)
      * to handle this 'simpoint'. */
     ptl_simpoint_reached(env->cpu_index);
 }
+
+void helper_warm_access(target_ulong addr, uint32_t is_write)
+{
+    ptl_warm_access(env, addr, is_write);
+}
+
+void helper_warm_fetch(target_ulong pc)
+{
+    ptl_warm_fetch(env, pc);
+}
+
+void helper_warm_branch(target_ulong branchaddr, uint32_t type)
+{
+    ptl_warm_branch(env, branchaddr, type);
+}
 #endif
 
 static inline unsigned int get_sp_mask(unsigned int e2)
@@ -496,9 +496,57 @@ static inline void gen_op_addq_A0_reg_sN(int shift, int reg)
 }
 #endif
 
+#ifdef MARSS_QEMU
+/* Functional warming: pass memory accesses and branches to PTLsim */
+static inline void gen_warm_access(TCGv a0, int is_write)
+{
+    TCGv_i32 t;
+
+    if (likely(!ptl_warm_enabled))
+        return;
+
+    t = tcg_const_i32(is_write);
+    gen_helper_warm_access(a0, t);
+    tcg_temp_free_i32(t);
+}
+
+static inline void gen_warm_fetch(target_ulong pc)
+{
+    TCGv t;
+
+    if (likely(!ptl_warm_enabled))
+        return;
+
+    t = tcg_const_tl(pc);
+    gen_helper_warm_fetch(t);
+    tcg_temp_free(t);
+}
+
+/* Branch ending at s->pc, its target is the next fetched rip */
+static inline void gen_warm_branch(DisasContext *s, int type)
+{
+    TCGv t;
+    TCGv_i32 t_type;
+
+    if (likely(!ptl_warm_enabled))
+        return;
+
+    t = tcg_const_tl(s->pc);
+    t_type = tcg_const_i32(type);
+    gen_helper_warm_branch(t, t_type);
+    tcg_temp_free(t);
+    tcg_temp_free_i32(t_type);
+}
+#else
+#define gen_warm_access(a0, is_write)
+#define gen_warm_fetch(pc)
+#define gen_warm_branch(s, type)
+#endif
+
 static inline void gen_op_lds_T0_A0(int idx)
 {
     int mem_index = (idx >> 2) - 1;
+    gen_warm_access(cpu_A0, 0);
     switch(idx & 3) {
     case 0:
         tcg_gen_qemu_ld8s(cpu_T[0], cpu_A0, mem_index);
@@ -516,6 +564,7 @@ static inline void gen_op_lds_T0_A0(int idx)
 static inline void gen_op_ld_v(int idx, TCGv t0, TCGv a0)
 {
     int mem_index = (idx >> 2) - 1;
+    gen_warm_access(a0, 0);
     switch(idx & 3) {
     case 0:
         tcg_gen_qemu_ld8u(t0, a0, mem_index);
@@ -555,6 +604,7 @@ static inline void gen_op_ld_T1_A0(int idx)
 static inline void gen_op_st_v(int idx, TCGv t0, TCGv a0)
 {
     int mem_index = (idx >> 2) - 1;
+    gen_warm_access(a0, 1);
     switch(idx & 3) {
     case 0:
         tcg_gen_qemu_st8(t0, a0, mem_index);
@@ -2720,6 +2770,7 @@ static void gen_jmp(DisasContext *s, target_ulong eip)
 static inline void gen_ldq_env_A0(int idx, int offset)
 {
     int mem_index = (idx >> 2) - 1;
+    gen_warm_access(cpu_A0, 0);
     tcg_gen_qemu_ld64(cpu_tmp1_i64, cpu_A0, mem_index);
     tcg_gen_st_i64(cpu_tmp1_i64, cpu_env, offset);
 }
@@ -2727,6 +2778,7 @@ static inline void gen_ldq_env_A0(int idx, int offset)
 static inline void gen_stq_env_A0(int idx, int offset)
 {
     int mem_index = (idx >> 2) - 1;
+    gen_warm_access(cpu_A0, 1);
     tcg_gen_ld_i64(cpu_tmp1_i64, cpu_env, offset);
     tcg_gen_qemu_st64(cpu_tmp1_i64, cpu_A0, mem_index);
 }
@@ -2734,6 +2786,7 @@ static inline void gen_stq_env_A0(int idx, int offset)
 static inline void gen_ldo_env_A0(int idx, int offset)
 {
     int mem_index = (idx >> 2) - 1;
+    gen_warm_access(cpu_A0, 0);
     tcg_gen_qemu_ld64(cpu_tmp1_i64, cpu_A0, mem_index);
     tcg_gen_st_i64(cpu_tmp1_i64, cpu_env, offset + offsetof(XMMReg, XMM_Q(0)));
     tcg_gen_addi_tl(cpu_tmp0, cpu_A0, 8);
@@ -2744,6 +2797,7 @@ static inline void gen_ldo_env_A0(int idx, int offset)
 static inline void gen_sto_env_A0(int idx, int offset)
 {
     int mem_index = (idx >> 2) - 1;
+    gen_warm_access(cpu_A0, 1);
     tcg_gen_ld_i64(cpu_tmp1_i64, cpu_env, offset + offsetof(XMMReg, XMM_Q(0)));
     tcg_gen_qemu_st64(cpu_tmp1_i64, cpu_A0, mem_index);
     tcg_gen_addi_tl(cpu_tmp0, cpu_A0, 8);
@@ -4624,6 +4678,7 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
             if (s->dflag == 0)
                 gen_op_andl_T0_ffff();
             next_eip = s->pc - s->cs_base;
+            gen_warm_branch(s, PTL_WARM_BRANCH_INDIRECT | PTL_WARM_BRANCH_CALL);
             gen_movtl_T1_im(next_eip);
             gen_push_T1(s);
             gen_op_jmp_T0();
@@ -4653,6 +4708,7 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
         case 4: /* jmp Ev */
             if (s->dflag == 0)
                 gen_op_andl_T0_ffff();
+            gen_warm_branch(s, PTL_WARM_BRANCH_INDIRECT);
             gen_op_jmp_T0();
             gen_eob(s);
             break;
@@ -6174,6 +6230,7 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
     case 0xc2: /* ret im */
         val = ldsw_code(s->pc);
         s->pc += 2;
+        gen_warm_branch(s, PTL_WARM_BRANCH_INDIRECT | PTL_WARM_BRANCH_RET);
         gen_pop_T0(s);
         if (CODE64(s) && s->dflag)
             s->dflag = 2;
@@ -6184,6 +6241,7 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
         gen_eob(s);
         break;
     case 0xc3: /* ret */
+        gen_warm_branch(s, PTL_WARM_BRANCH_INDIRECT | PTL_WARM_BRANCH_RET);
         gen_pop_T0(s);
         gen_pop_update(s);
         if (s->dflag == 0)
@@ -6257,6 +6315,7 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
                 tval &= 0xffff;
             else if(!CODE64(s))
                 tval &= 0xffffffff;
+            gen_warm_branch(s, PTL_WARM_BRANCH_CALL);
             gen_movtl_T0_im(next_eip);
             gen_push_T0(s);
             gen_jmp(s, tval);
@@ -6286,6 +6345,7 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
             tval &= 0xffff;
         else if(!CODE64(s))
             tval &= 0xffffffff;
+        gen_warm_branch(s, PTL_WARM_BRANCH_UNCOND);
         gen_jmp(s, tval);
         break;
     case 0xea: /* ljmp im */
@@ -6307,6 +6367,7 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
         tval += s->pc - s->cs_base;
         if (s->dflag == 0)
             tval &= 0xffff;
+        gen_warm_branch(s, PTL_WARM_BRANCH_UNCOND);
         gen_jmp(s, tval);
         break;
     case 0x70 ... 0x7f: /* jcc Jb */
@@ -6323,6 +6384,7 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
         tval += next_eip;
         if (s->dflag == 0)
             tval &= 0xffff;
+        gen_warm_branch(s, PTL_WARM_BRANCH_COND);
         gen_jcc(s, b, tval, next_eip);
         break;
 
@@ -6807,6 +6869,7 @@ static target_ulong disas_insn(DisasContext *s, target_ulong pc_start)
             tval += next_eip;
             if (s->dflag == 0)
                 tval &= 0xffff;
+            gen_warm_branch(s, PTL_WARM_BRANCH_COND);
 
             l1 = gen_new_label();
             l2 = gen_new_label();
@@ -7772,6 +7835,9 @@ static inline void gen_intermediate_code_internal(CPUState *env,
     target_ulong cs_base;
     int num_insns;
     int max_insns;
+#ifdef MARSS_QEMU
+    target_ulong warm_fetch_pc = 0;
+#endif
 
     /* generate intermediate code */
     pc_start = tb->pc;
@@ -7876,6 +7942,14 @@ static inline void gen_intermediate_code_internal(CPUState *env,
 
 #if 1 /* yclin */
         code_marker_insn_begin();
+#endif
+#ifdef MARSS_QEMU
+        /* Warm instruction fetch once per cache line of the block */
+        if (num_insns == 0 ||
+                (pc_ptr >> PTL_WARM_LINE_BITS) != (warm_fetch_pc >> PTL_WARM_LINE_BITS)) {
+            gen_warm_fetch(pc_ptr);
+            warm_fetch_pc = pc_ptr;
+        }
 #endif
         pc_ptr = disas_insn(dc, pc_ptr);
         num_insns++;
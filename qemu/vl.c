@@ -3164,7 +3164,11 @@ int main(int argc, char **argv, char **envp)
 
     qemu_system_reset();
     if (loadvm) {
+#ifdef MARSS_QEMU
+        if (ptl_load_checkpoint(loadvm) < 0) {
+#else
         if (load_vmstate(loadvm) < 0) {
+#endif
             autostart = 0;
         }
     }
@@ -0,0 +1,160 @@
+#!/usr/bin/env python
+
+#
+# This script checks that a checkpoint simulates to the same statistics when
+# cores run on one host thread and when they run on several ('-core-threads'
+# simconfig option). It runs the checkpoint once for each thread count and
+# compares the YAML statistics, ignoring host specific sections. With
+# '--quantum' all runs use that '-sync-quantum' value.
+#
+# Without a quantum the checkpoint is also run with the legacy single threaded
+# loop ('-core-threads 0') as a baseline, all runs have to match it exactly.
+# A quantum lets cores run ahead of each other, so it has no baseline.
+#
+# Example:
+#   compare_core_threads.py -q qemu/qemu-system-x86_64 -i disk.qcow2 \
+#       -c chk1 -m 4 -t 1,4 -s "-machine shared_l2 -stopinsns 10m"
+#
+
+import os
+import sys
+import tempfile
+import subprocess
+
+from optparse import OptionParser
+
+try:
+    import yaml
+except (ImportError, NotImplementedError):
+    path = os.path.dirname(sys.argv[0])
+    a_path = os.path.abspath(path)
+    sys.path.append("%s/../ptlsim/lib/python" % a_path)
+    import yaml
+
+try:
+    from yaml import CLoader as Loader
+except:
+    from yaml import Loader
+
+opt_parser = OptionParser("Usage: %prog [options]")
+opt_parser.add_option("-q", "--qemu", dest="qemu",
+        default="qemu/qemu-system-x86_64", help="QEMU binary of MARSS")
+opt_parser.add_option("-i", "--image", dest="image", help="qcow2 disk image")
+opt_parser.add_option("-c", "--checkpoint", dest="checkpoint",
+        help="Checkpoint name stored in disk image")
+opt_parser.add_option("-m", "--smp", dest="smp", default="4",
+        help="Number of simulated cores")
+opt_parser.add_option("--mem", dest="mem", default="1G",
+        help="Guest memory size")
+opt_parser.add_option("-t", "--threads", dest="threads", default="1,4",
+        help="',' seperated list of -core-threads values to compare")
+opt_parser.add_option("-Q", "--quantum", dest="quantum", type="int",
+        default=0, help="-sync-quantum value used for all runs")
+opt_parser.add_option("-s", "--simconfig", dest="simconfig", default="",
+        help="Additional simconfig options used for all runs")
+opt_parser.add_option("-x", "--ignore", dest="ignore",
+        default="simulator,core_threads",
+        help="',' seperated list of top level stats to ignore")
+opt_parser.add_option("-b", "--no-baseline", dest="baseline",
+        action="store_false", default=True,
+        help="Don't compare with the legacy single threaded loop")
+opt_parser.add_option("-k", "--keep", dest="keep", action="store_true",
+        default=False, help="Keep generated stats files")
+
+def run_checkpoint(options, threads, stats_file):
+    # The legacy loop ignores -sync-quantum
+    quantum = threads and options.quantum or 0
+    simconfig = "-run -kill-after-run -quiet -core-threads %d " \
+            "-sync-quantum %d -yamlstats %s %s\n" % (threads,
+                    quantum, stats_file, options.simconfig)
+
+    cfg_fd, cfg_name = tempfile.mkstemp(prefix="simconfig-", suffix=".cfg")
+    os.write(cfg_fd, simconfig)
+    os.close(cfg_fd)
+
+    cmd = [options.qemu, "-m", options.mem, "-smp", options.smp,
+            "-snapshot", "-nographic", "-hda", options.image,
+            "-loadvm", options.checkpoint, "-simconfig", cfg_name]
+    print("Running: %s" % " ".join(cmd))
+
+    ret = subprocess.call(cmd, stdin=open(os.devnull))
+    os.remove(cfg_name)
+
+    if ret != 0 or not os.path.exists(stats_file):
+        print("Simulation with %d core threads failed" % threads)
+        sys.exit(-1)
+
+def load_stats(stats_file, ignore):
+    docs = []
+    for doc in yaml.load_all(open(stats_file, "r"), Loader=Loader):
+        if isinstance(doc, dict):
+            for key in ignore:
+                doc.pop(key, None)
+        docs.append(doc)
+    return docs
+
+def compare(a, b, path, diffs):
+    if isinstance(a, dict) and isinstance(b, dict):
+        for key in sorted(set(a.keys()) | set(b.keys())):
+            compare(a.get(key), b.get(key), "%s.%s" % (path, key), diffs)
+    elif isinstance(a, list) and isinstance(b, list) and len(a) == len(b):
+        for i in range(len(a)):
+            compare(a[i], b[i], "%s[%d]" % (path, i), diffs)
+    elif a != b:
+        diffs.append((path, a, b))
+
+def report(a, b, a_name, b_name):
+    diffs = []
+    compare(a, b, "stats", diffs)
+    if diffs:
+        print("%d differences between %s and %s:" % (len(diffs), a_name,
+            b_name))
+        for path, x, y in diffs[:50]:
+            print("  %s: %s != %s" % (path, x, y))
+        return False
+
+    print("Stats with %s and %s are identical" % (a_name, b_name))
+    return True
+
+if __name__ == "__main__":
+    (options, args) = opt_parser.parse_args()
+
+    if not options.image or not options.checkpoint:
+        opt_parser.print_help()
+        sys.exit(-1)
+
+    threads = [int(t) for t in options.threads.split(",")]
+    ignore = [x.strip() for x in options.ignore.split(",") if x.strip()]
+
+    if options.quantum > 1:
+        options.baseline = False
+    if options.baseline:
+        threads = [t for t in threads if t != 0]
+
+    stats = []
+    for t in threads:
+        stats_file = "%s-core-threads-%d.yml" % (options.checkpoint, t)
+        run_checkpoint(options, t, stats_file)
+        stats.append(load_stats(stats_file, ignore))
+        if not options.keep:
+            os.remove(stats_file)
+
+    failed = False
+    for i in range(1, len(threads)):
+        if not report(stats[0], stats[i], "%d core threads" % threads[0],
+                "%d core threads" % threads[i]):
+            failed = True
+
+    if options.baseline:
+        stats_file = "%s-core-threads-0.yml" % options.checkpoint
+        run_checkpoint(options, 0, stats_file)
+        baseline = load_stats(stats_file, ignore)
+        if not options.keep:
+            os.remove(stats_file)
+
+        for i in range(len(threads)):
+            if not report(baseline, stats[i], "the legacy loop",
+                    "%d core threads" % threads[i]):
+                failed = True
+
+    sys.exit(failed and 1 or 0)
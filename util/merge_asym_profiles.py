@@ -0,0 +1,100 @@
+#!/usr/bin/env python
+
+#
+# This script merges the DRAM access profiles written with the
+# 'asym_map_profiling' option (<logfile>.dat) by several runs into one
+# profile, summing the access count of each row slot. All inputs must come
+# from the same memory geometry. Profiles without header, written by older
+# versions, are accepted if they have the same number of counts.
+#
+# Example:
+#   merge_asym_profiles.py -o merged.dat run1.log.dat run2.log.dat
+#
+
+import sys
+import struct
+import array
+
+from optparse import OptionParser
+
+MAGIC = b"MARSSMAP"
+VERSION = 1
+
+# magic, version, cluster/group/index width, count
+HEADER = struct.Struct("=8sIIIIQ")
+COUNT_MAX = 2 ** 31 - 1
+
+opt_parser = OptionParser("Usage: %prog [options] profile.dat...")
+opt_parser.add_option("-o", "--output", dest="output",
+        help="Merged profile file")
+
+def read_profile(path):
+    data = open(path, "rb").read()
+    header = None
+
+    if len(data) >= HEADER.size:
+        fields = HEADER.unpack(data[:HEADER.size])
+        if fields[0] == MAGIC:
+            if fields[1] != VERSION:
+                print("%s: unsupported profile version %d" % (path, fields[1]))
+                sys.exit(-1)
+            header = fields
+            data = data[HEADER.size:]
+
+    counts = array.array("i")
+    if hasattr(counts, "frombytes"):
+        counts.frombytes(data)
+    else:
+        counts.fromstring(data)
+
+    if header and header[5] != len(counts):
+        print("%s: truncated profile" % path)
+        sys.exit(-1)
+
+    return header, counts
+
+if __name__ == "__main__":
+    (options, args) = opt_parser.parse_args()
+
+    if not options.output or not args:
+        opt_parser.print_help()
+        sys.exit(-1)
+
+    header = None
+    merged = None
+
+    for path in args:
+        h, counts = read_profile(path)
+
+        if merged is None:
+            merged = counts
+        elif len(counts) != len(merged):
+            print("%s: %d counts, expected %d" % (path, len(counts),
+                len(merged)))
+            sys.exit(-1)
+        else:
+            for i in range(len(merged)):
+                if counts[i]:
+                    merged[i] = min(merged[i] + counts[i], COUNT_MAX)
+
+        if h:
+            if header and h[2:5] != header[2:5]:
+                print("%s: profile of another memory geometry" % path)
+                sys.exit(-1)
+            header = h
+
+    if not header:
+        print("No input has a header, can not tell memory geometry")
+        sys.exit(-1)
+
+    out = open(options.output, "wb")
+    out.write(HEADER.pack(MAGIC, VERSION, header[2], header[3], header[4],
+        len(merged)))
+    if hasattr(merged, "tobytes"):
+        out.write(merged.tobytes())
+    else:
+        out.write(merged.tostring())
+    out.close()
+
+    print("Merged %d profiles with %d row slots into %s" % (len(args),
+        len(merged), options.output))